@@ -0,0 +1,116 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+// beekeeper-bench: micro-benchmarks for the core utilities and the
+// management paths that run on every refresh. Everything runs on synthetic
+// inputs in a scratch directory, without root or real devices (btrfsls, which
+// asks blkid about the machine it runs on, is the one exception). The
+// sysroot cases run the clauses themselves against a synthetic system root,
+// and the ipc cases call the helper over a private D-Bus daemon.
+//
+// Results are printed as one JSON document, so runs can be saved and
+// compared; a readable summary goes to stderr.
+namespace bench {
+
+// Parameters of a case, e.g. {{"lines", 10000}}
+using params = std::vector<std::pair<std::string, uint64_t>>;
+
+struct result {
+    std::string name;
+    params parameters;
+    uint64_t items = 0;              // per operation, for items_per_second
+    uint64_t iterations = 0;         // operations timed, over all samples
+    double ns_min = 0;               // per operation, over the samples
+    double ns_median = 0;
+    double ns_mean = 0;
+    double ns_max = 0;
+    double ns_p90 = 0;               // latency cases only: one sample per operation
+    double ns_p99 = 0;
+    bool latency = false;
+    uint64_t failures = 0;           // latency cases: operations that reported failure
+    double ops_per_second = 0;       // latency cases run concurrently: overall throughput
+    std::string skipped;             // non-empty: why it did not run
+};
+
+class suite
+{
+public:
+    suite(std::string filter, double min_sample_ms, unsigned samples)
+        : filter(std::move(filter)), min_sample_ms(min_sample_ms), samples(samples) {}
+
+    // Time fn (one operation) over several samples, each repeated until it
+    // lasts at least min_sample_ms. `items` is what one operation processes.
+    void run(const std::string &name, const params &parameters, uint64_t items,
+             const std::function<void()> &fn);
+
+    // Record operations timed one by one, for those too slow or stateful to
+    // repeat in batches (starting bees, ...): percentiles instead of a mean.
+    // wall_ns, when given, is how long all of them took together: with
+    // several in flight at once it yields the throughput.
+    void latencies(const std::string &name, const params &parameters, std::vector<double> ns,
+                   uint64_t failures = 0, double wall_ns = 0);
+
+    void skip(const std::string &name, const params &parameters, const std::string &why);
+
+    // Whether `name` passes --filter, to skip building fixtures for nothing
+    bool wanted(const std::string &name) const;
+
+    std::string json() const;
+
+private:
+    std::string filter;
+    double min_sample_ms;
+    unsigned samples;
+    std::vector<result> results;
+};
+
+// Keep the compiler from optimizing away a result
+template<typename T>
+inline void
+keep(const T &value)
+{
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+// ---- fixtures (fixtures.cpp) ----
+
+// A /proc/mounts of `lines` lines: btrfs subvolumes over a few devices,
+// tmpfs, cgroup, overlay and bind mounts, some with escaped spaces
+std::string proc_mounts(size_t lines, uint32_t seed = 1);
+
+// A random lowercase UUID
+std::string uuid(uint32_t &state);
+
+// Scratch directory removed at exit
+const std::string &scratch_dir();
+
+// ---- system root (sysroot.cpp) ----
+
+struct sysroot_shape {
+    size_t filesystems = 100;
+    size_t mounts = 1000;            // /proc/mounts lines, at least one per filesystem
+    size_t processes = 500;          // /proc/<pid> entries, beesd and bees included
+    unsigned running = 33;           // percent of the filesystems with bees running
+};
+
+// Write a tree to point BEEKEEPER_SYSROOT at: a blkid cache, by-uuid links
+// and /proc/mounts entries for every filesystem, bees running on some of
+// them, their /etc/bees configs and the autostart and compression settings
+bool make_sysroot(const std::string &root, const sysroot_shape &shape);
+
+// ---- cases ----
+void strings(suite &s);
+void management(suite &s);
+void sysroot(suite &s);
+void e2e(suite &s);
+void ipc(suite &s);
+
+// The other end of the ipc cases: masterservice with canned clauses on the
+// private bus at `address`, until terminated (ipc.cpp)
+int ipc_server(const std::string &address);
+
+} // namespace bench
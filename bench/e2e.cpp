@@ -0,0 +1,138 @@
+#include "bench.hpp"
+#include "beekeeper/beesdmgmt.hpp"
+#include "beekeeper/btrfsetup.hpp"
+#include "beekeeper/schedulemgmt.hpp"
+#include "beekeeper/util.hpp"
+
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <unistd.h>
+
+// Where CMake built tests/fakebees, when it did
+#ifndef BEEKEEPER_FAKE_BEES
+#define BEEKEEPER_FAKE_BEES ""
+#endif
+
+namespace {
+
+// fake-bees, unless BEEKEEPER_BEES already names a bees to run
+void
+use_fake_bees()
+{
+    if (std::getenv("BEEKEEPER_BEES"))
+        return;
+
+    std::string path = BEEKEEPER_FAKE_BEES;
+    if (path.empty() || access(path.c_str(), X_OK) != 0) {
+        // Next to beekeeper-bench
+        char self[PATH_MAX];
+        ssize_t len = readlink("/proc/self/exe", self, sizeof(self) - 1);
+        if (len <= 0)
+            return;
+        self[len] = '\0';
+        path = std::string(self);
+        path = path.substr(0, path.rfind('/') + 1) + "fake-bees";
+    }
+    if (access(path.c_str(), X_OK) == 0)
+        setenv("BEEKEEPER_BEES", path.c_str(), 1);
+}
+
+// Time fn over every filesystem, one sample each
+template<typename Fn>
+void
+each(bench::suite &s, const std::string &name, const std::vector<std::string> &uuids, Fn fn)
+{
+    using clock = std::chrono::steady_clock;
+
+    std::vector<double> ns;
+    ns.reserve(uuids.size());
+    uint64_t failures = 0;
+
+    for (const auto &uuid : uuids) {
+        auto t0 = clock::now();
+        bool ok = fn(uuid);
+        ns.push_back(std::chrono::duration<double, std::nano>(clock::now() - t0).count());
+        if (!ok) ++failures;
+    }
+
+    s.latencies(name, { { "filesystems", uuids.size() } }, std::move(ns), failures);
+}
+
+} // anonymous namespace
+
+// Start, restart, stop and autostart bees on every stopped filesystem of
+// the system root, with fake-bees standing in for bees. Each operation is
+// timed on its own: these are the latencies the GUI waits for.
+void
+bench::e2e(suite &s)
+{
+    const char *names[] = { "e2e.start", "e2e.restart", "e2e.stop", "e2e.autostart" };
+
+    bool any = false;
+    for (const char *name : names)
+        any = any || s.wanted(name);
+    if (!any)
+        return;
+
+    auto skip_all = [&](const std::string &why) {
+        for (const char *name : names)
+            s.skip(name, {}, why);
+    };
+
+    // Real bees on real filesystems are not something to start and stop
+    // a hundred times over
+    if (bk_util::system_root().empty()) {
+        skip_all("set BEEKEEPER_SYSROOT to a tree made with --make-sysroot");
+        return;
+    }
+
+    use_fake_bees();
+    if (bk_mgmt::find_bees_binary().empty()) {
+        skip_all("no fake-bees next to beekeeper-bench; set BEEKEEPER_BEES");
+        return;
+    }
+
+    std::vector<std::string> uuids;
+    for (const auto &[uuid, info] : bk_mgmt::btrfsls())
+        if (info.status == "stopped")
+            uuids.push_back(uuid);
+    if (uuids.empty()) {
+        skip_all("no stopped filesystems with a bees config under " + bk_util::system_root());
+        return;
+    }
+
+    each(s, "e2e.start", uuids, [](const std::string &uuid) {
+        return bk_mgmt::beesstart(uuid);
+    });
+    each(s, "e2e.restart", uuids, [](const std::string &uuid) {
+        return bk_mgmt::beesrestart(uuid);
+    });
+    each(s, "e2e.stop", uuids, [](const std::string &uuid) {
+        return bk_mgmt::beesstop(uuid);
+    });
+
+    // What the helper's disk watcher does for a filesystem that shows up
+    // mounted: check it is mounted, wanted and not left to the scheduler,
+    // then start it. The autostart settings are put back afterwards.
+    std::vector<std::string> added;
+    for (const auto &uuid : uuids) {
+        if (!bk_mgmt::autostart::is_enabled_for(uuid)) {
+            bk_mgmt::autostart::add_uuid(uuid);
+            added.push_back(uuid);
+        }
+    }
+
+    each(s, "e2e.autostart", uuids, [](const std::string &uuid) {
+        if (bk_mgmt::get_mount_paths(uuid).empty()
+            || !bk_mgmt::autostart::is_enabled_for(uuid)
+            || bk_mgmt::schedule::is_scheduled(uuid))
+            return false;
+        return bk_mgmt::beesstart(uuid);
+    });
+
+    for (const auto &uuid : uuids)
+        bk_mgmt::beesstop(uuid);
+    for (const auto &uuid : added)
+        bk_mgmt::autostart::remove_uuid(uuid);
+}
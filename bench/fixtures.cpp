@@ -0,0 +1,96 @@
+#include "bench.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+
+namespace {
+
+uint32_t
+next(uint32_t &state)
+{
+    // xorshift32: fixtures only need to be varied and reproducible
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+// Outlives the statics, for the atexit cleanup
+const char *scratch_path = nullptr;
+
+} // anonymous namespace
+
+std::string
+bench::uuid(uint32_t &state)
+{
+    static const char hex[] = "0123456789abcdef";
+    std::string out;
+    out.reserve(36);
+    for (int i = 0; i < 32; ++i) {
+        if (i == 8 || i == 12 || i == 16 || i == 20) out += '-';
+        out += hex[next(state) & 0xf];
+    }
+    return out;
+}
+
+std::string
+bench::proc_mounts(size_t lines, uint32_t seed)
+{
+    uint32_t state = seed ? seed : 1;
+    std::string out;
+    out.reserve(lines * 120);
+
+    static const char *devices[] = { "/dev/nvme0n1p2", "/dev/nvme1n1", "/dev/sda1", "/dev/sdb", "/dev/mapper/luks-home" };
+    static const char *compress[] = { "", ",compress=zstd:3", ",compress=zstd:1", ",compress-force=zstd:6", ",compress=lzo" };
+
+    out += "proc /proc proc rw,nosuid,nodev,noexec,relatime 0 0\n";
+    out += "sysfs /sys sysfs rw,nosuid,nodev,noexec,relatime,seclabel 0 0\n";
+    out += "/dev/nvme0n1p2 / btrfs rw,relatime,seclabel,compress=zstd:1,ssd,discard=async,space_cache=v2,subvolid=256,subvol=/root 0 0\n";
+
+    for (size_t i = 3; i < lines; ++i) {
+        uint32_t kind = next(state) % 100;
+        std::string n = std::to_string(i);
+
+        if (kind < 55) {
+            // btrfs subvolumes: the lines get_mount_paths is after
+            const char *dev = devices[next(state) % 5];
+            bool spaced = next(state) % 10 == 0;
+            out += dev;
+            out += spaced ? " /srv/vol\\040" + n : " /srv/vol" + n;
+            out += " btrfs rw,relatime";
+            out += compress[next(state) % 5];
+            out += ",ssd,space_cache=v2,subvolid=" + std::to_string(256 + i) + ",subvol=/@vol" + n + " 0 0\n";
+        } else if (kind < 70) {
+            out += "tmpfs /run/user/" + n + " tmpfs rw,nosuid,nodev,relatime,size=3256644k,nr_inodes=814161,mode=700,uid=" + n + ",gid=" + n + " 0 0\n";
+        } else if (kind < 85) {
+            out += "overlay /var/lib/containers/storage/overlay/" + uuid(state) + "/merged overlay "
+                   "rw,relatime,lowerdir=/var/lib/containers/l/" + n + ",upperdir=/var/lib/containers/" + n
+                   + "/diff,workdir=/var/lib/containers/" + n + "/work 0 0\n";
+        } else if (kind < 93) {
+            out += "cgroup2 /sys/fs/cgroup/unit" + n + " cgroup2 rw,nosuid,nodev,noexec,relatime,nsdelegate,memory_recursiveprot 0 0\n";
+        } else {
+            out += "/dev/sdb /home/user/bind" + n + " ext4 rw,relatime,errors=remount-ro 0 0\n";
+        }
+    }
+    return out;
+}
+
+const std::string &
+bench::scratch_dir()
+{
+    static const std::string dir = [] {
+        std::string tmpl = (std::filesystem::temp_directory_path() / "beekeeper-bench-XXXXXX").string();
+        if (!mkdtemp(tmpl.data()))
+            return std::string();
+
+        scratch_path = strdup(tmpl.c_str());
+        std::atexit([] {
+            std::error_code ec;
+            std::filesystem::remove_all(scratch_path, ec);
+        });
+        return tmpl;
+    }();
+    return dir;
+}
@@ -0,0 +1,234 @@
+#include "bench.hpp"
+#include "beekeeper/util.hpp"
+#include "../src/polkit/masterservice.hpp"
+
+#include <QCoreApplication>
+#include <QDBusConnection>
+#include <QDBusInterface>
+#include <QDBusPendingCallWatcher>
+#include <QDBusReply>
+#include <QEventLoop>
+#include <QProcess>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <map>
+
+namespace {
+
+const QString service = QStringLiteral("org.beekeeper.dbush");
+const QString object_path = QStringLiteral("/org/beekeeper/dbush");
+
+// Reply sizes: `list --json` of this many filesystems
+const size_t payload_filesystems[] = { 0, 10, 100, 1000 };
+const unsigned concurrency_levels[] = { 1, 4, 16, 64 };
+
+// Built before the service starts, read-only afterwards
+std::map<size_t, std::string> payloads;
+
+std::string
+list_payload(size_t filesystems)
+{
+    uint32_t state = 23;
+    fs_map out;
+    for (size_t i = 0; i < filesystems; ++i) {
+        char devname[32];
+        std::snprintf(devname, sizeof(devname), "/dev/bkfs%05zu", i);
+        const std::string uuid = bench::uuid(state);
+        out[uuid] = fs_info { "Volume " + std::to_string(i), i % 3 == 0 ? "running" : "stopped", devname,
+                              "/etc/bees/" + uuid + ".conf", i % 4 == 0, i % 2 == 0 };
+    }
+    return bk_util::fs_map_to_json(out);
+}
+
+// Canned `list`: what the real one prints, without looking at the system
+command_streams
+canned_list(const clause_options &options, const clause_subjects &)
+{
+    auto it = options.find("filesystems");
+    auto payload = payloads.find(it == options.end() ? 0 : std::strtoul(it->second.c_str(), nullptr, 10));
+    if (payload == payloads.end())
+        return { "", "no payload of that size", 1 };
+    return { payload->second, "", 0 };
+}
+
+struct call_results {
+    std::vector<double> ns;
+    uint64_t failures = 0;
+    size_t bytes = 0;
+    double wall_ns = 0;
+};
+
+// `calls` execute_clause round trips with `concurrency` of them in flight,
+// each decoded the way the GUI does: the reply map into command_streams
+// (root_shell_thread::call_bk_future), stdout into an fs_map
+// (supercommander::btrfsls)
+call_results
+round_trips(QDBusInterface &iface, size_t filesystems, unsigned concurrency, size_t calls)
+{
+    using clock = std::chrono::steady_clock;
+
+    call_results out;
+    out.ns.reserve(calls);
+
+    const QVariantMap options { { "json", "<default>" }, { "filesystems", QString::number(filesystems) } };
+
+    QEventLoop loop;
+    size_t issued = 0;
+    size_t done = 0;
+
+    std::function<void()> issue = [&] {
+        ++issued;
+        const auto t0 = clock::now();
+        QDBusPendingCall call = iface.asyncCall("execute_clause", QStringLiteral("list"), options, QStringList {});
+        auto *watcher = new QDBusPendingCallWatcher(call);
+
+        QObject::connect(watcher, &QDBusPendingCallWatcher::finished, watcher, [&, t0, watcher] {
+            watcher->deleteLater();
+
+            bool ok = false;
+            QDBusReply<QVariantMap> reply = *watcher;
+            if (reply.isValid()) {
+                QVariantMap m = reply.value();
+
+                command_streams result;
+                result.stdout_str = m.value("stdout_str").toString().toStdString();
+                result.stderr_str = m.value("stderr_str").toString().toStdString();
+                result.errcode = m.value("errcode").toInt();
+
+                fs_map decoded = bk_util::fs_map_from_json(result.stdout_str);
+                ok = result.errcode == 0 && decoded.size() == filesystems;
+                out.bytes = result.stdout_str.size();
+            }
+
+            out.ns.push_back(std::chrono::duration<double, std::nano>(clock::now() - t0).count());
+            if (!ok) ++out.failures;
+
+            if (++done == calls)
+                loop.quit();
+            else if (issued < calls)
+                issue();
+        });
+    };
+
+    const auto start = clock::now();
+    for (unsigned i = 0; i < concurrency && issued < calls; ++i)
+        issue();
+    if (done < calls)
+        loop.exec();
+    out.wall_ns = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+    return out;
+}
+
+// Enough calls for a p99, fewer where each one moves a lot of JSON
+size_t
+calls_for(size_t filesystems)
+{
+    return filesystems >= 1000 ? 300 : filesystems >= 100 ? 1000 : 2000;
+}
+
+} // anonymous namespace
+
+int
+bench::ipc_server(const std::string &address)
+{
+    for (size_t filesystems : payload_filesystems)
+        payloads[filesystems] = list_payload(filesystems);
+
+    static const clause_registry canned = {
+        { "list", clause { canned_list, { { "json", "j", false }, { "filesystems", "", true } },
+                           "", "Canned filesystem list", 0, 0, true } }
+    };
+
+    QDBusConnection bus = QDBusConnection::connectToBus(QString::fromStdString(address), "thebeekeeper");
+    if (!bus.isConnected()) {
+        std::cerr << "beekeeper-bench: cannot connect to " << address << '\n';
+        return 1;
+    }
+    if (!bus.registerService(service)) {
+        std::cerr << "beekeeper-bench: cannot claim " << service.toStdString() << '\n';
+        return 2;
+    }
+
+    masterservice helper(canned);
+    if (!bus.registerObject(object_path, &helper,
+                            QDBusConnection::ExportAllSlots | QDBusConnection::ExportAllSignals)) {
+        std::cerr << "beekeeper-bench: cannot register " << object_path.toStdString() << '\n';
+        return 1;
+    }
+
+    // The client waits for this line
+    std::cout << "ready" << std::endl;
+    return QCoreApplication::exec();
+}
+
+// The GUI -> helper path end to end: a private dbus-daemon, masterservice
+// in its own process (this binary, with --ipc-server) serving canned
+// clauses, and QDBusInterface async calls from here
+void
+bench::ipc(suite &s)
+{
+    const std::string name = "ipc.execute_clause";
+    if (!s.wanted(name))
+        return;
+
+    const std::string daemon = bk_util::which("dbus-daemon");
+    if (daemon.empty()) {
+        s.skip(name, {}, "dbus-daemon not found");
+        return;
+    }
+
+    QProcess bus;
+    QProcess server;
+
+    // Also on the way out of a skip, so neither outlives its QProcess
+    auto shut_down = [&] {
+        for (QProcess *p : { &server, &bus }) {
+            if (p->state() == QProcess::NotRunning) continue;
+            p->terminate();
+            if (!p->waitForFinished(5000)) p->kill();
+        }
+    };
+
+    bus.start(QString::fromStdString(daemon), { "--session", "--nofork", "--print-address" });
+    if (!bus.waitForStarted() || !bus.waitForReadyRead(5000)) {
+        s.skip(name, {}, "cannot start a private dbus-daemon");
+        shut_down();
+        return;
+    }
+    const QString address = QString::fromUtf8(bus.readLine()).trimmed();
+
+    server.setProcessChannelMode(QProcess::ForwardedErrorChannel);
+    server.start(QCoreApplication::applicationFilePath(), { "--ipc-server", address });
+    if (!server.waitForReadyRead(5000) || !server.readLine().startsWith("ready")) {
+        s.skip(name, {}, "masterservice did not come up on the private bus");
+        shut_down();
+        return;
+    }
+
+    {
+        QDBusConnection conn = QDBusConnection::connectToBus(address, "beekeeper-bench");
+        QDBusInterface iface(service, object_path, service, conn);
+        if (!iface.isValid()) {
+            s.skip(name, {}, "cannot reach " + service.toStdString() + " on the private bus");
+        } else {
+            // Connection setup and the first thread pool spin-ups out of the way
+            round_trips(iface, 10, 16, 200);
+
+            for (size_t filesystems : payload_filesystems) {
+                for (unsigned concurrency : concurrency_levels) {
+                    call_results r = round_trips(iface, filesystems, concurrency, calls_for(filesystems));
+                    s.latencies(name,
+                                { { "filesystems", filesystems }, { "bytes", r.bytes }, { "concurrency", concurrency } },
+                                std::move(r.ns), r.failures, r.wall_ns);
+                }
+            }
+        }
+    }
+    QDBusConnection::disconnectFromBus("beekeeper-bench");
+
+    shut_down();
+}
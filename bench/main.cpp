@@ -0,0 +1,298 @@
+#include "bench.hpp"
+#include "beekeeper/util.hpp"
+
+#include <QCoreApplication>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <sys/utsname.h>
+#include <thread>
+
+#ifndef BEEKEEPER_BENCH_VERSION
+#define BEEKEEPER_BENCH_VERSION "unknown"
+#endif
+
+namespace {
+
+std::string
+format_params(const bench::params &parameters)
+{
+    std::string out;
+    for (const auto &[key, value] : parameters) {
+        if (!out.empty()) out += ' ';
+        out += key + '=' + std::to_string(value);
+    }
+    return out;
+}
+
+std::string
+format_ns(double ns)
+{
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(ns < 10 ? 2 : ns < 1000 ? 1 : 0);
+    if (ns < 1e3)       out << ns << " ns";
+    else if (ns < 1e6)  out << ns / 1e3 << " us";
+    else if (ns < 1e9)  out << ns / 1e6 << " ms";
+    else                out << ns / 1e9 << " s";
+    return out.str();
+}
+
+} // anonymous namespace
+
+bool
+bench::suite::wanted(const std::string &name) const
+{
+    return filter.empty() || name.find(filter) != std::string::npos;
+}
+
+void
+bench::suite::run(const std::string &name, const params &parameters, uint64_t items,
+                  const std::function<void()> &fn)
+{
+    if (!wanted(name))
+        return;
+
+    using clock = std::chrono::steady_clock;
+
+    // Warm up, and find how many operations fill a sample
+    uint64_t batch = 1;
+    for (;;) {
+        auto t0 = clock::now();
+        for (uint64_t i = 0; i < batch; ++i) fn();
+        double ms = std::chrono::duration<double, std::milli>(clock::now() - t0).count();
+        if (ms >= min_sample_ms || batch >= (1ull << 30))
+            break;
+        batch = ms <= 0 ? batch * 10
+                        : std::max(batch + 1, static_cast<uint64_t>(batch * (min_sample_ms * 1.2 / ms)));
+    }
+
+    std::vector<double> per_op;
+    per_op.reserve(samples);
+    for (unsigned s = 0; s < samples; ++s) {
+        auto t0 = clock::now();
+        for (uint64_t i = 0; i < batch; ++i) fn();
+        double ns = std::chrono::duration<double, std::nano>(clock::now() - t0).count();
+        per_op.push_back(ns / batch);
+    }
+    std::sort(per_op.begin(), per_op.end());
+
+    result r;
+    r.name = name;
+    r.parameters = parameters;
+    r.items = items;
+    r.iterations = batch * samples;
+    r.ns_min = per_op.front();
+    r.ns_max = per_op.back();
+    r.ns_median = per_op[per_op.size() / 2];
+    for (double v : per_op) r.ns_mean += v;
+    r.ns_mean /= per_op.size();
+    results.push_back(r);
+
+    std::cerr << std::left << std::setw(42) << name << std::setw(22) << format_params(parameters)
+              << std::right << std::setw(12) << format_ns(r.ns_median) << "/op";
+    if (items > 1)
+        std::cerr << std::setw(12) << format_ns(r.ns_median / items) << "/item";
+    std::cerr << '\n';
+}
+
+void
+bench::suite::latencies(const std::string &name, const params &parameters, std::vector<double> ns,
+                        uint64_t failures, double wall_ns)
+{
+    if (!wanted(name) || ns.empty())
+        return;
+
+    std::sort(ns.begin(), ns.end());
+    auto percentile = [&](double p) {
+        size_t rank = static_cast<size_t>(p * ns.size() + 0.999999);
+        return ns[std::clamp<size_t>(rank, 1, ns.size()) - 1];
+    };
+
+    result r;
+    r.name = name;
+    r.parameters = parameters;
+    r.items = 1;
+    r.iterations = ns.size();
+    r.latency = true;
+    r.failures = failures;
+    r.ns_min = ns.front();
+    r.ns_max = ns.back();
+    r.ns_median = percentile(0.5);
+    r.ns_p90 = percentile(0.9);
+    r.ns_p99 = percentile(0.99);
+    for (double v : ns) r.ns_mean += v;
+    r.ns_mean /= ns.size();
+    if (wall_ns > 0)
+        r.ops_per_second = ns.size() * 1e9 / wall_ns;
+    results.push_back(r);
+
+    std::cerr << std::left << std::setw(42) << name << std::setw(22) << format_params(parameters)
+              << std::right << std::setw(12) << format_ns(r.ns_median) << " p50"
+              << std::setw(12) << format_ns(r.ns_p99) << " p99"
+              << std::setw(12) << format_ns(r.ns_max) << " max";
+    if (r.ops_per_second > 0)
+        std::cerr << std::setw(10) << static_cast<uint64_t>(r.ops_per_second) << "/s";
+    if (failures)
+        std::cerr << "  (" << failures << " failed)";
+    std::cerr << '\n';
+}
+
+void
+bench::suite::skip(const std::string &name, const params &parameters, const std::string &why)
+{
+    if (!wanted(name))
+        return;
+
+    result r;
+    r.name = name;
+    r.parameters = parameters;
+    r.skipped = why;
+    results.push_back(r);
+
+    std::cerr << std::left << std::setw(42) << name << std::setw(22) << format_params(parameters)
+              << "skipped: " << why << '\n';
+}
+
+std::string
+bench::suite::json() const
+{
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1);
+
+    struct utsname uts{};
+    uname(&uts);
+
+    out << "{\"suite\":\"beekeeper-bench\",\"version\":\"" << BEEKEEPER_BENCH_VERSION << "\""
+        << ",\"timestamp\":" << std::chrono::duration_cast<std::chrono::seconds>(
+               std::chrono::system_clock::now().time_since_epoch()).count()
+        << ",\"host\":{\"kernel\":\"" << bk_util::json_escape(uts.release) << "\""
+        << ",\"machine\":\"" << bk_util::json_escape(uts.machine) << "\""
+        << ",\"cpus\":" << std::thread::hardware_concurrency() << "}"
+        << ",\"min_sample_ms\":" << min_sample_ms << ",\"samples\":" << samples
+        << ",\"results\":[";
+
+    bool first = true;
+    for (const auto &r : results) {
+        if (!first) out << ',';
+        first = false;
+
+        out << "{\"name\":\"" << bk_util::json_escape(r.name) << "\",\"params\":{";
+        for (size_t i = 0; i < r.parameters.size(); ++i) {
+            if (i) out << ',';
+            out << '"' << bk_util::json_escape(r.parameters[i].first) << "\":" << r.parameters[i].second;
+        }
+        out << '}';
+
+        if (!r.skipped.empty()) {
+            out << ",\"skipped\":\"" << bk_util::json_escape(r.skipped) << "\"}";
+            continue;
+        }
+
+        out << ",\"iterations\":" << r.iterations
+            << ",\"ns_per_op\":{\"min\":" << r.ns_min << ",\"median\":" << r.ns_median
+            << ",\"mean\":" << r.ns_mean << ",\"max\":" << r.ns_max << '}';
+        if (r.latency) {
+            out << ",\"latency_ns\":{\"p50\":" << r.ns_median << ",\"p90\":" << r.ns_p90
+                << ",\"p99\":" << r.ns_p99 << ",\"max\":" << r.ns_max << "},\"failures\":" << r.failures;
+            if (r.ops_per_second > 0)
+                out << ",\"ops_per_second\":" << r.ops_per_second;
+            out << '}';
+            continue;
+        }
+        if (r.items > 0)
+            out << ",\"items\":" << r.items
+                << ",\"items_per_second\":" << (r.ns_median > 0 ? r.items * 1e9 / r.ns_median : 0);
+        out << '}';
+    }
+    out << "]}";
+    return out.str();
+}
+
+int
+main(int argc, char **argv)
+{
+    // The ipc cases talk D-Bus, which wants an application object
+    QCoreApplication app(argc, argv);
+
+    std::string filter;
+    std::string output;
+    double min_sample_ms = 20;
+    unsigned samples = 7;
+    std::string sysroot_dir;
+    bench::sysroot_shape shape;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                std::cerr << "beekeeper-bench: " << arg << " needs a value\n";
+                std::exit(2);
+            }
+            return argv[++i];
+        };
+
+        if (arg == "--filter" || arg == "-f")           filter = value();
+        else if (arg == "--output" || arg == "-o")      output = value();
+        else if (arg == "--min-time" || arg == "-t")    {
+            try { min_sample_ms = std::max(1.0, bk_util::to_double(value())); }
+            catch (...) { min_sample_ms = 1.0; }
+        }
+        else if (arg == "--samples" || arg == "-s")     samples = std::max(1, std::atoi(value().c_str()));
+        else if (arg == "--make-sysroot")               sysroot_dir = value();
+        else if (arg == "--filesystems")                shape.filesystems = std::strtoul(value().c_str(), nullptr, 10);
+        else if (arg == "--mounts")                     shape.mounts = std::strtoul(value().c_str(), nullptr, 10);
+        else if (arg == "--processes")                  shape.processes = std::strtoul(value().c_str(), nullptr, 10);
+        else if (arg == "--running")                    shape.running = std::strtoul(value().c_str(), nullptr, 10);
+        else if (arg == "--ipc-server")                 return bench::ipc_server(value());
+        else {
+            std::cerr << "usage: beekeeper-bench [--filter SUBSTRING] [--min-time MS] [--samples N] [--output FILE]\n"
+                      << "       beekeeper-bench --make-sysroot DIR [--filesystems N] [--mounts N] [--processes N]\n"
+                      << "                       [--running PERCENT]\n"
+                      << "Runs the micro-benchmarks whose name contains SUBSTRING and prints the\n"
+                      << "results as JSON (to FILE, or stdout). Each case is timed over N samples\n"
+                      << "of at least MS milliseconds each (default: 7 of 20 ms).\n"
+                      << "--make-sysroot writes a synthetic system root to DIR (default: 100\n"
+                      << "filesystems, 1000 mounts, 500 processes, bees running on 33%); run\n"
+                      << "again with BEEKEEPER_SYSROOT=DIR to time list, status and compressctl\n"
+                      << "against it, and to start and stop fake-bees on its stopped filesystems.\n"
+                      << "The ipc cases start a private dbus-daemon and call the helper's\n"
+                      << "execute_clause over it (--ipc-server is that helper; not for direct use).\n";
+            return arg == "--help" || arg == "-h" ? 0 : 2;
+        }
+    }
+
+    if (!sysroot_dir.empty()) {
+        if (!bench::make_sysroot(sysroot_dir, shape)) {
+            std::cerr << "beekeeper-bench: cannot write a system root to " << sysroot_dir << '\n';
+            return 1;
+        }
+        std::cerr << "beekeeper-bench: wrote " << shape.filesystems << " filesystems to " << sysroot_dir << '\n';
+        return 0;
+    }
+
+    bench::suite s(filter, min_sample_ms, samples);
+    bench::strings(s);
+    bench::management(s);
+    bench::sysroot(s);
+    bench::e2e(s);
+    bench::ipc(s);
+
+    std::string json = s.json();
+    if (output.empty()) {
+        std::cout << json << std::endl;
+        return 0;
+    }
+
+    std::ofstream out(output, std::ios::trunc);
+    if (!out) {
+        std::cerr << "beekeeper-bench: cannot write " << output << ": " << std::strerror(errno) << '\n';
+        return 1;
+    }
+    out << json << '\n';
+    return 0;
+}
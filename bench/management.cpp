@@ -0,0 +1,151 @@
+#include "bench.hpp"
+#include "beekeeper/beesdmgmt.hpp"
+#include "beekeeper/btrfsetup.hpp"
+#include "beekeeper/timingsmgmt.hpp"
+#include "beekeeper/util.hpp"
+
+#include <filesystem>
+#include <fstream>
+
+namespace {
+
+// A fs_map of `count` filesystems, as btrfsls would return them
+fs_map
+filesystems(size_t count, uint32_t &state)
+{
+    fs_map out;
+    out.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        std::string uuid = bench::uuid(state);
+        out.emplace(uuid, fs_info {
+            "Volume \"" + std::to_string(i) + "\"",
+            (i % 3 == 0) ? "running" : "stopped",
+            "/dev/sd" + std::string(1, static_cast<char>('a' + i % 26)) + std::to_string(i / 26),
+            "/etc/bees/" + uuid + ".conf",
+            i % 4 == 0,
+            i % 2 == 0
+        });
+    }
+    return out;
+}
+
+} // anonymous namespace
+
+// configfile operations, btrfstat over many configs, btrfsls and the
+// fs_map work the GUI does on every refresh
+void
+bench::management(suite &s)
+{
+    namespace fs = std::filesystem;
+    namespace configfile = bk_mgmt::configfile;
+    uint32_t state = 7;
+
+    // ---- configfile: "<uuid> <algorithm> <level>" lines ----
+    for (size_t entries : { 100, 1000 }) {
+        const params p = { { "entries", entries } };
+        const std::string path = scratch_dir() + "/config-" + std::to_string(entries) + ".cfg";
+
+        std::vector<std::string> uuids;
+        {
+            std::ofstream out(path, std::ios::trunc);
+            for (size_t i = 0; i < entries; ++i) {
+                uuids.push_back(uuid(state));
+                out << uuids.back() << " zstd " << (i % 15 + 1) << '\n';
+            }
+        }
+        const std::string &last = uuids.back();
+
+        s.run("configfile.list_uuids", p, entries, [&] {
+            keep(configfile::list_uuids(path));
+        });
+        s.run("configfile.fetch", p, entries, [&] {
+            keep(configfile::fetch(path, last, /*case_insensitive=*/true, 1));
+        });
+        s.run("configfile.is_present.missing", p, entries, [&] {
+            keep(configfile::is_present(path, "00000000-0000-0000-0000-000000000000"));
+        });
+        // Both rewrite the file; together they leave it as it was
+        s.run("configfile.remove_uuid+add", p, entries, [&] {
+            configfile::remove_uuid(path, last);
+            configfile::add(path, last, std::string("zstd"), std::string("3"));
+        });
+    }
+
+    // ---- btrfstat: one bees .conf per filesystem ----
+    for (size_t configs : { 10, 100, 1000 }) {
+        const params p = { { "configs", configs } };
+        if (!s.wanted("btrfstat"))
+            break;
+
+        const std::string dir = scratch_dir() + "/bees-" + std::to_string(configs);
+        fs::create_directories(dir);
+
+        std::string last;
+        for (size_t i = 0; i < configs; ++i) {
+            last = uuid(state);
+            std::ofstream(dir + "/" + last + ".conf")
+                << "# bees configuration\nUUID=" << last << "\nDB_SIZE=" << (1u << 30) << "\n";
+        }
+
+        s.run("btrfstat.found", p, configs, [&] {
+            keep(bk_mgmt::btrfstat(last, dir));
+        });
+        s.run("btrfstat.missing", p, configs, [&] {
+            keep(bk_mgmt::btrfstat("00000000-0000-0000-0000-000000000000", dir));
+        });
+    }
+
+    // ---- btrfsls on this machine ----
+    if (s.wanted("btrfsls")) {
+        fs_map found = bk_mgmt::btrfsls();
+        if (found.empty())
+            s.skip("btrfsls", {}, "no btrfs filesystems visible to blkid");
+        else
+            s.run("btrfsls", { { "filesystems", found.size() } }, found.size(), [] {
+                keep(bk_mgmt::btrfsls());
+            });
+    }
+
+    // ---- fs_map: refresh diff and the JSON round trip through `list` ----
+    for (size_t count : { 10, 100, 1000 }) {
+        const params p = { { "filesystems", count } };
+
+        const fs_map snapshot = filesystems(count, state);
+
+        // One in ten changed status, a few removed, as many new ones
+        fs_map fresh = snapshot;
+        size_t i = 0;
+        for (auto it = fresh.begin(); it != fresh.end(); ++i) {
+            if (i % 10 == 0) it->second.status = "running";
+            if (i % 20 == 5) { it = fresh.erase(it); continue; }
+            ++it;
+        }
+        fs_map added = filesystems(count / 20, state);
+        fresh.insert(added.begin(), added.end());
+
+        s.run("fs_map.difference", p, count, [&] {
+            keep(bk_util::difference_between_two_fs_maps(snapshot, fresh));
+        });
+
+        const std::string json = bk_util::fs_map_to_json(snapshot);
+        s.run("fs_map.to_json", p, count, [&] {
+            keep(bk_util::fs_map_to_json(snapshot));
+        });
+        s.run("fs_map.from_json", p, count, [&] {
+            keep(bk_util::fs_map_from_json(json));
+        });
+    }
+
+    // What every timed path pays: one scoped timer, and the snapshot the
+    // metrics clause merges from all threads
+    {
+        namespace timings = bk_mgmt::timings;
+
+        s.run("timings.scoped_timer", {}, 1, [] {
+            timings::scoped_timer timer(timings::family::command, "btrfs");
+        });
+        s.run("timings.snapshot", {}, 1, [] {
+            keep(timings::snapshot());
+        });
+    }
+}
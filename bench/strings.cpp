@@ -0,0 +1,66 @@
+#include "bench.hpp"
+#include "beekeeper/util.hpp"
+
+#include <fstream>
+
+// tokenize, line splitting and line matching over /proc/mounts-shaped input
+void
+bench::strings(suite &s)
+{
+    for (size_t lines : { 1000, 10000, 50000 }) {
+        const params p = { { "lines", lines } };
+
+        bool any = false;
+        for (const char *name : { "tokenize", "text_buffer.tokenize", "read_lines_from_file",
+                                  "text_buffer.lines", "find_lines_matching_substring_in_vector",
+                                  "line_matcher.matching_lines" })
+            any = any || s.wanted(name);
+        if (!any)
+            continue;
+
+        const std::string mounts = proc_mounts(lines);
+        const std::string path = scratch_dir() + "/mounts-" + std::to_string(lines);
+        std::ofstream(path, std::ios::trunc) << mounts;
+
+        const std::vector<std::string> mount_lines = bk_util::read_lines_from_file(path);
+
+        s.run("tokenize", p, lines, [&] {
+            for (const auto &line : mount_lines)
+                keep(bk_util::tokenize(line, ' '));
+        });
+
+        bk_util::text_buffer buffer(mounts);
+        s.run("text_buffer.tokenize", p, lines, [&] {
+            for (std::string_view line : buffer.lines())
+                keep(buffer.tokenize(line, ' '));
+            buffer.clear_tokens();
+        });
+
+        s.run("read_lines_from_file", p, lines, [&] {
+            keep(bk_util::read_lines_from_file(path));
+        });
+
+        s.run("text_buffer.lines", p, lines, [&] {
+            bk_util::text_buffer file;
+            file.load(path);
+            keep(file.lines());
+        });
+
+        // The lookups get_mount_paths and the compression checks do
+        for (bool case_insensitive : { false, true }) {
+            const params pc = { { "lines", lines }, { "case_insensitive", case_insensitive } };
+            const std::vector<std::string> needles = case_insensitive
+                ? std::vector<std::string>{ "/DEV/SDB" }
+                : std::vector<std::string>{ "compress-force=zstd:6" };
+
+            s.run("find_lines_matching_substring_in_vector", pc, lines, [&] {
+                keep(bk_util::find_lines_matching_substring_in_vector(mount_lines, needles, case_insensitive));
+            });
+
+            const bk_util::line_matcher matcher(needles, case_insensitive);
+            s.run("line_matcher.matching_lines", pc, lines, [&] {
+                keep(matcher.matching_lines(mounts));
+            });
+        }
+    }
+}
@@ -0,0 +1,200 @@
+#include "bench.hpp"
+#include "beekeeper/btrfsetup.hpp"
+#include "beekeeper/util.hpp"
+#include "../src/core/clauses/bk-clauses.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+namespace fs = std::filesystem;
+
+// Fixed width, so no device name is a prefix of another: the mount lookups
+// match device names as substrings
+std::string
+device_name(size_t i)
+{
+    char name[16];
+    std::snprintf(name, sizeof(name), "bkfs%05zu", i);
+    return name;
+}
+
+std::string
+devno(size_t i)
+{
+    char out[16];
+    std::snprintf(out, sizeof(out), "0x%04zx", 0x800 + i);
+    return out;
+}
+
+bool
+write_file(const fs::path &path, const std::string &content)
+{
+    std::error_code ec;
+    fs::create_directories(path.parent_path(), ec);
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out << content;
+    return static_cast<bool>(out);
+}
+
+} // anonymous namespace
+
+bool
+bench::make_sysroot(const std::string &root, const sysroot_shape &shape)
+{
+    std::error_code ec;
+    const fs::path base = fs::absolute(root).lexically_normal();
+    uint32_t state = 11;
+
+    // Where bees would mount each filesystem once the tree is the root; the
+    // kernel reports those mounts, and the bees command lines, with it in front
+    const std::string bees_mnt = (base / "run/bees/mnt").string();
+
+    std::vector<std::string> uuids;
+    for (size_t i = 0; i < shape.filesystems; ++i)
+        uuids.push_back(uuid(state));
+
+    // shape.running percent of the filesystems, spread evenly, have bees
+    // running on them; every fourth transparent compression, every other
+    // one autostart, and all but every fifth a bees config
+    const size_t percent = std::min(shape.running, 100u);
+    auto running = [&](size_t i) { return i * percent / 100 != (i + 1) * percent / 100; };
+
+    // ---- /dev and /dev/disk/by-uuid ----
+    const fs::path by_uuid = base / "dev/disk/by-uuid";
+    fs::create_directories(by_uuid, ec);
+    for (size_t i = 0; i < uuids.size(); ++i) {
+        const std::string dev = device_name(i);
+        if (!write_file(base / "dev" / dev, ""))
+            return false;
+        fs::remove(by_uuid / uuids[i], ec);
+        fs::create_symlink("../../" + dev, by_uuid / uuids[i], ec);
+        if (ec) {
+            std::cerr << "beekeeper-bench: " << (by_uuid / uuids[i]).string() << ": " << ec.message() << '\n';
+            return false;
+        }
+    }
+
+    // ---- /run/blkid/blkid.tab, the cache btrfsls reads under a root ----
+    std::string tab;
+    for (size_t i = 0; i < uuids.size(); ++i)
+        tab += "<device DEVNO=\"" + devno(i) + "\" TIME=\"1700000000.0\" LABEL=\"Volume "
+               + std::to_string(i) + "\" UUID=\"" + uuids[i] + "\" BLOCK_SIZE=\"4096\" TYPE=\"btrfs\">/dev/"
+               + device_name(i) + "</device>\n";
+    if (!write_file(base / "run/blkid/blkid.tab", tab))
+        return false;
+
+    // ---- /proc/mounts: each filesystem at its mountpoint, bees' private
+    // mounts of the running ones, then unrelated mounts up to shape.mounts ----
+    std::string mounts;
+    size_t lines = 0;
+    for (size_t i = 0; i < uuids.size(); ++i) {
+        const std::string options = (i % 4 == 0) ? "rw,relatime,compress=zstd:3,ssd,space_cache=v2"
+                                                 : "rw,relatime,ssd,space_cache=v2";
+        mounts += "/dev/" + device_name(i) + " /mnt/fs" + std::to_string(i) + " btrfs " + options
+                  + ",subvolid=5,subvol=/ 0 0\n";
+        ++lines;
+        if (running(i)) {
+            mounts += "/dev/" + device_name(i) + " " + bees_mnt + "/" + uuids[i]
+                      + " btrfs " + options + ",subvolid=5,subvol=/ 0 0\n";
+            ++lines;
+        }
+    }
+    if (shape.mounts > lines)
+        mounts += proc_mounts(shape.mounts - lines, 3);
+    if (!write_file(base / "proc/mounts", mounts))
+        return false;
+
+    // ---- /proc/<pid>/cmdline: beesd and its worker for the running
+    // filesystems, then unrelated processes up to shape.processes ----
+    using namespace std::string_literals;
+    static const std::string others[] = { "/usr/lib/systemd/systemd-journald"s, "/usr/bin/bash\0--login"s,
+                                          "/usr/bin/python3\0-m\0http.server"s,
+                                          "/usr/lib/firefox/firefox\0-contentproc"s, "/usr/sbin/sshd\0-D"s };
+    unsigned long pid = 3000000;
+    size_t processes = 0;
+    auto add_process = [&](const std::string &cmdline) {
+        ++processes;
+        return write_file(base / "proc" / std::to_string(pid++) / "cmdline", cmdline);
+    };
+    for (size_t i = 0; i < uuids.size(); ++i) {
+        if (!running(i))
+            continue;
+        if (!add_process("/bin/bash\0/usr/sbin/beesd\0--no-timestamps\0"s + uuids[i] + '\0')
+            || !add_process("/usr/lib/bees/bees\0--thread-count\0"s + "4\0"s
+                            + bees_mnt + "/" + uuids[i] + '\0'))
+            return false;
+    }
+    for (size_t i = 0; processes < shape.processes; ++i)
+        if (!add_process(others[i % 5] + '\0'))
+            return false;
+
+    // ---- /etc/bees: a .conf per configured filesystem and the settings
+    // files autostartctl and compressctl keep ----
+    std::string autostart;
+    std::string compression;
+    for (size_t i = 0; i < uuids.size(); ++i) {
+        if (i % 5 != 4
+            && !write_file(base / "etc/bees" / (uuids[i] + ".conf"),
+                           "# bees configuration\nUUID=" + uuids[i] + "\nDB_SIZE=" + std::to_string(1u << 30) + "\n"))
+            return false;
+        if (i % 2 == 0) autostart += uuids[i] + '\n';
+        if (i % 4 == 0) compression += uuids[i] + " zstd 3\n";
+    }
+    if (!write_file(base / "etc/bees/autostartsettings.cfg", autostart)
+        || !write_file(base / "etc/bees/transparentcompressionsettings.cfg", compression))
+        return false;
+
+    fs::create_directories(base / "run/bees", ec);
+    fs::create_directories(base / "var/log/beesd", ec);
+    return true;
+}
+
+// list, status and compressctl against the tree BEEKEEPER_SYSROOT points at
+void
+bench::sysroot(suite &s)
+{
+    namespace clauses = beekeeper::clauses;
+
+    const char *names[] = { "sysroot.list", "sysroot.status", "sysroot.compressctl.status" };
+
+    if (bk_util::system_root().empty()) {
+        for (const char *name : names)
+            s.skip(name, {}, "set BEEKEEPER_SYSROOT to a tree made with --make-sysroot");
+        return;
+    }
+
+    bool any = false;
+    for (const char *name : names)
+        any = any || s.wanted(name);
+    if (!any)
+        return;
+
+    const fs_map filesystems = bk_mgmt::btrfsls();
+    if (filesystems.empty()) {
+        for (const char *name : names)
+            s.skip(name, {}, "no filesystems in " + bk_util::system_root() + "/run/blkid/blkid.tab");
+        return;
+    }
+
+    clause_subjects uuids;
+    for (const auto &[uuid, info] : filesystems)
+        uuids.push_back(uuid);
+
+    const params p = { { "filesystems", uuids.size() } };
+    const clause_options json = { { "json", "" } };
+
+    s.run("sysroot.list", p, uuids.size(), [&] {
+        keep(clauses::list(json, {}));
+    });
+    s.run("sysroot.status", p, uuids.size(), [&] {
+        keep(clauses::status(json, uuids));
+    });
+    s.run("sysroot.compressctl.status", p, uuids.size(), [&] {
+        keep(clauses::compressctl({ { "status", "" }, { "json", "" } }, uuids));
+    });
+}
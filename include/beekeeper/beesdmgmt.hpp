@@ -133,6 +133,8 @@ namespace beekeeper {
                 bk_util::make_file_world_readable(config_file);
             }
             void remove_line_matching_substring(const std::string &config_file, const std::string &s);
+            // Remove every line whose first token is this UUID (case-insensitive)
+            void remove_uuid(const std::string &config_file, const std::string &uuid);
             
         }
 
@@ -142,30 +144,72 @@ namespace beekeeper {
             // generic configfile APIs. This keeps callers unchanged while centralizing logic.
             inline std::vector<std::string> list_uuids()
             {
-                return configfile::list_uuids(autostart_config_file);
+                return configfile::list_uuids(bk_util::system_path(autostart_config_file));
             }
 
             inline bool is_enabled_for(const std::string &uuid)
             {
-                return configfile::is_present(autostart_config_file, uuid);
+                return configfile::is_present(bk_util::system_path(autostart_config_file), uuid);
             }
 
             inline void add_uuid(const std::string &uuid)
             {
-                configfile::add(autostart_config_file, uuid);
+                configfile::add(bk_util::system_path(autostart_config_file), uuid);
             }
 
             inline void remove_uuid(const std::string &uuid)
             {
-                configfile::remove_line_matching_substring(autostart_config_file, uuid);
+                configfile::remove_line_matching_substring(bk_util::system_path(autostart_config_file), uuid);
             }
 
         }
 
 
-        // Start beesd daemon for specified UUID
+        // Native bees launcher: what the beesd script does, in-process -----
+
+        // Private mount of the top level subvolume bees works on (/run/bees/mnt/<uuid>)
+        std::string
+        bees_mount_dir (const std::string &uuid);
+
+        // BEESSTATUS file bees rewrites with its progress
+        std::string
+        bees_status_path (const std::string &uuid);
+
+        // The bees binary beesd would run, "" if not installed.
+        // $BEEKEEPER_BEES, when set, is used instead (e.g. tests/fakebees)
+        // in builds with tests or benchmarks.
+        std::string
+        find_bees_binary ();
+
+        // The beesd script, or $BEEKEEPER_BEESD when set; "" if not found
+        std::string
+        find_beesd_binary ();
+
+        // Mount, set BEESHOME/BEESSTATUS and spawn bees directly.
+        // Returns the exact worker PID (also written to the pidfile), or -1.
+        pid_t
+        launch_bees (const std::string &uuid,
+                     const std::vector<std::string> &bees_args,
+                     const std::string &cgroup_procs = "");
+
+        // pidfd of a worker launched by this process that is still alive, -1 otherwise
+        int
+        launched_worker_pidfd (const std::string &uuid);
+
+        // SIGTERM the worker this process launched through its pidfd and wait
+        // for it to exit, SIGKILL after grace_ms. False if there is no such worker.
+        bool
+        stop_launched_worker (const std::string &uuid, int grace_ms);
+
+        // Unmount bees_mount_dir() once the worker is gone
+        void
+        release_bees_mount (const std::string &uuid);
+
+        // Start bees for specified UUID. Runs bees directly when its binary is
+        // found, through the beesd script otherwise.
+        // bees_args are handed to bees before the mountpoint
         bool
-        beesstart (const std::string& uuid);
+        beesstart (const std::string& uuid, const std::vector<std::string> &bees_args = {});
 
         // Stop beesd daemon for specified UUID
         bool
@@ -173,7 +217,7 @@ namespace beekeeper {
 
         // Restart beesd daemon for specified UUID
         bool
-        beesrestart (const std::string& uuid);
+        beesrestart (const std::string& uuid, const std::vector<std::string> &bees_args = {});
 
         // Get running status
         // Returns: "running", "stopped", or "unconfigured"
@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <string>
+
+// Placement and pre-allocation of the bees hash table.
+//
+// bees keeps its state in BEESHOME: beeshash.dat (the hash table, DB_SIZE
+// bytes, written at random offsets), beescrawl.dat and beesstats.txt.
+// Left to beesd, BEESHOME is a .beeshome subvolume at the top level of the
+// filesystem and beeshash.dat a sparse copy-on-write file, which ends up
+// split into one extent per 4 KiB write.
+//
+// prepare() creates BEESHOME with the NOCOW attribute (chattr +C) and
+// fallocate()s beeshash.dat to DB_SIZE, so beesd finds it at the right size
+// and leaves it alone. BEESHOME may also be set in the bees config to put
+// the hash table on another, faster device:
+//
+//   BEESHOME=/var/lib/bees/<uuid>
+namespace beekeeper::management::beeshome {
+
+const std::string default_dir_name = ".beeshome";
+const std::string hash_file_name   = "beeshash.dat";
+const std::string crawl_file_name  = "beescrawl.dat";
+const std::string stats_file_name  = "beesstats.txt";
+
+// Largest extent btrfs creates for file data
+constexpr uint64_t max_extent_size = 128ULL * 1024 * 1024;
+
+struct hash_file_info {
+    std::string beeshome;  // BEESHOME as configured, "" = default placement
+    bool exists = false;
+    uint64_t size = 0;
+    uint64_t extents = 0;  // FIEMAP mapped extents
+    bool nocow = false;
+};
+
+// BEESHOME from the config, "" if the default placement is used
+std::string configured(const std::string &uuid);
+
+// Create BEESHOME as NOCOW and pre-allocate beeshash.dat to DB_SIZE.
+//
+// If previous_beeshome is given and differs from the configured BEESHOME,
+// the bees state is moved over first. When DB_SIZE changed, the table is
+// recreated at the new size and beescrawl.dat dropped so bees rescans,
+// which is what beesd itself does on a size change. Existing tables that
+// are not NOCOW are rewritten into a NOCOW copy.
+//
+// Refuses to touch the hash table of a running bees worker.
+bool prepare(const std::string &uuid,
+             const std::optional<std::string> &previous_beeshome = std::nullopt);
+
+// Size, NOCOW attribute and extent count of beeshash.dat
+hash_file_info inspect(const std::string &uuid);
+
+// More than 8x the extents a pre-allocated file of this size would have
+bool is_fragmented(const hash_file_info &info);
+
+} // namespace beekeeper::management::beeshome
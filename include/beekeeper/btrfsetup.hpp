@@ -1,6 +1,8 @@
 #pragma once
 #include "beekeeper/internalaliases.hpp"
 
+#include <map>
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -17,15 +19,62 @@ namespace beekeeper {
         std::string
         btrfstat (std::string uuid);
 
+        // Same, looking for it under another configuration directory
+        std::string
+        btrfstat (const std::string &uuid, const std::string &config_dir);
+
+        // bees performance knobs, stored as BEES_* keys in the config file
+        // and turned into bees arguments by beesstart(). Zero (or -1 for
+        // scan_mode) means "not set": bees' own default applies.
+        struct bees_options {
+            int thread_count = 0;          // --thread-count
+            double thread_factor = 0;      // --thread-factor
+            double loadavg_target = 0;     // --loadavg-target
+            int scan_mode = -1;            // --scan-mode (0-4)
+            double throttle_factor = 0;    // --throttle-factor
+        };
+
+        // Read the BEES_* keys of a configured filesystem
+        bees_options
+        read_bees_options (const std::string &uuid);
+
+        // Turn options into bees command line arguments
+        std::vector<std::string>
+        bees_options_to_args (const bees_options &options);
+
         // Create a config file in /etc/bees for this filesystem
         // db_size = 0: do not change DB_SIZE if configuration file exists
+        // options = nullopt: do not change the BEES_* keys
+        // beeshome = nullopt: do not change BEESHOME; "" = back to the default placement
+        // config_keys: other KEY=value pairs to set; an empty value removes the key
         std::string
-        beessetup (std::string uuid, size_t db_size = 0);
+        beessetup (std::string uuid,
+                   size_t db_size = 0,
+                   const std::optional<bees_options> &options = std::nullopt,
+                   const std::optional<std::string> &beeshome = std::nullopt,
+                   const std::map<std::string, std::string> &config_keys = {});
+
+        // Read the KEY=value pairs of the config file for this filesystem
+        // (quotes stripped). Empty if the filesystem is not configured.
+        std::map<std::string, std::string>
+        read_beesconfig (const std::string &uuid);
 
         // Get block device/mapper device for uuid
         std::string
         get_real_device(const std::string &uuid);
 
+        // sysfs directory of the whole disk behind a filesystem (partitions resolved to their disk)
+        std::string
+        get_backing_disk(const std::string &uuid_or_device);
+
+        // "MAJ:MIN" of that disk
+        std::string
+        get_backing_disk_devno(const std::string &uuid_or_device);
+
+        // Does the backing disk report queue/rotational = 1?
+        bool
+        is_rotational(const std::string &uuid_or_device);
+
         // Return mount point by uuid
         std::vector<std::string> get_mount_paths(const std::string &uuid);
 
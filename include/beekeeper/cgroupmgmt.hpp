@@ -0,0 +1,106 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <sys/types.h>
+
+// Per-filesystem cgroup v2 isolation for bees workers.
+//
+// Every configured filesystem gets its own child cgroup under
+// /sys/fs/cgroup/beekeeper.slice/bees-<uuid>. Limits are taken from the
+// bees configuration file of that filesystem:
+//
+//   CGROUP_CPU_MAX=50%            (or raw cpu.max syntax: "50000 100000")
+//   CGROUP_CPU_WEIGHT=50          (1-10000)
+//   CGROUP_IO_WEIGHT=50           (1-10000, applied to the backing disk)
+//   CGROUP_IO_MAX="wbps=52428800" (io.max keys, the backing disk is prepended)
+//   CGROUP_MEMORY_HIGH=2G         (bytes, accepts K/M/G/T suffixes)
+//
+// Missing keys leave the kernel defaults untouched. Everything here is
+// best-effort: on cgroup v1 hosts or without the needed controllers the
+// worker simply runs where it would have run anyway.
+namespace beekeeper::management::cgroup {
+
+const std::string cgroup_root = "/sys/fs/cgroup";
+const std::string unit_path   = "system.slice/beekeeper-qt.service";
+const std::string helper_leaf = "helper";
+
+// Setup options and the config keys they write
+struct limit_key {
+    const char *option;
+    const char *config_key;
+};
+constexpr limit_key limit_keys[] = {
+    { "cpu-max",     "CGROUP_CPU_MAX" },
+    { "cpu-weight",  "CGROUP_CPU_WEIGHT" },
+    { "io-max",      "CGROUP_IO_MAX" },
+    { "io-weight",   "CGROUP_IO_WEIGHT" },
+    { "memory-high", "CGROUP_MEMORY_HIGH" },
+};
+
+struct limits {
+    std::string cpu_max;
+    std::string cpu_weight;
+    std::string io_max;
+    std::string io_weight;
+    std::string memory_high;
+};
+
+struct stats {
+    bool available = false; // false if the cgroup does not exist
+
+    // cpu.stat
+    uint64_t cpu_usage_usec = 0;
+    uint64_t cpu_user_usec = 0;
+    uint64_t cpu_system_usec = 0;
+    uint64_t cpu_throttled_usec = 0;
+
+    // io.stat, summed over all devices
+    uint64_t io_rbytes = 0;
+    uint64_t io_wbytes = 0;
+    uint64_t io_rios = 0;
+    uint64_t io_wios = 0;
+
+    // memory.current
+    uint64_t memory_current = 0;
+};
+
+// Is a cgroup v2 (unified) hierarchy mounted?
+bool is_available();
+
+// Is this process inside the helper's delegated unit?
+bool in_unit();
+
+// Move this process (the helper) into the helper leaf of its unit and hand
+// the controllers down. False when not running inside the unit.
+bool enter_unit();
+
+// /sys/fs/cgroup/system.slice/beekeeper-qt.service/bees-<uuid>
+std::string path_for(const std::string &uuid);
+
+// Read CGROUP_* keys from the bees config of this filesystem
+limits read_limits(const std::string &uuid);
+
+// Create the cgroup and apply its limits.
+// Returns the path of its cgroup.procs file, or "" on failure or outside
+// the helper's unit.
+std::string prepare(const std::string &uuid);
+
+// Move an already running process into the cgroup of this filesystem
+bool attach(const std::string &uuid, pid_t pid);
+
+// Freeze (pause) or thaw (resume) every process in the cgroup
+bool freeze(const std::string &uuid, bool frozen);
+
+// Override cpu.weight and io.weight at runtime (1-10000)
+bool set_weight(const std::string &uuid, int weight);
+
+// Undo set_weight(): back to the configured weights, or the kernel's
+bool reset_weight(const std::string &uuid);
+
+// Remove the cgroup once it has no processes left
+void release(const std::string &uuid);
+
+// Read back the live usage counters
+stats read_stats(const std::string &uuid);
+
+} // namespace beekeeper::management::cgroup
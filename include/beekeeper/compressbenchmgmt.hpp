@@ -0,0 +1,76 @@
+#pragma once
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <vector>
+
+// Write throughput of each transparent compression preset, measured on the
+// filesystem itself.
+//
+// A scratch directory is created on the mount with one subdirectory per
+// preset carrying its btrfs.compression property, plus an uncompressed
+// baseline. Each gets the same generated data (a mix of text-like,
+// random and zero blocks), written file by file with an fsync, then read
+// back with O_DIRECT. Compression happens in kernel workers at writeback,
+// so CPU time is the machine-wide busy time over the write phase: run it
+// on an otherwise quiet machine.
+//
+// Kernels that ignore the level in the property compress every zstd preset
+// at the default level; the results then only tell the algorithms apart.
+//
+// Results go to /var/lib/beekeeper-qt/benchmark/<uuid>.results
+// (world-readable, so the GUI reads them directly).
+namespace beekeeper::management::compressbench {
+
+const std::string results_dir = "/var/lib/beekeeper-qt/benchmark/";
+
+// Shares of the generated data (normalized, need not add up to 1)
+struct mix {
+    double text = 0.6;               // compresses well
+    double random = 0.3;             // does not compress at all
+    double zeros = 0.1;              // compresses to almost nothing
+};
+
+struct options {
+    uint64_t bytes_per_preset = 256ULL * 1024 * 1024;
+    uint64_t file_size = 8ULL * 1024 * 1024;
+    mix data;
+    bool baseline = true;            // also measure without compression
+};
+
+struct result {
+    std::string preset;              // "none" for the baseline
+    std::string algorithm;
+    int level = 0;
+    bool ok = false;                 // false: the property or a write failed
+
+    uint64_t bytes = 0;
+    double write_bytes_per_sec = 0;  // written and fsynced
+    double read_bytes_per_sec = 0;   // O_DIRECT, after dropping the cache
+    double cpu_seconds = 0;          // machine-wide, during the writes
+    double p50_ms = 0;               // per-file write + fsync latency
+    double p90_ms = 0;
+    double p99_ms = 0;
+};
+
+struct report {
+    bool available = false;          // false: not mounted, no space, or never run
+    std::time_t when = 0;
+    uint64_t bytes_per_preset = 0;
+    mix data;
+    std::vector<result> results;
+};
+
+std::string results_path(const std::string &uuid);
+
+// Benchmark every preset on the mounted filesystem (root only) and store
+// the report. Needs twice bytes_per_preset free; removes its files after.
+report run(const std::string &uuid, const options &opts = {});
+
+// Last stored report
+report load(const std::string &uuid);
+
+// "text:60,random:30,zeros:10" -> mix. False on a malformed string.
+bool parse_mix(const std::string &spec, mix &out);
+
+} // namespace beekeeper::management::compressbench
@@ -0,0 +1,64 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// How well a filesystem's data compresses, and which transparent
+// compression preset pays off on it.
+//
+// Blocks of 128 KiB (btrfs compresses in chunks of that size) are sampled
+// uniformly over the bytes of the mounted filesystem, so a few large files
+// weigh as much as the many small ones holding the same amount of data.
+// Each block is compressed with every preset (and zlib for reference) the
+// way btrfs would store it: rounded up to whole sectors, and kept
+// uncompressed when that does not save anything. The sampling is spread
+// over all cores and timed in per-thread CPU time, so the speeds are per
+// core whatever else the machine is doing.
+namespace beekeeper::management::compressibility {
+
+constexpr uint32_t block_size = 128 * 1024;
+
+struct options {
+    unsigned samples = 256;          // blocks to read (32 MiB)
+    double cpu_budget = 1.0;         // cores compression may take at the write rate
+    double write_rate = 0;           // bytes/s to sustain; 0: guessed from the disk
+    unsigned walk_seconds = 20;      // stop looking for more files after this long
+};
+
+struct candidate {
+    std::string preset;              // empty for reference-only candidates
+    std::string algorithm;
+    int level = 0;
+
+    uint64_t input = 0;              // bytes compressed
+    uint64_t stored = 0;             // bytes btrfs would store for them
+    double saved_fraction = 0;       // 1 - stored / input
+    double bytes_per_sec_per_core = 0;
+    bool within_budget = false;
+};
+
+struct analysis {
+    bool available = false;          // false: not mounted, nothing readable, or cancelled
+    bool cancelled = false;          // cancel() stopped it
+    bool partial_walk = false;       // walk_seconds ran out: sampled what was seen
+    uint64_t files_seen = 0;
+    uint64_t bytes_seen = 0;
+    uint64_t blocks = 0;             // blocks actually sampled
+    double write_rate = 0;
+    double cpu_budget = 0;
+
+    std::vector<candidate> candidates;
+    std::string recommended;         // preset name
+};
+
+// Sample the filesystem `uuid` is mounted on (root only: reads any file)
+analysis analyze(const std::string &uuid, const options &opts = {});
+
+// Stop every analysis running on this filesystem. False if none was running.
+bool cancel(const std::string &uuid);
+
+// Bytes btrfs would store for `n` bytes of `data` (at most block_size)
+// compressed with algorithm:level. Thread-safe.
+uint64_t stored_bytes(const std::string &algorithm, int level, const unsigned char *data, size_t n);
+
+} // namespace beekeeper::management::compressibility
@@ -1,16 +1,19 @@
 #pragma once
 #ifdef BEEKEEPER_DEBUG_LOGGING
+#include "beekeeper/debuglogmgmt.hpp"
+
 #include <cstdlib>
-#include <fstream>
 #include <iostream>
 #include <sstream>
+#include <string>
+#include <string_view>
 #include <thread>
 #include <type_traits>
 #include <utility>
 
 static std::string
 daemon_debug_log_path () {
-    return "/run/bees/beekeeper-qt/debug.log";
+    return beekeeper::management::debuglog::file_path();
 }
 
 // Runtime debug logging control
@@ -57,22 +60,49 @@ void _debug_print_helper(std::ostream& os, T&& first, Args&&... rest) {
     }
 }
 
-// Global log file accessor
-inline std::ostream& debug_log_file() {
-    static std::ofstream ofs;
-    static std::ostream* stream = nullptr;
-    
-    if (!stream) {
-        ofs.open(daemon_debug_log_path(), std::ios::out | std::ios::app);
-        
-        if (ofs.is_open()) {
-            stream = &ofs;
-        } else {
-            stream = &std::cerr;  // Fallback to stderr
-        }
+// Per-thread line being formatted. Keeps its capacity between lines, so
+// a DEBUG_LOG allocates nothing once the thread has logged a long one.
+class debug_line_buffer : public std::streambuf {
+public:
+    std::string_view view() const { return line; }
+    void clear() { line.clear(); }
+
+protected:
+    int_type overflow(int_type c) override {
+        if (c != traits_type::eof()) line += traits_type::to_char_type(c);
+        return c;
+    }
+    std::streamsize xsputn(const char* s, std::streamsize n) override {
+        line.append(s, static_cast<size_t>(n));
+        return n;
     }
-    
-    return *stream;
+
+private:
+    std::string line;
+};
+
+struct debug_line {
+    debug_line_buffer buffer;
+    std::ostream os { &buffer };
+};
+
+inline debug_line& this_thread_debug_line() {
+    thread_local debug_line line;
+    line.buffer.clear();
+    return line;
+}
+
+// Structured field: DEBUG_LOG("bees started", debug_field("uuid", uuid))
+// prints " uuid=<value>", quoted when the value has spaces
+template<typename T>
+struct debug_field_t {
+    const char* key;
+    const T& value;
+};
+
+template<typename T>
+debug_field_t<T> debug_field(const char* key, const T& value) {
+    return { key, value };
 }
 // Compile-time path stripper
 constexpr const char* shorten_path(const char* path) {
@@ -117,25 +147,49 @@ inline void debug_print(std::ostream& os, const std::thread::id& tid) {
     os << oss.str();
 }
 
-// Debug logging macro
-#define DEBUG_LOG(...) do { \
-    if (DebugLogger::enabled()) { \
-        std::ostringstream debug_oss; \
-        debug_oss << "[" << __SHORT_FILE__ << ":" << __LINE__ << "] "; \
-        _debug_print_helper(debug_oss, __VA_ARGS__); \
-        std::string msg = debug_oss.str(); \
-        debug_log_file() << msg << std::endl; \
+template<typename T>
+inline void debug_print(std::ostream& os, const debug_field_t<T>& field) {
+    debug_line_buffer value;
+    std::ostream value_os(&value);
+    _debug_print_helper(value_os, field.value);
+
+    os << ' ' << field.key << '=';
+    if (value.view().find(' ') == std::string_view::npos && !value.view().empty())
+        os << value.view();
+    else
+        os << '"' << value.view() << '"';
+}
+
+// Debug logging macros. The level and categories are checked before
+// anything is formatted; the line is then queued, not written, see
+// debuglogmgmt.hpp.
+#define DEBUG_LOG_AT(lvl, ...) do { \
+    if (DebugLogger::enabled() \
+        && beekeeper::management::debuglog::wants(beekeeper::management::debuglog::level::lvl, __SHORT_FILE__)) { \
+        debug_line& debug_msg = this_thread_debug_line(); \
+        _debug_print_helper(debug_msg.os, __VA_ARGS__); \
+        beekeeper::management::debuglog::write(beekeeper::management::debuglog::level::lvl, \
+                                               __SHORT_FILE__, __LINE__, debug_msg.buffer.view()); \
+        debug_msg.buffer.clear(); /* a DEBUG_LOG among the arguments of another */ \
     } \
-} while(0) // <- NO backslash here, file ends naturally
+} while(0)
+
+#define DEBUG_LOG(...) DEBUG_LOG_AT(debug, __VA_ARGS__)
 
 /* No std::cerr printing. From now on, for daemon debugging one must run:
 
    tail -f /run/bees/beekeeper-qt/debug.log
+
+   and, to change what ends up there without restarting the helper:
+
+   busctl call org.beekeeper.dbush /org/beekeeper/dbush org.beekeeper.dbush \
+       execute_clause 'sa{sv}as' debuglog 1 level s trace 0
 */
 
 #else // !BEEKEEPER_DEBUG_LOGGING
 
 // No-op in release
+#define DEBUG_LOG_AT(lvl, ...) do { } while(0)
 #define DEBUG_LOG(...) do { } while(0)
 
 #endif
\ No newline at end of file
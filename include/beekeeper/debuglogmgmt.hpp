@@ -0,0 +1,62 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Asynchronous backend of DEBUG_LOG (see debug.hpp).
+//
+// Every thread appends finished lines to its own ring buffer: a single
+// producer, single consumer byte ring, so logging never takes a lock or
+// waits for the disk. A background flusher collects whatever the rings
+// hold every few milliseconds and writes it with one writev(). When a
+// ring is full the line is dropped and counted instead of blocking the
+// thread; the flusher reports how many were lost.
+//
+// What gets logged can be changed while running: a level, and categories
+// matched against the source file of each DEBUG_LOG. BEEKEEPER_DEBUG_LEVEL
+// and BEEKEEPER_DEBUG_CATEGORIES set them at startup, the `debuglog` clause
+// afterwards. The file is rotated by size into <file>.1 ... <file>.N.
+//
+// With BEEKEEPER_DEBUG_LOGGING undefined DEBUG_LOG still compiles to
+// nothing; this backend is then linked but never started.
+namespace beekeeper::management::debuglog {
+
+enum class level : uint8_t { error, warning, info, debug, trace };
+
+constexpr size_t ring_capacity = 256 * 1024;            // per thread
+constexpr int flush_interval_ms = 50;
+constexpr uint64_t max_file_size = 16 * 1024 * 1024;    // then rotate
+constexpr int files_kept = 3;                           // debug.log.1 ... .3
+
+// "error", "warning", "info", "debug", "trace"
+const char *level_name(level l);
+bool parse_level(std::string_view name, level &out);
+
+// Whether a line at `l` from `file` would be written. Cheap enough to ask
+// before formatting anything.
+bool wants(level l, const char *file);
+
+// Queue one line. `message` is already formatted, without a newline.
+void write(level l, const char *file, int line, std::string_view message);
+
+// Runtime control
+level current_level();
+void set_level(level l);
+
+// Substrings of source paths to keep ("launcher", "src/polkit/", ...);
+// empty keeps everything
+std::vector<std::string> categories();
+void set_categories(const std::vector<std::string> &substrings);
+
+// Lines dropped because a thread's ring was full, since startup
+uint64_t dropped();
+
+// Write out everything queued so far, and wait for it
+void flush();
+
+// Where the lines go: /run/bees/beekeeper-qt/debug.log
+std::string file_path();
+
+} // namespace beekeeper::management::debuglog
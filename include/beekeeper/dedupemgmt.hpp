@@ -0,0 +1,51 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Deduplicate files already known to be identical, without bees.
+//
+// Each set is deduplicated against its first file with FIDEDUPERANGE,
+// one range of at most 16 MiB (the most btrfs takes per call) at a time,
+// with every other file of the set as a destination of the same call. The
+// kernel compares the data itself, so a stale set only costs a failed
+// comparison. Ranges a destination already shares with the source (same
+// physical extent, per FIEMAP) are left out. Sets are worked on by a few
+// threads at once.
+namespace beekeeper::management::dedupe {
+
+struct options {
+    unsigned queue_depth = 4;        // sets in flight at once
+    bool dry_run = false;            // only count what would be submitted
+};
+
+struct report {
+    uint64_t sets = 0;
+    uint64_t files = 0;              // destinations looked at
+    uint64_t calls = 0;              // FIDEDUPERANGE ioctls issued
+    uint64_t bytes_deduped = 0;      // as reported by the kernel (dry run: would be submitted)
+    uint64_t bytes_already_shared = 0;
+    uint64_t files_differing = 0;    // the kernel found different data: not duplicates after all
+    uint64_t errors = 0;             // unreadable files, other filesystems, size changes
+};
+
+using file_set = std::vector<std::string>;
+
+// One FIEMAP extent of a file
+struct extent {
+    uint64_t logical;
+    uint64_t physical;
+    uint64_t length;
+    uint32_t flags;                  // FIEMAP_EXTENT_*
+};
+
+report apply(const std::vector<file_set> &sets, const options &opts = {});
+
+// Duplicate sets from `dupscan -j` output, or from fdupes-style text: one
+// path per line, sets separated by blank lines. Sets of one file are dropped.
+std::vector<file_set> parse_sets(const std::string &text);
+
+// Whether [off, off + len) of dst already points at the same data as src
+bool already_shared(const std::vector<extent> &src, const std::vector<extent> &dst, uint64_t off, uint64_t len);
+
+} // namespace beekeeper::management::dedupe
@@ -0,0 +1,51 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// File-level duplicate finder for chosen directories.
+//
+// bees finds duplicate blocks across the whole filesystem, but only once
+// its crawl gets there. This looks at a few directories (Wine prefixes,
+// virtualenvs, document folders) right away: files are grouped by size,
+// then by a hash of their first and last 4 KiB, and only the survivors are
+// hashed in full (XXH3-128 over large sequential reads). Directories are
+// walked and files hashed by a pool of threads.
+//
+// Hashes are kept in a memory-mapped index keyed by device and inode and
+// checked against size, mtime, ctime and inode generation, so later scans
+// only read the files that changed. Entries not seen for a few scans are
+// dropped when the index grows.
+namespace beekeeper::management::dupscan {
+
+const std::string index_path = "/var/lib/beekeeper-qt/dupscan/index";
+
+struct options {
+    unsigned threads = 0;            // 0: one per core
+    uint64_t min_size = 4096;        // smaller files are not worth deduplicating
+    bool use_index = true;
+};
+
+struct duplicate_set {
+    uint64_t size = 0;               // of each file
+    uint64_t reclaimable = 0;        // size * (copies - 1)
+    std::vector<std::string> paths;  // one per inode: hard links are not duplicates
+};
+
+struct report {
+    bool complete = false;           // false: no directory could be read
+    uint64_t files = 0;              // regular files of at least min_size
+    uint64_t candidates = 0;         // sharing a size with another file
+    uint64_t fully_hashed = 0;       // files whose whole content was hashed
+    uint64_t from_index = 0;         // hashes reused from earlier scans
+    uint64_t bytes_read = 0;
+    uint64_t errors = 0;             // unreadable files or directories
+
+    uint64_t reclaimable = 0;
+    std::vector<duplicate_set> sets; // most reclaimable first
+};
+
+// Find duplicate files under `roots` (each walked on its own filesystem)
+report scan(const std::vector<std::string> &roots, const options &opts = {});
+
+} // namespace beekeeper::management::dupscan
@@ -0,0 +1,84 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <sys/types.h>
+#include <unordered_map>
+#include <vector>
+
+// Pieces shared by everything that walks a whole btrfs filesystem
+// (space accounting, duplicate scans, compressibility sampling, the
+// incompressible scan, recompression).
+//
+// A walk stays on the filesystems of its roots: subvolumes have an st_dev
+// of their own but the same fsid, so they are entered, while anything
+// mounted inside the tree is left out. Directory trees too large for one
+// thread are read by a pool that steals work from each other.
+namespace beekeeper::management::fswalk {
+
+// Which directories belong to the filesystems of the walk's roots.
+// The answer is cached per st_dev; safe to use from several threads.
+class filesystem_filter
+{
+public:
+    // Take the filesystem of a root directory; false if it is not on btrfs
+    bool add_root(const std::string &root);
+
+    // Is `name` in the directory `parent_fd` (or a path with AT_FDCWD),
+    // whose lstat gave `dev`, on one of the roots' filesystems?
+    bool contains(int parent_fd, const char *name, dev_t dev);
+
+private:
+    std::mutex m_mutex;
+    std::unordered_map<dev_t, bool> m_same;            // st_dev -> on a root's filesystem
+    std::vector<std::array<uint8_t, 16>> m_fsids;      // BTRFS_FSID_SIZE each
+};
+
+// Directories read in parallel. Each thread takes from its own queue from
+// the back (depth first, warm caches) and from the others' from the front;
+// threads out of work sleep until a directory is queued or the walk ends.
+class parallel_walk
+{
+public:
+    // Called for every directory; subdirectories go back in with push()
+    using read_dir_fn = std::function<void(size_t worker, const std::string &dir)>;
+    // Called once on each thread before it takes any work
+    using thread_init_fn = std::function<void(size_t worker)>;
+
+    explicit parallel_walk(unsigned threads);
+
+    size_t threads() const { return m_queues.size(); }
+
+    // Queue a directory; `worker` is the calling thread, or any before run()
+    void push(size_t worker, std::string dir);
+
+    // Read every queued directory, and all they push, then return
+    void run(const read_dir_fn &read_dir, const thread_init_fn &thread_init = nullptr);
+
+private:
+    struct queue {
+        std::mutex mutex;
+        std::deque<std::string> dirs;
+    };
+    std::vector<std::unique_ptr<queue>> m_queues;
+
+    // Directories queued or being read; 0 means the walk is over
+    std::atomic<size_t> m_pending { 0 };
+    // Directories sitting in the queues
+    std::atomic<size_t> m_queued { 0 };
+    std::mutex m_idle_mutex;
+    std::condition_variable m_work_available;
+
+    bool next_dir(size_t worker, std::string &dir);
+    void wake(bool everyone);
+    void wait_for_work();
+    void worker(size_t worker, const read_dir_fn &read_dir, const thread_init_fn &thread_init);
+};
+
+} // namespace beekeeper::management::fswalk
@@ -0,0 +1,62 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Per-directory compression opt-out for data that never compresses.
+//
+// With transparent compression on, btrfs still tries (and fails) to
+// compress media, archives and VM images on every write before giving up
+// on a file. Directories full of such data are found by sampling a few
+// blocks of a few files in each: a byte entropy estimate rules out the
+// hopeless blocks cheaply, the others get a trial compression with lzo and
+// zstd:1 the way btrfs stores them. Directories below a threshold get the
+// btrfs.compression=none property (the "btrfs.compression" xattr), which
+// new files in them inherit.
+//
+// Every change is appended to an undo log
+// (/var/lib/beekeeper-qt/incompressible/<uuid>.undo) so it can be reverted.
+namespace beekeeper::management::incompressible {
+
+const std::string undo_dir = "/var/lib/beekeeper-qt/incompressible/";
+
+struct options {
+    double threshold = 0.03;         // flag directories saving less than this fraction
+    uint64_t min_sampled = 1 << 20;  // and only with at least this many bytes sampled
+    unsigned files_per_dir = 16;
+    unsigned blocks_per_file = 3;
+    unsigned walk_seconds = 30;
+    unsigned threads = 0;            // 0: one per core
+};
+
+struct directory {
+    std::string path;
+    std::string current;             // btrfs.compression already set on it, if any
+    uint64_t sampled = 0;            // bytes read
+    double entropy = 0;              // mean bits per byte of the sampled blocks
+    double saved_fraction = 0;       // best of lzo and zstd:1
+    bool incompressible = false;
+};
+
+struct report {
+    bool available = false;          // false: not mounted
+    bool partial_walk = false;
+    std::vector<directory> directories; // only those with enough data sampled
+};
+
+// Sample every directory of a mounted filesystem (dry run: changes nothing)
+report scan(const std::string &uuid, const options &opts = {});
+
+// Set btrfs.compression=none on the incompressible directories of a scan
+// that have no property yet, logging each change. Returns how many were set.
+size_t apply(const std::string &uuid, const report &r);
+
+// Revert every logged change, newest first. Entries that could not be
+// reverted stay in the log; it is dropped once it is empty.
+// Returns how many were reverted.
+size_t undo(const std::string &uuid);
+
+// Directories changed so far (oldest first)
+std::vector<std::string> changed(const std::string &uuid);
+
+} // namespace beekeeper::management::incompressible
@@ -0,0 +1,46 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Bounded capture of bees output.
+//
+// The helper owns the stdout/stderr pipe of every bees worker it starts and
+// drains it into a fixed-size ring per filesystem, so the most recent output
+// is always at hand without ever growing. Readers never block the worker:
+// they copy from the ring without locks and detect when the writer lapped
+// them. Positions are byte offsets that only grow (cursors), so a client
+// asks for "everything after N" and gets only new lines.
+//
+// Optionally the output is also written to /var/log/beesd/<uuid>.log, rotated
+// into a few gzip-compressed segments so it stays under a size cap.
+namespace beekeeper::management::logring {
+
+constexpr size_t ring_capacity = 1024 * 1024;           // per filesystem
+constexpr size_t max_line_length = 4096;                // longer lines are cut
+constexpr uint64_t file_segment_size = 8 * 1024 * 1024; // plain log before rotation
+constexpr int file_segments_kept = 4;                   // <uuid>.log.1.gz ... .4.gz
+
+struct chunk {
+    uint64_t cursor = 0;            // pass back to get what comes after
+    bool lost = false;              // lines between the given cursor and these were overwritten
+    std::vector<std::string> lines;
+};
+
+// Take ownership of the read end of a worker's output pipe and drain it in
+// the background until the worker closes it.
+void capture(const std::string &uuid, int fd);
+
+// Also keep the output in rotating log files (off by default)
+void keep_files(const std::string &uuid, bool enable);
+
+// Complete lines written after `cursor`. Cursor 0 means "as far back as the
+// ring goes".
+chunk read(const std::string &uuid, uint64_t cursor = 0);
+
+// Current cursor of every filesystem with captured output
+std::vector<std::pair<std::string, uint64_t>> heads();
+
+} // namespace beekeeper::management::logring
@@ -0,0 +1,56 @@
+#pragma once
+#include <cstdint>
+#include <ctime>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Live dedupe metrics from the bees status file (BEESSTATUS).
+//
+// bees rewrites that file every few seconds with its counters since the
+// worker started (TOTAL), their per-second rates (RATES), what each thread
+// is doing and how far every crawler got (PROGRESS). This turns it into
+// typed numbers. Parsing only happens when the file actually changed; the
+// helper additionally watches the status directory with inotify so it
+// knows when that is without asking.
+namespace beekeeper::management::metrics {
+
+struct crawl_row {
+    std::string extent_size;  // size class: "max", "32M", ... or "total"
+    uint64_t data_size = 0;   // bytes of data in that class
+    double position = -1;     // 0..1 through the current cycle, -1 if idle/unknown
+};
+
+struct snapshot {
+    bool available = false;          // false: no status file (bees not running)
+    std::time_t updated = 0;         // when bees last wrote it
+
+    double dedup_bytes_per_sec = 0;
+    double scanned_bytes_per_sec = 0;
+    uint64_t dedup_bytes = 0;        // since the worker started
+    uint64_t extents_scanned = 0;    // since the worker started
+    double crawl_progress = -1;      // 0..1 over all size classes, weighted by data size
+    double hash_fill = -1;           // 0..1 estimate of the hash table in use, -1 if unknown
+
+    std::vector<crawl_row> crawl;
+    std::map<std::string, double> totals; // raw TOTAL counters
+    std::map<std::string, double> rates;  // raw RATES counters
+};
+
+// Parse the contents of a status file. db_size (bytes) enables hash_fill.
+snapshot parse(std::string_view text, uint64_t db_size = 0);
+
+// Current metrics for a filesystem. Cached: the file is only re-read when
+// its modification time or size changed.
+snapshot read(const std::string &uuid);
+
+// inotify descriptor watching the default status directory, or -1. It
+// also watches /etc/bees, so DB_SIZE is only re-read after a config changed.
+int watch();
+
+// Drain pending inotify events and re-read every status file bees just
+// finished writing. Returns the UUIDs whose metrics changed.
+std::vector<std::string> changed(int fd);
+
+} // namespace beekeeper::management::metrics
@@ -0,0 +1,44 @@
+#pragma once
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+// Live table of bees workers, fed by the kernel proc connector.
+//
+// The helper subscribes to NETLINK_CONNECTOR process events and hears about
+// every exec() and process exit as it happens. bees workers are recognized
+// at exec time from their command line (the last argument is the
+// filesystem they work on) and dropped when they exit, so status queries
+// become lookups instead of pidfile checks and ps scans.
+//
+// Subscribing needs CAP_NET_ADMIN; without it is_live() stays false and
+// callers keep using their usual discovery.
+namespace beekeeper::management::procwatch {
+
+struct event {
+    std::string uuid;
+    pid_t pid = 0;
+    bool started = false; // false: the worker exited
+};
+
+// Open the connector socket and start listening. Returns the fd, or -1.
+int subscribe();
+
+// Stop listening and close the socket. The table stops being live.
+void unsubscribe(int fd);
+
+// Fill the table from /proc, for workers started before subscribe() or
+// missed when the event queue overflowed. Returns how the table changed.
+std::vector<event> seed();
+
+// Read every pending message on fd and update the table.
+// Returns the bees worker changes among them.
+std::vector<event> drain(int fd);
+
+// Is the table kept up to date by a subscription right now?
+bool is_live();
+
+// PID of the bees worker for this filesystem, 0 if none
+pid_t worker_for(const std::string &uuid);
+
+} // namespace beekeeper::management::procwatch
@@ -0,0 +1,73 @@
+#pragma once
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <vector>
+
+// Background recompression of data written before transparent compression
+// was turned on.
+//
+// A job walks the filesystem in a fixed (sorted) order and rewrites the
+// uncompressed extents of each file with BTRFS_IOC_DEFRAG_RANGE and the
+// configured algorithm, on a few threads. Extents that are already
+// compressed, inline or shared are left alone: rewriting a shared extent
+// would undo what deduplication saved. Files btrfs marked incompressible,
+// nodatacow files and files with btrfs.compression=none are skipped.
+//
+// Rewrites are throttled by a byte and an operation rate, and the job waits
+// while the machine is busy. Progress is checkpointed to
+// /var/lib/beekeeper-qt/recompress/<uuid>.state (world-readable, so the GUI
+// reads it directly); the helper resumes unfinished jobs when it starts.
+namespace beekeeper::management::recompress {
+
+const std::string state_dir = "/var/lib/beekeeper-qt/recompress/";
+
+// A rate of 0 means unlimited; a load of 0 never waits
+struct limits {
+    double bytes_per_sec = 32.0 * 1024 * 1024;  // rewrite at most this much per second
+    double ops_per_sec = 64;                    // and issue at most this many rewrites
+    double max_load_per_core = 0.75;            // wait while loadavg / cores is above this
+    unsigned threads = 2;
+};
+
+struct progress {
+    std::string uuid;
+    std::string state;              // "running", "waiting" (busy machine), "paused", "done", "failed"; empty: no job
+    std::string algorithm;
+    int level = 0;
+    limits rate;
+
+    std::string resume_after;       // every file up to this path (relative to the mount) is done
+    uint64_t bytes_total = 0;       // used space when the job started
+    uint64_t bytes_visited = 0;     // file bytes looked at, rewritten or not
+    uint64_t bytes_rewritten = 0;
+    uint64_t bytes_skipped = 0;     // already compressed, shared or inline
+    uint64_t files_done = 0;
+    uint64_t files_skipped = 0;     // incompressible, nodatacow or compression=none
+    uint64_t errors = 0;
+    std::time_t started = 0;
+    std::time_t updated = 0;
+};
+
+std::string state_path(const std::string &uuid);
+
+// Start (or resume) recompressing a mounted filesystem with the algorithm
+// of its transparent compression setting. Returns at once; the job runs in
+// this process, so only the helper should start, pause or cancel jobs
+// (beekeeperman sends these to it). False if it is not mounted or has no
+// compression setting.
+bool start(const std::string &uuid, const limits &rate = {});
+
+// Stop the job and keep its checkpoint, to be resumed by start()
+bool pause(const std::string &uuid);
+
+// Stop the job and forget its checkpoint
+bool cancel(const std::string &uuid);
+
+// Last checkpointed progress (state is empty when there is no job)
+progress status(const std::string &uuid);
+
+// Restart every job that was running when the helper stopped
+void resume_all();
+
+} // namespace beekeeper::management::recompress
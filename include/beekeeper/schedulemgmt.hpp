@@ -0,0 +1,81 @@
+#pragma once
+#include <ctime>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Time-window scheduling for bees workers.
+//
+// /etc/bees/schedulesettings.cfg holds one line per filesystem:
+//
+//   <uuid> [idle=stop|pause] <window> [<window> ...]
+//
+// where a window is
+//
+//   [days@]HH:MM-HH:MM[,threads=N][,weight=N]
+//
+//   days     "mon-fri", "sat,sun", "tue" ... (every day if omitted)
+//   HH:MM    local time; an end before the start wraps past midnight,
+//            "24:00" means end of day
+//   threads  restart bees with --thread-count=N inside this window
+//   weight   cgroup cpu.weight / io.weight inside this window
+//
+// Inside a window the worker runs; outside every window it is stopped, or
+// frozen in place when idle=pause. Days refer to the day a window starts.
+//
+// Example:  <uuid> idle=pause mon-fri@22:00-06:00,weight=1000 sat,sun@00:00-24:00
+namespace beekeeper::management::schedule {
+
+const std::string schedule_config_file = "/etc/bees/schedulesettings.cfg";
+
+struct window {
+    unsigned days_mask = 0x7f; // bit 0 = Monday ... bit 6 = Sunday
+    int start_minute = 0;      // minutes since midnight
+    int end_minute = 0;        // may be <= start_minute (wraps) or 1440
+    int threads = 0;           // 0 = leave bees' own default
+    int weight = 0;            // 0 = leave the cgroup weight alone
+};
+
+struct plan {
+    std::string uuid;
+    bool pause_when_idle = false;
+    std::vector<window> windows;
+};
+
+// Parse one window spec. Returns false on malformed input.
+bool parse_window(const std::string &spec, window &out);
+
+// Render a window back to its spec form
+std::string format_window(const window &w);
+
+// Parse "<uuid> [idle=...] <window>..." config lines
+std::optional<plan> parse_plan(const std::string &line);
+
+// Read every schedule from the config file
+std::vector<plan> list();
+
+// Schedule for a single filesystem, if any
+std::optional<plan> fetch(const std::string &uuid);
+
+// Does this filesystem have a schedule?
+bool is_scheduled(const std::string &uuid);
+
+// Validate and store a schedule (replaces any previous one)
+bool set(const std::string &uuid,
+         const std::vector<std::string> &window_specs,
+         bool pause_when_idle = false);
+
+// Drop the schedule of a filesystem
+void remove(const std::string &uuid);
+
+// Index into plan.windows of the window active at `when`, or -1
+int active_window(const plan &p, std::time_t when);
+
+// Next time after `now` at which the active window changes, or 0 if never
+std::time_t next_transition(const plan &p, std::time_t now);
+
+// Bring the worker into the state the schedule wants at `now`.
+// Returns the active window index, like active_window().
+int apply(const plan &p, std::time_t now);
+
+} // namespace beekeeper::management::schedule
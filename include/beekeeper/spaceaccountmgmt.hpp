@@ -0,0 +1,60 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+
+// compsize-style space accounting: what the files under a directory take
+// as seen by applications, before compression and on disk, how much of it
+// lives in shared (deduplicated or reflinked) extents, and the compression
+// ratio of each algorithm.
+//
+// Unlike "free space now versus at start", this does not move when
+// something else writes to the filesystem.
+//
+// Extents are read from the subvolume tree with BTRFS_IOC_TREE_SEARCH_V2
+// (root only); without the privilege FIEMAP is used, which cannot tell
+// algorithms or on-disk sizes of compressed extents apart. Directories are
+// walked by a pool of threads that steal work from each other. Results per
+// inode are cached by the inode's transid (bumped by every write, clone
+// and dedupe), so walking the same tree again only reads what changed; the
+// cache keeps the inodes of the most recent walks, up to a fixed count.
+namespace beekeeper::management::spaceaccount {
+
+struct usage {
+    uint64_t disk = 0;          // on-disk bytes of the distinct extents
+    uint64_t uncompressed = 0;  // the same extents before compression
+    uint64_t referenced = 0;    // bytes files see through them
+};
+
+struct report {
+    bool complete = false;      // false: cancelled (or the root was unusable)
+    bool precise = false;       // true: tree search; false: FIEMAP fallback
+
+    uint64_t files = 0;
+    uint64_t cached_files = 0;  // unchanged since the previous walk
+    uint64_t extents = 0;       // distinct extents
+    uint64_t errors = 0;        // files or directories that could not be read
+
+    usage total;
+    uint64_t shared = 0;        // referenced bytes in extents referenced more than once
+    std::map<std::string, usage> by_algorithm; // "none", "zlib", "lzo", "zstd" ("encoded" with FIEMAP)
+};
+
+struct options {
+    unsigned threads = 0;                 // 0: one per core
+    bool idle_io = false;                 // idle I/O priority for the walkers
+    std::function<bool()> cancelled;      // polled between files; true stops the walk
+};
+
+// Walk `root` (a directory on a btrfs filesystem) and account its extents.
+// Stays on the filesystem `root` is on, like compsize -x.
+report account(const std::string &root, const options &opts = {});
+
+// Stop every walk running on `root`. False if none was running.
+bool cancel(const std::string &root);
+
+// Forget cached per-inode results (e.g. to free memory)
+void clear_cache();
+
+} // namespace beekeeper::management::spaceaccount
@@ -0,0 +1,50 @@
+#pragma once
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <vector>
+
+// Free/used space history per filesystem, and what it says about savings.
+//
+// The helper samples every deduplicating filesystem on a fixed interval into
+// a small ring file (/var/lib/beekeeper-qt/space/<uuid>.ring, a few KB, kept
+// across restarts and reboots). The file is memory mapped and world-readable,
+// so the GUI reads it directly without asking the helper.
+//
+// Savings are measured on used space: bees giving extents back shrinks it.
+// Whatever the user writes meanwhile counts against it, so rates are net.
+namespace beekeeper::management::spacehistory {
+
+constexpr uint32_t capacity = 256;           // samples kept per filesystem
+constexpr int sample_interval_sec = 15 * 60; // 64 hours of history
+
+struct sample {
+    int64_t time = 0;   // unix time
+    uint64_t free = 0;
+    uint64_t used = 0;
+};
+
+struct trend {
+    bool available = false;        // needs at least two samples
+    int64_t saved = 0;             // bytes given back since the first sample (net)
+    double saved_last_hour = 0;    // bytes given back over the last hour
+    double rate_per_hour = 0;      // moving average of the savings rate, bytes/hour
+    double remaining = -1;         // bytes still expected at the current decay, -1 if unknown
+    std::time_t eta = 0;           // when the rate should fall to a trickle, 0 if unknown
+};
+
+std::string history_path(const std::string &uuid);
+
+// Append a sample (helper only: the file lives in a root-owned directory)
+bool append(const std::string &uuid, const sample &s);
+
+// Sample the filesystem now and append it. False if it is not mounted.
+bool record(const std::string &uuid);
+
+// Every sample in the ring, oldest first. Empty if there is no history.
+std::vector<sample> load(const std::string &uuid);
+
+// Savings so far, the smoothed rate and a convergence estimate
+trend analyze(const std::vector<sample> &samples);
+
+} // namespace beekeeper::management::spacehistory
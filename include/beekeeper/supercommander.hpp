@@ -71,10 +71,15 @@ public:
     QFuture<bool> beesstop(const QString &uuid);
     QFuture<bool> beesrestart(const QString &uuid);
     QFuture<std::string> beeslog(const QString &uuid);
+    QFuture<QVariantMap> beeslog_since(const QString &uuid, qulonglong cursor);
     QFuture<bool> beesclean(const QString &uuid);
     QFuture<std::string> beessetup(const QString &uuid,
                                     size_t db_size = 0,
-                                    bool return_success_bool_instead = false);
+                                    bool return_success_bool_instead = false,
+                                    const QVariantMap &bees_options = {});
+    QFuture<qulonglong> advise_db_size(const QString &uuid);
+    QFuture<qulonglong> fragmented_hash_table_extents(const QString &uuid);
+    QFuture<QVariantMap> metrics(const QString &uuid);
     QFuture<std::string> beeslocate(const QString &uuid);
     QFuture<bool> beesremoveconfig(const QString &uuid);
     QFuture<std::string> btrfstat(const QString &uuid, const QString &mode = "");
@@ -89,6 +94,10 @@ public:
 
     QFuture<bool> start_transparentcompression_for_uuid(const QString &uuid);
     QFuture<bool> pause_transparentcompression_for_uuid(const QString &uuid);
+    QFuture<QVariantMap> analyze_compression(const QString &uuid);
+    QFuture<bool> cancel_compression_analysis(const QString &uuid);
+    QFuture<bool> recompress(const QString &uuid, const QString &action);
+    QFuture<QVariantMap> recompress_status(const QString &uuid);
 
 signals:
     void command_finished(const QString &cmd,
@@ -0,0 +1,97 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Always-on latency histograms of beekeeper's own hot paths.
+//
+// Clause handlers, external commands, D-Bus calls, /proc scans and remounts
+// time themselves with a scoped_timer. Each thread records into its own
+// shard, so recording never waits on another thread; shards are merged
+// when somebody asks (the `metrics --timings` clause, the helper's
+// exporter file). Histograms are log-linear like HDR histograms: 16 linear
+// buckets per power of two, so any percentile is within 6.25% of the truth
+// from a nanosecond up to about 18 minutes.
+namespace beekeeper::management::timings {
+
+// What is being timed. One histogram per family, its series told apart by
+// a label: the verb, the program, the D-Bus method, the scan, the mountpoint
+enum class family { clause, command, dbus, proc_scan, remount };
+
+constexpr int sub_bucket_bits = 4;                  // 16 buckets per power of two
+constexpr int max_exponent = 40;                    // 2^41 ns and beyond land in the last bucket
+constexpr size_t bucket_count = (max_exponent - sub_bucket_bits + 2) << sub_bucket_bits;
+
+struct histogram {
+    uint64_t count = 0;
+    uint64_t sum_ns = 0;
+    uint64_t max_ns = 0;
+    std::array<uint64_t, bucket_count> buckets {};
+
+    void record(uint64_t ns);
+    void merge(const histogram &other);
+
+    // The p-th (0..1) recorded value, rounded up to its bucket's upper bound
+    uint64_t percentile(double p) const;
+
+    static size_t bucket_of(uint64_t ns);
+    static uint64_t bucket_upper(size_t bucket);
+};
+
+struct series {
+    family what;
+    std::string label;
+    histogram h;
+};
+
+// Add one measurement
+void record(family what, std::string_view label, uint64_t ns);
+
+// Times its own lifetime
+class scoped_timer
+{
+public:
+    scoped_timer(family what, std::string_view label)
+        : what(what), label(label), start(std::chrono::steady_clock::now()) {}
+
+    ~scoped_timer()
+    {
+        record(what, label, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                std::chrono::steady_clock::now() - start).count());
+    }
+
+    scoped_timer(const scoped_timer &) = delete;
+    scoped_timer &operator=(const scoped_timer &) = delete;
+
+private:
+    family what;
+    std::string_view label;    // must outlive the timer
+    std::chrono::steady_clock::time_point start;
+};
+
+// Every series of this process, merged over all threads, ordered by family
+// and label
+std::vector<series> snapshot();
+
+// Prometheus text exposition format: one histogram per family
+std::string prometheus();
+
+// {"family":[{"label":..,"count":..,"sum_ns":..,"max_ns":..,"p50_ns":..,...}],...}
+std::string json();
+
+// Where the helper keeps prometheus() for a node exporter's textfile
+// collector: /run/bees/beekeeper.prom
+std::string default_file();
+
+// Write prometheus() to `path`, replacing it atomically
+bool write_file(const std::string &path);
+
+// Names used in both outputs
+const char *family_name(family what);
+const char *label_name(family what);
+
+} // namespace beekeeper::management::timings
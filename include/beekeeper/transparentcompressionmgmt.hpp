@@ -1,13 +1,26 @@
 #pragma once
 #include <string>
+#include <vector>
 
 namespace beekeeper::management::transparentcompression {
 
+// Named algorithm/level pairs offered by compressctl and the setup dialog
+struct preset {
+    std::string name;
+    std::string algorithm;
+    int level;
+};
+
+// Lightest first
+const std::vector<preset> &presets();
+
 bool is_enabled_for(const std::string &uuid);
 bool start(const std::string &uuid);
 bool pause(const std::string &uuid);
 void add_uuid(const std::string &uuid, const std::string &algorithm, int level);
 void remove_uuid(const std::string &uuid);
+// Algorithm and level configured for a filesystem; empty algorithm if none
+std::pair<std::string, int> configured_compression(const std::string &uuid);
 bool is_running(const std::string &uuid);
 bool is_not_running_for_at_least_one_mountpoint_of(const std::string &uuid);
 std::pair<std::string, std::string>
@@ -0,0 +1,55 @@
+#pragma once
+#include "beekeeper/btrfsetup.hpp"
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+// Hardware-aware defaults for bees.
+namespace beekeeper::management::tuning {
+
+struct hardware {
+    unsigned cores = 1;
+    uint64_t ram_bytes = 0;
+    bool rotational = false; // backing disk spins
+};
+
+// Probe cores, RAM and /sys/block/<disk>/queue/rotational for a filesystem
+hardware probe(const std::string &uuid);
+
+// Propose bees options for this hardware
+bees_options autotune(const hardware &hw);
+
+// Convenience: probe + autotune
+bees_options autotune(const std::string &uuid);
+
+// ----- Hash table (DB_SIZE) sizing -----
+
+// bees stores its hash table in 16 MiB extents
+constexpr uint64_t db_size_granularity = 16ULL * 1024 * 1024;
+constexpr uint64_t min_db_size = db_size_granularity;
+
+struct db_size_advice {
+    uint64_t recommended = 0;         // what we suggest writing as DB_SIZE
+    uint64_t ideal = 0;               // what the data alone would call for
+    uint64_t current = 0;             // DB_SIZE already configured, 0 if none
+    uint64_t used_bytes = 0;          // data on the filesystem, 0 if unknown
+    uint64_t budget = 0;              // RAM allowed for all hash tables together
+    uint64_t committed_elsewhere = 0; // DB_SIZE of every other configured filesystem
+    bool capped = false;              // recommended < ideal because of the budget
+};
+
+// DB_SIZE as written in a config: "1073741824", "$((1024*1024*1024))".
+// 0 when it is neither.
+uint64_t parse_db_size(std::string value);
+
+// DB_SIZE of every configured filesystem, keyed by UUID
+std::map<std::string, uint64_t> configured_db_sizes();
+
+// Default budget for all hash tables together: a quarter of the RAM
+uint64_t default_db_budget();
+
+// Recommend a DB_SIZE for this filesystem. budget = 0 uses default_db_budget().
+db_size_advice advise_db_size(const std::string &uuid, uint64_t budget = 0);
+
+} // namespace beekeeper::management::tuning
@@ -2,8 +2,10 @@
 #include "beekeeper/internalaliases.hpp"
 
 #include <cstddef>
+#include <memory>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include <QVariant>
@@ -63,6 +65,24 @@ namespace beekeeper {
         bool
         file_readable(const std::string& path);
 
+        // System root. BEEKEEPER_SYSROOT=<dir> makes the system locations
+        // beekeeper reads (/proc, /sys, /dev/disk, /etc/bees, /run/bees,
+        // /var/log/beesd, /var/lib/beekeeper-qt) resolve under <dir>, so a
+        // synthetic tree can stand in for the machine. Read once; empty
+        // when unset, and then nothing changes. Only builds with tests or
+        // benchmarks (BEEKEEPER_TEST_HOOKS) look at the variable.
+        const std::string &
+        system_root();
+
+        // An absolute system path, under the system root
+        std::string
+        system_path(const std::string &absolute);
+
+        // The inverse, for paths resolved inside the system root (symlink
+        // targets under /dev/disk/by-uuid): the path as the machine names it
+        std::string
+        system_relative(const std::string &path);
+
         // Check if running as root
         bool
         is_root ();
@@ -91,6 +111,18 @@ namespace beekeeper {
         std::string
         quote_if_needed(const std::string &input);
 
+        // Decimal numbers with a '.' whatever LC_NUMERIC says; std::stod and
+        // strtod follow the locale QCoreApplication sets from the environment.
+        // Parses a leading number like std::stod and throws
+        // std::invalid_argument when there is none. `consumed`, if given,
+        // receives the number of characters read.
+        double
+        to_double(std::string_view s, size_t *consumed = nullptr);
+
+        // Shortest form that reads back the same: 1.5, not 1,500000
+        std::string
+        format_double(double value);
+
         // Divide and apply the suffix to a byte size
         std::string
         auto_size_suffix(size_t size_in_bytes);
@@ -202,6 +234,123 @@ namespace beekeeper {
                                             bool case_insensitive = false,
                                             size_t max_coincidence_lines_count = 0);
 
+        // The needles of find_lines_matching_substring_in_*, compiled once.
+        // Lines are matched in place: nothing is copied or allocated per line.
+        // A "key=value" needle matches a key=value token of the line (quotes
+        // around the value ignored); any other needle matches a token
+        // containing it.
+        class line_matcher
+        {
+        public:
+            explicit line_matcher(const std::vector<std::string> &substrs_to_find,
+                                  bool case_insensitive = false);
+
+            bool matches(std::string_view line) const;
+
+            // Trimmed, non-empty lines of a whole buffer that match, as views into it
+            std::vector<std::string_view>
+            matching_lines(std::string_view buffer, size_t max_coincidence_lines_count = 0) const;
+
+        private:
+            struct needle {
+                bool is_kv = false;
+                bool has_space = false;  // can only match inside a quoted token
+                std::string key;         // lowercased when case-insensitive
+                std::string val;
+                std::string raw;
+            };
+
+            std::vector<needle> needles;
+            bool case_insensitive;
+        };
+
+        // Whole file in one buffer; empty if it cannot be read
+        std::string read_file(const std::string &path);
+
+        // A file or command output held in one buffer, handed out as
+        // string_view spans instead of a string per line and per token.
+        //
+        // Lifetimes: every view returned points into this object, either
+        // into the text itself or, for tokens whose text differs from the
+        // input (quotes dropped, escapes or octal sequences resolved), into
+        // its arena. Views from lines() and text() stay valid until the next
+        // load()/assign(); views from tokenize() and unescape_mount_field()
+        // until the next load()/assign()/clear_tokens(), which reuse the
+        // arena's memory instead of freeing it.
+        class text_buffer
+        {
+        public:
+            text_buffer() = default;
+            explicit text_buffer(std::string text) { assign(std::move(text)); }
+            ~text_buffer();
+
+            text_buffer(const text_buffer &) = delete;
+            text_buffer &operator=(const text_buffer &) = delete;
+
+            // Regular files are mapped, anything else (/proc, pipes) read
+            // with read(2). False (and empty) if the file cannot be opened.
+            bool load(const std::string &path);
+            // Take ownership of text already in memory (command output)
+            void assign(std::string text);
+
+            std::string_view text() const { return {data, size}; }
+
+            // Trimmed, non-empty lines, as read_lines_from_file gives them
+            const std::vector<std::string_view> &lines();
+
+            // Split like bk_util::tokenize, same quoting and escaping rules.
+            // The vector is reused by the next call.
+            const std::vector<std::string_view> &tokenize(std::string_view line, char split_char = ' ');
+
+            // unescape_proc_mount_field without a copy when nothing is escaped
+            std::string_view unescape_mount_field(std::string_view field);
+
+            // Forget the tokens, keep the arena's memory for the next ones
+            void clear_tokens();
+
+        private:
+            // Bump allocator for tokens that are not a span of the text.
+            // The token being built is always the last allocation, so it
+            // can grow in place.
+            class arena
+            {
+            public:
+                void begin(std::string_view prefix);
+                void push(char c);
+                void append(std::string_view text);
+                void pop() { if (used > start) --used; }
+                char back() const { return blocks[current].data[used - 1]; }
+                size_t length() const { return used - start; }
+                std::string_view finish();
+                void reset() { current = 0; used = start = 0; }
+
+            private:
+                struct block {
+                    std::unique_ptr<char[]> data;
+                    size_t capacity = 0;
+                };
+                void reserve(size_t extra);
+
+                std::vector<block> blocks;
+                size_t current = 0;
+                size_t used = 0;
+                size_t start = 0;
+            };
+
+            void release();
+
+            std::string owned;
+            void *mapping = nullptr;
+            const char *data = nullptr;
+            size_t size = 0;
+
+            std::vector<std::string_view> line_views;
+            bool lines_split = false;
+            std::vector<std::string_view> split_views;   // tokenize's first pass
+            std::vector<std::string_view> token_views;
+            arena tokens_arena;
+        };
+
         // For bk_mgmt::transparentcompression::start
         std::string
         unescape_proc_mount_field(const std::string &s);
@@ -229,5 +378,9 @@ namespace beekeeper {
             const fs_map &snapshot,
             const fs_map &fresh_list
         );
+
+        // fs_map as the JSON array `list --json` prints, and back (as the GUI reads it)
+        std::string fs_map_to_json(const fs_map &filesystems);
+        fs_map fs_map_from_json(const std::string &json);
     }
 }
\ No newline at end of file
@@ -8,11 +8,54 @@
 #include <vector>
 
 #include <QCoreApplication>
+#include <QDBusConnection>
+#include <QDBusInterface>
+#include <QDBusReply>
 #include <QTranslator>
 #include <QLocale>
 #include <QDir>
 #include <QStringList>
 
+// Run a clause in the helper, the way the GUI does
+static command_streams
+call_helper(const std::string &verb,
+            const std::map<std::string, std::string> &options,
+            const std::vector<std::string> &subjects)
+{
+    QDBusInterface helper("org.beekeeper.dbush", "/org/beekeeper/dbush", "org.beekeeper.dbush",
+                          QDBusConnection::systemBus());
+
+    // Starting bees may wait for its filesystem to show up
+    constexpr int helper_timeout_ms = 5 * 60 * 1000;
+    helper.setTimeout(helper_timeout_ms);
+
+    QVariantMap dbus_options;
+    for (const auto &[name, value] : options)
+        dbus_options.insert(QString::fromStdString(name), QString::fromStdString(value));
+
+    QStringList dbus_subjects;
+    for (const auto &subject : subjects)
+        dbus_subjects << QString::fromStdString(subject);
+
+    QDBusReply<QVariantMap> reply = helper.call("execute_clause", QString::fromStdString(verb),
+                                                dbus_options, dbus_subjects);
+    if (!reply.isValid()) {
+        return {
+            "",
+            clauses_registry::tr("Cannot reach the beekeeper helper: %1")
+                .arg(reply.error().message()).toStdString(),
+            1
+        };
+    }
+
+    const QVariantMap result = reply.value();
+    return {
+        result.value("stdout_str").toString().toStdString(),
+        result.value("stderr_str").toString().toStdString(),
+        result.value("errcode").toInt()
+    };
+}
+
 int main(int argc, char **argv)
 {
     // 1. Create QCoreApplication FIRST (removes Qt args from argc/argv)
@@ -71,6 +114,11 @@ int main(int argc, char **argv)
     std::string verb;
     std::map<std::string, std::string> options;
     std::vector<std::string> subjects;
+
+    // Value options are bound per verb; only the options actually given to
+    // the chosen verb reach its handler (see the end of parsing)
+    std::map<std::string, std::map<std::string, std::string>> values;
+    std::map<std::string, std::vector<std::pair<option_spec, CLI::Option *>>> verb_options;
     
     // Register each of the verbs dynamically
     for (const auto &[verb_name, meta] : clauses_registry) {
@@ -86,13 +134,10 @@ int main(int argc, char **argv)
             if (!option.short_name.empty())
                 opt_spec += ",-" + option.short_name;
             
-            if (option.requires_value) {
-                sub->add_option(opt_spec, options[option.long_name]);
-            } else {
-                sub->add_flag(opt_spec, [&](std::size_t) {
-                    options[option.long_name] = "true";
-                });
-            }
+            CLI::Option *opt = option.requires_value
+                ? sub->add_option(opt_spec, values[verb_name][option.long_name])
+                : sub->add_flag(opt_spec);
+            verb_options[verb_name].emplace_back(option, opt);
         }
         
         sub->add_option("subjects", subjects, "Subjects for this clause");
@@ -105,9 +150,18 @@ int main(int argc, char **argv)
     } catch (const CLI::ParseError &e) {
         return app.exit(e);
     }
+
+    for (const auto &[option, opt] : verb_options[verb]) {
+        if (opt->count() == 0)
+            continue;
+        options[option.long_name] = option.requires_value ? values[verb][option.long_name] : "true";
+    }
     
+    // bees started from here would write into a pipe that dies with us
     command_streams execution_result =
-        clauses_registry.at(verb).handler(options, subjects);
+        beekeeper::clauses::runs_in_helper(verb, options)
+            ? call_helper(verb, options, subjects)
+            : clauses_registry.at(verb).handler(options, subjects);
     
     if (!execution_result.stderr_str.empty())
         std::cerr << execution_result.stderr_str << std::endl;
@@ -1,10 +1,34 @@
 #include "beekeeper/beesdmgmt.hpp"
+#include "beekeeper/beeshomemgmt.hpp"
 #include "beekeeper/btrfsetup.hpp"
+#include "beekeeper/cgroupmgmt.hpp"
+#include "beekeeper/compressbenchmgmt.hpp"
+#include "beekeeper/compressibilitymgmt.hpp"
 #include "beekeeper/debug.hpp"
+#include "beekeeper/debuglogmgmt.hpp"
+#include "beekeeper/dedupemgmt.hpp"
+#include "beekeeper/dupscanmgmt.hpp"
+#include "beekeeper/incompressiblemgmt.hpp"
+#include "beekeeper/logringmgmt.hpp"
+#include "beekeeper/metricsmgmt.hpp"
+#include "beekeeper/recompressmgmt.hpp"
+#include "beekeeper/schedulemgmt.hpp"
+#include "beekeeper/spaceaccountmgmt.hpp"
+#include "beekeeper/spacehistorymgmt.hpp"
+#include "beekeeper/timingsmgmt.hpp"
 #include "beekeeper/transparentcompressionmgmt.hpp"
+#include "beekeeper/tuningmgmt.hpp"
 #include "beekeeper/util.hpp"
 #include "bk-clauses.hpp"
+#include <algorithm>
+#include <cmath>
+#include <ctime>
 #include <filesystem> // for std::setw
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <type_traits>
 #include <string>
 #include <sstream>
 
@@ -32,12 +56,15 @@ clauses::start(const clause_options &options,
     bool enable_logging = options.find("enable-logging") != options.end();
     
     for (const auto& uuid : subjects) {
+        // Output is always kept in memory; this decides about log files
+        bk_mgmt::logring::keep_files(uuid, enable_logging);
+
         if (bk_mgmt::beesstart(uuid)) {
             if (enable_logging) {
-                cout << clauses_registry::tr("Started beesd for %1").arg(uuid).toStdString();
+                cout << clauses_registry::tr("Started beesd for %1 with logging enabled").arg(uuid).toStdString();
 
             } else {
-                cout << clauses_registry::tr("Started beesd for %1 with logging enabled").arg(uuid).toStdString();
+                cout << clauses_registry::tr("Started beesd for %1").arg(uuid).toStdString();
             }
 
             cout << '\n';
@@ -99,8 +126,67 @@ clauses::status(const clause_options &options,
     std::ostringstream cerr;
     int errcode = 0;
 
+    bool want_cgroup = options.find("cgroup") != options.end();
+    bool want_json = options.find("json") != options.end();
+
+    if (want_json) {
+        cout << "[";
+    }
+
+    bool first_json_item = true;
+
     for (const auto& uuid : subjects) {
-        cout << clauses_registry::tr("Status for %1: %2").arg(uuid, bk_mgmt::beesstatus(uuid)).toStdString() << '\n';
+        std::string status = bk_mgmt::beesstatus(uuid);
+
+        if (!want_json) {
+            cout << clauses_registry::tr("Status for %1: %2").arg(uuid, status).toStdString() << '\n';
+        } else {
+            if (!first_json_item) cout << ",";
+            first_json_item = false;
+
+            cout << "\n  {"
+                 << "\"uuid\":\"" << bk_util::json_escape(uuid) << "\","
+                 << "\"status\":\"" << bk_util::json_escape(status) << "\"";
+        }
+
+        if (want_cgroup) {
+            auto cg = bk_mgmt::cgroup::read_stats(uuid);
+
+            if (want_json) {
+                cout << ",\"cgroup\":{"
+                     << "\"available\":" << (cg.available ? "true" : "false") << ","
+                     << "\"cpu_usage_usec\":" << cg.cpu_usage_usec << ","
+                     << "\"cpu_user_usec\":" << cg.cpu_user_usec << ","
+                     << "\"cpu_system_usec\":" << cg.cpu_system_usec << ","
+                     << "\"cpu_throttled_usec\":" << cg.cpu_throttled_usec << ","
+                     << "\"io_rbytes\":" << cg.io_rbytes << ","
+                     << "\"io_wbytes\":" << cg.io_wbytes << ","
+                     << "\"io_rios\":" << cg.io_rios << ","
+                     << "\"io_wios\":" << cg.io_wios << ","
+                     << "\"memory_current\":" << cg.memory_current
+                     << "}";
+            } else if (cg.available) {
+                cout << '\t' << clauses_registry::tr("CPU time: %1 s (%2 s throttled)")
+                                    .arg(std::to_string(cg.cpu_usage_usec / 1000000),
+                                         std::to_string(cg.cpu_throttled_usec / 1000000)).toStdString() << '\n'
+                     << '\t' << clauses_registry::tr("I/O: %1 read, %2 written")
+                                    .arg(bk_util::auto_size_suffix(cg.io_rbytes),
+                                         bk_util::auto_size_suffix(cg.io_wbytes)).toStdString() << '\n'
+                     << '\t' << clauses_registry::tr("Memory: %1")
+                                    .arg(bk_util::auto_size_suffix(cg.memory_current)).toStdString() << '\n';
+            } else {
+                cout << '\t' << clauses_registry::tr("No cgroup for this filesystem").toStdString() << '\n';
+            }
+        }
+
+        if (want_json) {
+            cout << "}";
+        }
+    }
+
+    if (want_json) {
+        if (!first_json_item) cout << '\n';
+        cout << "]" << std::endl;
     }
     
     RETURN_COMMANDSTREAMS
@@ -113,8 +199,61 @@ clauses::log(const clause_options &options,
     std::ostringstream cout;
     std::ostringstream cerr;
     int errcode = 0;
-    
-    // Deactivated, may remove
+
+    bool want_json = options.find("json") != options.end();
+
+    uint64_t since = 0;
+    if (std::string given = option_value(options, "since"); !given.empty()) {
+        try {
+            since = std::stoull(given);
+        } catch (...) {
+            cerr << clauses_registry::tr("Invalid cursor: %1").arg(given).toStdString() << '\n';
+            errcode = 1;
+            RETURN_COMMANDSTREAMS
+        }
+    }
+
+    if (want_json) {
+        cout << "[";
+    }
+
+    bool first_json_item = true;
+
+    for (const auto &uuid : subjects) {
+        auto captured = bk_mgmt::logring::read(uuid, since);
+
+        if (want_json) {
+            if (!first_json_item) cout << ",";
+            first_json_item = false;
+
+            cout << "\n  {"
+                 << "\"uuid\":\"" << bk_util::json_escape(uuid) << "\","
+                 << "\"cursor\":" << captured.cursor << ","
+                 << "\"lost\":" << (captured.lost ? "true" : "false") << ","
+                 << "\"lines\":[";
+
+            bool first_line = true;
+            for (const auto &line : captured.lines) {
+                if (!first_line) cout << ",";
+                first_line = false;
+                cout << "\"" << bk_util::json_escape(line) << "\"";
+            }
+            cout << "]}";
+            continue;
+        }
+
+        if (captured.lost)
+            cout << clauses_registry::tr("[... earlier output of %1 was overwritten ...]").arg(uuid).toStdString() << '\n';
+
+        for (const auto &line : captured.lines)
+            cout << line << '\n';
+    }
+
+    if (want_json) {
+        if (!first_json_item) cout << '\n';
+        cout << "]" << std::endl;
+    }
+
     RETURN_COMMANDSTREAMS
 }
 
@@ -173,8 +312,112 @@ clauses::setup(const clause_options &options,
     std::string uuid = subjects.empty() ? "" : subjects[0];
     size_t db_size = 0;
 
+    uint64_t budget = 0;
+    auto ib = options.find("budget");
+    if (ib != options.end()) {
+        try {
+            budget = std::stoull(ib->second);
+        } catch (...) {
+            budget = 0;
+        }
+        if (budget == 0) {
+            if (json_mode) emit_json(0, "Error: budget must be a positive integer.");
+            else cerr << clauses_registry::tr("Error: budget must be a positive integer.").toStdString() << '\n';
+            errcode = 1;
+            RETURN_COMMANDSTREAMS
+        }
+    }
+
+    // Hash table sizing advice only, nothing is written
+    if (options.count("advise")) {
+        auto advice = bk_mgmt::tuning::advise_db_size(uuid, budget);
+
+        if (json_mode) {
+            cout
+                << "{\n"
+                << "  \"uuid\": \"" << bk_util::json_escape(uuid) << "\",\n"
+                << "  \"recommended\": " << advice.recommended << ",\n"
+                << "  \"ideal\": " << advice.ideal << ",\n"
+                << "  \"current\": " << advice.current << ",\n"
+                << "  \"used\": " << advice.used_bytes << ",\n"
+                << "  \"budget\": " << advice.budget << ",\n"
+                << "  \"committed_elsewhere\": " << advice.committed_elsewhere << ",\n"
+                << "  \"capped\": " << (advice.capped ? "true" : "false") << "\n"
+                << "}\n";
+        } else {
+            cout << clauses_registry::tr("Recommended DB_SIZE: %1 (%2)")
+                        .arg(std::to_string(advice.recommended), bk_util::auto_size_suffix(advice.recommended))
+                        .toStdString() << '\n';
+            if (advice.current)
+                cout << clauses_registry::tr("Current DB_SIZE: %1")
+                            .arg(bk_util::auto_size_suffix(advice.current)).toStdString() << '\n';
+            if (advice.capped)
+                cout << clauses_registry::tr("Capped by the RAM budget: %1 ideal, %2 of %3 already used by other filesystems")
+                            .arg(bk_util::auto_size_suffix(advice.ideal),
+                                 bk_util::auto_size_suffix(advice.committed_elsewhere),
+                                 bk_util::auto_size_suffix(advice.budget))
+                            .toStdString() << '\n';
+        }
+        RETURN_COMMANDSTREAMS
+    }
+
+    // Hash table file state only
+    if (options.count("inspect")) {
+        auto info = bk_mgmt::beeshome::inspect(uuid);
+        bool fragmented = bk_mgmt::beeshome::is_fragmented(info);
+
+        if (json_mode) {
+            cout
+                << "{\n"
+                << "  \"uuid\": \"" << bk_util::json_escape(uuid) << "\",\n"
+                << "  \"beeshome\": \"" << bk_util::json_escape(info.beeshome) << "\",\n"
+                << "  \"exists\": " << (info.exists ? "true" : "false") << ",\n"
+                << "  \"size\": " << info.size << ",\n"
+                << "  \"extents\": " << info.extents << ",\n"
+                << "  \"nocow\": " << (info.nocow ? "true" : "false") << ",\n"
+                << "  \"fragmented\": " << (fragmented ? "true" : "false") << "\n"
+                << "}\n";
+        } else if (!info.exists) {
+            cout << clauses_registry::tr("No hash table yet for %1").arg(uuid).toStdString() << '\n';
+        } else {
+            cout << clauses_registry::tr("BEESHOME: %1")
+                        .arg(info.beeshome.empty() ? std::string("(default)") : info.beeshome).toStdString() << '\n'
+                 << clauses_registry::tr("Hash table: %1, %2 extents, %3")
+                        .arg(bk_util::auto_size_suffix(info.size),
+                             std::to_string(info.extents),
+                             info.nocow ? std::string("NOCOW") : std::string("copy-on-write")).toStdString() << '\n';
+            if (fragmented)
+                cout << clauses_registry::tr("The hash table is heavily fragmented. Stop bees and run setup again to rewrite it.")
+                            .toStdString() << '\n';
+        }
+        RETURN_COMMANDSTREAMS
+    }
+
+    // Hash table placement; "default" goes back to the filesystem itself
+    std::optional<std::string> beeshome;
+    std::optional<std::string> previous_beeshome;
+
+    auto ih = options.find("beeshome");
+    if (ih != options.end()) {
+        std::string v = bk_util::trim_string(ih->second);
+        if (v == "default" || v == "<default>")
+            v.clear();
+
+        if (!v.empty() && v.front() != '/') {
+            if (json_mode) emit_json(0, "Error: beeshome must be an absolute path.");
+            else cerr << clauses_registry::tr("Error: beeshome must be an absolute path.").toStdString() << '\n';
+            errcode = 1;
+            RETURN_COMMANDSTREAMS
+        }
+
+        beeshome = v;
+        previous_beeshome = bk_mgmt::beeshome::configured(uuid);
+    }
+
     auto it = options.find("db-size");
-    if (it != options.end()) {
+    if (it != options.end() && bk_util::to_lower(bk_util::trim_string(it->second)) == "auto") {
+        db_size = bk_mgmt::tuning::advise_db_size(uuid, budget).recommended;
+    } else if (it != options.end()) {
         try {
             db_size = std::stoull(it->second);
             if (db_size == 0) {
@@ -215,11 +458,90 @@ clauses::setup(const clause_options &options,
         RETURN_COMMANDSTREAMS
     }
 
+    // Performance options: start from auto-tune or from what is configured,
+    // then apply the explicit ones on top
+    static const std::vector<std::string> perf_keys = {
+        "thread-count", "thread-factor", "loadavg-target", "scan-mode", "throttle-factor"
+    };
+
+    bool auto_tune = options.count("auto-tune") > 0;
+    bool any_perf_key = std::any_of(perf_keys.begin(), perf_keys.end(),
+                                    [&options](const std::string &k) { return options.count(k) > 0; });
+
+    std::optional<bk_mgmt::bees_options> perf;
+
+    if (auto_tune || any_perf_key) {
+        bk_mgmt::bees_options o = auto_tune ? bk_mgmt::tuning::autotune(uuid)
+                                            : bk_mgmt::read_bees_options(uuid);
+
+        std::string bad_key;
+
+        // "default" clears a knob; returns false on garbage
+        auto parse = [&options, &bad_key](const std::string &key, auto &field, auto unset) {
+            auto it = options.find(key);
+            if (it == options.end()) return;
+
+            std::string v = bk_util::to_lower(bk_util::trim_string(it->second));
+            if (v == "default" || v == "<default>") { field = unset; return; }
+
+            try {
+                if constexpr (std::is_same_v<std::decay_t<decltype(field)>, int>)
+                    field = std::stoi(v);
+                else
+                    field = bk_util::to_double(v);
+            } catch (...) {
+                bad_key = key;
+            }
+        };
+
+        parse("thread-count", o.thread_count, 0);
+        parse("thread-factor", o.thread_factor, 0.0);
+        parse("loadavg-target", o.loadavg_target, 0.0);
+        parse("scan-mode", o.scan_mode, -1);
+        parse("throttle-factor", o.throttle_factor, 0.0);
+
+        if (bad_key.empty() && (o.scan_mode < -1 || o.scan_mode > 4))
+            bad_key = "scan-mode";
+
+        if (!bad_key.empty()) {
+            if (json_mode) emit_json(0, "Error: Invalid --" + bad_key + " value.");
+            else cerr << clauses_registry::tr("Error: Invalid --%1 value.").arg(bad_key).toStdString() << '\n';
+            errcode = 1;
+            RETURN_COMMANDSTREAMS
+        }
+
+        perf = o;
+    }
+
+    // cgroup limits; "default" clears one
+    std::map<std::string, std::string> limits;
+    for (const auto &key : bk_mgmt::cgroup::limit_keys) {
+        std::string v = bk_util::trim_string(option_value(options, key.option));
+        if (v.empty())
+            continue;
+        limits[key.config_key] = bk_util::to_lower(v) == "default" ? "" : v;
+    }
+
     // Normal setup
-    std::string config_path = bk_mgmt::beessetup(uuid, db_size);
+    std::string config_path = bk_mgmt::beessetup(uuid, db_size, perf, beeshome, limits);
     if (!config_path.empty()) {
-        if (json_mode) emit_json(1, "Configuration created/updated: " + config_path);
-        else cout << clauses_registry::tr("Configuration created/updated: %1").arg(config_path).toStdString() << '\n';
+        // Pre-allocate the hash table; beesstart retries if bees is busy now
+        bool hash_ready = bk_mgmt::beeshome::prepare(uuid, previous_beeshome);
+
+        if (json_mode) {
+            emit_json(1, "Configuration created/updated: " + config_path
+                         + (hash_ready ? "" : " (hash table will be prepared on next start)"));
+        } else {
+            cout << clauses_registry::tr("Configuration created/updated: %1").arg(config_path).toStdString() << '\n';
+            if (!hash_ready)
+                cout << clauses_registry::tr("Hash table not prepared now, it will be on the next start of bees.")
+                            .toStdString() << '\n';
+        }
+
+        if (perf && !json_mode) {
+            std::string args = bk_util::serialize_vector(bk_mgmt::bees_options_to_args(*perf));
+            cout << clauses_registry::tr("bees options: %1").arg(args).toStdString() << '\n';
+        }
         errcode = 0;
         RETURN_COMMANDSTREAMS
     } else {
@@ -303,37 +625,7 @@ clauses::list(const clause_options &options,
 
     if (want_json) {
         // Emit compact JSON array for machine consumption
-        std::ostringstream out;
-        out << '[';
-
-        bool is_first = true;
-        for (const auto &[uuid, info] : filesystems) {
-            if (!is_first) {
-                out << ",";
-            }
-
-            is_first = false;
-
-            std::string label   = info.label;
-            std::string status  = info.status;
-            std::string devname = info.devname;
-            std::string config_path = info.config;
-            bool compressing = info.compressing;
-            bool autostart = info.autostart;
-
-            out << '{';
-            out << "\"uuid\":\""    << bk_util::json_escape(uuid)    << "\",";
-            out << "\"label\":\""   << bk_util::json_escape(label)   << "\",";
-            out << "\"status\":\""  << bk_util::json_escape(status)  << "\",";
-            out << "\"devname\":\"" << bk_util::json_escape(devname) << "\",";
-            out << "\"config\":\""  << bk_util::json_escape(config_path) << "\",";
-            out << "\"compressing\":" << (compressing ? "true" : "false") << ",";
-            out << "\"autostart\":" << (autostart ? "true" : "false") << "";
-            out << '}';
-        }
-
-        out << ']';
-        cout << out.str() << std::endl;
+        cout << bk_util::fs_map_to_json(filesystems) << std::endl;
         errcode = 0;
         RETURN_COMMANDSTREAMS
     }
@@ -513,12 +805,90 @@ clauses::autostartctl(const clause_options &options,
     
     bool add = options.find("add") != options.end();
     bool remove = options.find("remove") != options.end();
+    bool next = options.find("next") != options.end();
+    bool want_json = options.find("json") != options.end();
+
+    // Windows may be separated by spaces or semicolons
+    std::vector<std::string> windows;
+    if (std::string schedule = option_value(options, "schedule"); !schedule.empty()) {
+        for (const auto &group : bk_util::tokenize(schedule, ';')) {
+            for (const auto &spec : bk_util::tokenize(group)) {
+                windows.push_back(spec);
+            }
+        }
+    }
+
+    bool pause_when_idle = false;
+    if (std::string idle = bk_util::to_lower(bk_util::trim_string(option_value(options, "idle"))); !idle.empty()) {
+        if (idle == "pause") {
+            pause_when_idle = true;
+        } else if (idle != "stop") {
+            cerr << clauses_registry::tr("Invalid --idle value %1, expected stop or pause").arg(idle).toStdString() << '\n';
+            errcode = 1;
+            RETURN_COMMANDSTREAMS
+        }
+    }
+
+    if (next && want_json) {
+        cout << "[";
+    }
+
+    bool first_json_item = true;
 
     for (const std::string &uuid_str : subjects) {
-        if (add)
+        if (add) {
+            if (!windows.empty() && !bk_mgmt::schedule::set(uuid_str, windows, pause_when_idle)) {
+                cerr << clauses_registry::tr("Invalid schedule for %1").arg(uuid_str).toStdString() << '\n';
+                errcode = 1;
+                continue;
+            }
             bk_mgmt::autostart::add_uuid(uuid_str);
-        else if (remove)
+        } else if (remove) {
             bk_mgmt::autostart::remove_uuid(uuid_str);
+            bk_mgmt::schedule::remove(uuid_str);
+        } else if (next) {
+            auto plan = bk_mgmt::schedule::fetch(uuid_str);
+            std::time_t now = std::time(nullptr);
+
+            int active = plan ? bk_mgmt::schedule::active_window(*plan, now) : -1;
+            std::time_t when = plan ? bk_mgmt::schedule::next_transition(*plan, now) : 0;
+            int after = when ? bk_mgmt::schedule::active_window(*plan, when) : active;
+
+            if (want_json) {
+                if (!first_json_item) cout << ",";
+                first_json_item = false;
+
+                cout << "\n  {"
+                     << "\"uuid\":\"" << bk_util::json_escape(uuid_str) << "\","
+                     << "\"scheduled\":" << (plan ? "true" : "false") << ","
+                     << "\"active_window\":" << active << ","
+                     << "\"next_transition\":" << static_cast<long long>(when) << ","
+                     << "\"next_window\":" << after << ","
+                     << "\"pause_when_idle\":" << (plan && plan->pause_when_idle ? "true" : "false")
+                     << "}";
+            } else if (!plan) {
+                cout << clauses_registry::tr("%1: no schedule").arg(uuid_str).toStdString() << '\n';
+            } else if (!when) {
+                cout << clauses_registry::tr("%1: no upcoming transition").arg(uuid_str).toStdString() << '\n';
+            } else {
+                char when_str[32];
+                std::tm tm {};
+                localtime_r(&when, &tm);
+                std::strftime(when_str, sizeof(when_str), "%a %H:%M", &tm);
+
+                cout << uuid_str << ": "
+                     << (after < 0
+                            ? clauses_registry::tr("goes idle at %1").arg(std::string(when_str)).toStdString()
+                            : clauses_registry::tr("runs window %1 from %2")
+                                .arg(bk_mgmt::schedule::format_window(plan->windows[after]), std::string(when_str)).toStdString())
+                     << '\n';
+            }
+        }
+    }
+
+    if (next && want_json) {
+        if (!first_json_item) cout << '\n';
+        cout << "]" << std::endl;
     }
 
     RETURN_COMMANDSTREAMS
@@ -539,33 +909,111 @@ clauses::compressctl(const clause_options &options,
     bool status = options.find("status") != options.end() || options.find("i") != options.end();
     bool add    = options.find("add")    != options.end() || options.find("a") != options.end();
     bool remove = options.find("remove") != options.end() || options.find("r") != options.end();
+    bool analyze = options.find("analyze") != options.end();
+    bool cancel_analysis = options.find("cancel-analysis") != options.end();
+    bool benchmark = options.find("benchmark") != options.end();
+
+    std::string recompress_action;
+    if (auto it = options.find("recompress"); it != options.end())
+        recompress_action = it->second == "<default>" ? "status" : bk_util::to_lower(it->second);
+    bool recompress = !recompress_action.empty();
+
+    std::string incompressible_action;
+    if (auto it = options.find("incompressible"); it != options.end())
+        incompressible_action = it->second == "<default>" ? "scan" : bk_util::to_lower(it->second);
+    bool incompressible = !incompressible_action.empty();
 
     bool want_json = (options.find("json") != options.end()) || (options.find("j") != options.end());
 
+    bk_mgmt::compressibility::options analyze_opts;
+    if (analyze) {
+        try {
+            if (std::string samples = option_value(options, "samples"); !samples.empty())
+                analyze_opts.samples = static_cast<unsigned>(std::stoul(samples));
+            if (std::string budget = option_value(options, "cpu-budget"); !budget.empty())
+                analyze_opts.cpu_budget = bk_util::to_double(budget);
+        } catch (...) {
+            cerr << clauses_registry::tr("Invalid --samples or --cpu-budget value").toStdString() << '\n';
+            errcode = 1;
+            RETURN_COMMANDSTREAMS
+        }
+    }
+
+    bk_mgmt::compressbench::options benchmark_opts;
+    if (benchmark) {
+        try {
+            if (std::string size = option_value(options, "size"); !size.empty())
+                benchmark_opts.bytes_per_preset = std::stoull(size) * 1024 * 1024;
+        } catch (...) {
+            cerr << clauses_registry::tr("Invalid --size value").toStdString() << '\n';
+            errcode = 1;
+            RETURN_COMMANDSTREAMS
+        }
+
+        if (std::string mix = option_value(options, "mix");
+            !mix.empty() && !bk_mgmt::compressbench::parse_mix(mix, benchmark_opts.data)) {
+            cerr << clauses_registry::tr("Invalid --mix value: %1 (expected e.g. text:60,random:30,zeros:10)")
+                        .arg(mix).toStdString() << '\n';
+            errcode = 1;
+            RETURN_COMMANDSTREAMS
+        }
+    }
+
+    bk_mgmt::recompress::limits recompress_limits;
+    if (recompress) {
+        if (recompress_action != "start" && recompress_action != "pause"
+            && recompress_action != "cancel" && recompress_action != "status") {
+            cerr << clauses_registry::tr("Unknown --recompress action: %1").arg(recompress_action).toStdString() << '\n';
+            errcode = 1;
+            RETURN_COMMANDSTREAMS
+        }
+
+        try {
+            if (std::string rate = option_value(options, "rate"); !rate.empty())
+                recompress_limits.bytes_per_sec = bk_util::to_double(rate) * 1024 * 1024;
+            if (std::string iops = option_value(options, "iops"); !iops.empty())
+                recompress_limits.ops_per_sec = bk_util::to_double(iops);
+        } catch (...) {
+            cerr << clauses_registry::tr("Invalid --rate or --iops value").toStdString() << '\n';
+            errcode = 1;
+            RETURN_COMMANDSTREAMS
+        }
+    }
+
+    bk_mgmt::incompressible::options incompressible_opts;
+    if (incompressible) {
+        if (incompressible_action != "scan" && incompressible_action != "apply" && incompressible_action != "undo") {
+            cerr << clauses_registry::tr("Unknown --incompressible action: %1").arg(incompressible_action).toStdString() << '\n';
+            errcode = 1;
+            RETURN_COMMANDSTREAMS
+        }
+
+        try {
+            if (std::string threshold = option_value(options, "threshold"); !threshold.empty())
+                incompressible_opts.threshold = bk_util::to_double(threshold) / 100;
+        } catch (...) {
+            cerr << clauses_registry::tr("Invalid --threshold value").toStdString() << '\n';
+            errcode = 1;
+            RETURN_COMMANDSTREAMS
+        }
+    }
+
     std::string algo;
     int level = 0;
 
     if (add) {
-        // Preset mapping
-        static const std::unordered_map<std::string, std::pair<std::string, int>> preset_map = {
-            {"feather",     {"lzo", 0}},
-            {"light",       {"zstd", 1}},
-            {"balanced",    {"zstd", 3}},
-            {"high",        {"zstd", 6}},
-            {"harder",      {"zstd", 10}},
-            {"maximum",     {"zstd", 15}}
-        };
-
         // 1) --compression-level / -c
         auto it_comp = options.find("compression-level");
 
         if (it_comp != options.end()) {
             std::string preset = bk_util::to_lower(it_comp->second);
             if (preset == "<default>") preset = "";          // normalize <default>
-            auto it = preset_map.find(preset);
-            if (it != preset_map.end()) {
-                algo = it->second.first;
-                level = it->second.second;
+            const auto &presets = tc::presets();
+            auto it = std::find_if(presets.begin(), presets.end(),
+                                   [&](const tc::preset &p) { return p.name == preset; });
+            if (it != presets.end()) {
+                algo = it->algorithm;
+                level = it->level;
             } else if (!preset.empty()) {                    // unknown preset, warn
                 DEBUG_LOG("[compressctl] unknown compression-level preset: ", preset);
                 algo = "lzo";
@@ -604,14 +1052,285 @@ clauses::compressctl(const clause_options &options,
             algo = "lzo";
     }
 
-    if (status && want_json) {
+    bool json_list = want_json && (status || analyze || benchmark || recompress_action == "status" || incompressible);
+
+    if (json_list) {
         cout << "[";
     }
 
     bool first_json_item = true;
 
     for (const std::string &uuid_str : subjects) {
-        if (start) {
+        if (recompress) {
+            namespace rc = bk_mgmt::recompress;
+            DEBUG_LOG("[compressctl] recompress ", recompress_action, " for UUID ", uuid_str);
+
+            if (recompress_action == "start") {
+                if (!rc::start(uuid_str, recompress_limits)) {
+                    cerr << clauses_registry::tr("%1: cannot recompress (not mounted, or no compression configured)")
+                                .arg(uuid_str).toStdString() << '\n';
+                    errcode = 1;
+                }
+                continue;
+            }
+            if (recompress_action == "pause") {
+                if (!rc::pause(uuid_str))
+                    cerr << clauses_registry::tr("%1: no recompression running").arg(uuid_str).toStdString() << '\n';
+                continue;
+            }
+            if (recompress_action == "cancel") {
+                rc::cancel(uuid_str);
+                continue;
+            }
+
+            auto p = rc::status(uuid_str);
+            double fraction = p.bytes_total ? std::min(1.0, static_cast<double>(p.bytes_visited) / static_cast<double>(p.bytes_total)) : 0;
+            if (p.state == "done") fraction = 1;
+
+            if (want_json) {
+                if (!first_json_item) cout << ",";
+                first_json_item = false;
+
+                cout << "\n  {"
+                     << "\"uuid\":\"" << bk_util::json_escape(uuid_str) << "\","
+                     << "\"state\":\"" << p.state << "\","
+                     << "\"algorithm\":\"" << p.algorithm << "\","
+                     << "\"level\":" << p.level << ","
+                     << "\"progress\":" << fraction << ","
+                     << "\"bytes_total\":" << p.bytes_total << ","
+                     << "\"bytes_visited\":" << p.bytes_visited << ","
+                     << "\"bytes_rewritten\":" << p.bytes_rewritten << ","
+                     << "\"bytes_skipped\":" << p.bytes_skipped << ","
+                     << "\"files_done\":" << p.files_done << ","
+                     << "\"files_skipped\":" << p.files_skipped << ","
+                     << "\"errors\":" << p.errors << ","
+                     << "\"started\":" << p.started << ","
+                     << "\"updated\":" << p.updated
+                     << "}";
+                continue;
+            }
+
+            if (p.state.empty()) {
+                cout << uuid_str << ": " << clauses_registry::tr("no recompression").toStdString() << '\n';
+                continue;
+            }
+
+            cout << uuid_str << ": "
+                 << clauses_registry::tr("recompression %1 with %2, %3% (%4 rewritten, %5 left as is), %6 files")
+                        .arg(p.state, p.algorithm,
+                             std::to_string(static_cast<int>(fraction * 100)),
+                             bk_util::auto_size_suffix(p.bytes_rewritten),
+                             bk_util::auto_size_suffix(p.bytes_skipped),
+                             std::to_string(p.files_done)).toStdString() << '\n';
+        } else if (incompressible) {
+            namespace inc = bk_mgmt::incompressible;
+            DEBUG_LOG("[compressctl] incompressible ", incompressible_action, " for UUID ", uuid_str);
+
+            if (incompressible_action == "undo") {
+                size_t reverted = inc::undo(uuid_str);
+                if (want_json) {
+                    if (!first_json_item) cout << ",";
+                    first_json_item = false;
+                    cout << "\n  {\"uuid\":\"" << bk_util::json_escape(uuid_str) << "\",\"reverted\":" << reverted << "}";
+                } else {
+                    cout << uuid_str << ": "
+                         << clauses_registry::tr("compression re-enabled on %1 directories").arg(std::to_string(reverted)).toStdString()
+                         << '\n';
+                }
+                continue;
+            }
+
+            // Scanning is the dry run; apply acts on a fresh scan
+            auto r = inc::scan(uuid_str, incompressible_opts);
+            if (!r.available) {
+                cerr << clauses_registry::tr("%1: not mounted").arg(uuid_str).toStdString() << '\n';
+                errcode = 1;
+                continue;
+            }
+            size_t set = incompressible_action == "apply" ? inc::apply(uuid_str, r) : 0;
+
+            if (want_json) {
+                if (!first_json_item) cout << ",";
+                first_json_item = false;
+
+                cout << "\n  {"
+                     << "\"uuid\":\"" << bk_util::json_escape(uuid_str) << "\","
+                     << "\"partial\":" << (r.partial_walk ? "true" : "false") << ","
+                     << "\"threshold\":" << incompressible_opts.threshold << ","
+                     << "\"applied\":" << set << ","
+                     << "\"directories\":[";
+
+                bool first_dir = true;
+                for (const auto &d : r.directories) {
+                    if (!first_dir) cout << ",";
+                    first_dir = false;
+                    cout << "{"
+                         << "\"path\":\"" << bk_util::json_escape(d.path) << "\","
+                         << "\"current\":\"" << bk_util::json_escape(d.current) << "\","
+                         << "\"sampled\":" << d.sampled << ","
+                         << "\"entropy\":" << d.entropy << ","
+                         << "\"saved\":" << d.saved_fraction << ","
+                         << "\"incompressible\":" << (d.incompressible ? "true" : "false")
+                         << "}";
+                }
+                cout << "]}";
+                continue;
+            }
+
+            size_t flagged = 0;
+            cout << uuid_str << ":" << (r.partial_walk ? " " + clauses_registry::tr("(walk cut short)").toStdString() : std::string()) << '\n';
+            for (const auto &d : r.directories) {
+                if (!d.incompressible) continue;
+                ++flagged;
+                cout << '\t' << clauses_registry::tr("%1: saves %2% (%3 bits/byte)%4")
+                                    .arg(d.path,
+                                         std::to_string(static_cast<int>(std::lround(d.saved_fraction * 100))),
+                                         std::to_string(d.entropy).substr(0, 4),
+                                         d.current.empty() ? std::string()
+                                                           : clauses_registry::tr(", already set to %1").arg(d.current).toStdString())
+                                    .toStdString() << '\n';
+            }
+
+            if (incompressible_action == "apply")
+                cout << '\t' << clauses_registry::tr("compression disabled on %1 directories").arg(std::to_string(set)).toStdString() << '\n';
+            else
+                cout << '\t' << clauses_registry::tr("%1 of %2 directories would get btrfs.compression=none (dry run)")
+                                    .arg(std::to_string(flagged), std::to_string(r.directories.size())).toStdString() << '\n';
+        } else if (benchmark) {
+            DEBUG_LOG("[compressctl] benchmark compression presets for UUID ", uuid_str);
+
+            auto rep = bk_mgmt::compressbench::run(uuid_str, benchmark_opts);
+
+            if (want_json) {
+                if (!first_json_item) cout << ",";
+                first_json_item = false;
+
+                cout << "\n  {"
+                     << "\"uuid\":\"" << bk_util::json_escape(uuid_str) << "\","
+                     << "\"available\":" << (rep.available ? "true" : "false") << ","
+                     << "\"when\":" << rep.when << ","
+                     << "\"bytes_per_preset\":" << rep.bytes_per_preset << ","
+                     << "\"results\":[";
+
+                bool first_result = true;
+                for (const auto &r : rep.results) {
+                    if (!first_result) cout << ",";
+                    first_result = false;
+                    cout << "{"
+                         << "\"preset\":\"" << r.preset << "\","
+                         << "\"algorithm\":\"" << r.algorithm << "\","
+                         << "\"level\":" << r.level << ","
+                         << "\"ok\":" << (r.ok ? "true" : "false") << ","
+                         << "\"write_bytes_per_sec\":" << r.write_bytes_per_sec << ","
+                         << "\"read_bytes_per_sec\":" << r.read_bytes_per_sec << ","
+                         << "\"cpu_seconds\":" << r.cpu_seconds << ","
+                         << "\"p50_ms\":" << r.p50_ms << ","
+                         << "\"p90_ms\":" << r.p90_ms << ","
+                         << "\"p99_ms\":" << r.p99_ms
+                         << "}";
+                }
+                cout << "]}";
+                continue;
+            }
+
+            if (!rep.available) {
+                cerr << clauses_registry::tr("%1: cannot benchmark (not mounted, or not enough free space)")
+                            .arg(uuid_str).toStdString() << '\n';
+                errcode = 1;
+                continue;
+            }
+
+            cout << uuid_str << ":\n";
+            for (const auto &r : rep.results) {
+                cout << "\t  " << std::left << std::setw(12) << r.preset;
+                if (!r.ok) {
+                    cout << clauses_registry::tr("failed").toStdString() << '\n';
+                    continue;
+                }
+                cout << clauses_registry::tr("write %1/s, read %2/s, %3 CPU s, latency p50 %4 ms, p90 %5 ms, p99 %6 ms")
+                            .arg(bk_util::auto_size_suffix(static_cast<size_t>(r.write_bytes_per_sec)),
+                                 bk_util::auto_size_suffix(static_cast<size_t>(r.read_bytes_per_sec)),
+                                 std::to_string(r.cpu_seconds).substr(0, 5),
+                                 std::to_string(std::lround(r.p50_ms)),
+                                 std::to_string(std::lround(r.p90_ms)),
+                                 std::to_string(std::lround(r.p99_ms)))
+                            .toStdString() << '\n';
+            }
+        } else if (cancel_analysis) {
+            if (!bk_mgmt::compressibility::cancel(uuid_str))
+                cerr << clauses_registry::tr("%1: no compression analysis running").arg(uuid_str).toStdString() << '\n';
+        } else if (analyze) {
+            DEBUG_LOG("[compressctl] analyze compressibility for UUID ", uuid_str);
+
+            auto a = bk_mgmt::compressibility::analyze(uuid_str, analyze_opts);
+
+            if (want_json) {
+                if (!first_json_item) cout << ",";
+                first_json_item = false;
+
+                cout << "\n  {"
+                     << "\"uuid\":\"" << bk_util::json_escape(uuid_str) << "\","
+                     << "\"available\":" << (a.available ? "true" : "false") << ","
+                     << "\"cancelled\":" << (a.cancelled ? "true" : "false") << ","
+                     << "\"partial\":" << (a.partial_walk ? "true" : "false") << ","
+                     << "\"files_seen\":" << a.files_seen << ","
+                     << "\"bytes_seen\":" << a.bytes_seen << ","
+                     << "\"blocks\":" << a.blocks << ","
+                     << "\"write_rate\":" << a.write_rate << ","
+                     << "\"cpu_budget\":" << a.cpu_budget << ","
+                     << "\"recommended\":\"" << a.recommended << "\","
+                     << "\"candidates\":[";
+
+                bool first_candidate = true;
+                for (const auto &c : a.candidates) {
+                    if (!first_candidate) cout << ",";
+                    first_candidate = false;
+                    cout << "{"
+                         << "\"preset\":\"" << c.preset << "\","
+                         << "\"algorithm\":\"" << c.algorithm << "\","
+                         << "\"level\":" << c.level << ","
+                         << "\"saved\":" << c.saved_fraction << ","
+                         << "\"speed_per_core\":" << c.bytes_per_sec_per_core << ","
+                         << "\"within_budget\":" << (c.within_budget ? "true" : "false")
+                         << "}";
+                }
+                cout << "]}";
+                continue;
+            }
+
+            if (a.cancelled) {
+                cerr << clauses_registry::tr("%1: analysis cancelled").arg(uuid_str).toStdString() << '\n';
+                errcode = 1;
+                continue;
+            }
+
+            if (!a.available) {
+                cerr << clauses_registry::tr("%1: nothing could be sampled (is it mounted?)").arg(uuid_str).toStdString() << '\n';
+                errcode = 1;
+                continue;
+            }
+
+            cout << uuid_str << ":\n"
+                 << '\t' << clauses_registry::tr("%1 blocks sampled from %2 files (%3)%4")
+                                .arg(std::to_string(a.blocks), std::to_string(a.files_seen),
+                                     bk_util::auto_size_suffix(a.bytes_seen),
+                                     a.partial_walk ? clauses_registry::tr(", walk cut short").toStdString() : std::string())
+                                .toStdString() << '\n';
+
+            for (const auto &c : a.candidates) {
+                std::string name = c.preset.empty() ? "(" + c.algorithm + ":" + std::to_string(c.level) + ")" : c.preset;
+                cout << "\t  " << std::left << std::setw(12) << name
+                     << clauses_registry::tr("saves %1%, %2/s per core%3")
+                            .arg(std::to_string(static_cast<int>(std::lround(c.saved_fraction * 100))),
+                                 bk_util::auto_size_suffix(static_cast<size_t>(c.bytes_per_sec_per_core)),
+                                 c.within_budget ? std::string() : clauses_registry::tr(", over budget").toStdString())
+                            .toStdString() << '\n';
+            }
+
+            cout << '\t' << clauses_registry::tr("Recommended: %1 (writes at %2/s within %3 cores)")
+                                .arg(a.recommended, bk_util::auto_size_suffix(static_cast<size_t>(a.write_rate)),
+                                     std::to_string(a.cpu_budget).substr(0, 4)).toStdString() << '\n';
+        } else if (start) {
             DEBUG_LOG("[compressctl] start compression for UUID ", uuid_str);
             tc::start(uuid_str);
         } else if (pause) {
@@ -664,7 +1383,7 @@ clauses::compressctl(const clause_options &options,
         }
     }
 
-    if (status && want_json) {
+    if (json_list) {
         if (!first_json_item) cout << '\n';
         cout << "]" << std::endl;
     }
@@ -672,3 +1391,606 @@ clauses::compressctl(const clause_options &options,
     errcode = 0;
     RETURN_COMMANDSTREAMS
 }
+
+command_streams
+clauses::metrics(const clause_options &options,
+                 const clause_subjects &subjects)
+{
+    std::ostringstream cout;
+    std::ostringstream cerr;
+    int errcode = 0;
+
+    bool want_json = options.find("json") != options.end();
+
+    // beekeeper's own latencies rather than bees'
+    if (options.find("timings") != options.end()) {
+        namespace timings = bk_mgmt::timings;
+
+        if (options.find("prometheus") != options.end()) {
+            cout << timings::prometheus();
+            RETURN_COMMANDSTREAMS
+        }
+        if (want_json) {
+            cout << timings::json() << std::endl;
+            RETURN_COMMANDSTREAMS
+        }
+
+        auto ms = [](uint64_t ns) {
+            std::ostringstream out;
+            out << std::fixed << std::setprecision(ns < 10'000'000 ? 3 : 1) << ns / 1e6 << " ms";
+            return out.str();
+        };
+
+        const auto all = timings::snapshot();
+        if (all.empty())
+            cout << clauses_registry::tr("Nothing timed yet").toStdString() << '\n';
+
+        for (const auto &s : all) {
+            cout << timings::family_name(s.what) << ' ' << s.label << ":\n"
+                 << '\t' << clauses_registry::tr("%1 calls, %2 in total")
+                                .arg(std::to_string(s.h.count), ms(s.h.sum_ns)).toStdString() << '\n'
+                 << '\t' << clauses_registry::tr("p50 %1, p99 %2, max %3")
+                                .arg(ms(s.h.percentile(0.5)), ms(s.h.percentile(0.99)), ms(s.h.max_ns)).toStdString()
+                 << '\n';
+        }
+        RETURN_COMMANDSTREAMS
+    }
+
+    if (subjects.empty()) {
+        cerr << clauses_registry::tr("No UUID specified").toStdString();
+        errcode = 1;
+        RETURN_COMMANDSTREAMS
+    }
+
+    if (want_json) {
+        cout << "[";
+    }
+
+    bool first_json_item = true;
+
+    for (const auto &uuid : subjects) {
+        auto m = bk_mgmt::metrics::read(uuid);
+
+        if (want_json) {
+            if (!first_json_item) cout << ",";
+            first_json_item = false;
+
+            cout << "\n  {"
+                 << "\"uuid\":\"" << bk_util::json_escape(uuid) << "\","
+                 << "\"available\":" << (m.available ? "true" : "false") << ","
+                 << "\"updated\":" << m.updated << ","
+                 << "\"dedup_bytes_per_sec\":" << m.dedup_bytes_per_sec << ","
+                 << "\"scanned_bytes_per_sec\":" << m.scanned_bytes_per_sec << ","
+                 << "\"dedup_bytes\":" << m.dedup_bytes << ","
+                 << "\"extents_scanned\":" << m.extents_scanned << ","
+                 << "\"crawl_progress\":" << m.crawl_progress << ","
+                 << "\"hash_fill\":" << m.hash_fill << ","
+                 << "\"crawl\":[";
+
+            bool first_row = true;
+            for (const auto &row : m.crawl) {
+                if (!first_row) cout << ",";
+                first_row = false;
+                cout << "{\"extent_size\":\"" << bk_util::json_escape(row.extent_size) << "\","
+                     << "\"data_size\":" << row.data_size << ","
+                     << "\"position\":" << row.position << "}";
+            }
+            cout << "]}";
+            continue;
+        }
+
+        if (!m.available) {
+            cerr << clauses_registry::tr("No bees status for %1, is bees running?").arg(uuid).toStdString() << '\n';
+            errcode = 1;
+            continue;
+        }
+
+        auto percent = [](double fraction) {
+            return fraction < 0 ? std::string("?") : std::to_string(static_cast<int>(fraction * 100)) + "%";
+        };
+
+        cout << uuid << ":\n"
+             << '\t' << clauses_registry::tr("Dedupe: %1/s (%2 since start)")
+                            .arg(bk_util::auto_size_suffix(static_cast<size_t>(m.dedup_bytes_per_sec)),
+                                 bk_util::auto_size_suffix(m.dedup_bytes)).toStdString() << '\n'
+             << '\t' << clauses_registry::tr("Scan: %1/s, %2 extents since start")
+                            .arg(bk_util::auto_size_suffix(static_cast<size_t>(m.scanned_bytes_per_sec)),
+                                 std::to_string(m.extents_scanned)).toStdString() << '\n'
+             << '\t' << clauses_registry::tr("Crawl progress: %1").arg(percent(m.crawl_progress)).toStdString() << '\n'
+             << '\t' << clauses_registry::tr("Hash table fill: %1").arg(percent(m.hash_fill)).toStdString() << '\n';
+    }
+
+    if (want_json) {
+        if (!first_json_item) cout << '\n';
+        cout << "]" << std::endl;
+    }
+
+    RETURN_COMMANDSTREAMS
+}
+
+command_streams
+clauses::savings(const clause_options &options,
+                 const clause_subjects &subjects)
+{
+    std::ostringstream cout;
+    std::ostringstream cerr;
+    int errcode = 0;
+
+    namespace history = bk_mgmt::spacehistory;
+
+    bool want_json = options.find("json") != options.end();
+    bool want_samples = options.find("history") != options.end();
+
+    auto format_time = [](std::time_t t) {
+        char buf[32];
+        std::strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M", std::localtime(&t));
+        return std::string(buf);
+    };
+
+    if (want_json) {
+        cout << "[";
+    }
+
+    bool first_json_item = true;
+
+    for (const auto &uuid : subjects) {
+        auto samples = history::load(uuid);
+        auto t = history::analyze(samples);
+
+        if (want_json) {
+            if (!first_json_item) cout << ",";
+            first_json_item = false;
+
+            cout << "\n  {"
+                 << "\"uuid\":\"" << bk_util::json_escape(uuid) << "\","
+                 << "\"available\":" << (t.available ? "true" : "false") << ","
+                 << "\"since\":" << (samples.empty() ? 0 : samples.front().time) << ","
+                 << "\"saved\":" << t.saved << ","
+                 << "\"saved_last_hour\":" << t.saved_last_hour << ","
+                 << "\"rate_per_hour\":" << t.rate_per_hour << ","
+                 << "\"remaining\":" << t.remaining << ","
+                 << "\"eta\":" << t.eta;
+
+            if (want_samples) {
+                cout << ",\"samples\":[";
+                for (size_t i = 0; i < samples.size(); ++i) {
+                    if (i) cout << ",";
+                    cout << "[" << samples[i].time << "," << samples[i].free << "," << samples[i].used << "]";
+                }
+                cout << "]";
+            }
+
+            cout << "}";
+            continue;
+        }
+
+        if (!t.available) {
+            cout << clauses_registry::tr("%1: no space history yet").arg(uuid).toStdString() << '\n';
+            continue;
+        }
+
+        // Net savings can be negative when the user writes faster than bees frees
+        auto signed_size = [](double bytes) {
+            std::string text = bk_util::auto_size_suffix(static_cast<size_t>(std::fabs(bytes)));
+            return bytes < 0 ? "-" + text : text;
+        };
+
+        cout << uuid << ":\n"
+             << '\t' << clauses_registry::tr("Saved %1 since %2 (%3 in the last hour)")
+                            .arg(signed_size(static_cast<double>(t.saved)),
+                                 format_time(samples.front().time),
+                                 signed_size(t.saved_last_hour)).toStdString() << '\n'
+             << '\t' << clauses_registry::tr("Savings rate: %1/h").arg(signed_size(t.rate_per_hour)).toStdString() << '\n';
+
+        if (t.eta)
+            cout << '\t' << clauses_registry::tr("About %1 more, converging by %2")
+                                .arg(signed_size(t.remaining), format_time(t.eta)).toStdString() << '\n';
+        else
+            cout << '\t' << clauses_registry::tr("Not converging yet").toStdString() << '\n';
+
+        if (want_samples)
+            for (const auto &s : samples)
+                cout << '\t' << format_time(s.time) << ' '
+                     << clauses_registry::tr("free %1, used %2")
+                            .arg(bk_util::auto_size_suffix(s.free), bk_util::auto_size_suffix(s.used)).toStdString() << '\n';
+    }
+
+    if (want_json) {
+        if (!first_json_item) cout << '\n';
+        cout << "]" << std::endl;
+    }
+
+    RETURN_COMMANDSTREAMS
+}
+
+command_streams
+clauses::usage(const clause_options &options,
+               const clause_subjects &subjects)
+{
+    std::ostringstream cout;
+    std::ostringstream cerr;
+    int errcode = 0;
+
+    namespace account = bk_mgmt::spaceaccount;
+
+    bool want_json = options.find("json") != options.end();
+    bool want_cancel = options.find("cancel") != options.end();
+
+    account::options opts;
+    opts.idle_io = options.find("idle-io") != options.end();
+
+    if (std::string threads = option_value(options, "threads"); !threads.empty()) {
+        try {
+            opts.threads = static_cast<unsigned>(std::stoul(threads));
+        } catch (...) {
+            cerr << clauses_registry::tr("Invalid thread count: %1").arg(threads).toStdString() << '\n';
+            errcode = 1;
+            RETURN_COMMANDSTREAMS
+        }
+    }
+
+    std::string path_option = option_value(options, "path");
+
+    auto ratio = [](uint64_t disk, uint64_t uncompressed) {
+        return uncompressed ? 100.0 * static_cast<double>(disk) / static_cast<double>(uncompressed) : 100.0;
+    };
+
+    if (want_json) {
+        cout << "[";
+    }
+
+    bool first_json_item = true;
+
+    for (const auto &uuid : subjects) {
+        auto mounts = bk_mgmt::get_mount_paths(uuid);
+        if (mounts.empty()) {
+            cerr << clauses_registry::tr("%1 is not mounted").arg(uuid).toStdString() << '\n';
+            errcode = 1;
+            continue;
+        }
+
+        // --path must lie under one of this filesystem's mount points
+        std::string root = mounts.front();
+        if (!path_option.empty()) {
+            std::error_code ec;
+            std::filesystem::path wanted = std::filesystem::weakly_canonical(path_option, ec);
+
+            bool inside = false;
+            for (const auto &mount : mounts) {
+                auto relative = wanted.lexically_relative(std::filesystem::weakly_canonical(mount, ec));
+                if (!relative.empty() && *relative.begin() != "..") {
+                    inside = true;
+                    break;
+                }
+            }
+
+            if (!inside) {
+                cerr << clauses_registry::tr("%1 is not on %2").arg(path_option, uuid).toStdString() << '\n';
+                errcode = 1;
+                continue;
+            }
+            root = wanted.string();
+        }
+
+        if (want_cancel) {
+            if (!account::cancel(root))
+                cerr << clauses_registry::tr("No walk running on %1").arg(root).toStdString() << '\n';
+            continue;
+        }
+
+        auto r = account::account(root, opts);
+
+        if (want_json) {
+            if (!first_json_item) cout << ",";
+            first_json_item = false;
+
+            cout << "\n  {"
+                 << "\"uuid\":\"" << bk_util::json_escape(uuid) << "\","
+                 << "\"path\":\"" << bk_util::json_escape(root) << "\","
+                 << "\"complete\":" << (r.complete ? "true" : "false") << ","
+                 << "\"precise\":" << (r.precise ? "true" : "false") << ","
+                 << "\"files\":" << r.files << ","
+                 << "\"cached_files\":" << r.cached_files << ","
+                 << "\"extents\":" << r.extents << ","
+                 << "\"errors\":" << r.errors << ","
+                 << "\"disk\":" << r.total.disk << ","
+                 << "\"uncompressed\":" << r.total.uncompressed << ","
+                 << "\"referenced\":" << r.total.referenced << ","
+                 << "\"shared\":" << r.shared << ","
+                 << "\"algorithms\":{";
+
+            bool first_algorithm = true;
+            for (const auto &[name, u] : r.by_algorithm) {
+                if (!first_algorithm) cout << ",";
+                first_algorithm = false;
+                cout << "\"" << bk_util::json_escape(name) << "\":{"
+                     << "\"disk\":" << u.disk << ","
+                     << "\"uncompressed\":" << u.uncompressed << ","
+                     << "\"referenced\":" << u.referenced << "}";
+            }
+            cout << "}}";
+            continue;
+        }
+
+        if (!r.complete && r.files == 0) {
+            cerr << clauses_registry::tr("Could not account %1").arg(root).toStdString() << '\n';
+            errcode = 1;
+            continue;
+        }
+
+        uint64_t dedup_saved = r.total.referenced > r.total.uncompressed ? r.total.referenced - r.total.uncompressed : 0;
+        uint64_t compression_saved = r.total.uncompressed > r.total.disk ? r.total.uncompressed - r.total.disk : 0;
+
+        cout << uuid << " (" << root << "):\n"
+             << '\t' << clauses_registry::tr("%1 files, %2 extents, %3 unchanged since the last walk")
+                            .arg(std::to_string(r.files), std::to_string(r.extents),
+                                 std::to_string(r.cached_files)).toStdString() << '\n'
+             << '\t' << clauses_registry::tr("Referenced %1, uncompressed %2, on disk %3 (%4%)")
+                            .arg(bk_util::auto_size_suffix(r.total.referenced),
+                                 bk_util::auto_size_suffix(r.total.uncompressed),
+                                 bk_util::auto_size_suffix(r.total.disk),
+                                 std::to_string(static_cast<int>(std::lround(ratio(r.total.disk, r.total.uncompressed))))).toStdString() << '\n'
+             << '\t' << clauses_registry::tr("Saved by sharing: %1 (%2 in shared extents)")
+                            .arg(bk_util::auto_size_suffix(dedup_saved),
+                                 bk_util::auto_size_suffix(r.shared)).toStdString() << '\n'
+             << '\t' << clauses_registry::tr("Saved by compression: %1")
+                            .arg(bk_util::auto_size_suffix(compression_saved)).toStdString() << '\n';
+
+        for (const auto &[name, u] : r.by_algorithm)
+            cout << "\t  " << std::left << std::setw(8) << name
+                 << clauses_registry::tr("%1 -> %2 (%3%)")
+                        .arg(bk_util::auto_size_suffix(u.uncompressed),
+                             bk_util::auto_size_suffix(u.disk),
+                             std::to_string(static_cast<int>(std::lround(ratio(u.disk, u.uncompressed))))).toStdString() << '\n';
+
+        if (!r.precise)
+            cout << '\t' << clauses_registry::tr("Estimated with FIEMAP: compressed sizes and algorithms are unknown without root").toStdString() << '\n';
+        if (!r.complete)
+            cout << '\t' << clauses_registry::tr("Cancelled: partial result").toStdString() << '\n';
+        if (r.errors)
+            cout << '\t' << clauses_registry::tr("%1 entries could not be read").arg(std::to_string(r.errors)).toStdString() << '\n';
+    }
+
+    if (want_json) {
+        if (!first_json_item) cout << '\n';
+        cout << "]" << std::endl;
+    }
+
+    RETURN_COMMANDSTREAMS
+}
+
+command_streams
+clauses::dupscan(const clause_options &options,
+                 const clause_subjects &subjects)
+{
+    std::ostringstream cout;
+    std::ostringstream cerr;
+    int errcode = 0;
+
+    namespace ds = bk_mgmt::dupscan;
+
+    bool want_json = options.find("json") != options.end();
+
+    ds::options opts;
+    opts.use_index = options.find("no-index") == options.end();
+
+    try {
+        if (std::string threads = option_value(options, "threads"); !threads.empty())
+            opts.threads = static_cast<unsigned>(std::stoul(threads));
+        if (std::string min_size = option_value(options, "min-size"); !min_size.empty())
+            opts.min_size = std::max<uint64_t>(1, std::stoull(min_size));
+    } catch (...) {
+        cerr << clauses_registry::tr("Invalid --threads or --min-size value").toStdString() << '\n';
+        errcode = 1;
+        RETURN_COMMANDSTREAMS
+    }
+
+    // Duplicates across the directories count too: one scan for all of them
+    std::vector<std::string> roots(subjects.begin(), subjects.end());
+    auto r = ds::scan(roots, opts);
+
+    if (want_json) {
+        cout << "{"
+             << "\"complete\":" << (r.complete ? "true" : "false") << ","
+             << "\"files\":" << r.files << ","
+             << "\"candidates\":" << r.candidates << ","
+             << "\"fully_hashed\":" << r.fully_hashed << ","
+             << "\"from_index\":" << r.from_index << ","
+             << "\"bytes_read\":" << r.bytes_read << ","
+             << "\"errors\":" << r.errors << ","
+             << "\"reclaimable\":" << r.reclaimable << ","
+             << "\"sets\":[";
+
+        bool first_set = true;
+        for (const auto &set : r.sets) {
+            if (!first_set) cout << ",";
+            first_set = false;
+
+            cout << "\n  {\"size\":" << set.size << ",\"reclaimable\":" << set.reclaimable << ",\"paths\":[";
+            bool first_path = true;
+            for (const auto &path : set.paths) {
+                if (!first_path) cout << ",";
+                first_path = false;
+                cout << "\"" << bk_util::json_escape(path) << "\"";
+            }
+            cout << "]}";
+        }
+        if (!first_set) cout << '\n';
+        cout << "]}" << std::endl;
+
+        if (!r.complete) errcode = 1;
+        RETURN_COMMANDSTREAMS
+    }
+
+    if (!r.complete) {
+        cerr << clauses_registry::tr("None of the directories could be read").toStdString() << '\n';
+        errcode = 1;
+        RETURN_COMMANDSTREAMS
+    }
+
+    for (const auto &set : r.sets) {
+        cout << clauses_registry::tr("%1 copies of %2 (%3 reclaimable):")
+                    .arg(std::to_string(set.paths.size()),
+                         bk_util::auto_size_suffix(set.size),
+                         bk_util::auto_size_suffix(set.reclaimable)).toStdString() << '\n';
+        for (const auto &path : set.paths)
+            cout << '\t' << path << '\n';
+    }
+
+    cout << clauses_registry::tr("%1 duplicate sets, %2 reclaimable").arg(std::to_string(r.sets.size()),
+                                                                         bk_util::auto_size_suffix(r.reclaimable)).toStdString() << '\n'
+         << clauses_registry::tr("%1 files, %2 hashed in full, %3 hashes reused, %4 read")
+                .arg(std::to_string(r.files), std::to_string(r.fully_hashed),
+                     std::to_string(r.from_index), bk_util::auto_size_suffix(r.bytes_read)).toStdString() << '\n';
+    if (r.errors)
+        cout << clauses_registry::tr("%1 entries could not be read").arg(std::to_string(r.errors)).toStdString() << '\n';
+
+    RETURN_COMMANDSTREAMS
+}
+
+command_streams
+clauses::dedupe(const clause_options &options,
+                const clause_subjects &subjects)
+{
+    std::ostringstream cout;
+    std::ostringstream cerr;
+    int errcode = 0;
+
+    namespace dd = bk_mgmt::dedupe;
+
+    bool want_json = options.find("json") != options.end();
+
+    dd::options opts;
+    opts.dry_run = options.find("dry-run") != options.end();
+
+    if (std::string depth = option_value(options, "queue-depth"); !depth.empty()) {
+        try {
+            opts.queue_depth = static_cast<unsigned>(std::stoul(depth));
+        } catch (...) {
+            cerr << clauses_registry::tr("Invalid queue depth: %1").arg(depth).toStdString() << '\n';
+            errcode = 1;
+            RETURN_COMMANDSTREAMS
+        }
+    }
+
+    std::vector<dd::file_set> sets;
+    if (subjects.size() > 1)
+        sets.emplace_back(subjects.begin(), subjects.end());
+
+    if (std::string from = option_value(options, "from"); !from.empty()) {
+        std::ostringstream text;
+        if (from == "-") {
+            text << std::cin.rdbuf();
+        } else {
+            std::ifstream in(from);
+            if (!in) {
+                cerr << clauses_registry::tr("Cannot read %1").arg(from).toStdString() << '\n';
+                errcode = 1;
+                RETURN_COMMANDSTREAMS
+            }
+            text << in.rdbuf();
+        }
+
+        auto parsed = dd::parse_sets(text.str());
+        sets.insert(sets.end(), std::make_move_iterator(parsed.begin()), std::make_move_iterator(parsed.end()));
+    }
+
+    if (sets.empty()) {
+        cerr << clauses_registry::tr("Nothing to deduplicate: give at least two files, or --from").toStdString() << '\n';
+        errcode = 1;
+        RETURN_COMMANDSTREAMS
+    }
+
+    auto r = dd::apply(sets, opts);
+    if (r.errors) errcode = 1;
+
+    if (want_json) {
+        cout << "{"
+             << "\"dry_run\":" << (opts.dry_run ? "true" : "false") << ","
+             << "\"sets\":" << r.sets << ","
+             << "\"files\":" << r.files << ","
+             << "\"calls\":" << r.calls << ","
+             << "\"bytes_deduped\":" << r.bytes_deduped << ","
+             << "\"bytes_already_shared\":" << r.bytes_already_shared << ","
+             << "\"files_differing\":" << r.files_differing << ","
+             << "\"errors\":" << r.errors
+             << "}" << std::endl;
+        RETURN_COMMANDSTREAMS
+    }
+
+    cout << (opts.dry_run
+                 ? clauses_registry::tr("Would deduplicate %1 in %2 sets (%3 already shared)")
+                 : clauses_registry::tr("Deduplicated %1 in %2 sets (%3 already shared)"))
+                .arg(bk_util::auto_size_suffix(r.bytes_deduped), std::to_string(r.sets),
+                     bk_util::auto_size_suffix(r.bytes_already_shared)).toStdString() << '\n';
+    if (r.files_differing)
+        cout << clauses_registry::tr("%1 files turned out to differ and were left alone")
+                    .arg(std::to_string(r.files_differing)).toStdString() << '\n';
+    if (r.errors)
+        cerr << clauses_registry::tr("%1 files or calls failed (not readable, not the same size, or another filesystem)")
+                    .arg(std::to_string(r.errors)).toStdString() << '\n';
+
+    RETURN_COMMANDSTREAMS
+}
+
+command_streams
+clauses::debuglog(const clause_options &options,
+                  const clause_subjects &subjects)
+{
+    std::ostringstream cout;
+    std::ostringstream cerr;
+    int errcode = 0;
+
+    namespace debuglog = bk_mgmt::debuglog;
+
+    (void) subjects;
+
+    if (std::string value = option_value(options, "level"); !value.empty()) {
+        debuglog::level l;
+        if (!debuglog::parse_level(bk_util::trim_string(value), l)) {
+            cerr << clauses_registry::tr("Invalid level: %1 (error, warning, info, debug or trace)")
+                        .arg(value).toStdString() << '\n';
+            errcode = 1;
+            RETURN_COMMANDSTREAMS
+        }
+        debuglog::set_level(l);
+        DEBUG_LOG_AT(info, "[debuglog] level set to ", debuglog::level_name(l));
+    }
+
+    // Comma separated; "all" lifts the filter
+    if (std::string value = option_value(options, "categories"); !value.empty()) {
+        std::vector<std::string> categories;
+        std::istringstream list(value);
+        for (std::string item; std::getline(list, item, ',');) {
+            item = bk_util::trim_string(item);
+            if (!item.empty() && item != "all")
+                categories.push_back(item);
+        }
+        debuglog::set_categories(categories);
+        DEBUG_LOG_AT(info, "[debuglog] categories set to ", value);
+    }
+
+    const std::vector<std::string> categories = debuglog::categories();
+    std::string joined;
+    for (const auto &c : categories)
+        joined += (joined.empty() ? "" : ",") + c;
+
+    if (options.find("json") != options.end()) {
+        cout << "{\"level\":\"" << debuglog::level_name(debuglog::current_level()) << "\","
+             << "\"categories\":[";
+        for (size_t i = 0; i < categories.size(); ++i)
+            cout << (i ? "," : "") << '"' << bk_util::json_escape(categories[i]) << '"';
+        cout << "],"
+             << "\"dropped\":" << debuglog::dropped() << ","
+             << "\"file\":\"" << bk_util::json_escape(debuglog::file_path()) << "\"}" << std::endl;
+        RETURN_COMMANDSTREAMS
+    }
+
+    cout << clauses_registry::tr("Level: %1").arg(debuglog::level_name(debuglog::current_level())).toStdString() << '\n'
+         << clauses_registry::tr("Categories: %1")
+                .arg(joined.empty() ? clauses_registry::tr("all").toStdString() : joined).toStdString() << '\n'
+         << clauses_registry::tr("Dropped lines: %1").arg(std::to_string(debuglog::dropped())).toStdString() << '\n'
+         << clauses_registry::tr("File: %1").arg(debuglog::file_path()).toStdString() << '\n';
+
+    RETURN_COMMANDSTREAMS
+}
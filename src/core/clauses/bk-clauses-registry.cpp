@@ -1,3 +1,4 @@
+#include "beekeeper/util.hpp"
 #include "bk-clauses.hpp"
 #include <unordered_map>
 #include <string>
@@ -45,19 +46,130 @@ clauses_registry::get() {
             "status",
             {
                 clauses::status,
-                {},
+                {
+                    {"cgroup", "c", false},
+                    {"json", "j", false}
+                },
+                tr("UUID").toStdString(),
+                tr("Check beesd status, optionally with the CPU, I/O and memory usage of its cgroup").toStdString(),
+                1, -1
+            }
+        },
+        {
+            "metrics",
+            {
+                clauses::metrics,
+                {
+                    {"json", "j", false},
+                    {"timings", "t", false},
+                    {"prometheus", "p", false}
+                },
+                tr("UUID").toStdString(),
+                tr("Show live dedupe metrics from the bees status file: dedupe and scan rates,\n"
+                    "extents scanned, crawl progress and an estimate of the hash table fill.\n"
+                    "With --timings, show how long the helper spent in clauses, commands, D-Bus calls,\n"
+                    "/proc scans and remounts instead (--prometheus for the Prometheus text format)").toStdString(),
+                0, -1
+            }
+        },
+        {
+            "debuglog",
+            {
+                clauses::debuglog,
+                {
+                    {"level", "", true},
+                    {"categories", "", true},
+                    {"json", "j", false}
+                },
+                tr("").toStdString(),
+                tr("Show or change what the helper writes to its debug log, while it runs.\n"
+                    "--level error|warning|info|debug|trace keeps lines up to that level; --categories a,b\n"
+                    "keeps debug and trace lines only from source files whose path contains one of them\n"
+                    "(\"all\" for every file). Also shows how many lines were dropped under load.").toStdString(),
+                0, 0
+            }
+        },
+        {
+            "savings",
+            {
+                clauses::savings,
+                {
+                    {"history", "H", false},
+                    {"json", "j", false}
+                },
+                tr("UUID").toStdString(),
+                tr("Show space saved by deduplication, the savings rate per hour and when it should converge,\n"
+                    "from the free space history the helper samples every 15 minutes.\n"
+                    "--history also lists the samples themselves.").toStdString(),
+                1, -1
+            }
+        },
+        {
+            "usage",
+            {
+                clauses::usage,
+                {
+                    {"path", "p", true},
+                    {"threads", "t", true},
+                    {"idle-io", "i", false},
+                    {"cancel", "c", false},
+                    {"json", "j", false}
+                },
                 tr("UUID").toStdString(),
-                tr("Check beesd status").toStdString(),
+                tr("Account the extents of a filesystem like compsize: disk, uncompressed and referenced bytes\n"
+                    "per compression algorithm, and how much lives in shared (deduplicated) extents.\n"
+                    "Walks the first mount point, or --path DIR inside it, with --threads walkers\n"
+                    "(--idle-io: idle I/O priority). --cancel stops a running walk.").toStdString(),
                 1, -1
             }
         },
+        {
+            "dupscan",
+            {
+                clauses::dupscan,
+                {
+                    {"threads", "t", true},
+                    {"min-size", "m", true},
+                    {"no-index", "n", false},
+                    {"json", "j", false}
+                },
+                tr("DIRECTORY").toStdString(),
+                tr("Find identical files under the given directories and how much deduplicating them would free.\n"
+                    "Files are compared by size, then by a hash of their ends, then in full, with --threads\n"
+                    "workers. Files under --min-size bytes (default 4096) are ignored. Hashes are kept in an\n"
+                    "index so later scans only read changed files (--no-index: neither read nor update it).").toStdString(),
+                1, -1
+            }
+        },
+        {
+            "dedupe",
+            {
+                clauses::dedupe,
+                {
+                    {"from", "f", true},
+                    {"queue-depth", "q", true},
+                    {"dry-run", "n", false},
+                    {"json", "j", false}
+                },
+                tr("FILE...").toStdString(),
+                tr("Deduplicate files known to be identical, without waiting for bees. The given files form one\n"
+                    "set; --from FILE reads sets from `dupscan -j` output or fdupes-style lists (- for stdin).\n"
+                    "Ranges already shared are skipped; --queue-depth sets are processed at once (default 4).\n"
+                    "--dry-run only reports what would be submitted.").toStdString(),
+                0, -1
+            }
+        },
         {
             "log", 
             {
                 clauses::log,
-                {},
+                {
+                    {"since", "s", true},
+                    {"json", "j", false}
+                },
                 tr("UUID").toStdString(),
-                tr("Show log file").toStdString(),
+                tr("Show the latest bees output kept in memory by the helper.\n"
+                    "--since CURSOR only shows lines after a cursor from a previous --json call.").toStdString(),
                 1, -1
             }
         },
@@ -78,10 +190,35 @@ clauses_registry::get() {
                 {
                     {"db-size", "d", true},
                     {"remove", "r", false},
+                    {"thread-count", "", true},
+                    {"thread-factor", "", true},
+                    {"loadavg-target", "", true},
+                    {"scan-mode", "", true},
+                    {"throttle-factor", "", true},
+                    {"auto-tune", "t", false},
+                    {"advise", "a", false},
+                    {"budget", "b", true},
+                    {"beeshome", "", true},
+                    {"inspect", "i", false},
+                    {"cpu-max", "", true},
+                    {"cpu-weight", "", true},
+                    {"io-max", "", true},
+                    {"io-weight", "", true},
+                    {"memory-high", "", true},
                     {"json", "j", false}
                 },
                 tr("UUID").toStdString(),
-                tr("Create/update configuration for a btrfs filesystem").toStdString(),
+                tr("Create/update configuration for a btrfs filesystem.\n"
+                    "--auto-tune proposes bees performance options from the CPU, RAM and disk type;\n"
+                    "explicit --thread-count, --thread-factor, --loadavg-target, --scan-mode and --throttle-factor\n"
+                    "override it. Pass \"default\" to clear one.\n"
+                    "--db-size auto sizes the hash table from the data on the filesystem, capped so every\n"
+                    "hash table together fits --budget bytes of RAM (a quarter of the RAM by default).\n"
+                    "--advise only prints that recommendation.\n"
+                    "The hash table is pre-allocated as a NOCOW file in BEESHOME; --beeshome puts it on\n"
+                    "another device (\"default\" moves it back) and --inspect reports its fragmentation.\n"
+                    "--cpu-max (50% or cpu.max syntax), --cpu-weight, --io-max (e.g. wbps=52428800), --io-weight\n"
+                    "and --memory-high (e.g. 2G) limit the bees worker through its cgroup from its next start.").toStdString(),
                 1, 1
             }
         },
@@ -121,9 +258,18 @@ clauses_registry::get() {
             "autostartctl",
             {
                 clauses::autostartctl,
-                { {"add", "a", false}, {"remove", "r", false} },
+                {
+                    {"add", "a", false},
+                    {"remove", "r", false},
+                    {"schedule", "s", true},
+                    {"idle", "i", true},
+                    {"next", "n", false},
+                    {"json", "j", false}
+                },
                 tr("").toStdString(),
-                tr("Add or remove filesystems from the autostart file").toStdString(),
+                tr("Add or remove filesystems from the autostart file.\n"
+                    "--schedule \"[days@]HH:MM-HH:MM[,threads=N][,weight=N] ...\" limits bees to those time windows;\n"
+                    "--idle stop|pause picks what happens outside them. --next shows the next scheduled transition.").toStdString(),
                 1, -1
             }
         },
@@ -140,14 +286,78 @@ clauses_registry::get() {
                     {"compression-level", "c", false},
                     {"algorithm", "", true},
                     {"level", "", false},
+                    {"analyze", "z", false},
+                    {"cancel-analysis", "", false},
+                    {"samples", "", true},
+                    {"cpu-budget", "", true},
+                    {"benchmark", "", false},
+                    {"size", "", true},
+                    {"mix", "", true},
+                    {"recompress", "", true},
+                    {"rate", "", true},
+                    {"iops", "", true},
+                    {"incompressible", "", true},
+                    {"threshold", "", true},
                     {"json", "j", false}
                 },
                 tr("").toStdString(),
                 tr("Manage transparent compression (start, pause, status, add, or remove) on filesystems.\n"
-                    "Options --algorithm / --algo and --level override presets given by --compression-level.").toStdString(),
+                    "Options --algorithm / --algo and --level override presets given by --compression-level.\n"
+                    "--analyze samples --samples blocks of 128 KiB, compresses them with every preset and\n"
+                    "recommends the one saving the most within --cpu-budget cores (default 1);\n"
+                    "--cancel-analysis stops one the helper is running.\n"
+                    "--benchmark writes --size MB (default 256) of --mix text:60,random:30,zeros:10 data with\n"
+                    "every preset in a scratch directory and reports write/read throughput, CPU time and latency.\n"
+                    "--recompress start|pause|cancel|status rewrites existing data with the configured algorithm\n"
+                    "in the background, at most --rate MB/s and --iops rewrites per second.\n"
+                    "--incompressible scan|apply|undo finds directories whose data saves less than --threshold\n"
+                    "percent (default 3) and sets btrfs.compression=none on them; scan is a dry run.").toStdString(),
                 1, -1
             }
         }
     };
     return clauses_registry;
-}
\ No newline at end of file
+}
+bool
+clauses::runs_in_helper(const std::string &verb, const clause_options &options)
+{
+    // Recompression jobs run on threads of the process that started them
+    if (verb == "compressctl") {
+        std::string action = bk_util::to_lower(option_value(options, "recompress"));
+        bool controls_job = !action.empty() && action != "status";
+        return controls_job || options.count("cancel-analysis") > 0;
+    }
+
+    // The helper's timings and debug log are the interesting ones, not a
+    // one-shot CLI's
+    if (verb == "metrics")
+        return options.count("timings") > 0;
+    if (verb == "debuglog")
+        return true;
+
+    return verb == "start" || verb == "restart" || verb == "log";
+}
+
+clauses::helper_caller
+clauses::helper_access(const std::string &verb, const clause_options &options)
+{
+    if (verb == "compressctl") {
+        // Starting, pausing or cancelling a recompression of every file
+        std::string action = bk_util::to_lower(option_value(options, "recompress"));
+        if (!action.empty() && action != "status")
+            return helper_caller::authorized;
+
+        // Sets or clears btrfs.compression across the filesystem; even a
+        // scan reports on directories the caller may not be able to read
+        if (options.count("incompressible"))
+            return helper_caller::authorized;
+    }
+
+    // Hashes and compares whole files under the given directories; dedupe
+    // opens the given files (or those listed in --from) and its result
+    // tells whether their contents match
+    if (verb == "dupscan" || verb == "dedupe")
+        return helper_caller::root_only;
+
+    return helper_caller::anyone;
+}
@@ -15,6 +15,38 @@ public:
 // clause handler implementations
 namespace beekeeper { namespace clauses {
 
+// The value given to a value option, or "" when it was not given.
+// An empty value (--since "") counts as not given; the GUI sends
+// "<default>" for options it leaves alone.
+inline std::string
+option_value(const clause_options &options, const std::string &name)
+{
+    auto it = options.find(name);
+    if (it == options.end() || it->second == "<default>")
+        return "";
+    return it->second;
+}
+
+// Does this clause act on state only the helper has? bees output is
+// captured by the process that starts bees, so starting and reading logs
+// has to happen in the helper. beekeeperman sends these over D-Bus instead
+// of running them itself.
+bool
+runs_in_helper(const std::string &verb, const clause_options &options);
+
+// Who may have the helper run this clause for them. The helper runs every
+// clause as root, and any local user can call it; root always may.
+//   anyone      nothing to guard
+//   authorized  rewrites or inspects every file of a filesystem: polkit must
+//               grant the caller org.beekeeper.privileged (active sessions get it)
+//   root_only   opens paths the caller chose: as root it would read files the
+//               caller cannot, so only root may. beekeeperman runs these in
+//               its own process, with the caller's permissions.
+enum class helper_caller { anyone, authorized, root_only };
+
+helper_caller
+helper_access(const std::string &verb, const clause_options &options);
+
 command_streams
 start(const clause_options& options, 
       const clause_subjects& subjects);
@@ -67,6 +99,30 @@ command_streams
 compressctl(const clause_options &options,
             const clause_subjects &subjects);
 
+command_streams
+metrics(const clause_options &options,
+        const clause_subjects &subjects);
+
+command_streams
+savings(const clause_options &options,
+        const clause_subjects &subjects);
+
+command_streams
+usage(const clause_options &options,
+      const clause_subjects &subjects);
+
+command_streams
+dupscan(const clause_options &options,
+        const clause_subjects &subjects);
+
+command_streams
+dedupe(const clause_options &options,
+       const clause_subjects &subjects);
+
+command_streams
+debuglog(const clause_options &options,
+         const clause_subjects &subjects);
+
 
 } // namespace clauses
 } // namespace beekeeper
\ No newline at end of file
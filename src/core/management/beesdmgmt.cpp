@@ -1,10 +1,18 @@
 #include "beekeeper/beesdmgmt.hpp"
+#include "beekeeper/beeshomemgmt.hpp"
 #include "beekeeper/btrfsetup.hpp"
+#include "beekeeper/cgroupmgmt.hpp"
+#include "beekeeper/logringmgmt.hpp"
+#include "beekeeper/procwatchmgmt.hpp"
+#include "beekeeper/timingsmgmt.hpp"
 #include "beekeeper/debug.hpp"
 #include "beekeeper/util.hpp"
 #include <algorithm>
+#include <cctype>
+#include <csignal>
 #include <cstdlib>
 #include <cstring>
+#include <dirent.h>
 #include <fcntl.h>
 #include <fstream>
 #include <iostream>
@@ -13,18 +21,21 @@
 #include <thread>
 #include <unistd.h>
 
+namespace timings = beekeeper::management::timings;
+
 /**
  * @brief Find system processes whose command line matches given substrings.
  *
  * This function searches for processes whose command line contains ALL of
- * the provided substrings (AND logic, not OR). It uses ps aux and filters
- * the output carefully to avoid false matches.
+ * the provided substrings (AND logic, not OR). It reads /proc/<pid>/cmdline
+ * for every process (under the system root), arguments joined by spaces.
  *
  * @param match_these_substrings A vector of substrings to match against each process's command line.
  * @return A vector of process IDs (pid_t) for all matching processes. If no matches are found, returns an empty vector.
  *
  * @note The search is case-sensitive and requires ALL substrings to match.
- * @note Uses manual parsing instead of chained greps to avoid shell escaping issues.
+ * @note Processes without a command line (kernel threads, defunct processes)
+ *       and the calling process itself never match.
  */
 std::vector<pid_t>
 bk_mgmt::find_processes(const std::vector<std::string> &match_these_substrings)
@@ -35,76 +46,59 @@ bk_mgmt::find_processes(const std::vector<std::string> &match_these_substrings)
         return matching_processes;
     }
 
-    // Get all processes
-    command_streams res = bk_util::exec_command("ps", "aux");
-    if (!res.stderr_str.empty())
+    timings::scoped_timer timer(timings::family::proc_scan, "processes");
+
+    // Walk the process table directly: no ps to fork, and it follows the
+    // system root like every other /proc read
+    const std::string proc_dir = bk_util::system_path("/proc");
+    DIR *dir = opendir(proc_dir.c_str());
+    if (!dir)
     {
-        std::cerr << "Failed to run ps aux for ["
+        std::cerr << "Failed to read " << proc_dir << " for ["
                   << bk_util::serialize_vector(match_these_substrings)
-                  << "]. Message: " << res.stderr_str << std::endl;
+                  << "]. Message: " << strerror(errno) << std::endl;
         return {};
     }
 
-    if (res.stdout_str.empty())
+    const pid_t self = getpid();
+    while (dirent *entry = readdir(dir))
     {
-        DEBUG_LOG("No ps output for: ",
-                  bk_util::serialize_vector(match_these_substrings));
-        return {};
-    }
-
-    // Split into lines
-    auto all_lines = bk_util::split_command_streams_by_lines(res).first;
+        const char *name = entry->d_name;
+        if (!std::isdigit(static_cast<unsigned char>(name[0])))
+            continue;
 
-    // Filter lines manually to ensure ALL substrings match
-    std::vector<std::string> matching_lines;
-    for (const auto &line : all_lines)
-    {
-        // Skip grep and ps aux itself
-        if (line.find("grep") != std::string::npos || 
-            line.find("ps aux") != std::string::npos) {
+        pid_t pid = static_cast<pid_t>(std::strtol(name, nullptr, 10));
+        if (pid <= 0 || pid == self)
             continue;
-        }
 
-        // Skip defunct processes
-        if (line.find("defunct") != std::string::npos) {
+        // NUL-separated argv; empty for kernel threads and defunct processes
+        std::string cmdline = bk_util::read_file(proc_dir + "/" + name + "/cmdline");
+        if (cmdline.empty())
             continue;
-        }
+        std::replace(cmdline.begin(), cmdline.end(), '\0', ' ');
 
-        // Check if ALL substrings are present in this line
+        // Check if ALL substrings are present in this command line
         bool all_match = true;
         for (const auto &needle : match_these_substrings)
         {
-            if (line.find(needle) == std::string::npos) {
+            if (cmdline.find(needle) == std::string::npos) {
                 all_match = false;
                 break;
             }
         }
 
         if (all_match) {
-            matching_lines.push_back(line);
+            matching_processes.push_back(pid);
         }
     }
+    closedir(dir);
+
+    // Oldest first, as ps lists them
+    std::sort(matching_processes.begin(), matching_processes.end());
 
     DEBUG_LOG("Process search for [", 
               bk_util::serialize_vector(match_these_substrings),
-              "] found ", matching_lines.size(), " matches");
-
-    // Extract PIDs from matching lines
-    for (const auto &line : matching_lines)
-    {
-        auto tokens = bk_util::tokenize(line);
-        if (tokens.size() > 1)
-        {
-            try
-            {
-                matching_processes.emplace_back(static_cast<pid_t>(std::stoi(tokens[1])));
-            }
-            catch (const std::exception &)
-            {
-                // Skip malformed line
-            }
-        }
-    }
+              "] found ", matching_processes.size(), " matches");
 
     DEBUG_LOG("Extracted PIDs: ", bk_util::serialize_vector(matching_processes));
 
@@ -147,7 +141,7 @@ bk_mgmt::find_beesd_processes(const std::string &mountpoint_or_uuid, bool find_w
         
         for (pid_t pid : all_beesd) {
             // Read the command line for this PID
-            std::string cmdline_path = "/proc/" + std::to_string(pid) + "/cmdline";
+            std::string cmdline_path = bk_util::system_path("/proc/" + std::to_string(pid) + "/cmdline");
             std::ifstream cmdline_file(cmdline_path);
             if (!cmdline_file) continue;
             
@@ -186,7 +180,7 @@ bk_mgmt::find_beesd_processes(const std::string &mountpoint_or_uuid, bool find_w
 // Helper: verify that PID is actually a beesd process
 bool
 bk_mgmt::verify_beesd_process(pid_t pid) {
-    std::string proc_path = "/proc/" + std::to_string(pid);
+    std::string proc_path = bk_util::system_path("/proc/" + std::to_string(pid));
     if (!bk_util::file_exists(proc_path)) {
         DEBUG_LOG("Process directory does not exist for PID: ", pid);
         return false;
@@ -285,9 +279,9 @@ wait_for_bees_worker(const std::string &uuid, const int retry_delay_ms = 3000, c
 
 // Start beesd daemon using UUID
 bool
-bk_mgmt::beesstart(const std::string &uuid)
+bk_mgmt::beesstart(const std::string &uuid, const std::vector<std::string> &bees_args)
 {
-    DEBUG_LOG("beesstart(", uuid, ")");
+    DEBUG_LOG("beesstart(", uuid, ", ", bk_util::serialize_vector(bees_args), ")");
 
     // ------------------------------------------------------------
     // 1) Must have a valid config file
@@ -317,20 +311,63 @@ bk_mgmt::beesstart(const std::string &uuid)
         // Write PID file
         write_pid_file_for_uuid(uuid, worker_pid);
 
+        // Adopt it into its cgroup in case it was started elsewhere
+        bk_mgmt::cgroup::attach(uuid, worker_pid);
+
         bk_mgmt::create_started_with_n_gb_file(uuid);
         return true;
     }
 
 
+    // NOCOW, fully allocated hash table at DB_SIZE, so beesd finds nothing
+    // to truncate. Best-effort: beesd still creates a sparse one otherwise.
+    bk_mgmt::beeshome::prepare(uuid);
+
+    // Resolve the cgroup before forking: the child only gets to do a raw write()
+    const std::string cgroup_procs = bk_mgmt::cgroup::prepare(uuid);
+
+    // Performance options from the config first, so callers (e.g. the
+    // scheduler) can override them: bees takes the last occurrence
+    std::vector<std::string> all_bees_args = bk_mgmt::bees_options_to_args(bk_mgmt::read_bees_options(uuid));
+    all_bees_args.insert(all_bees_args.end(), bees_args.begin(), bees_args.end());
+
     // ------------------------------------------------------------
-    // 4) Launch via beesd (double-fork trampoline)
-    //     beesd may die; bees must survive
+    // 4) Launch bees ourselves: exact PID, no discovery needed
+    // ------------------------------------------------------------
+    if (!bk_mgmt::find_bees_binary().empty()) {
+        if (bk_mgmt::launch_bees(uuid, all_bees_args, cgroup_procs) < 0)
+            return false;
+
+        bk_mgmt::create_started_with_n_gb_file(uuid);
+        return true;
+    }
+
+    // ------------------------------------------------------------
+    // 4b) No bees binary where we look: launch via beesd (double-fork
+    //     trampoline) and discover the worker. beesd may die; bees must survive
     // ------------------------------------------------------------
     DEBUG_LOG("Launching beesd for uuid ", uuid);
 
+    // Build argv up front as well
+    std::vector<char *> beesd_argv;
+    beesd_argv.push_back(const_cast<char *>("beesd"));
+    for (const auto &arg : all_bees_args)
+        beesd_argv.push_back(const_cast<char *>(arg.c_str()));
+    beesd_argv.push_back(const_cast<char *>(uuid.c_str()));
+    beesd_argv.push_back(nullptr);
+
+    // beesd and bees output, drained by the log ring
+    int output_pipe[2] = { -1, -1 };
+    if (pipe2(output_pipe, O_CLOEXEC) < 0)
+        DEBUG_LOG("pipe2 failed, bees output goes to /dev/null: ", strerror(errno));
+
     pid_t pid = fork();
     if (pid < 0) {
         DEBUG_LOG("First fork failed");
+        if (output_pipe[0] >= 0) {
+            close(output_pipe[0]);
+            close(output_pipe[1]);
+        }
         return false;
     }
 
@@ -342,7 +379,7 @@ bk_mgmt::beesstart(const std::string &uuid)
         }
 
         if (pid2 == 0) {
-            std::string beesd_path = bk_util::which("beesd");
+            std::string beesd_path = bk_mgmt::find_beesd_binary();
             if (beesd_path.empty()) {
                 std::cerr << "[beesstart] beesd not found in PATH\n";
                 _exit(127);
@@ -353,23 +390,34 @@ bk_mgmt::beesstart(const std::string &uuid)
                 _exit(1);
             }
 
-            // Redirect stdin, stdout, stderr to /dev/null
+            // Join the per-filesystem cgroup; beesd and bees inherit it.
+            // "0" means the writing process itself.
+            if (!cgroup_procs.empty()) {
+                int cgfd = open(cgroup_procs.c_str(), O_WRONLY | O_CLOEXEC);
+                if (cgfd >= 0) {
+                    (void) write(cgfd, "0", 1);
+                    close(cgfd);
+                }
+            }
+
+            // stdin from /dev/null; stdout and stderr to the log ring when
+            // we have a pipe, /dev/null otherwise
             int devnull = open("/dev/null", O_RDWR);
-            if (devnull >= 0) {
+            int output = output_pipe[1] >= 0 ? output_pipe[1] : devnull;
+            if (devnull >= 0)
                 dup2(devnull, STDIN_FILENO);
-                dup2(devnull, STDOUT_FILENO);
-                dup2(devnull, STDERR_FILENO);
-                if (devnull > STDERR_FILENO)
-                    close(devnull);
+            if (output >= 0) {
+                dup2(output, STDOUT_FILENO);
+                dup2(output, STDERR_FILENO);
             }
+            if (devnull > STDERR_FILENO)
+                close(devnull);
+
+            // If the helper goes away, bees loses its output, not its life
+            signal(SIGPIPE, SIG_IGN);
 
             // child #2 → this becomes beesd
-            execl(
-                beesd_path.c_str(),
-                "beesd",
-                uuid.c_str(),
-                nullptr
-            );
+            execv(beesd_path.c_str(), beesd_argv.data());
 
             // only reached on failure
             int err = errno;
@@ -384,6 +432,10 @@ bk_mgmt::beesstart(const std::string &uuid)
     }
 
     // parent continues
+    if (output_pipe[0] >= 0) {
+        close(output_pipe[1]);
+        bk_mgmt::logring::capture(uuid, output_pipe[0]);
+    }
 
     // ------------------------------------------------------------
     // 5) Wait for bees worker to appear
@@ -416,8 +468,9 @@ bk_mgmt::beesstart(const std::string &uuid)
 bool
 bk_mgmt::beesstop(const std::string& uuid)
 {
-    // Check for root privileges
-    if (!bk_util::is_root()) {
+    // Check for root privileges. Under a system root the workers are
+    // stand-ins run by the caller itself.
+    if (!bk_util::is_root() && bk_util::system_root().empty()) {
         std::cerr << "Error: beesstop requires root privileges." << std::endl;
         return false;
     }
@@ -429,22 +482,40 @@ bk_mgmt::beesstop(const std::string& uuid)
         return true;
     }
 
+    // PID file, logs, the bees mount and the then empty cgroup
+    auto clean_up = [&uuid]() {
+        clean_pid_file_for_uuid(uuid);
+        clear_log_file_for_uuid(uuid);
+        release_bees_mount(uuid);
+        bk_mgmt::cgroup::release(uuid);
+    };
+
+    constexpr auto wait_time = std::chrono::seconds(15);
+    constexpr auto poll_interval = std::chrono::milliseconds(200);
+
     // ------------------------------------------------------------
-    // 1) Find all bees/beesd processes containing this UUID
+    // 1) A worker we launched: signal and wait on its pidfd, which
+    //    cannot reach a process that reused its PID
+    // ------------------------------------------------------------
+    if (stop_launched_worker(uuid, std::chrono::milliseconds(wait_time).count())) {
+        clean_up();
+        return true;
+    }
+
+    // ------------------------------------------------------------
+    // 2) Otherwise (beesd, or a helper that restarted since): find all
+    //    bees/beesd processes containing this UUID
     // ------------------------------------------------------------
     std::vector<std::string> ps_lines = bk_util::get_process_lines("bees", uuid);
     if (ps_lines.empty()) {
         DEBUG_LOG("No bees processes found for UUID ", uuid);
-        clean_pid_file_for_uuid(uuid);
-        clear_log_file_for_uuid(uuid);
+        clean_up();
         return true;
     }
 
     // ------------------------------------------------------------
-    // 2) Terminate each process aggressively
+    // 3) Terminate each process aggressively
     // ------------------------------------------------------------
-    constexpr auto wait_time = std::chrono::seconds(15);
-    constexpr auto poll_interval = std::chrono::milliseconds(200);
 
     for (const auto &line : ps_lines) {
         pid_t pid = std::stoll(bk_util::get_second_token(line));
@@ -473,12 +544,7 @@ bk_mgmt::beesstop(const std::string& uuid)
         }
     }
 
-    // ------------------------------------------------------------
-    // 3) Cleanup PID file and logs
-    // ------------------------------------------------------------
-    clean_pid_file_for_uuid(uuid);
-    clear_log_file_for_uuid(uuid);
-
+    clean_up();
     return true;
 }
 
@@ -486,7 +552,7 @@ bk_mgmt::beesstop(const std::string& uuid)
 
 // Restart beesd daemon
 bool
-bk_mgmt::beesrestart(const std::string& uuid)
+bk_mgmt::beesrestart(const std::string& uuid, const std::vector<std::string> &bees_args)
 {
     if (beesstatus(uuid) == "running") {
         // Only stop if it's running
@@ -498,7 +564,7 @@ bk_mgmt::beesrestart(const std::string& uuid)
     }
 
     // Start the daemon (whether it was stopped or just stopped now)
-    return beesstart(uuid);
+    return beesstart(uuid, bees_args);
 }
 
 
@@ -506,6 +572,18 @@ bk_mgmt::beesrestart(const std::string& uuid)
 std::string
 bk_mgmt::beesstatus(const std::string& uuid)
 {
+    // 0. A worker we launched ourselves: its pidfd is dropped the moment it exits
+    if (launched_worker_pidfd(uuid) >= 0) {
+        return "running";
+    }
+
+    // 0b. Inside the helper, the proc connector table knows every worker
+    if (bk_mgmt::procwatch::is_live()) {
+        if (bk_mgmt::procwatch::worker_for(uuid) > 0)
+            return "running";
+        return bk_mgmt::btrfstat(uuid).empty() ? "unconfigured" : "stopped";
+    }
+
     std::string pidfile = get_pid_path(uuid);
 
     // 1. Check PID file
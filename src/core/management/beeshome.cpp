@@ -0,0 +1,395 @@
+#include "beekeeper/beesdmgmt.hpp"
+#include "beekeeper/beeshomemgmt.hpp"
+#include "beekeeper/btrfsetup.hpp"
+#include "beekeeper/debug.hpp"
+#include "beekeeper/tuningmgmt.hpp"
+#include "beekeeper/util.hpp"
+
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <linux/btrfs.h>
+#include <linux/fiemap.h>
+#include <linux/fs.h>
+#include <memory>
+#include <sys/ioctl.h>
+#include <sys/mount.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace fs = std::filesystem;
+namespace bh = beekeeper::management::beeshome;
+
+// Helpers
+namespace {
+
+// Where we mount the top level subvolume of a filesystem while working on
+// its default BEESHOME. beesd uses /run/bees/mnt/<uuid> for the same purpose.
+const std::string private_mount_dir = "/run/bees/beekeeper-qt/mnt/";
+
+// Resolves BEESHOME values to directories. The default placement lives in
+// the top level subvolume (subvolid=5), which is usually not mounted
+// anywhere, so it is mounted privately on first use and unmounted when
+// this object goes away.
+class beeshome_resolver
+{
+public:
+    explicit beeshome_resolver(const std::string &uuid) : m_uuid(uuid) {}
+
+    ~beeshome_resolver()
+    {
+        if (!m_mountpoint.empty() && umount2(m_mountpoint.c_str(), MNT_DETACH) < 0)
+            DEBUG_LOG("[beeshome] umount ", m_mountpoint, " failed: ", strerror(errno));
+    }
+
+    beeshome_resolver(const beeshome_resolver &) = delete;
+    beeshome_resolver &operator=(const beeshome_resolver &) = delete;
+
+    // "" if the filesystem cannot be reached
+    std::string
+    dir_for(const std::string &beeshome)
+    {
+        if (!beeshome.empty())
+            return beeshome;
+
+        if (m_mountpoint.empty() && !mount_top_level())
+            return "";
+
+        return m_mountpoint + "/" + bh::default_dir_name;
+    }
+
+private:
+    bool
+    mount_top_level()
+    {
+        std::string device = bk_mgmt::get_real_device(m_uuid);
+        if (device.empty()) {
+            DEBUG_LOG("[beeshome] no device for ", m_uuid);
+            return false;
+        }
+
+        std::string target = bk_util::system_path(private_mount_dir) + m_uuid;
+        std::error_code ec;
+        fs::create_directories(target, ec);
+
+        if (mount(device.c_str(), target.c_str(), "btrfs",
+                  MS_NODEV | MS_NOEXEC | MS_NOSUID, "subvolid=5") < 0) {
+            DEBUG_LOG("[beeshome] mount ", device, " on ", target, " failed: ", strerror(errno));
+            return false;
+        }
+
+        // Keep it out of the desktop's sight
+        (void) mount(nullptr, target.c_str(), nullptr, MS_PRIVATE, nullptr);
+
+        m_mountpoint = target;
+        return true;
+    }
+
+    std::string m_uuid;
+    std::string m_mountpoint;
+};
+
+// chattr +C. Only takes effect on directories and on empty files.
+bool
+set_nocow(int fd)
+{
+    int flags = 0;
+    if (ioctl(fd, FS_IOC_GETFLAGS, &flags) < 0)
+        return false;
+
+    if (flags & FS_NOCOW_FL)
+        return true;
+
+    flags |= FS_NOCOW_FL;
+    return ioctl(fd, FS_IOC_SETFLAGS, &flags) == 0;
+}
+
+// Create BEESHOME if needed and mark it NOCOW so new files inherit it.
+// The default one is a subvolume, like beesd makes it, so snapshots of the
+// top level do not drag the hash table along.
+bool
+ensure_beeshome(const std::string &dir, bool as_subvolume)
+{
+    std::error_code ec;
+
+    if (!fs::exists(dir, ec)) {
+        bool created = false;
+
+        if (as_subvolume) {
+            fs::path p(dir);
+            int parent = open(p.parent_path().c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            if (parent >= 0) {
+                btrfs_ioctl_vol_args args {};
+                std::strncpy(args.name, p.filename().c_str(), BTRFS_PATH_NAME_MAX);
+                created = ioctl(parent, BTRFS_IOC_SUBVOL_CREATE, &args) == 0;
+                close(parent);
+            }
+        }
+
+        if (!created && !fs::create_directories(dir, ec)) {
+            DEBUG_LOG("[beeshome] cannot create ", dir, ": ", ec.message());
+            return false;
+        }
+
+        fs::permissions(dir, fs::perms::owner_all, ec);
+    }
+
+    int fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        DEBUG_LOG("[beeshome] cannot open ", dir, ": ", strerror(errno));
+        return false;
+    }
+
+    // Not fatal: BEESHOME may be on a filesystem without NOCOW (ext4, xfs)
+    if (!set_nocow(fd))
+        DEBUG_LOG("[beeshome] cannot set NOCOW on ", dir, ": ", strerror(errno));
+
+    close(fd);
+    return true;
+}
+
+// Write a fresh, fully allocated NOCOW hash table next to `path` and
+// rename it into place, so the old one survives any failure on the way.
+// With copy_from, its contents are carried over (same size only).
+bool
+allocate_hash_file(const std::string &path, uint64_t size, const std::string &copy_from = "")
+{
+    const std::string tmp = path + ".new";
+    unlink(tmp.c_str());
+
+    int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        DEBUG_LOG("[beeshome] cannot create ", tmp, ": ", strerror(errno));
+        return false;
+    }
+
+    auto fail = [&]([[maybe_unused]] const char *what) {
+        DEBUG_LOG("[beeshome] ", what, " ", tmp, ": ", strerror(errno));
+        close(fd);
+        unlink(tmp.c_str());
+        return false;
+    };
+
+    // Must happen while the file is still empty
+    set_nocow(fd);
+
+    if (fallocate(fd, 0, 0, static_cast<off_t>(size)) < 0)
+        return fail("fallocate");
+
+    // Plain read/write instead of copy_file_range(): a reflinked copy would
+    // share extents with the old file and be copy-on-write again.
+    if (!copy_from.empty()) {
+        int src = open(copy_from.c_str(), O_RDONLY | O_CLOEXEC);
+        if (src < 0)
+            return fail("cannot open source for");
+
+        std::vector<char> buffer(4 * 1024 * 1024);
+        off_t offset = 0;
+
+        while (static_cast<uint64_t>(offset) < size) {
+            ssize_t n = pread(src, buffer.data(), buffer.size(), offset);
+            if (n <= 0) break;
+
+            if (pwrite(fd, buffer.data(), n, offset) != n) {
+                close(src);
+                return fail("copy into");
+            }
+            offset += n;
+        }
+
+        close(src);
+    }
+
+    if (fsync(fd) < 0)
+        return fail("fsync");
+
+    close(fd);
+
+    if (rename(tmp.c_str(), path.c_str()) < 0) {
+        DEBUG_LOG("[beeshome] rename ", tmp, " failed: ", strerror(errno));
+        unlink(tmp.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+// Move a small state file, across devices if need be
+void
+move_file(const fs::path &from, const fs::path &to)
+{
+    std::error_code ec;
+    if (!fs::exists(from, ec)) return;
+
+    fs::rename(from, to, ec);
+    if (ec) {
+        ec.clear();
+        if (fs::copy_file(from, to, fs::copy_options::overwrite_existing, ec))
+            fs::remove(from, ec);
+    }
+
+    if (ec)
+        DEBUG_LOG("[beeshome] cannot move ", from, " to ", to, ": ", ec.message());
+}
+
+// Size, NOCOW attribute and FIEMAP extent count of a hash table file
+bh::hash_file_info
+inspect_file(const std::string &hash_path)
+{
+    bh::hash_file_info info;
+
+    int fd = open(hash_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return info;
+
+    struct stat st {};
+    if (fstat(fd, &st) == 0) {
+        info.exists = true;
+        info.size = static_cast<uint64_t>(st.st_size);
+    }
+
+    int flags = 0;
+    info.nocow = ioctl(fd, FS_IOC_GETFLAGS, &flags) == 0 && (flags & FS_NOCOW_FL);
+
+    // fm_extent_count = 0 only counts the extents
+    fiemap fm {};
+    fm.fm_start = 0;
+    fm.fm_length = FIEMAP_MAX_OFFSET;
+    fm.fm_flags = FIEMAP_FLAG_SYNC;
+    if (ioctl(fd, FS_IOC_FIEMAP, &fm) == 0)
+        info.extents = fm.fm_mapped_extents;
+    else
+        DEBUG_LOG("[beeshome] FIEMAP on ", hash_path, " failed: ", strerror(errno));
+
+    close(fd);
+    return info;
+}
+
+} // anonymous namespace
+
+
+std::string
+bh::configured(const std::string &uuid)
+{
+    auto config = bk_mgmt::read_beesconfig(uuid);
+    auto it = config.find("BEESHOME");
+    return it == config.end() ? "" : it->second;
+}
+
+bool
+bh::prepare(const std::string &uuid, const std::optional<std::string> &previous_beeshome)
+{
+    auto config = bk_mgmt::read_beesconfig(uuid);
+    if (config.empty()) {
+        DEBUG_LOG("[beeshome] ", uuid, " is not configured");
+        return false;
+    }
+
+    uint64_t db_size = bk_mgmt::tuning::parse_db_size(config["DB_SIZE"]);
+    if (db_size == 0) {
+        DEBUG_LOG("[beeshome] ", uuid, ": unusable DB_SIZE '", config["DB_SIZE"], "'");
+        return false;
+    }
+
+    // bees has the table mmap()ed; changing it under its feet corrupts it
+    if (bk_mgmt::beesstatus(uuid) == "running") {
+        DEBUG_LOG("[beeshome] bees is running for ", uuid, ", not touching its hash table");
+        return false;
+    }
+
+    const std::string beeshome = config["BEESHOME"];
+    beeshome_resolver resolver(uuid);
+
+    std::string dir = resolver.dir_for(beeshome);
+    if (dir.empty() || !ensure_beeshome(dir, beeshome.empty()))
+        return false;
+
+    const fs::path home(dir);
+    const std::string hash_path = (home / hash_file_name).string();
+    std::error_code ec;
+
+    // Moved to another place: bring the bees state along
+    if (previous_beeshome && *previous_beeshome != beeshome) {
+        std::string old_dir = resolver.dir_for(*previous_beeshome);
+        fs::path old_home(old_dir);
+        fs::path old_hash = old_home / hash_file_name;
+
+        if (!old_dir.empty() && old_home != home && fs::exists(old_hash, ec) && !fs::exists(hash_path, ec)) {
+            DEBUG_LOG("[beeshome] moving bees state from ", old_dir, " to ", dir);
+
+            bool same_size = fs::file_size(old_hash, ec) == db_size;
+            if (!allocate_hash_file(hash_path, db_size, same_size ? old_hash.string() : ""))
+                return false;
+
+            fs::remove(old_hash, ec);
+            move_file(old_home / stats_file_name, home / stats_file_name);
+
+            // Crawl positions are only valid together with the table they filled
+            if (same_size)
+                move_file(old_home / crawl_file_name, home / crawl_file_name);
+            else
+                fs::remove(old_home / crawl_file_name, ec);
+
+            return true;
+        }
+    }
+
+    if (!fs::exists(hash_path, ec)) {
+        DEBUG_LOG("[beeshome] allocating ", db_size, " bytes at ", hash_path);
+        return allocate_hash_file(hash_path, db_size);
+    }
+
+    uint64_t current_size = fs::file_size(hash_path, ec);
+
+    if (current_size != db_size) {
+        // Hash positions depend on the table size, so the old contents are
+        // useless: start over and let bees rescan, as beesd would
+        DEBUG_LOG("[beeshome] resizing ", hash_path, " from ", current_size, " to ", db_size);
+        if (!allocate_hash_file(hash_path, db_size))
+            return false;
+        fs::remove(home / crawl_file_name, ec);
+        return true;
+    }
+
+    hash_file_info current = inspect_file(hash_path);
+    if (!current.nocow || is_fragmented(current)) {
+        DEBUG_LOG("[beeshome] rewriting ", hash_path, " as a contiguous NOCOW file");
+        return allocate_hash_file(hash_path, db_size, hash_path);
+    }
+
+    // Right size and NOCOW: just fill any holes left by a sparse truncate
+    int fd = open(hash_path.c_str(), O_WRONLY | O_CLOEXEC);
+    if (fd >= 0) {
+        if (fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(db_size)) < 0)
+            DEBUG_LOG("[beeshome] fallocate ", hash_path, " failed: ", strerror(errno));
+        close(fd);
+    }
+
+    return true;
+}
+
+bh::hash_file_info
+bh::inspect(const std::string &uuid)
+{
+    const std::string beeshome = configured(uuid);
+
+    beeshome_resolver resolver(uuid);
+    std::string dir = resolver.dir_for(beeshome);
+    if (dir.empty())
+        return { beeshome };
+
+    hash_file_info info = inspect_file(dir + "/" + hash_file_name);
+    info.beeshome = beeshome;
+    return info;
+}
+
+bool
+bh::is_fragmented(const hash_file_info &info)
+{
+    if (!info.exists || info.size == 0)
+        return false;
+
+    uint64_t ideal = (info.size + max_extent_size - 1) / max_extent_size;
+    return info.extents > ideal * 8;
+}
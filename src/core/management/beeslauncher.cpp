@@ -0,0 +1,396 @@
+#include "beekeeper/beesdmgmt.hpp"
+#include "beekeeper/btrfsetup.hpp"
+#include "beekeeper/cgroupmgmt.hpp"
+#include "beekeeper/debug.hpp"
+#include "beekeeper/logringmgmt.hpp"
+#include "beekeeper/util.hpp"
+
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <poll.h>
+#include <sys/mount.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+#ifndef P_PIDFD
+#define P_PIDFD 3
+#endif
+
+extern char **environ;
+
+namespace fs = std::filesystem;
+
+// Helpers
+namespace {
+
+// Same layout beesd uses, so tools looking for bees there keep working
+const std::string bees_work_dir = "/run/bees/";
+
+// How long a fresh worker must survive before we call it started. bees
+// rejects bad arguments and unusable BEESHOMEs right away.
+constexpr int startup_grace_ms = 300;
+
+// Workers this process launched, by UUID. Entries go away when the
+// waiter thread reaps the worker.
+std::mutex launched_mutex;
+std::map<std::string, int> launched_pidfds;
+
+int
+pidfd_open(pid_t pid)
+{
+    return static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+}
+
+int
+pidfd_send_signal(int pidfd, int sig)
+{
+    return static_cast<int>(syscall(SYS_pidfd_send_signal, pidfd, sig, nullptr, 0));
+}
+
+// Readable once the process has exited; false on timeout
+bool
+wait_for_pidfd(int pidfd, int timeout_ms)
+{
+    pollfd pfd { pidfd, POLLIN, 0 };
+    int n;
+    while ((n = poll(&pfd, 1, timeout_ms)) < 0 && errno == EINTR) {}
+    return n > 0;
+}
+
+// Is `dir` a mountpoint of this filesystem already (e.g. left by beesd)?
+bool
+is_mounted_at(const std::string &uuid, const std::string &dir)
+{
+    for (const auto &path : bk_mgmt::get_mount_paths(uuid))
+        if (path == dir)
+            return true;
+    return false;
+}
+
+// Reap the worker as soon as it exits, so it never lingers as a zombie
+// that kill(pid, 0) would still report as alive, and clean up after it
+// like beesd does.
+void
+wait_for_worker_exit(std::string uuid, pid_t pid, int pidfd)
+{
+    siginfo_t info {};
+    while (waitid(static_cast<idtype_t>(P_PIDFD), pidfd, &info, WEXITED) < 0 && errno == EINTR) {}
+
+    DEBUG_LOG("[launcher] bees worker ", pid, " for ", uuid, " exited, code ", info.si_status);
+
+    {
+        std::lock_guard<std::mutex> lock(launched_mutex);
+        auto it = launched_pidfds.find(uuid);
+        if (it != launched_pidfds.end() && it->second == pidfd)
+            launched_pidfds.erase(it);
+    }
+    close(pidfd);
+
+    if (bk_mgmt::read_pidfile_for_uuid(uuid) == pid)
+        bk_mgmt::clean_pid_file_for_uuid(uuid);
+
+    bk_mgmt::release_bees_mount(uuid);
+}
+
+} // anonymous namespace
+
+
+std::string
+bk_mgmt::bees_mount_dir(const std::string &uuid)
+{
+    return bk_util::system_path(bees_work_dir) + "mnt/" + uuid;
+}
+
+std::string
+bk_mgmt::bees_status_path(const std::string &uuid)
+{
+    auto config = read_beesconfig(uuid);
+    auto it = config.find("BEESSTATUS");
+    if (it != config.end() && !it->second.empty())
+        return it->second;
+
+    return bk_util::system_path(bees_work_dir) + uuid + ".status";
+}
+
+std::string
+bk_mgmt::find_bees_binary()
+{
+#ifdef BEEKEEPER_TEST_HOOKS
+    // A stand-in for tests and benchmarks. Set but not executable means
+    // "no bees here", which sends beesstart() down the beesd path.
+    if (const char *override_path = std::getenv("BEEKEEPER_BEES"))
+        return access(override_path, X_OK) == 0 ? override_path : "";
+#endif
+
+    // beesd runs bees from its libexec directory, which is not in PATH
+    for (const char *candidate : {"/usr/lib/bees/bees",
+                                  "/usr/libexec/bees/bees",
+                                  "/usr/libexec/bees",
+                                  "/usr/local/lib/bees/bees",
+                                  "/usr/local/libexec/bees"}) {
+        if (access(candidate, X_OK) == 0 && fs::is_regular_file(candidate))
+            return candidate;
+    }
+
+    return bk_util::which("bees");
+}
+
+std::string
+bk_mgmt::find_beesd_binary()
+{
+#ifdef BEEKEEPER_TEST_HOOKS
+    if (const char *override_path = std::getenv("BEEKEEPER_BEESD"))
+        return access(override_path, X_OK) == 0 ? override_path : "";
+#endif
+
+    return bk_util::which("beesd");
+}
+
+/**
+ * @brief Start bees for a filesystem without going through beesd.
+ *
+ * Does what the beesd script does: mounts the top level subvolume
+ * privately under /run/bees/mnt/<uuid>, points BEESHOME and BEESSTATUS at
+ * the configured (or default) places and runs bees on the mountpoint. The
+ * worker is our own child, so its PID is exact and a pidfd tracks it; a
+ * failed exec or an immediate exit is reported right away instead of
+ * being guessed from ps output seconds later. Its output goes to the
+ * per-filesystem log ring (see logringmgmt.hpp).
+ *
+ * @param uuid Filesystem UUID, must be configured.
+ * @param bees_args Options for bees, before the mountpoint.
+ * @param cgroup_procs cgroup.procs file for the worker to join, or "".
+ * @return The worker PID, already written to the pidfile, or -1.
+ */
+pid_t
+bk_mgmt::launch_bees(const std::string &uuid,
+                     const std::vector<std::string> &bees_args,
+                     const std::string &cgroup_procs)
+{
+    const std::string bees_path = find_bees_binary();
+    if (bees_path.empty()) {
+        DEBUG_LOG("[launcher] bees binary not found");
+        return -1;
+    }
+
+    auto config = read_beesconfig(uuid);
+    if (config.empty()) {
+        DEBUG_LOG("[launcher] ", uuid, " is not configured");
+        return -1;
+    }
+
+    // 1) Private view of the whole filesystem
+    const std::string mount_dir = bees_mount_dir(uuid);
+    std::error_code ec;
+    fs::create_directories(mount_dir, ec);
+
+    // Under a system root there is no device to mount: the directory
+    // stands in for the filesystem
+    if (!is_mounted_at(uuid, mount_dir) && bk_util::system_root().empty()) {
+        std::string device = get_real_device(uuid);
+        if (device.empty()
+            || mount(device.c_str(), mount_dir.c_str(), "btrfs",
+                     MS_NODEV | MS_NOEXEC | MS_NOSUID, "subvolid=5") < 0) {
+            DEBUG_LOG("[launcher] cannot mount ", uuid, " on ", mount_dir, ": ", strerror(errno));
+            return -1;
+        }
+        (void) mount(nullptr, mount_dir.c_str(), nullptr, MS_PRIVATE, nullptr);
+    }
+
+    // 2) Environment: ours plus BEESHOME/BEESSTATUS
+    std::string beeshome = config["BEESHOME"];
+    if (beeshome.empty())
+        beeshome = mount_dir + "/.beeshome";
+
+    std::vector<std::string> env_strings;
+    for (char **e = environ; e && *e; ++e) {
+        std::string entry(*e);
+        if (entry.rfind("BEESHOME=", 0) != 0 && entry.rfind("BEESSTATUS=", 0) != 0)
+            env_strings.push_back(std::move(entry));
+    }
+    env_strings.push_back("BEESHOME=" + beeshome);
+    env_strings.push_back("BEESSTATUS=" + bees_status_path(uuid));
+
+    // 3) Command line: extra OPTIONS from the config (as beesd passes them),
+    //    then ours, then the mountpoint
+    std::vector<std::string> arg_strings { bees_path };
+    for (const auto &opt : bk_util::tokenize(config["OPTIONS"]))
+        if (!opt.empty()) arg_strings.push_back(opt);
+    arg_strings.insert(arg_strings.end(), bees_args.begin(), bees_args.end());
+    arg_strings.push_back(mount_dir);
+
+    // Everything the child touches is built before fork(): after it, only
+    // async-signal-safe calls are allowed in a threaded process
+    std::vector<char *> argv, envp;
+    for (auto &s : arg_strings) argv.push_back(s.data());
+    argv.push_back(nullptr);
+    for (auto &s : env_strings) envp.push_back(s.data());
+    envp.push_back(nullptr);
+
+    DEBUG_LOG("[launcher] ", bk_util::serialize_vector(arg_strings));
+
+    // exec() closes the write end on success; on failure the child sends errno
+    int status_pipe[2];
+    if (pipe2(status_pipe, O_CLOEXEC) < 0) {
+        DEBUG_LOG("[launcher] pipe2 failed: ", strerror(errno));
+        return -1;
+    }
+
+    // bees stdout + stderr, drained by the log ring
+    int output_pipe[2];
+    if (pipe2(output_pipe, O_CLOEXEC) < 0) {
+        DEBUG_LOG("[launcher] pipe2 failed: ", strerror(errno));
+        close(status_pipe[0]);
+        close(status_pipe[1]);
+        return -1;
+    }
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        DEBUG_LOG("[launcher] fork failed: ", strerror(errno));
+        close(status_pipe[0]);
+        close(status_pipe[1]);
+        close(output_pipe[0]);
+        close(output_pipe[1]);
+        return -1;
+    }
+
+    if (pid == 0) {
+        close(status_pipe[0]);
+
+        // Outlive the helper and the desktop session
+        setsid();
+
+        if (!cgroup_procs.empty()) {
+            int cgfd = open(cgroup_procs.c_str(), O_WRONLY | O_CLOEXEC);
+            if (cgfd >= 0) {
+                (void) write(cgfd, "0", 1);
+                close(cgfd);
+            }
+        }
+
+        int devnull = open("/dev/null", O_RDWR);
+        if (devnull >= 0) {
+            dup2(devnull, STDIN_FILENO);
+            if (devnull > STDERR_FILENO)
+                close(devnull);
+        }
+        dup2(output_pipe[1], STDOUT_FILENO);
+        dup2(output_pipe[1], STDERR_FILENO);
+
+        // If the helper goes away, bees loses its output, not its life
+        signal(SIGPIPE, SIG_IGN);
+
+        execve(bees_path.c_str(), argv.data(), envp.data());
+
+        int err = errno;
+        (void) write(status_pipe[1], &err, sizeof(err));
+        _exit(127);
+    }
+
+    close(status_pipe[1]);
+    close(output_pipe[1]);
+
+    // Drain from the start: a worker that fails right away says why here
+    bk_mgmt::logring::capture(uuid, output_pipe[0]);
+
+    int exec_errno = 0;
+    ssize_t n;
+    while ((n = read(status_pipe[0], &exec_errno, sizeof(exec_errno))) < 0 && errno == EINTR) {}
+    close(status_pipe[0]);
+
+    // Our unreaped child: its PID cannot be recycled, so this pidfd is exact
+    int pidfd = pidfd_open(pid);
+
+    auto give_up = [&]() -> pid_t {
+        if (pidfd >= 0) close(pidfd);
+        waitpid(pid, nullptr, 0);
+        release_bees_mount(uuid);
+        return -1;
+    };
+
+    if (n > 0) {
+        DEBUG_LOG("[launcher] exec ", bees_path, " failed: ", strerror(exec_errno));
+        return give_up();
+    }
+
+    // 4) Readiness: exec worked; make sure bees did not bail out at once
+    if (pidfd >= 0) {
+        pollfd pfd { pidfd, POLLIN, 0 };
+        if (poll(&pfd, 1, startup_grace_ms) > 0) {
+            DEBUG_LOG("[launcher] bees exited right after starting for ", uuid);
+            return give_up();
+        }
+    } else {
+        DEBUG_LOG("[launcher] pidfd_open failed: ", strerror(errno), ", not tracking ", pid);
+    }
+
+    write_pid_file_for_uuid(uuid, pid);
+
+    if (pidfd >= 0) {
+        {
+            std::lock_guard<std::mutex> lock(launched_mutex);
+            launched_pidfds[uuid] = pidfd;
+        }
+        std::thread(wait_for_worker_exit, uuid, pid, pidfd).detach();
+    }
+
+    DEBUG_LOG("[launcher] bees worker for ", uuid, " is PID ", pid);
+    return pid;
+}
+
+int
+bk_mgmt::launched_worker_pidfd(const std::string &uuid)
+{
+    std::lock_guard<std::mutex> lock(launched_mutex);
+    auto it = launched_pidfds.find(uuid);
+    return it == launched_pidfds.end() ? -1 : it->second;
+}
+
+bool
+bk_mgmt::stop_launched_worker(const std::string &uuid, int grace_ms)
+{
+    // A copy of our own: the waiter thread closes its pidfd when it reaps
+    int pidfd = -1;
+    {
+        std::lock_guard<std::mutex> lock(launched_mutex);
+        auto it = launched_pidfds.find(uuid);
+        if (it != launched_pidfds.end())
+            pidfd = fcntl(it->second, F_DUPFD_CLOEXEC, 0);
+    }
+    if (pidfd < 0)
+        return false;
+
+    // ESRCH: it exited since we looked
+    bool exited = pidfd_send_signal(pidfd, SIGTERM) < 0 && errno == ESRCH;
+    if (!exited && !wait_for_pidfd(pidfd, grace_ms)) {
+        DEBUG_LOG_AT(warning, "[launcher] bees for ", uuid, " did not exit after SIGTERM, sending SIGKILL");
+        pidfd_send_signal(pidfd, SIGKILL);
+        wait_for_pidfd(pidfd, grace_ms);
+    }
+
+    close(pidfd);
+    DEBUG_LOG("[launcher] bees worker for ", uuid, " stopped");
+    return true;
+}
+
+void
+bk_mgmt::release_bees_mount(const std::string &uuid)
+{
+    const std::string mount_dir = bees_mount_dir(uuid);
+
+    // EINVAL: nothing mounted there, which is fine
+    if (umount2(mount_dir.c_str(), MNT_DETACH) < 0 && errno != EINVAL && errno != ENOENT)
+        DEBUG_LOG("[launcher] umount ", mount_dir, " failed: ", strerror(errno));
+
+    std::error_code ec;
+    fs::remove(mount_dir, ec); // only if empty
+}
@@ -11,6 +11,8 @@
 #include <filesystem>
 #include <iostream>
 #include <map>
+#include <sstream>
+#include <type_traits>
 
 extern "C" {
     #include <blkid/blkid.h>
@@ -21,6 +23,25 @@ namespace fs = std::filesystem;
 // Helpers for btrfsls()
 namespace {
 
+// Fill in what the GUI shows for a btrfs filesystem blkid knows about
+void add_filesystem(fs_map& out, const char* uuid, const char* label, const std::string& devname)
+{
+    DEBUG_LOG("btrfsls: found a btrfs with uuid ", uuid, " and label ", label);
+
+    if (!uuid || !*uuid)
+        return;
+
+    fs_info info;
+    info.devname     = devname;
+    if (label)   info.label = label;
+    info.status      = bk_mgmt::beesstatus(uuid);
+    info.config      = bk_mgmt::btrfstat(uuid);
+    info.compressing = bk_mgmt::transparentcompression::is_running(uuid);
+    info.autostart   = bk_mgmt::autostart::is_enabled_for(uuid);
+
+    out.emplace(uuid, std::move(info));
+}
+
 bool iterate_btrfs_devices(blkid_cache cache, fs_map& out)
 {
     bool found_any = false;
@@ -41,28 +62,58 @@ bool iterate_btrfs_devices(blkid_cache cache, fs_map& out)
         char* uuid  = blkid_get_tag_value(cache, "UUID", devname);
         char* label = blkid_get_tag_value(cache, "LABEL", devname);
 
-        DEBUG_LOG("btrfsls: found a btrfs with uuid ", uuid, " and label ", label);
+        add_filesystem(out, uuid, label, devname);
+
+        if (uuid)  free(uuid);
+        if (label) free(label);
+    }
+
+    blkid_dev_iterate_end(iter);
+    return found_any;
+}
+
+// KEY="value" out of a blkid.tab <device ...> line
+std::string recorded_tag(std::string_view line, const std::string& key)
+{
+    const std::string needle = ' ' + key + "=\"";
+    size_t pos = line.find(needle);
+    if (pos == std::string_view::npos)
+        return {};
+    pos += needle.size();
+    size_t end = line.find('"', pos);
+    return std::string(line.substr(pos, end == std::string_view::npos ? std::string_view::npos : end - pos));
+}
 
-        std::pair<std::string, fs_info> entry;
+// Under a system root, read its blkid cache file as written. libblkid
+// would drop every entry whose device node is not really there.
+bool read_btrfs_cache_file(const std::string& cache_file, fs_map& out)
+{
+    bk_util::text_buffer tab;
+    if (!tab.load(cache_file))
+        return false;
 
-        if (uuid)    entry.first = uuid;
-        entry.second.devname = devname;
-        if (label)   entry.second.label = label;
+    bool found_any = false;
 
-        if (uuid && *uuid) {
-            entry.second.status      = bk_mgmt::beesstatus(uuid);
-            entry.second.config      = bk_mgmt::btrfstat(uuid);
-            entry.second.compressing = bk_mgmt::transparentcompression::is_running(uuid);
-            entry.second.autostart   = bk_mgmt::autostart::is_enabled_for(uuid);
+    for (std::string_view line : tab.lines()) {
+        // <device DEVNO="..." UUID="..." TYPE="btrfs">/dev/sdX</device>
+        if (line.find(" TYPE=\"btrfs\"") == std::string_view::npos)
+            continue;
 
-            out.insert(std::move(entry));
-        }
+        size_t open = line.find('>');
+        size_t close = line.rfind("</device>");
+        if (line.rfind("<device ", 0) != 0 || open == std::string_view::npos
+            || close == std::string_view::npos || close < open)
+            continue;
 
-        if (uuid)  free(uuid);
-        if (label) free(label);
+        std::string_view attributes = line.substr(0, open);
+        std::string devname(line.substr(open + 1, close - open - 1));
+
+        found_any = true;
+        std::string uuid  = recorded_tag(attributes, "UUID");
+        std::string label = recorded_tag(attributes, "LABEL");
+        add_filesystem(out, uuid.c_str(), label.c_str(), devname);
     }
 
-    blkid_dev_iterate_end(iter);
     return found_any;
 }
 
@@ -153,6 +204,12 @@ bk_mgmt::btrfsls()
 
     DEBUG_LOG("btrfsls: using built-in libblkid…");
 
+    // Under a system root, its blkid cache file stands in for the devices
+    if (!bk_util::system_root().empty()) {
+        read_btrfs_cache_file(bk_util::system_path("/run/blkid/blkid.tab"), available_filesystems);
+        return available_filesystems;
+    }
+
     blkid_cache cache = nullptr;
     if (blkid_get_cache(&cache, nullptr) < 0) {
         DEBUG_LOG("blkid_get_cache() failed.");
@@ -181,7 +238,13 @@ bk_mgmt::btrfsls()
 std::string
 bk_mgmt::btrfstat (std::string uuid)
 {
-    const fs::path conf_dir = "/etc/bees";
+    return btrfstat(uuid, bk_util::system_path("/etc/bees"));
+}
+
+std::string
+bk_mgmt::btrfstat (const std::string &uuid, const std::string &config_dir)
+{
+    const fs::path conf_dir = config_dir;
     
     if (!fs::exists(conf_dir)) {
         return "";
@@ -209,9 +272,76 @@ bk_mgmt::btrfstat (std::string uuid)
     return "";
 }
 
+// Read the config file of a given UUID into a key-value map
+std::map<std::string, std::string>
+bk_mgmt::read_beesconfig (const std::string &uuid)
+{
+    std::string config_path = bk_mgmt::btrfstat(uuid);
+    if (config_path.empty())
+        return {};
+
+    auto config = parse_config(config_path);
+    for (auto &[key, value] : config)
+        value = bk_util::trip_quotes(value);
+
+    return config;
+}
+
+bk_mgmt::bees_options
+bk_mgmt::read_bees_options (const std::string &uuid)
+{
+    bees_options options;
+    auto config = read_beesconfig(uuid);
+
+    auto read = [&config](const std::string &key, auto &field) {
+        auto it = config.find(key);
+        if (it == config.end() || it->second.empty())
+            return;
+        try {
+            if constexpr (std::is_same_v<std::decay_t<decltype(field)>, int>)
+                field = std::stoi(it->second);
+            else
+                field = bk_util::to_double(it->second);
+        } catch (...) {
+            DEBUG_LOG("read_bees_options: ignoring invalid ", key, "=", it->second);
+        }
+    };
+
+    read("BEES_THREAD_COUNT", options.thread_count);
+    read("BEES_THREAD_FACTOR", options.thread_factor);
+    read("BEES_LOADAVG_TARGET", options.loadavg_target);
+    read("BEES_SCAN_MODE", options.scan_mode);
+    read("BEES_THROTTLE_FACTOR", options.throttle_factor);
+
+    return options;
+}
+
+std::vector<std::string>
+bk_mgmt::bees_options_to_args (const bees_options &options)
+{
+    std::vector<std::string> args;
+
+    if (options.thread_count > 0)
+        args.push_back("--thread-count=" + std::to_string(options.thread_count));
+    if (options.thread_factor > 0)
+        args.push_back("--thread-factor=" + bk_util::format_double(options.thread_factor));
+    if (options.loadavg_target > 0)
+        args.push_back("--loadavg-target=" + bk_util::format_double(options.loadavg_target));
+    if (options.scan_mode >= 0 && options.scan_mode <= 4)
+        args.push_back("--scan-mode=" + std::to_string(options.scan_mode));
+    if (options.throttle_factor > 0)
+        args.push_back("--throttle-factor=" + bk_util::format_double(options.throttle_factor));
+
+    return args;
+}
+
 // Create/update config file for a given UUID and database size
 std::string
-bk_mgmt::beessetup(std::string uuid, size_t db_size)
+bk_mgmt::beessetup(std::string uuid,
+                   size_t db_size,
+                   const std::optional<bees_options> &options,
+                   const std::optional<std::string> &beeshome,
+                   const std::map<std::string, std::string> &config_keys)
 {
     // Check if config already exists
     std::string config_path = bk_mgmt::btrfstat(uuid);
@@ -252,8 +382,33 @@ bk_mgmt::beessetup(std::string uuid, size_t db_size)
         new_config["DB_SIZE"] = std::to_string(DEFAULT_DB_SIZE);
     }
 
+    // Performance knobs: set what is set, drop what was cleared
+    if (options) {
+        auto put = [&new_config](const std::string &key, bool is_set, const std::string &value) {
+            if (is_set) new_config[key] = value;
+            else        new_config.erase(key);
+        };
+
+        put("BEES_THREAD_COUNT",    options->thread_count > 0,    std::to_string(options->thread_count));
+        put("BEES_THREAD_FACTOR",   options->thread_factor > 0,   bk_util::format_double(options->thread_factor));
+        put("BEES_LOADAVG_TARGET",  options->loadavg_target > 0,  bk_util::format_double(options->loadavg_target));
+        put("BEES_SCAN_MODE",       options->scan_mode >= 0 && options->scan_mode <= 4,
+                                    std::to_string(options->scan_mode));
+        put("BEES_THROTTLE_FACTOR", options->throttle_factor > 0, bk_util::format_double(options->throttle_factor));
+    }
+
+    if (beeshome) {
+        if (beeshome->empty()) new_config.erase("BEESHOME");
+        else                   new_config["BEESHOME"] = *beeshome;
+    }
+
+    for (const auto &[key, value] : config_keys) {
+        if (value.empty()) new_config.erase(key);
+        else               new_config[key] = value;
+    }
+
     // Ensure /etc/bees directory exists
-    const fs::path conf_dir = "/etc/bees";
+    const fs::path conf_dir = bk_util::system_path("/etc/bees");
     std::error_code ec;
 
     if (!fs::exists(conf_dir, ec)) {
@@ -0,0 +1,346 @@
+#include "beekeeper/btrfsetup.hpp"
+#include "beekeeper/cgroupmgmt.hpp"
+#include "beekeeper/debug.hpp"
+#include "beekeeper/util.hpp"
+
+#include <charconv>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace fs = std::filesystem;
+namespace cg = beekeeper::management::cgroup;
+
+// Helpers
+namespace {
+
+// Write a value into a cgroup interface file. The kernel reports invalid
+// values at write time, so the stream state after flushing is meaningful.
+bool
+write_knob(const std::string &path, const std::string &value)
+{
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        DEBUG_LOG("[cgroup] cannot open ", path);
+        return false;
+    }
+
+    out << value;
+    out.flush();
+
+    if (!out.good()) {
+        DEBUG_LOG("[cgroup] kernel rejected '", value, "' for ", path);
+        return false;
+    }
+
+    return true;
+}
+
+uint64_t
+to_u64(std::string_view s)
+{
+    uint64_t value = 0;
+    auto result = std::from_chars(s.data(), s.data() + s.size(), value);
+    return result.ec == std::errc() ? value : 0;
+}
+
+// "50%" -> "50000 100000"; anything else is passed through as-is
+std::string
+normalize_cpu_max(const std::string &value)
+{
+    constexpr uint64_t period_usec = 100000;
+
+    if (value.empty() || value.back() != '%')
+        return value;
+
+    uint64_t percent = to_u64(value.substr(0, value.size() - 1));
+    if (percent == 0)
+        return "";
+
+    return std::to_string(percent * period_usec / 100) + " " + std::to_string(period_usec);
+}
+
+// Turn on the controllers we need for children of this cgroup
+void
+enable_controllers(const fs::path &parent)
+{
+    for (const char *controller : {"+cpu", "+io", "+memory"})
+        write_knob((parent / "cgroup.subtree_control").string(), controller);
+}
+
+fs::path
+unit_dir()
+{
+    return fs::path(bk_util::system_path(cg::cgroup_root)) / cg::unit_path;
+}
+
+// "/system.slice/beekeeper-qt.service/helper", from the unified hierarchy line
+std::string
+own_cgroup()
+{
+    std::ifstream in(bk_util::system_path("/proc/self/cgroup"));
+    std::string line;
+    while (std::getline(in, line))
+        if (line.rfind("0::", 0) == 0)
+            return line.substr(3);
+    return "";
+}
+
+} // anonymous namespace
+
+
+bool
+cg::is_available()
+{
+    return bk_util::file_exists(bk_util::system_path(cgroup_root) + "/cgroup.controllers");
+}
+
+bool
+cg::in_unit()
+{
+    const std::string own = own_cgroup();
+    const std::string unit = "/" + unit_path;
+    return own == unit || own.rfind(unit + "/", 0) == 0;
+}
+
+bool
+cg::enter_unit()
+{
+    if (!is_available() || !in_unit())
+        return false;
+
+    fs::path leaf = unit_dir() / helper_leaf;
+    std::error_code ec;
+    fs::create_directories(leaf, ec);
+    if (ec) {
+        DEBUG_LOG("[cgroup] failed to create ", leaf.string(), ": ", ec.message());
+        return false;
+    }
+
+    if (!write_knob((leaf / "cgroup.procs").string(), std::to_string(getpid())))
+        return false;
+
+    enable_controllers(unit_dir());
+    return true;
+}
+
+std::string
+cg::path_for(const std::string &uuid)
+{
+    return (unit_dir() / ("bees-" + uuid)).string();
+}
+
+cg::limits
+cg::read_limits(const std::string &uuid)
+{
+    auto config = bk_mgmt::read_beesconfig(uuid);
+
+    auto value_of = [&config](const std::string &key) -> std::string {
+        auto it = config.find(key);
+        return it != config.end() ? bk_util::trim_string(it->second) : "";
+    };
+
+    return limits {
+        normalize_cpu_max(value_of("CGROUP_CPU_MAX")),
+        value_of("CGROUP_CPU_WEIGHT"),
+        value_of("CGROUP_IO_MAX"),
+        value_of("CGROUP_IO_WEIGHT"),
+        value_of("CGROUP_MEMORY_HIGH")
+    };
+}
+
+/**
+ * @brief Create the cgroup of a filesystem and apply its configured limits.
+ *
+ * The cgroup lives in the subtree systemd delegates to the helper's unit;
+ * anywhere else systemd could move or kill it. Limits that fail to apply
+ * are logged and skipped; the cgroup is still usable.
+ *
+ * @param uuid Filesystem UUID.
+ * @return Path to the cgroup.procs file of the new cgroup, or "" if cgroup v2
+ *         is unavailable, this process is not the helper in its unit, or the
+ *         directory could not be created.
+ */
+std::string
+cg::prepare(const std::string &uuid)
+{
+    if (uuid.empty() || !is_available())
+        return "";
+
+    if (!in_unit()) {
+        DEBUG_LOG("[cgroup] not running in ", unit_path, ", no cgroup for ", uuid);
+        return "";
+    }
+
+    fs::path group = path_for(uuid);
+
+    std::error_code ec;
+    fs::create_directories(group, ec);
+    if (ec) {
+        DEBUG_LOG("[cgroup] failed to create ", group.string(), ": ", ec.message());
+        return "";
+    }
+
+    enable_controllers(unit_dir());
+
+    limits l = read_limits(uuid);
+
+    if (!l.cpu_max.empty())
+        write_knob((group / "cpu.max").string(), l.cpu_max);
+
+    if (!l.cpu_weight.empty())
+        write_knob((group / "cpu.weight").string(), l.cpu_weight);
+
+    if (!l.memory_high.empty())
+        write_knob((group / "memory.high").string(), l.memory_high);
+
+    if (!l.io_max.empty() || !l.io_weight.empty()) {
+        std::string devno = bk_mgmt::get_backing_disk_devno(uuid);
+
+        if (devno.empty()) {
+            DEBUG_LOG("[cgroup] no backing disk for ", uuid, ", skipping io limits");
+        } else {
+            if (!l.io_max.empty())
+                write_knob((group / "io.max").string(), devno + " " + l.io_max);
+
+            if (!l.io_weight.empty())
+                write_knob((group / "io.weight").string(), devno + " " + l.io_weight);
+        }
+    }
+
+    return (group / "cgroup.procs").string();
+}
+
+bool
+cg::attach(const std::string &uuid, pid_t pid)
+{
+    if (pid <= 0)
+        return false;
+
+    std::string procs = prepare(uuid);
+    if (procs.empty())
+        return false;
+
+    return write_knob(procs, std::to_string(pid));
+}
+
+bool
+cg::freeze(const std::string &uuid, bool frozen)
+{
+    std::string knob = path_for(uuid) + "/cgroup.freeze";
+    if (!bk_util::file_exists(knob))
+        return false;
+
+    return write_knob(knob, frozen ? "1" : "0");
+}
+
+bool
+cg::set_weight(const std::string &uuid, int weight)
+{
+    if (weight < 1 || weight > 10000)
+        return false;
+
+    std::string group = path_for(uuid);
+    if (!bk_util::file_exists(group + "/cgroup.procs"))
+        return false;
+
+    bool ok = write_knob(group + "/cpu.weight", std::to_string(weight));
+
+    // io.weight is only present with an io cost/bfq-capable setup
+    std::string devno = bk_mgmt::get_backing_disk_devno(uuid);
+    if (!devno.empty())
+        write_knob(group + "/io.weight", devno + " " + std::to_string(weight));
+
+    return ok;
+}
+
+bool
+cg::reset_weight(const std::string &uuid)
+{
+    std::string group = path_for(uuid);
+    if (!bk_util::file_exists(group + "/cgroup.procs"))
+        return false;
+
+    limits l = read_limits(uuid);
+
+    // 100 is cpu.weight's default; "default" drops a per-disk io.weight
+    bool ok = write_knob(group + "/cpu.weight", l.cpu_weight.empty() ? "100" : l.cpu_weight);
+
+    std::string devno = bk_mgmt::get_backing_disk_devno(uuid);
+    if (!devno.empty())
+        write_knob(group + "/io.weight", devno + " " + (l.io_weight.empty() ? "default" : l.io_weight));
+
+    return ok;
+}
+
+void
+cg::release(const std::string &uuid)
+{
+    std::error_code ec;
+
+    // rmdir only succeeds on an empty cgroup, which is exactly what we want
+    fs::remove(path_for(uuid), ec);
+    if (ec)
+        DEBUG_LOG("[cgroup] could not remove cgroup for ", uuid, ": ", ec.message());
+}
+
+/**
+ * @brief Read back CPU, I/O and memory usage of a filesystem's bees worker.
+ *
+ * Interface files are world-readable, so this works without root.
+ *
+ * @param uuid Filesystem UUID.
+ * @return Filled stats, or stats with available = false if no cgroup exists.
+ */
+cg::stats
+cg::read_stats(const std::string &uuid)
+{
+    stats s;
+    std::string group = path_for(uuid);
+
+    if (!bk_util::file_exists(group + "/cgroup.procs"))
+        return s;
+
+    s.available = true;
+
+    bk_util::text_buffer file;
+
+    // cpu.stat: "key value" per line
+    file.load(group + "/cpu.stat");
+    for (std::string_view line : file.lines()) {
+        const auto &tokens = file.tokenize(line);
+        if (tokens.size() < 2)
+            continue;
+
+        if      (tokens[0] == "usage_usec")     s.cpu_usage_usec     = to_u64(tokens[1]);
+        else if (tokens[0] == "user_usec")      s.cpu_user_usec      = to_u64(tokens[1]);
+        else if (tokens[0] == "system_usec")    s.cpu_system_usec    = to_u64(tokens[1]);
+        else if (tokens[0] == "throttled_usec") s.cpu_throttled_usec = to_u64(tokens[1]);
+    }
+
+    // io.stat: "MAJ:MIN rbytes=N wbytes=N rios=N wios=N ..." per device
+    file.load(group + "/io.stat");
+    for (std::string_view line : file.lines()) {
+        for (std::string_view token : file.tokenize(line)) {
+            auto eq = token.find('=');
+            if (eq == std::string_view::npos)
+                continue;
+
+            std::string_view key = token.substr(0, eq);
+            uint64_t value = to_u64(token.substr(eq + 1));
+
+            if      (key == "rbytes") s.io_rbytes += value;
+            else if (key == "wbytes") s.io_wbytes += value;
+            else if (key == "rios")   s.io_rios   += value;
+            else if (key == "wios")   s.io_wios   += value;
+        }
+    }
+
+    file.load(group + "/memory.current");
+    if (!file.lines().empty())
+        s.memory_current = to_u64(file.lines()[0]);
+
+    return s;
+}
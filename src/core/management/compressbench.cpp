@@ -0,0 +1,483 @@
+#include "beekeeper/btrfsetup.hpp"
+#include "beekeeper/compressbenchmgmt.hpp"
+#include "beekeeper/debug.hpp"
+#include "beekeeper/transparentcompressionmgmt.hpp"
+#include "beekeeper/util.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <sys/xattr.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+namespace cb = beekeeper::management::compressbench;
+namespace tc = beekeeper::management::transparentcompression;
+
+// Helpers
+namespace {
+
+// btrfs compresses in chunks of this size: the data mix is chosen per chunk
+constexpr size_t chunk_size = 128 * 1024;
+
+// Distinct generated chunks per kind, so no two neighbours are identical
+constexpr size_t pool_chunks = 16;
+
+// O_DIRECT buffers and lengths are aligned to this
+constexpr size_t alignment = 4096;
+
+using clock_type = std::chrono::steady_clock;
+
+struct xorshift {
+    uint64_t s;
+    explicit xorshift(uint64_t seed) : s(seed ? seed : 0x9e3779b97f4a7c15ULL) {}
+    uint64_t next() { s ^= s << 13; s ^= s >> 7; s ^= s << 17; return s; }
+};
+
+struct aligned_buffer {
+    unsigned char *data = nullptr;
+    explicit aligned_buffer(size_t n) { if (posix_memalign(reinterpret_cast<void **>(&data), alignment, n) != 0) data = nullptr; }
+    ~aligned_buffer() { std::free(data); }
+    aligned_buffer(const aligned_buffer &) = delete;
+    aligned_buffer &operator=(const aligned_buffer &) = delete;
+};
+
+constexpr const char *scratch_prefix = ".beekeeper-bench-";
+
+// Scratch directory at the top of the filesystem, locked while a run uses
+// it and removed with everything in it when the run ends or throws
+struct scratch_dir {
+    std::string path;
+    int fd = -1;
+
+    explicit scratch_dir(const std::string &mount)
+    {
+        std::string name = (fs::path(mount) / (std::string(scratch_prefix) + "XXXXXX")).string();
+        if (!mkdtemp(name.data()))
+            return;
+        path = name;
+        fd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd >= 0)
+            flock(fd, LOCK_EX);
+    }
+    ~scratch_dir()
+    {
+        std::error_code ec;
+        if (!path.empty())
+            fs::remove_all(path, ec);
+        if (fd >= 0)
+            ::close(fd);
+    }
+    scratch_dir(const scratch_dir &) = delete;
+    scratch_dir &operator=(const scratch_dir &) = delete;
+};
+
+// Remove scratch directories of runs that were killed; one still locked
+// belongs to a run in progress
+void
+remove_stale_scratch(const std::string &mount)
+{
+    std::error_code ec;
+    for (const auto &entry : fs::directory_iterator(mount, ec)) {
+        const std::string name = entry.path().filename().string();
+        if (name.rfind(scratch_prefix, 0) != 0 || !entry.is_directory(ec))
+            continue;
+
+        int fd = open(entry.path().c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd < 0)
+            continue;
+        if (flock(fd, LOCK_EX | LOCK_NB) == 0) {
+            DEBUG_LOG("[compressbench] removing stale ", entry.path().string());
+            fs::remove_all(entry.path(), ec);
+        }
+        ::close(fd);
+    }
+}
+
+// Chunks of each kind, generated once per run
+struct data_pool {
+    std::vector<unsigned char> text, random;
+    std::array<double, 2> cumulative {};  // text, text + random (of 1)
+
+    explicit data_pool(const cb::mix &m)
+        : text(chunk_size * pool_chunks), random(chunk_size * pool_chunks)
+    {
+        static const char *words[] = {
+            "the", "of", "and", "filesystem", "extent", "block", "to", "in", "is", "data",
+            "compression", "for", "with", "that", "on", "btrfs", "file", "as", "by", "this",
+            "write", "read", "at", "be", "from", "or", "an", "are", "which", "page",
+            "directory", "inode", "metadata", "checksum", "snapshot", "subvolume", "it", "not",
+        };
+        constexpr size_t word_count = sizeof(words) / sizeof(words[0]);
+
+        xorshift rng(1);
+        size_t pos = 0, line = 0;
+        while (pos < text.size()) {
+            const char *w = words[rng.next() % word_count];
+            for (const char *c = w; *c && pos < text.size(); ++c)
+                text[pos++] = static_cast<unsigned char>(*c);
+            if (pos < text.size())
+                text[pos++] = ++line % 12 == 0 ? '\n' : ' ';
+        }
+
+        for (size_t i = 0; i < random.size(); i += sizeof(uint64_t)) {
+            uint64_t v = rng.next();
+            std::memcpy(&random[i], &v, sizeof(v));
+        }
+
+        double total = std::max(0.0, m.text) + std::max(0.0, m.random) + std::max(0.0, m.zeros);
+        if (total <= 0) total = 1;
+        cumulative[0] = std::max(0.0, m.text) / total;
+        cumulative[1] = cumulative[0] + std::max(0.0, m.random) / total;
+    }
+
+    // Fill `n` bytes (a multiple of chunk_size) for file number `index`;
+    // the same index gives the same content for every preset
+    void fill(unsigned char *out, size_t n, uint64_t index) const
+    {
+        xorshift rng(index * 0x2545f4914f6cdd1dULL + 7);
+        for (size_t off = 0; off < n; off += chunk_size) {
+            double pick = static_cast<double>(rng.next() % 1000000) / 1000000.0;
+            size_t which = (rng.next() % pool_chunks) * chunk_size;
+            if (pick < cumulative[0])
+                std::memcpy(out + off, &text[which], chunk_size);
+            else if (pick < cumulative[1])
+                std::memcpy(out + off, &random[which], chunk_size);
+            else
+                std::memset(out + off, 0, chunk_size);
+        }
+    }
+};
+
+// Busy CPU seconds of the whole machine, from /proc/stat
+double
+busy_cpu_seconds()
+{
+    std::ifstream in(bk_util::system_path("/proc/stat"));
+    std::string cpu;
+    unsigned long long user = 0, nice = 0, system = 0, idle = 0, iowait = 0, irq = 0, softirq = 0, steal = 0;
+    in >> cpu >> user >> nice >> system >> idle >> iowait >> irq >> softirq >> steal;
+    if (!in || cpu != "cpu") return 0;
+
+    long ticks = sysconf(_SC_CLK_TCK);
+    return static_cast<double>(user + nice + system + irq + softirq + steal) / static_cast<double>(ticks > 0 ? ticks : 100);
+}
+
+double
+percentile_ms(std::vector<double> &sorted_seconds, double q)
+{
+    if (sorted_seconds.empty()) return 0;
+    size_t rank = static_cast<size_t>(q * static_cast<double>(sorted_seconds.size() - 1) + 0.5);
+    return sorted_seconds[std::min(rank, sorted_seconds.size() - 1)] * 1000.0;
+}
+
+bool
+write_all(int fd, const unsigned char *data, size_t n)
+{
+    while (n > 0) {
+        ssize_t w = write(fd, data, n);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) return false;
+        data += w;
+        n -= static_cast<size_t>(w);
+    }
+    return true;
+}
+
+// Set the directory's compression property; "algorithm:level" first,
+// plain "algorithm" on kernels that refuse the level
+bool
+set_property(const std::string &dir, const std::string &algorithm, int level)
+{
+    const char *name = "btrfs.compression";
+    if (level > 0) {
+        std::string value = algorithm + ":" + std::to_string(level);
+        if (setxattr(dir.c_str(), name, value.data(), value.size(), 0) == 0)
+            return true;
+    }
+    return setxattr(dir.c_str(), name, algorithm.data(), algorithm.size(), 0) == 0;
+}
+
+// Write then read back one preset's share of files in `dir`
+cb::result
+measure(const std::string &dir, cb::result r, const cb::options &opts, const data_pool &pool)
+{
+    const size_t file_size = static_cast<size_t>(opts.file_size);
+    const uint64_t files = std::max<uint64_t>(1, opts.bytes_per_preset / file_size);
+
+    aligned_buffer buffer(file_size);
+    if (!buffer.data) return r;
+
+    std::vector<double> latencies;
+    latencies.reserve(files);
+    double busy_before = busy_cpu_seconds();
+
+    for (uint64_t i = 0; i < files; ++i) {
+        pool.fill(buffer.data, file_size, i);
+        const std::string path = dir + "/" + std::to_string(i);
+
+        auto t0 = clock_type::now();
+        int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+        if (fd < 0) {
+            DEBUG_LOG("[compressbench] cannot create ", path, ": ", strerror(errno));
+            return r;
+        }
+        bool ok = write_all(fd, buffer.data, file_size) && fsync(fd) == 0;
+        latencies.push_back(std::chrono::duration<double>(clock_type::now() - t0).count());
+
+        // Keep the read phase honest: nothing left in the page cache
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+        if (!ok) {
+            DEBUG_LOG("[compressbench] write failed in ", dir, ": ", strerror(errno));
+            return r;
+        }
+        r.bytes += file_size;
+    }
+
+    r.cpu_seconds = busy_cpu_seconds() - busy_before;
+
+    double write_seconds = 0;
+    for (double s : latencies) write_seconds += s;
+    r.write_bytes_per_sec = write_seconds > 0 ? static_cast<double>(r.bytes) / write_seconds : 0;
+
+    std::sort(latencies.begin(), latencies.end());
+    r.p50_ms = percentile_ms(latencies, 0.50);
+    r.p90_ms = percentile_ms(latencies, 0.90);
+    r.p99_ms = percentile_ms(latencies, 0.99);
+
+    // Read back. btrfs serves compressed extents through the page cache
+    // even for O_DIRECT, which is why the writes dropped it.
+    uint64_t read_bytes = 0;
+    auto t0 = clock_type::now();
+    for (uint64_t i = 0; i < files; ++i) {
+        const std::string path = dir + "/" + std::to_string(i);
+        int fd = open(path.c_str(), O_RDONLY | O_DIRECT | O_CLOEXEC);
+        if (fd < 0 && errno == EINVAL)
+            fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) continue;
+
+        ssize_t n;
+        while ((n = read(fd, buffer.data, file_size)) > 0)
+            read_bytes += static_cast<uint64_t>(n);
+        close(fd);
+    }
+    double read_seconds = std::chrono::duration<double>(clock_type::now() - t0).count();
+    r.read_bytes_per_sec = read_seconds > 0 ? static_cast<double>(read_bytes) / read_seconds : 0;
+
+    r.ok = true;
+    return r;
+}
+
+bool
+save(const std::string &uuid, const cb::report &rep)
+{
+    std::error_code ec;
+    fs::create_directories(bk_util::system_path(cb::results_dir), ec);
+
+    const std::string path = cb::results_path(uuid);
+    const std::string tmp = path + ".tmp";
+
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        if (!out) return false;
+
+        out << "when=" << rep.when << '\n'
+            << "bytes_per_preset=" << rep.bytes_per_preset << '\n'
+            << "mix=" << rep.data.text << ',' << rep.data.random << ',' << rep.data.zeros << '\n';
+
+        // One line per preset: name, then space-separated key=value pairs
+        for (const auto &r : rep.results)
+            out << "preset=" << r.preset
+                << " algorithm=" << r.algorithm
+                << " level=" << r.level
+                << " ok=" << (r.ok ? 1 : 0)
+                << " bytes=" << r.bytes
+                << " write=" << r.write_bytes_per_sec
+                << " read=" << r.read_bytes_per_sec
+                << " cpu=" << r.cpu_seconds
+                << " p50=" << r.p50_ms
+                << " p90=" << r.p90_ms
+                << " p99=" << r.p99_ms << '\n';
+        if (!out) return false;
+    }
+
+    chmod(tmp.c_str(), 0644);
+    return std::rename(tmp.c_str(), path.c_str()) == 0;
+}
+
+} // anonymous namespace
+
+
+std::string
+cb::results_path(const std::string &uuid)
+{
+    return bk_util::system_path(results_dir) + bk_util::to_lower(uuid) + ".results";
+}
+
+/**
+ * @brief Measure write and read throughput of every compression preset.
+ *
+ * The presets are measured one after the other on the same generated data,
+ * each in its own scratch subdirectory, whose files are removed before the
+ * next preset starts. The whole scratch directory is removed at the end,
+ * also when measuring throws; ones left by killed runs are removed first.
+ *
+ * @param uuid Filesystem UUID; it must be mounted.
+ * @param opts Amount and mix of data to write per preset.
+ */
+cb::report
+cb::run(const std::string &uuid, const options &opts)
+{
+    report rep;
+
+    auto mounts = bk_mgmt::get_mount_paths(uuid);
+    if (mounts.empty()) {
+        DEBUG_LOG("[compressbench] ", uuid, " is not mounted");
+        return rep;
+    }
+
+    options o = opts;
+    o.file_size = std::max<uint64_t>(chunk_size, (o.file_size + chunk_size - 1) / chunk_size * chunk_size);
+    o.bytes_per_preset = std::max(o.bytes_per_preset, o.file_size);
+
+    struct statvfs st {};
+    if (statvfs(mounts.front().c_str(), &st) != 0
+        || static_cast<uint64_t>(st.f_bavail) * st.f_frsize < 2 * o.bytes_per_preset) {
+        DEBUG_LOG("[compressbench] not enough free space on ", mounts.front());
+        return rep;
+    }
+
+    remove_stale_scratch(mounts.front());
+
+    scratch_dir scratch(mounts.front());
+    if (scratch.path.empty()) {
+        DEBUG_LOG("[compressbench] cannot create a scratch directory: ", strerror(errno));
+        return rep;
+    }
+
+    rep.available = true;
+    rep.when = std::time(nullptr);
+    rep.bytes_per_preset = o.bytes_per_preset;
+    rep.data = o.data;
+
+    data_pool pool(o.data);
+
+    std::vector<result> todo;
+    if (o.baseline)
+        todo.push_back(result { "none", "none", 0 });
+    for (const auto &p : tc::presets())
+        todo.push_back(result { p.name, p.algorithm, p.level });
+
+    for (const result &r : todo) {
+        const std::string dir = scratch.path + "/" + r.preset;
+        std::error_code ec;
+        fs::create_directory(dir, ec);
+
+        if (ec || !set_property(dir, r.algorithm, r.level)) {
+            DEBUG_LOG("[compressbench] cannot set compression ", r.algorithm, " on ", dir);
+            rep.results.push_back(r);
+            continue;
+        }
+
+        DEBUG_LOG("[compressbench] measuring ", r.preset, " on ", uuid);
+        rep.results.push_back(measure(dir, r, o, pool));
+        fs::remove_all(dir, ec);
+    }
+
+    if (!save(uuid, rep))
+        DEBUG_LOG("[compressbench] cannot store results for ", uuid);
+    return rep;
+}
+
+cb::report
+cb::load(const std::string &uuid)
+{
+    report rep;
+
+    std::ifstream in(results_path(uuid));
+    std::string line;
+    while (std::getline(in, line)) {
+        try {
+            if (line.rfind("when=", 0) == 0) {
+                rep.when = static_cast<std::time_t>(std::stoll(line.substr(5)));
+                rep.available = true;
+            } else if (line.rfind("bytes_per_preset=", 0) == 0) {
+                rep.bytes_per_preset = std::stoull(line.substr(17));
+            } else if (line.rfind("mix=", 0) == 0) {
+                std::istringstream values(line.substr(4));
+                char comma;
+                values >> rep.data.text >> comma >> rep.data.random >> comma >> rep.data.zeros;
+            } else if (line.rfind("preset=", 0) == 0) {
+                result r;
+                std::istringstream fields(line);
+                std::string field;
+                while (fields >> field) {
+                    auto eq = field.find('=');
+                    if (eq == std::string::npos) continue;
+                    std::string key = field.substr(0, eq);
+                    std::string value = field.substr(eq + 1);
+
+                    if (key == "preset") r.preset = value;
+                    else if (key == "algorithm") r.algorithm = value;
+                    else if (key == "level") r.level = std::stoi(value);
+                    else if (key == "ok") r.ok = value == "1";
+                    else if (key == "bytes") r.bytes = std::stoull(value);
+                    else if (key == "write") r.write_bytes_per_sec = bk_util::to_double(value);
+                    else if (key == "read") r.read_bytes_per_sec = bk_util::to_double(value);
+                    else if (key == "cpu") r.cpu_seconds = bk_util::to_double(value);
+                    else if (key == "p50") r.p50_ms = bk_util::to_double(value);
+                    else if (key == "p90") r.p90_ms = bk_util::to_double(value);
+                    else if (key == "p99") r.p99_ms = bk_util::to_double(value);
+                }
+                rep.results.push_back(r);
+            }
+        } catch (...) {
+            DEBUG_LOG("[compressbench] bad line in results: ", line);
+        }
+    }
+
+    return rep;
+}
+
+bool
+cb::parse_mix(const std::string &spec, mix &out)
+{
+    mix m { 0, 0, 0 };
+    std::istringstream parts(spec);
+    std::string part;
+
+    while (std::getline(parts, part, ',')) {
+        auto colon = part.find(':');
+        if (colon == std::string::npos) return false;
+
+        std::string kind = bk_util::to_lower(bk_util::trim_string(part.substr(0, colon)));
+        double share;
+        try {
+            share = bk_util::to_double(part.substr(colon + 1));
+        } catch (...) {
+            return false;
+        }
+        if (share < 0) return false;
+
+        if (kind == "text") m.text = share;
+        else if (kind == "random") m.random = share;
+        else if (kind == "zeros" || kind == "zero") m.zeros = share;
+        else return false;
+    }
+
+    if (m.text + m.random + m.zeros <= 0) return false;
+    out = m;
+    return true;
+}
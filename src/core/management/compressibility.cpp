@@ -0,0 +1,419 @@
+#include "beekeeper/btrfsetup.hpp"
+#include "beekeeper/compressibilitymgmt.hpp"
+#include "beekeeper/debug.hpp"
+#include "beekeeper/fswalkmgmt.hpp"
+#include "beekeeper/transparentcompressionmgmt.hpp"
+#include "beekeeper/util.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <filesystem>
+#include <lzo/lzo1x.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include <zlib.h>
+#include <zstd.h>
+
+namespace fs = std::filesystem;
+namespace cmp = beekeeper::management::compressibility;
+namespace tc = beekeeper::management::transparentcompression;
+
+// Helpers
+namespace {
+
+constexpr uint32_t sector_size = 4096;
+
+// Sustained write rates assumed when the caller gives none
+constexpr double rotational_write_rate = 150.0 * 1024 * 1024;
+constexpr double solid_state_write_rate = 500.0 * 1024 * 1024;
+
+// A heavier preset has to save this much more (of the input) to be worth it
+constexpr double worthwhile_gain = 0.01;
+
+// zlib is not offered as a preset, but users know it from btrfs' own default
+const std::vector<std::pair<std::string, int>> reference_candidates = {
+    {"zlib", 3},
+    {"zlib", 9},
+};
+
+uint64_t
+round_up(uint64_t n, uint64_t to)
+{
+    return (n + to - 1) / to * to;
+}
+
+int64_t
+thread_cpu_ns()
+{
+    timespec ts {};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+// ----- cancellation of running analyses -----
+
+std::mutex analyses_mutex;
+std::multimap<std::string, std::shared_ptr<std::atomic_bool>> running_analyses; // uuid -> stop flag
+
+// Registers a stop flag for the lifetime of one analysis
+struct running_analysis
+{
+    explicit running_analysis(const std::string &uuid)
+        : stop(std::make_shared<std::atomic_bool>(false))
+    {
+        std::lock_guard<std::mutex> lock(analyses_mutex);
+        entry = running_analyses.emplace(bk_util::to_lower(uuid), stop);
+    }
+
+    ~running_analysis()
+    {
+        std::lock_guard<std::mutex> lock(analyses_mutex);
+        running_analyses.erase(entry);
+    }
+
+    bool stopped() const { return stop->load(std::memory_order_relaxed); }
+
+    std::shared_ptr<std::atomic_bool> stop;
+    std::multimap<std::string, std::shared_ptr<std::atomic_bool>>::iterator entry;
+};
+
+// A sampled block: the file it is in, and where
+struct sampled_block {
+    size_t file = 0;     // index into the path list
+    uint64_t offset = 0;
+};
+
+// Uniform sample of blocks over the bytes of every file seen.
+//
+// Each slot keeps one block, replaced by a block of the incoming file with
+// probability size / (bytes seen so far): a weighted reservoir of one per
+// slot. How many slots a file takes is binomial, so this costs a random
+// draw per file rather than one per slot.
+class block_reservoir
+{
+public:
+    explicit block_reservoir(unsigned slots) : m_slots(slots) {}
+
+    void
+    offer(const std::string &path, uint64_t size)
+    {
+        if (size == 0 || m_slots.empty()) return;
+        m_seen += size;
+
+        double p = static_cast<double>(size) / static_cast<double>(m_seen);
+        unsigned k = std::binomial_distribution<unsigned>(static_cast<unsigned>(m_slots.size()), p)(m_rng);
+        if (k == 0) return;
+
+        size_t file = m_paths.size();
+        m_paths.push_back(path);
+
+        uint64_t blocks = (size + cmp::block_size - 1) / cmp::block_size;
+        std::uniform_int_distribution<uint64_t> pick_block(0, blocks - 1);
+
+        // k distinct slots: partial Fisher-Yates over the slot indices
+        if (m_order.size() != m_slots.size()) {
+            m_order.resize(m_slots.size());
+            std::iota(m_order.begin(), m_order.end(), 0);
+        }
+        for (unsigned i = 0; i < k; ++i) {
+            std::uniform_int_distribution<size_t> pick(i, m_order.size() - 1);
+            std::swap(m_order[i], m_order[pick(m_rng)]);
+            m_slots[m_order[i]] = { file, pick_block(m_rng) * cmp::block_size };
+        }
+    }
+
+    bool empty() const { return m_paths.empty(); }
+    uint64_t bytes_seen() const { return m_seen; }
+    const std::vector<sampled_block> &slots() const { return m_slots; }
+    const std::string &path(size_t file) const { return m_paths[file]; }
+
+private:
+    std::vector<sampled_block> m_slots;
+    std::vector<size_t> m_order;
+    std::vector<std::string> m_paths;
+    uint64_t m_seen = 0;
+    std::mt19937_64 m_rng { std::random_device{}() };
+};
+
+// Walk the filesystem below `root` (its subvolumes included, other
+// filesystems mounted inside it left out) until the deadline or a cancel
+void
+collect(const std::string &root, block_reservoir &reservoir, std::chrono::steady_clock::time_point deadline,
+        const running_analysis &run, uint64_t &files_seen, bool &partial)
+{
+    bk_mgmt::fswalk::filesystem_filter filter;
+    if (!filter.add_root(root)) return;
+
+    std::error_code ec;
+    fs::recursive_directory_iterator it(root, fs::directory_options::skip_permission_denied, ec);
+    for (; !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+        if (run.stopped())
+            break;
+        if ((files_seen & 1023) == 0 && std::chrono::steady_clock::now() > deadline) {
+            partial = true;
+            break;
+        }
+
+        struct stat st {};
+        if (lstat(it->path().c_str(), &st) < 0)
+            continue;
+
+        if (S_ISDIR(st.st_mode)) {
+            if (!filter.contains(AT_FDCWD, it->path().c_str(), st.st_dev))
+                it.disable_recursion_pending();
+        } else if (S_ISREG(st.st_mode)) {
+            ++files_seen;
+            reservoir.offer(it->path().string(), static_cast<uint64_t>(st.st_size));
+        }
+    }
+}
+
+// What btrfs would store for `n` input bytes compressed into `compressed`:
+// whole sectors, and nothing gained unless at least one sector is saved
+uint64_t
+stored_size(uint64_t n, uint64_t compressed)
+{
+    uint64_t raw = round_up(n, sector_size);
+    uint64_t packed = round_up(compressed, sector_size);
+    return packed < raw ? packed : raw;
+}
+
+// Per-thread compressor state
+struct compressor {
+    std::vector<unsigned char> out;
+    std::vector<unsigned char> lzo_work;
+    ZSTD_CCtx *zstd = nullptr;
+
+    compressor()
+        : out(std::max<size_t>({ compressBound(cmp::block_size), ZSTD_compressBound(cmp::block_size),
+                                 cmp::block_size + cmp::block_size / 16 + 64 + 3 })),
+          lzo_work(LZO1X_1_MEM_COMPRESS),
+          zstd(ZSTD_createCCtx())
+    {}
+
+    ~compressor() { ZSTD_freeCCtx(zstd); }
+
+    compressor(const compressor &) = delete;
+    compressor &operator=(const compressor &) = delete;
+
+    // Compressed size of `data`, or `n` when it failed
+    uint64_t
+    compress(const std::string &algorithm, int level, const unsigned char *data, size_t n)
+    {
+        if (algorithm == "zstd") {
+            size_t r = zstd ? ZSTD_compressCCtx(zstd, out.data(), out.size(), data, n, level) : 0;
+            return (zstd && !ZSTD_isError(r)) ? r : n;
+        }
+
+        if (algorithm == "zlib") {
+            uLongf len = out.size();
+            return compress2(out.data(), &len, data, n, level) == Z_OK ? len : n;
+        }
+
+        if (algorithm == "lzo") {
+            // btrfs compresses lzo extents sector by sector, each segment
+            // behind a 4-byte length, after a 4-byte total
+            uint64_t total = 4;
+            for (size_t off = 0; off < n; off += sector_size) {
+                lzo_uint len = out.size();
+                size_t chunk = std::min<size_t>(sector_size, n - off);
+                if (lzo1x_1_compress(data + off, chunk, out.data(), &len, lzo_work.data()) != LZO_E_OK)
+                    return n;
+                total += 4 + len;
+            }
+            return total;
+        }
+
+        return n;
+    }
+};
+
+std::once_flag lzo_ready;
+
+// Totals per candidate, one set per worker
+struct tally {
+    uint64_t input = 0;
+    uint64_t stored = 0;
+    int64_t cpu_ns = 0;
+};
+
+} // anonymous namespace
+
+
+/**
+ * @brief Sample a filesystem and recommend a transparent compression preset.
+ *
+ * The recommended preset saves the most space among the presets that keep
+ * up with the write rate on the CPU budget (compression speed per core
+ * times budget cores). A heavier preset has to save at least one more
+ * percent of the data than a lighter one to be preferred, since it costs
+ * CPU on every write. When no preset fits the budget the lightest one is
+ * recommended.
+ *
+ * @param uuid Filesystem UUID; it must be mounted.
+ * @param opts Sample size, CPU budget and write rate.
+ */
+cmp::analysis
+cmp::analyze(const std::string &uuid, const options &opts)
+{
+    analysis result;
+    result.cpu_budget = opts.cpu_budget > 0 ? opts.cpu_budget : 1.0;
+    result.write_rate = opts.write_rate > 0 ? opts.write_rate
+                        : bk_mgmt::is_rotational(uuid) ? rotational_write_rate
+                        : solid_state_write_rate;
+
+    auto mounts = bk_mgmt::get_mount_paths(uuid);
+    if (mounts.empty()) {
+        DEBUG_LOG("[compressibility] ", uuid, " is not mounted");
+        return result;
+    }
+
+    running_analysis run(uuid);
+
+    // 1) Pick the blocks
+    block_reservoir reservoir(std::max(1u, opts.samples));
+    collect(mounts.front(), reservoir,
+            std::chrono::steady_clock::now() + std::chrono::seconds(opts.walk_seconds),
+            run, result.files_seen, result.partial_walk);
+    result.bytes_seen = reservoir.bytes_seen();
+
+    if (run.stopped()) {
+        DEBUG_LOG("[compressibility] analysis of ", uuid, " cancelled");
+        result.cancelled = true;
+        return result;
+    }
+
+    if (reservoir.empty()) {
+        DEBUG_LOG("[compressibility] nothing to sample on ", mounts.front());
+        return result;
+    }
+
+    // 2) Candidates: the presets, then the reference ones
+    for (const auto &p : tc::presets())
+        result.candidates.push_back({ p.name, p.algorithm, p.level });
+    for (const auto &[algorithm, level] : reference_candidates)
+        result.candidates.push_back({ "", algorithm, level });
+
+    std::call_once(lzo_ready, [] { lzo_init(); });
+
+    // 3) Read and compress in parallel
+    const auto &slots = reservoir.slots();
+    std::atomic<size_t> next { 0 };
+    std::atomic<uint64_t> blocks { 0 };
+    std::vector<std::vector<tally>> tallies;
+
+    unsigned threads = std::clamp<unsigned>(std::thread::hardware_concurrency(), 1,
+                                            static_cast<unsigned>(slots.size()));
+    tallies.assign(threads, std::vector<tally>(result.candidates.size()));
+
+    auto worker = [&](unsigned id) {
+        compressor c;
+        std::vector<unsigned char> block(block_size);
+        auto &mine = tallies[id];
+
+        for (size_t i = next.fetch_add(1); i < slots.size() && !run.stopped(); i = next.fetch_add(1)) {
+            const std::string &path = reservoir.path(slots[i].file);
+            int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC | O_NOATIME);
+            if (fd < 0 && errno == EPERM)
+                fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) continue;
+
+            ssize_t n = pread(fd, block.data(), block.size(), static_cast<off_t>(slots[i].offset));
+            close(fd);
+            if (n <= 0) continue; // shrank since the walk
+
+            ++blocks;
+            for (size_t k = 0; k < result.candidates.size(); ++k) {
+                const candidate &cand = result.candidates[k];
+
+                int64_t start = thread_cpu_ns();
+                uint64_t compressed = c.compress(cand.algorithm, cand.level, block.data(), static_cast<size_t>(n));
+                mine[k].cpu_ns += thread_cpu_ns() - start;
+
+                mine[k].input += round_up(static_cast<uint64_t>(n), sector_size);
+                mine[k].stored += stored_size(static_cast<uint64_t>(n), compressed);
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned i = 0; i < threads; ++i)
+        pool.emplace_back(worker, i);
+    for (auto &t : pool)
+        t.join();
+
+    if (run.stopped()) {
+        DEBUG_LOG("[compressibility] analysis of ", uuid, " cancelled");
+        result.cancelled = true;
+        return result;
+    }
+
+    result.blocks = blocks.load();
+    if (result.blocks == 0)
+        return result;
+
+    // 4) Totals and the recommendation
+    const double needed_speed = result.write_rate / result.cpu_budget;
+    const candidate *best = nullptr;
+
+    for (size_t k = 0; k < result.candidates.size(); ++k) {
+        candidate &cand = result.candidates[k];
+        int64_t cpu_ns = 0;
+        for (const auto &t : tallies) {
+            cand.input += t[k].input;
+            cand.stored += t[k].stored;
+            cpu_ns += t[k].cpu_ns;
+        }
+
+        cand.saved_fraction = cand.input ? 1.0 - static_cast<double>(cand.stored) / static_cast<double>(cand.input) : 0;
+        cand.bytes_per_sec_per_core = cpu_ns > 0 ? static_cast<double>(cand.input) * 1e9 / static_cast<double>(cpu_ns) : 0;
+        cand.within_budget = cand.bytes_per_sec_per_core >= needed_speed;
+
+        if (cand.preset.empty() || !cand.within_budget)
+            continue;
+        if (!best || cand.saved_fraction > best->saved_fraction + worthwhile_gain)
+            best = &cand;
+    }
+
+    result.recommended = best ? best->preset : tc::presets().front().name;
+    result.available = true;
+
+    DEBUG_LOG("[compressibility] ", uuid, ": ", result.blocks, " blocks from ", result.files_seen,
+              " files, recommending ", result.recommended);
+    return result;
+}
+
+bool
+cmp::cancel(const std::string &uuid)
+{
+    bool any = false;
+
+    std::lock_guard<std::mutex> lock(analyses_mutex);
+    auto [begin, end] = running_analyses.equal_range(bk_util::to_lower(uuid));
+    for (auto it = begin; it != end; ++it) {
+        it->second->store(true);
+        any = true;
+    }
+    return any;
+}
+
+uint64_t
+cmp::stored_bytes(const std::string &algorithm, int level, const unsigned char *data, size_t n)
+{
+    std::call_once(lzo_ready, [] { lzo_init(); });
+
+    thread_local compressor c;
+    return stored_size(n, c.compress(algorithm, level, data, std::min<size_t>(n, block_size)));
+}
@@ -12,14 +12,18 @@ list_uuids(const std::string &config_file)
 {
     std::vector<std::string> uuids_found;
 
-    // Read all lines from config file
-    std::vector<std::string> lines = bk_util::read_lines_from_file(config_file);
+    // Read the config file once and split it in place
+    bk_util::text_buffer config;
+    config.load(config_file);
 
-    for (const auto &line : lines) {
+    for (std::string_view line : config.lines()) {
         // Tokenize and check if the first token is a valid UUID
-        std::vector<std::string> tokens = bk_util::tokenize(line);
-        if (!tokens.empty() && bk_util::is_uuid(tokens[0])) {
-            uuids_found.push_back(tokens[0]);
+        const auto &tokens = config.tokenize(line);
+        if (tokens.empty()) continue;
+
+        std::string first(tokens[0]);
+        if (bk_util::is_uuid(first)) {
+            uuids_found.push_back(std::move(first));
         }
     }
 
@@ -62,6 +66,31 @@ remove_line_matching_substring(const std::string &config_file, const std::string
     bk_util::make_file_world_readable(config_file);
 }
 
+// Remove lines keyed by uuid, whatever follows it on the line.
+// Rewrites the file and restores world-readable perms.
+void
+remove_uuid(const std::string &config_file, const std::string &uuid)
+{
+    if (uuid.empty())
+        return;
+
+    std::vector<std::string> lines = bk_util::read_lines_from_file(config_file);
+
+    std::ofstream outfile(config_file, std::ios::trunc);
+    if (!outfile.is_open())
+        return;
+
+    for (const auto &l : lines) {
+        std::vector<std::string> tokens = bk_util::tokenize(l);
+        if (!tokens.empty() && bk_util::compare_strings_case_insensitive(tokens[0], uuid))
+            continue; // skip
+        outfile << l << "\n";
+    }
+    outfile.close();
+
+    bk_util::make_file_world_readable(config_file);
+}
+
 std::vector<std::string> fetch (
     const std::string &config_file,
     const std::string &substr_to_find,
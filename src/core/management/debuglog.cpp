@@ -0,0 +1,505 @@
+#include "beekeeper/debuglogmgmt.hpp"
+#include "beekeeper/util.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <thread>
+#include <unistd.h>
+
+namespace debuglog = beekeeper::management::debuglog;
+
+// Helpers
+namespace {
+
+constexpr size_t max_message_length = 16 * 1024;   // longer messages are cut
+constexpr int max_iovecs = 64;                      // per writev(), well under IOV_MAX
+
+// Byte ring of whole '\n'-terminated lines. Exactly one thread appends (the
+// one that owns it) and one thread drains it (the flusher), so the two
+// positions are all the synchronization needed. Positions only grow; the
+// byte for position p lives at p % ring_capacity.
+class line_ring
+{
+public:
+    // Producer side. All or nothing: false if the line does not fit.
+    bool
+    push(std::string_view prefix, std::string_view message)
+    {
+        const size_t len = prefix.size() + message.size() + 1;
+        const uint64_t head = head_pos.load(std::memory_order_relaxed);
+        const uint64_t tail = tail_pos.load(std::memory_order_acquire);
+        if (len > debuglog::ring_capacity - (head - tail))
+            return false;
+
+        copy_in(head, prefix);
+        copy_in(head + prefix.size(), message);
+        bytes[(head + len - 1) % debuglog::ring_capacity] = '\n';
+
+        head_pos.store(head + len, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side: what is there now, as at most two spans. Pass `end`
+    // to consume() once written.
+    int
+    spans(iovec *out, uint64_t &end) const
+    {
+        const uint64_t tail = tail_pos.load(std::memory_order_relaxed);
+        end = head_pos.load(std::memory_order_acquire);
+        if (end == tail)
+            return 0;
+
+        const size_t offset = tail % debuglog::ring_capacity;
+        const size_t len = end - tail;
+        const size_t first = std::min(len, debuglog::ring_capacity - offset);
+
+        out[0] = { bytes.get() + offset, first };
+        if (first == len)
+            return 1;
+        out[1] = { bytes.get(), len - first };
+        return 2;
+    }
+
+    void
+    consume(uint64_t end)
+    {
+        tail_pos.store(end, std::memory_order_release);
+    }
+
+    size_t
+    used() const
+    {
+        return head_pos.load(std::memory_order_relaxed) - tail_pos.load(std::memory_order_acquire);
+    }
+
+    bool
+    empty() const
+    {
+        return head_pos.load(std::memory_order_acquire) == tail_pos.load(std::memory_order_relaxed);
+    }
+
+    // Set when the owning thread exits; the flusher frees the ring once drained
+    std::atomic<bool> closed { false };
+
+private:
+    void
+    copy_in(uint64_t pos, std::string_view data)
+    {
+        const size_t offset = pos % debuglog::ring_capacity;
+        const size_t first = std::min(data.size(), debuglog::ring_capacity - offset);
+        std::memcpy(bytes.get() + offset, data.data(), first);
+        std::memcpy(bytes.get(), data.data() + first, data.size() - first);
+    }
+
+    std::unique_ptr<char[]> bytes { new char[debuglog::ring_capacity] };
+    alignas(64) std::atomic<uint64_t> head_pos { 0 };
+    alignas(64) std::atomic<uint64_t> tail_pos { 0 };
+};
+
+std::vector<std::string>
+split_categories(const char *list)
+{
+    std::vector<std::string> out;
+    std::string_view rest = list ? list : "";
+    while (!rest.empty()) {
+        size_t comma = rest.find(',');
+        std::string_view item = rest.substr(0, comma);
+        if (!item.empty())
+            out.emplace_back(item);
+        rest = comma == std::string_view::npos ? std::string_view() : rest.substr(comma + 1);
+    }
+    return out;
+}
+
+// Never destroyed: threads may still log while static destructors run
+struct logger_state {
+    std::atomic<uint8_t> max_level { static_cast<uint8_t>(debuglog::level::debug) };
+
+    // Swapped whole, never modified in place; replaced lists are kept
+    // alive (they are a few strings each) so readers need no lock
+    std::atomic<const std::vector<std::string> *> filter { nullptr };
+    std::mutex filter_mutex;
+    std::vector<std::unique_ptr<const std::vector<std::string>>> filters;
+
+    std::mutex rings_mutex;
+    std::vector<std::shared_ptr<line_ring>> rings;
+
+    std::atomic<uint64_t> dropped { 0 };
+
+    // Flusher
+    std::once_flag started;
+    std::atomic<bool> running { false };
+    std::mutex wake_mutex;
+    std::condition_variable wake;
+    std::condition_variable flushed;
+    uint64_t flush_requested = 0;
+    uint64_t flush_done = 0;
+
+    // Only touched by the flusher
+    int fd = -1;
+    uint64_t file_size = 0;
+    uint64_t dropped_reported = 0;
+
+    logger_state()
+    {
+        if (const char *env = std::getenv("BEEKEEPER_DEBUG_LEVEL")) {
+            debuglog::level l;
+            if (debuglog::parse_level(env, l))
+                max_level.store(static_cast<uint8_t>(l));
+        }
+        if (const char *env = std::getenv("BEEKEEPER_DEBUG_CATEGORIES")) {
+            filters.emplace_back(new std::vector<std::string>(split_categories(env)));
+            filter.store(filters.back().get());
+        }
+    }
+};
+
+logger_state &
+state()
+{
+    static logger_state *instance = new logger_state;
+    return *instance;
+}
+
+void
+open_file(logger_state &s)
+{
+    const std::string path = debuglog::file_path();
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ec);
+
+    s.fd = open(path.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+    s.file_size = 0;
+    if (s.fd < 0) {
+        s.fd = STDERR_FILENO;    // as before: nowhere else to go
+        return;
+    }
+
+    struct stat st {};
+    if (fstat(s.fd, &st) == 0)
+        s.file_size = static_cast<uint64_t>(st.st_size);
+}
+
+// debug.log -> debug.log.1 -> ... -> debug.log.N, then a fresh debug.log.
+// The GUI and the helper may share the file: if the path no longer is the
+// file we have open, the other one rotated already and we only reopen.
+void
+rotate(logger_state &s)
+{
+    const std::string path = debuglog::file_path();
+
+    struct stat by_path {}, by_fd {};
+    if (stat(path.c_str(), &by_path) == 0 && fstat(s.fd, &by_fd) == 0
+        && by_path.st_dev == by_fd.st_dev && by_path.st_ino == by_fd.st_ino) {
+        for (int i = debuglog::files_kept - 1; i >= 1; --i)
+            std::rename((path + "." + std::to_string(i)).c_str(), (path + "." + std::to_string(i + 1)).c_str());
+        std::rename(path.c_str(), (path + ".1").c_str());
+    }
+
+    close(s.fd);
+    open_file(s);
+}
+
+void
+write_all(logger_state &s, iovec *iov, int count)
+{
+    while (count > 0) {
+        ssize_t n = writev(s.fd, iov, count);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return;    // nothing sensible to report it to
+        }
+        s.file_size += static_cast<uint64_t>(n);
+
+        // Skip what went out; a short write resumes mid-span
+        while (count > 0 && static_cast<size_t>(n) >= iov->iov_len) {
+            n -= static_cast<ssize_t>(iov->iov_len);
+            ++iov;
+            --count;
+        }
+        if (count > 0) {
+            iov->iov_base = static_cast<char *>(iov->iov_base) + n;
+            iov->iov_len -= static_cast<size_t>(n);
+        }
+    }
+}
+
+// One pass: everything the rings hold, in as few writev() calls as fit
+void
+drain(logger_state &s)
+{
+    std::vector<std::shared_ptr<line_ring>> rings;
+    {
+        std::lock_guard<std::mutex> lock(s.rings_mutex);
+        rings = s.rings;
+    }
+
+    iovec iov[max_iovecs];
+    std::pair<line_ring *, uint64_t> pending[max_iovecs];
+    int iov_count = 0;
+    int pending_count = 0;
+
+    auto write_batch = [&] {
+        write_all(s, iov, iov_count);
+        for (int i = 0; i < pending_count; ++i)
+            pending[i].first->consume(pending[i].second);
+        iov_count = 0;
+        pending_count = 0;
+    };
+
+    for (const auto &ring : rings) {
+        if (iov_count + 2 > max_iovecs)
+            write_batch();
+
+        uint64_t end = 0;
+        int n = ring->spans(iov + iov_count, end);
+        if (n > 0) {
+            iov_count += n;
+            pending[pending_count++] = { ring.get(), end };
+        }
+    }
+
+    const uint64_t dropped = s.dropped.load(std::memory_order_relaxed);
+    std::string notice;
+    if (dropped != s.dropped_reported) {
+        notice = "[debuglog] " + std::to_string(dropped - s.dropped_reported)
+                 + " lines dropped: a thread logged faster than they could be written\n";
+        if (iov_count == max_iovecs)
+            write_batch();
+        iov[iov_count++] = { notice.data(), notice.size() };
+        s.dropped_reported = dropped;
+    }
+
+    if (iov_count > 0)
+        write_batch();
+
+    if (s.fd != STDERR_FILENO && s.file_size >= debuglog::max_file_size)
+        rotate(s);
+
+    // Rings of threads that exited, once there is nothing left in them
+    std::lock_guard<std::mutex> lock(s.rings_mutex);
+    s.rings.erase(std::remove_if(s.rings.begin(), s.rings.end(), [](const std::shared_ptr<line_ring> &ring) {
+                      return ring->closed.load(std::memory_order_acquire) && ring->empty();
+                  }),
+                  s.rings.end());
+}
+
+void
+flusher_main()
+{
+    logger_state &s = state();
+    open_file(s);
+
+    std::unique_lock<std::mutex> lock(s.wake_mutex);
+    for (;;) {
+        s.wake.wait_for(lock, std::chrono::milliseconds(debuglog::flush_interval_ms), [&] {
+            return s.flush_requested != s.flush_done;
+        });
+
+        const uint64_t requested = s.flush_requested;
+
+        lock.unlock();
+        drain(s);
+        lock.lock();
+
+        s.flush_done = requested;
+        s.flushed.notify_all();
+    }
+}
+
+void
+start_flusher()
+{
+    std::call_once(state().started, [] {
+        std::thread(flusher_main).detach();
+        state().running.store(true, std::memory_order_release);
+
+        // Whatever is still queued at a normal exit goes out too
+        std::atexit([] {
+            debuglog::flush();
+        });
+    });
+}
+
+// Registers this thread's ring on first use, and hands it over to the
+// flusher when the thread exits
+struct ring_handle {
+    std::shared_ptr<line_ring> ring = std::make_shared<line_ring>();
+
+    ring_handle()
+    {
+        start_flusher();
+        std::lock_guard<std::mutex> lock(state().rings_mutex);
+        state().rings.push_back(ring);
+    }
+
+    ~ring_handle()
+    {
+        ring->closed.store(true, std::memory_order_release);
+    }
+};
+
+// "2026-10-18 14:03:07.123456 D 4242 ", the date part only formatted once
+// per second per thread
+std::string_view
+line_prefix(debuglog::level l, std::string &buffer)
+{
+    thread_local time_t cached_second = -1;
+    thread_local char cached_date[32];
+    thread_local const long tid = static_cast<long>(gettid());
+
+    timespec now {};
+    clock_gettime(CLOCK_REALTIME, &now);
+    if (now.tv_sec != cached_second) {
+        tm local {};
+        localtime_r(&now.tv_sec, &local);
+        strftime(cached_date, sizeof(cached_date), "%Y-%m-%d %H:%M:%S", &local);
+        cached_second = now.tv_sec;
+    }
+
+    static const char letters[] = { 'E', 'W', 'I', 'D', 'T' };
+    char out[96];
+    int n = std::snprintf(out, sizeof(out), "%s.%06ld %c %ld ", cached_date, now.tv_nsec / 1000,
+                          letters[static_cast<size_t>(l)], tid);
+    buffer.assign(out, n > 0 ? static_cast<size_t>(n) : 0);
+    return buffer;
+}
+
+} // anonymous namespace
+
+const char *
+debuglog::level_name(level l)
+{
+    switch (l) {
+    case level::error:   return "error";
+    case level::warning: return "warning";
+    case level::info:    return "info";
+    case level::debug:   return "debug";
+    case level::trace:   return "trace";
+    }
+    return "debug";
+}
+
+bool
+debuglog::parse_level(std::string_view name, level &out)
+{
+    for (level l : { level::error, level::warning, level::info, level::debug, level::trace }) {
+        if (name == level_name(l)) {
+            out = l;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool
+debuglog::wants(level l, const char *file)
+{
+    logger_state &s = state();
+    if (static_cast<uint8_t>(l) > s.max_level.load(std::memory_order_relaxed))
+        return false;
+
+    // Errors and warnings get through whatever the categories
+    const std::vector<std::string> *filter = s.filter.load(std::memory_order_acquire);
+    if (!filter || filter->empty() || l <= level::warning)
+        return true;
+
+    for (const auto &category : *filter)
+        if (std::strstr(file, category.c_str()))
+            return true;
+    return false;
+}
+
+void
+debuglog::write(level l, const char *file, int line, std::string_view message)
+{
+    thread_local ring_handle handle;
+    thread_local std::string prefix;
+
+    line_prefix(l, prefix);
+    prefix += '[';
+    prefix += file;
+    prefix += ':';
+    prefix += std::to_string(line);
+    prefix += "] ";
+
+    if (message.size() > max_message_length)
+        message = message.substr(0, max_message_length);
+
+    const size_t before = handle.ring->used();
+    if (!handle.ring->push(prefix, message)) {
+        state().dropped.fetch_add(1, std::memory_order_relaxed);
+        state().wake.notify_one();
+        return;
+    }
+
+    // A burst: do not wait for the next tick to make room
+    if (before < ring_capacity / 2 && handle.ring->used() >= ring_capacity / 2)
+        state().wake.notify_one();
+}
+
+debuglog::level
+debuglog::current_level()
+{
+    return static_cast<level>(state().max_level.load(std::memory_order_relaxed));
+}
+
+void
+debuglog::set_level(level l)
+{
+    state().max_level.store(static_cast<uint8_t>(l), std::memory_order_relaxed);
+}
+
+std::vector<std::string>
+debuglog::categories()
+{
+    const std::vector<std::string> *filter = state().filter.load(std::memory_order_acquire);
+    return filter ? *filter : std::vector<std::string>();
+}
+
+void
+debuglog::set_categories(const std::vector<std::string> &substrings)
+{
+    logger_state &s = state();
+    std::lock_guard<std::mutex> lock(s.filter_mutex);
+    s.filters.emplace_back(new std::vector<std::string>(substrings));
+    s.filter.store(s.filters.back().get(), std::memory_order_release);
+}
+
+uint64_t
+debuglog::dropped()
+{
+    return state().dropped.load(std::memory_order_relaxed);
+}
+
+void
+debuglog::flush()
+{
+    logger_state &s = state();
+    if (!s.running.load(std::memory_order_acquire))
+        return;    // nothing was ever logged
+
+    std::unique_lock<std::mutex> lock(s.wake_mutex);
+    const uint64_t ticket = ++s.flush_requested;
+    s.wake.notify_one();
+    s.flushed.wait_for(lock, std::chrono::seconds(2), [&] { return s.flush_done >= ticket; });
+}
+
+std::string
+debuglog::file_path()
+{
+    return bk_util::system_path("/run/bees/beekeeper-qt/debug.log");
+}
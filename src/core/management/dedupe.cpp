@@ -0,0 +1,425 @@
+#include "beekeeper/debug.hpp"
+#include "beekeeper/dedupemgmt.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/fiemap.h>
+#include <linux/fs.h>
+#include <memory>
+#include <sstream>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+namespace dd = beekeeper::management::dedupe;
+
+// Helpers
+namespace {
+
+// btrfs refuses longer ranges per call (BTRFS_MAX_DEDUPE_LEN)
+constexpr uint64_t max_range = 16ULL * 1024 * 1024;
+
+// The argument of one call must fit in a page: 127 destinations
+constexpr size_t max_dests_per_call = 120;
+
+constexpr uint32_t fiemap_batch = 512;
+
+// Every extent of an open file, in logical order
+bool
+read_extents(int fd, std::vector<dd::extent> &out)
+{
+    std::vector<char> buffer(sizeof(fiemap) + fiemap_batch * sizeof(fiemap_extent));
+    auto *fm = reinterpret_cast<fiemap *>(buffer.data());
+
+    uint64_t start = 0;
+    for (;;) {
+        std::memset(buffer.data(), 0, buffer.size());
+        fm->fm_start = start;
+        fm->fm_length = FIEMAP_MAX_OFFSET - start;
+        fm->fm_flags = FIEMAP_FLAG_SYNC;
+        fm->fm_extent_count = fiemap_batch;
+
+        if (ioctl(fd, FS_IOC_FIEMAP, fm) < 0)
+            return false;
+        if (fm->fm_mapped_extents == 0)
+            return true;
+
+        for (uint32_t i = 0; i < fm->fm_mapped_extents; ++i) {
+            const fiemap_extent &e = fm->fm_extents[i];
+            out.push_back({ e.fe_logical, e.fe_physical, e.fe_length, e.fe_flags });
+            if (e.fe_flags & FIEMAP_EXTENT_LAST)
+                return true;
+        }
+
+        const fiemap_extent &last = fm->fm_extents[fm->fm_mapped_extents - 1];
+        start = last.fe_logical + last.fe_length;
+    }
+}
+
+// Extent covering `pos`, or null in a hole
+const dd::extent *
+extent_at(const std::vector<dd::extent> &extents, uint64_t pos)
+{
+    auto it = std::upper_bound(extents.begin(), extents.end(), pos,
+                               [](uint64_t p, const dd::extent &e) { return p < e.logical; });
+    if (it == extents.begin()) return nullptr;
+    --it;
+    return pos < it->logical + it->length ? &*it : nullptr;
+}
+
+struct destination {
+    std::string path;
+    int fd = -1;
+    std::vector<dd::extent> extents;
+    bool mapped = false;             // extents read: sharing can be checked
+    bool done = false;               // differs or failed: no more ranges
+};
+
+struct totals {
+    std::atomic<uint64_t> files { 0 }, calls { 0 }, deduped { 0 }, shared { 0 }, differing { 0 }, errors { 0 };
+};
+
+int
+open_file(const std::string &path)
+{
+    int fd = open(path.c_str(), O_RDONLY | O_NOFOLLOW | O_CLOEXEC | O_NOATIME);
+    if (fd < 0 && errno == EPERM)
+        fd = open(path.c_str(), O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    return fd;
+}
+
+void
+dedupe_set(const dd::file_set &set, const dd::options &opts, totals &t)
+{
+    int src_fd = open_file(set.front());
+    struct stat src_st {};
+    if (src_fd < 0 || fstat(src_fd, &src_st) < 0 || !S_ISREG(src_st.st_mode)) {
+        DEBUG_LOG("[dedupe] cannot open ", set.front(), ": ", strerror(errno));
+        if (src_fd >= 0) close(src_fd);
+        ++t.errors;
+        return;
+    }
+    const uint64_t size = static_cast<uint64_t>(src_st.st_size);
+
+    // Without a map of both files every range is submitted: the kernel
+    // compares the data anyway, it only costs a call
+    std::vector<dd::extent> src_extents;
+    bool src_mapped = read_extents(src_fd, src_extents);
+    if (!src_mapped)
+        DEBUG_LOG("[dedupe] cannot map extents of ", set.front(), ": ", strerror(errno));
+
+    std::vector<destination> dests;
+    for (size_t i = 1; i < set.size(); ++i) {
+        destination d;
+        d.path = set[i];
+        d.fd = open_file(d.path);
+        ++t.files;
+
+        struct stat st {};
+        if (d.fd < 0 || fstat(d.fd, &st) < 0 || !S_ISREG(st.st_mode)
+            || static_cast<uint64_t>(st.st_size) != size
+            || (st.st_dev == src_st.st_dev && st.st_ino == src_st.st_ino)) {
+            // Hard links of the source are fine already; anything else is an error
+            if (!(d.fd >= 0 && st.st_dev == src_st.st_dev && st.st_ino == src_st.st_ino)) {
+                DEBUG_LOG("[dedupe] skipping ", d.path, ": unreadable or not the same size");
+                ++t.errors;
+            }
+            if (d.fd >= 0) close(d.fd);
+            continue;
+        }
+
+        d.mapped = src_mapped && read_extents(d.fd, d.extents);
+        dests.push_back(std::move(d));
+    }
+
+    // One call per range, with every destination still needing it
+    std::vector<char> buffer(sizeof(file_dedupe_range) + max_dests_per_call * sizeof(file_dedupe_range_info));
+    auto *req = reinterpret_cast<file_dedupe_range *>(buffer.data());
+    std::vector<destination *> pending, in_call;
+
+    for (uint64_t off = 0; off < size && !dests.empty(); off += max_range) {
+        uint64_t len = std::min(max_range, size - off);
+
+        pending.clear();
+        for (auto &d : dests) {
+            if (d.done) continue;
+            if (d.mapped && dd::already_shared(src_extents, d.extents, off, len))
+                t.shared += len;
+            else
+                pending.push_back(&d);
+        }
+
+        if (opts.dry_run) {
+            t.deduped += len * pending.size();
+            continue;
+        }
+
+        for (size_t from = 0; from < pending.size(); from += max_dests_per_call) {
+            in_call.assign(pending.begin() + static_cast<std::ptrdiff_t>(from),
+                           pending.begin() + static_cast<std::ptrdiff_t>(std::min(pending.size(), from + max_dests_per_call)));
+
+            std::memset(buffer.data(), 0, buffer.size());
+            req->src_offset = off;
+            req->src_length = len;
+            req->dest_count = static_cast<uint16_t>(in_call.size());
+            for (size_t i = 0; i < in_call.size(); ++i) {
+                req->info[i].dest_fd = in_call[i]->fd;
+                req->info[i].dest_offset = off;
+            }
+
+            ++t.calls;
+            if (ioctl(src_fd, FIDEDUPERANGE, req) < 0) {
+                DEBUG_LOG("[dedupe] FIDEDUPERANGE on ", set.front(), " failed: ", strerror(errno));
+                ++t.errors;
+                for (destination *d : in_call)
+                    d->done = true;
+                continue;
+            }
+
+            for (size_t i = 0; i < in_call.size(); ++i) {
+                const auto &info = req->info[i];
+                if (info.status == FILE_DEDUPE_RANGE_DIFFERS) {
+                    in_call[i]->done = true;
+                    ++t.differing;
+                } else if (info.status < 0) {
+                    DEBUG_LOG("[dedupe] ", in_call[i]->path, ": ", strerror(-info.status));
+                    in_call[i]->done = true;
+                    ++t.errors;
+                } else {
+                    t.deduped += info.bytes_deduped;
+                }
+            }
+        }
+    }
+
+    for (auto &d : dests)
+        close(d.fd);
+    close(src_fd);
+}
+
+// Four hex digits of a \\u escape at `i`; advances `i` past them
+unsigned
+hex4(const std::string &text, size_t &i)
+{
+    unsigned code = 0;
+    size_t end = std::min(i + 4, text.size());
+    for (; i < end; ++i) {
+        char c = text[i];
+        unsigned digit = c >= '0' && c <= '9' ? static_cast<unsigned>(c - '0')
+                       : c >= 'a' && c <= 'f' ? static_cast<unsigned>(c - 'a' + 10)
+                       : c >= 'A' && c <= 'F' ? static_cast<unsigned>(c - 'A' + 10)
+                       : 16;
+        if (digit == 16) break;
+        code = code << 4 | digit;
+    }
+    return code;
+}
+
+void
+append_utf8(std::string &out, unsigned code)
+{
+    if (code < 0x80) {
+        out += static_cast<char>(code);
+    } else if (code < 0x800) {
+        out += static_cast<char>(0xc0 | code >> 6);
+        out += static_cast<char>(0x80 | (code & 0x3f));
+    } else if (code < 0x10000) {
+        out += static_cast<char>(0xe0 | code >> 12);
+        out += static_cast<char>(0x80 | (code >> 6 & 0x3f));
+        out += static_cast<char>(0x80 | (code & 0x3f));
+    } else {
+        out += static_cast<char>(0xf0 | code >> 18);
+        out += static_cast<char>(0x80 | (code >> 12 & 0x3f));
+        out += static_cast<char>(0x80 | (code >> 6 & 0x3f));
+        out += static_cast<char>(0x80 | (code & 0x3f));
+    }
+}
+
+// Unescape a JSON string starting after its opening quote; advances `i`
+// past the closing quote
+std::string
+json_string(const std::string &text, size_t &i)
+{
+    std::string out;
+    while (i < text.size() && text[i] != '"') {
+        char c = text[i++];
+        if (c != '\\' || i >= text.size()) {
+            out += c;
+            continue;
+        }
+        char e = text[i++];
+        switch (e) {
+        case 'n': out += '\n'; break;
+        case 't': out += '\t'; break;
+        case 'r': out += '\r'; break;
+        case 'b': out += '\b'; break;
+        case 'f': out += '\f'; break;
+        case 'u': {
+            unsigned code = hex4(text, i);
+            // A surrogate pair spells one code point above the BMP
+            if (code >= 0xd800 && code < 0xdc00 && text.compare(i, 2, "\\u") == 0) {
+                size_t j = i + 2;
+                unsigned low = hex4(text, j);
+                if (low >= 0xdc00 && low < 0xe000) {
+                    code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+                    i = j;
+                }
+            }
+            append_utf8(out, code);
+            break;
+        }
+        default: out += e; break;
+        }
+    }
+    ++i;
+    return out;
+}
+
+} // anonymous namespace
+
+
+/**
+ * @brief Whether a range of dst already points at the same data as src.
+ *
+ * Holes in both files count as shared; a hole in only one does not.
+ *
+ * @param src, dst Extent maps of the two files, in logical order.
+ * @param off, len The range, in file offsets.
+ */
+bool
+dd::already_shared(const std::vector<extent> &src, const std::vector<extent> &dst, uint64_t off, uint64_t len)
+{
+    uint64_t pos = off, end = off + len;
+    while (pos < end) {
+        const extent *s = extent_at(src, pos);
+        const extent *d = extent_at(dst, pos);
+
+        if (!s && !d) {
+            // Hole in both: skip to whichever extent starts first
+            auto next = [&](const std::vector<extent> &v) {
+                auto it = std::upper_bound(v.begin(), v.end(), pos,
+                                           [](uint64_t p, const extent &e) { return p < e.logical; });
+                return it == v.end() ? end : it->logical;
+            };
+            pos = std::min({ next(src), next(dst), end });
+            continue;
+        }
+        if (!s || !d || !(d->flags & FIEMAP_EXTENT_SHARED))
+            return false;
+
+        // Compressed extents report where the whole compressed extent starts
+        bool same = (s->flags & FIEMAP_EXTENT_ENCODED) || (d->flags & FIEMAP_EXTENT_ENCODED)
+            ? s->physical == d->physical && s->logical == d->logical
+            : s->physical + (pos - s->logical) == d->physical + (pos - d->logical);
+        if (!same)
+            return false;
+
+        pos = std::min(s->logical + s->length, d->logical + d->length);
+    }
+    return true;
+}
+
+/**
+ * @brief Deduplicate each set of identical files against its first file.
+ *
+ * @param sets Files believed identical; each set needs at least two.
+ * @param opts Queue depth and dry run.
+ */
+dd::report
+dd::apply(const std::vector<file_set> &sets, const options &opts)
+{
+    report r;
+    totals t;
+
+    // Biggest sets first, so the last one to finish is a small one
+    std::vector<const file_set *> order;
+    for (const auto &set : sets)
+        if (set.size() > 1)
+            order.push_back(&set);
+
+    std::vector<uint64_t> sizes(order.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        struct stat st {};
+        sizes[i] = stat(order[i]->front().c_str(), &st) == 0 ? static_cast<uint64_t>(st.st_size) * (order[i]->size() - 1) : 0;
+    }
+    std::vector<size_t> index(order.size());
+    for (size_t i = 0; i < index.size(); ++i) index[i] = i;
+    std::stable_sort(index.begin(), index.end(), [&](size_t a, size_t b) { return sizes[a] > sizes[b]; });
+
+    std::atomic<size_t> next { 0 };
+    unsigned depth = std::clamp<unsigned>(opts.queue_depth, 1,
+                                          static_cast<unsigned>(std::max<size_t>(1, order.size())));
+
+    std::vector<std::thread> pool;
+    for (unsigned w = 0; w < depth; ++w)
+        pool.emplace_back([&]() {
+            for (size_t i = next.fetch_add(1); i < index.size(); i = next.fetch_add(1))
+                dedupe_set(*order[index[i]], opts, t);
+        });
+    for (auto &th : pool)
+        th.join();
+
+    r.sets = order.size();
+    r.files = t.files;
+    r.calls = t.calls;
+    r.bytes_deduped = t.deduped;
+    r.bytes_already_shared = t.shared;
+    r.files_differing = t.differing;
+    r.errors = t.errors;
+
+    DEBUG_LOG("[dedupe] ", r.sets, " sets, ", r.calls, " calls, ", r.bytes_deduped, " bytes deduplicated, ",
+              r.bytes_already_shared, " already shared");
+    return r;
+}
+
+std::vector<dd::file_set>
+dd::parse_sets(const std::string &text)
+{
+    std::vector<file_set> sets;
+
+    size_t first = text.find_first_not_of(" \t\r\n");
+    if (first != std::string::npos && text[first] == '{') {
+        // dupscan -j: every "paths" array is a set
+        const std::string key = "\"paths\":[";
+        for (size_t at = text.find(key); at != std::string::npos; at = text.find(key, at)) {
+            size_t i = at + key.size();
+            file_set set;
+            while (i < text.size() && text[i] != ']') {
+                if (text[i] == '"') {
+                    ++i;
+                    set.push_back(json_string(text, i));
+                } else {
+                    ++i;
+                }
+            }
+            if (set.size() > 1)
+                sets.push_back(std::move(set));
+            at = i;
+        }
+        return sets;
+    }
+
+    // fdupes style
+    std::istringstream in(text);
+    std::string line;
+    file_set set;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (line.empty()) {
+            if (set.size() > 1)
+                sets.push_back(std::move(set));
+            set.clear();
+            continue;
+        }
+        set.push_back(line);
+    }
+    if (set.size() > 1)
+        sets.push_back(std::move(set));
+
+    return sets;
+}
@@ -0,0 +1,649 @@
+#include "beekeeper/debug.hpp"
+#include "beekeeper/dupscanmgmt.hpp"
+#include "beekeeper/fswalkmgmt.hpp"
+#include "beekeeper/util.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <filesystem>
+#include <linux/fs.h>
+#include <memory>
+#include <mutex>
+#include <sys/file.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <tuple>
+#include <unistd.h>
+#include <xxhash.h>
+
+namespace fs = std::filesystem;
+namespace ds = beekeeper::management::dupscan;
+namespace fw = beekeeper::management::fswalk;
+
+// Helpers
+namespace {
+
+// Bytes hashed at each end of a file in the cheap pass
+constexpr size_t probe_size = 4096;
+
+// Sequential read size of the full pass
+constexpr size_t read_size = 1024 * 1024;
+
+// ----- persistent hash index -----
+
+constexpr char index_magic[8] = { 'B', 'K', 'D', 'U', 'P', 'I', 'X', '1' };
+constexpr uint64_t initial_slots = 4096;
+
+// Entries not seen for this many scans are dropped when the index grows
+constexpr uint32_t keep_epochs = 4;
+
+enum : uint32_t {
+    slot_used = 1,
+    has_head_tail = 2,
+    has_full = 4,
+};
+
+struct index_header {
+    char magic[8];
+    uint32_t epoch;
+    uint32_t reserved;
+    uint64_t capacity;
+    uint64_t count;
+};
+
+// What a hash is valid for: any change to these means the file changed
+struct stamp {
+    uint64_t size = 0;
+    int64_t mtime_ns = 0;
+    int64_t ctime_ns = 0;
+    uint64_t generation = 0;
+
+    bool operator==(const stamp &) const = default;
+};
+
+struct index_record {
+    uint64_t dev;
+    uint64_t ino;
+    stamp when;
+    uint64_t head_tail;
+    XXH128_hash_t full;
+    uint32_t seen;
+    uint32_t flags;
+};
+
+uint64_t
+slot_hash(uint64_t dev, uint64_t ino)
+{
+    // splitmix64 of both halves of the key
+    uint64_t x = dev * 0x9e3779b97f4a7c15ULL ^ ino;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+// Open-addressing table in a shared file mapping. Only a cache: anything
+// unexpected in the file and it starts over empty.
+class hash_index
+{
+public:
+    ~hash_index() { close(); }
+
+    bool
+    open(const std::string &path)
+    {
+        std::error_code ec;
+        fs::create_directories(fs::path(path).parent_path(), ec);
+
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+        if (fd < 0) return false;
+
+        // One scan at a time keeps the table consistent
+        if (flock(fd, LOCK_EX | LOCK_NB) < 0) {
+            DEBUG_LOG("[dupscan] index busy, scanning without it");
+            ::close(fd);
+            fd = -1;
+            return false;
+        }
+
+        struct stat st {};
+        bool valid = fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(index_header);
+        if (valid) {
+            index_header h {};
+            valid = pread(fd, &h, sizeof(h), 0) == static_cast<ssize_t>(sizeof(h))
+                 && std::memcmp(h.magic, index_magic, sizeof(index_magic)) == 0
+                 && h.capacity > 0
+                 && static_cast<uint64_t>(st.st_size) == file_size(h.capacity);
+        }
+
+        if (!valid ? !reset(initial_slots) : !map(static_cast<uint64_t>(st.st_size))) {
+            close();
+            return false;
+        }
+
+        ++header->epoch;
+        return true;
+    }
+
+    void
+    close()
+    {
+        if (header) munmap(header, mapped);
+        header = nullptr;
+        slots = nullptr;
+        if (fd >= 0) ::close(fd); // drops the lock too
+        fd = -1;
+    }
+
+    bool
+    lookup(uint64_t dev, uint64_t ino, const stamp &s, index_record &out)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!header) return false;
+
+        index_record *r = find(dev, ino);
+        if (!(r->flags & slot_used) || !(r->when == s))
+            return false;
+
+        r->seen = header->epoch;
+        out = *r;
+        return true;
+    }
+
+    void
+    store(const index_record &rec)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!header) return;
+
+        if ((header->count + 1) * 10 > header->capacity * 7 && !grow()) {
+            close();
+            return;
+        }
+
+        index_record *r = find(rec.dev, rec.ino);
+        if (!(r->flags & slot_used))
+            ++header->count;
+        *r = rec;
+        r->seen = header->epoch;
+        r->flags |= slot_used;
+    }
+
+private:
+    int fd = -1;
+    index_header *header = nullptr;
+    index_record *slots = nullptr;
+    size_t mapped = 0;
+    std::mutex mutex;
+
+    static uint64_t
+    file_size(uint64_t capacity)
+    {
+        return sizeof(index_header) + capacity * sizeof(index_record);
+    }
+
+    bool
+    map(uint64_t size)
+    {
+        void *p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED) return false;
+        header = static_cast<index_header *>(p);
+        slots = reinterpret_cast<index_record *>(header + 1);
+        mapped = size;
+        return true;
+    }
+
+    // Empty table of `capacity` slots (the file is zero-filled by ftruncate)
+    bool
+    reset(uint64_t capacity)
+    {
+        if (header) munmap(header, mapped);
+        header = nullptr;
+
+        if (ftruncate(fd, 0) < 0 || ftruncate(fd, static_cast<off_t>(file_size(capacity))) < 0)
+            return false;
+        if (!map(file_size(capacity)))
+            return false;
+
+        std::memcpy(header->magic, index_magic, sizeof(index_magic));
+        header->capacity = capacity;
+        return true;
+    }
+
+    // Slot holding the key, or the empty slot where it belongs
+    index_record *
+    find(uint64_t dev, uint64_t ino)
+    {
+        uint64_t mask = header->capacity - 1;
+        for (uint64_t i = slot_hash(dev, ino) & mask;; i = (i + 1) & mask) {
+            index_record &r = slots[i];
+            if (!(r.flags & slot_used) || (r.dev == dev && r.ino == ino))
+                return &r;
+        }
+    }
+
+    // Double the table, leaving out entries that have not been seen lately
+    bool
+    grow()
+    {
+        uint32_t epoch = header->epoch;
+        std::vector<index_record> live;
+        live.reserve(header->count);
+        for (uint64_t i = 0; i < header->capacity; ++i)
+            if ((slots[i].flags & slot_used) && epoch - slots[i].seen < keep_epochs)
+                live.push_back(slots[i]);
+
+        uint64_t capacity = header->capacity;
+        while (live.size() * 10 > capacity * 7 / 2)
+            capacity *= 2;
+
+        // Half-written tables are caught by the missing magic
+        std::memset(header->magic, 0, sizeof(header->magic));
+        if (!reset(capacity))
+            return false;
+
+        header->epoch = epoch;
+        for (const auto &rec : live) {
+            *find(rec.dev, rec.ino) = rec;
+            ++header->count;
+        }
+        return true;
+    }
+};
+
+// ----- files -----
+
+struct file_entry {
+    std::string path;
+    uint64_t dev = 0;
+    uint64_t ino = 0;
+    uint64_t size = 0;
+
+    bool ok = true;
+    uint64_t head_tail = 0;
+    XXH128_hash_t full {};
+};
+
+bool
+full_equal(const XXH128_hash_t &a, const XXH128_hash_t &b)
+{
+    return XXH128_isEqual(a, b);
+}
+
+// ----- the walk -----
+
+struct walk
+{
+    const ds::options &opts;
+
+    fw::filesystem_filter filter;
+    fw::parallel_walk dirs;
+
+    std::atomic<uint64_t> errors { 0 };
+    std::vector<std::vector<file_entry>> files;  // per walker thread
+
+    walk(const ds::options &o, unsigned threads) : opts(o), dirs(threads), files(dirs.threads()) {}
+
+    void
+    read_dir(size_t worker, const std::string &path)
+    {
+        DIR *dir = opendir(path.c_str());
+        if (!dir) {
+            ++errors;
+            return;
+        }
+        int dir_fd = dirfd(dir);
+
+        while (dirent *e = readdir(dir)) {
+            if (std::strcmp(e->d_name, ".") == 0 || std::strcmp(e->d_name, "..") == 0)
+                continue;
+
+            struct stat st {};
+            if (fstatat(dir_fd, e->d_name, &st, AT_SYMLINK_NOFOLLOW) < 0)
+                continue;
+
+            std::string child = path + "/" + e->d_name;
+            if (S_ISDIR(st.st_mode)) {
+                if (filter.contains(dir_fd, e->d_name, st.st_dev))
+                    dirs.push(worker, std::move(child));
+            } else if (S_ISREG(st.st_mode) && static_cast<uint64_t>(st.st_size) >= opts.min_size) {
+                file_entry f;
+                f.path = std::move(child);
+                f.dev = st.st_dev;
+                f.ino = st.st_ino;
+                f.size = static_cast<uint64_t>(st.st_size);
+                files[worker].push_back(std::move(f));
+            }
+        }
+        closedir(dir);
+    }
+};
+
+// ----- hashing -----
+
+struct hasher
+{
+    hash_index *index = nullptr;     // null: no index
+    std::atomic<uint64_t> fully_hashed { 0 }, from_index { 0 }, bytes_read { 0 }, errors { 0 };
+
+    int
+    open_file(const file_entry &f, stamp &s)
+    {
+        int fd = open(f.path.c_str(), O_RDONLY | O_NOFOLLOW | O_CLOEXEC | O_NOATIME);
+        if (fd < 0 && errno == EPERM)
+            fd = open(f.path.c_str(), O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+        if (fd < 0) return -1;
+
+        struct stat st {};
+        // Replaced since the walk: not the file that was grouped
+        if (fstat(fd, &st) < 0 || st.st_ino != f.ino || static_cast<uint64_t>(st.st_size) != f.size) {
+            close(fd);
+            return -1;
+        }
+
+        long generation = 0;
+        if (ioctl(fd, FS_IOC_GETVERSION, &generation) < 0)
+            generation = 0;
+
+        s.size = f.size;
+        s.mtime_ns = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+        s.ctime_ns = static_cast<int64_t>(st.st_ctim.tv_sec) * 1000000000 + st.st_ctim.tv_nsec;
+        s.generation = static_cast<uint64_t>(generation);
+        return fd;
+    }
+
+    void
+    remember(const file_entry &f, const stamp &s, uint32_t flags)
+    {
+        if (!index) return;
+
+        index_record rec {};
+        index_record old {};
+        // Keep what is already known about the same version of the file
+        if (index->lookup(f.dev, f.ino, s, old))
+            rec = old;
+        rec.dev = f.dev;
+        rec.ino = f.ino;
+        rec.when = s;
+        if (flags & has_head_tail) rec.head_tail = f.head_tail;
+        if (flags & has_full) rec.full = f.full;
+        rec.flags |= flags;
+        index->store(rec);
+    }
+
+    // Small files are read whole here, so they get their full hash at once
+    void
+    head_tail(file_entry &f)
+    {
+        stamp s;
+        int fd = open_file(f, s);
+        if (fd < 0) {
+            f.ok = false;
+            ++errors;
+            return;
+        }
+
+        index_record rec {};
+        if (index && index->lookup(f.dev, f.ino, s, rec) && (rec.flags & has_head_tail)) {
+            f.head_tail = rec.head_tail;
+            if (rec.flags & has_full) f.full = rec.full;
+            ++from_index;
+            close(fd);
+            return;
+        }
+
+        unsigned char buffer[2 * probe_size];
+        size_t n = 0;
+        bool whole = f.size <= sizeof(buffer);
+
+        if (whole) {
+            ssize_t r = pread(fd, buffer, f.size, 0);
+            n = r > 0 ? static_cast<size_t>(r) : 0;
+        } else {
+            ssize_t head = pread(fd, buffer, probe_size, 0);
+            ssize_t tail = pread(fd, buffer + probe_size, probe_size, static_cast<off_t>(f.size - probe_size));
+            if (head == static_cast<ssize_t>(probe_size) && tail == static_cast<ssize_t>(probe_size))
+                n = sizeof(buffer);
+        }
+        close(fd);
+
+        if (n == 0 || (whole && n != f.size)) {
+            f.ok = false;
+            ++errors;
+            return;
+        }
+        bytes_read += n;
+
+        f.head_tail = XXH3_64bits_withSeed(buffer, n, f.size);
+        uint32_t flags = has_head_tail;
+        if (whole) {
+            f.full = XXH3_128bits(buffer, n);
+            flags |= has_full;
+            ++fully_hashed;
+        }
+        remember(f, s, flags);
+    }
+
+    void
+    full(file_entry &f, std::vector<unsigned char> &buffer)
+    {
+        stamp s;
+        int fd = open_file(f, s);
+        if (fd < 0) {
+            f.ok = false;
+            ++errors;
+            return;
+        }
+
+        index_record rec {};
+        if (index && index->lookup(f.dev, f.ino, s, rec) && (rec.flags & has_full)) {
+            f.full = rec.full;
+            ++from_index;
+            close(fd);
+            return;
+        }
+
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+        XXH3_state_t *state = XXH3_createState();
+        XXH3_128bits_reset(state);
+
+        uint64_t total = 0;
+        ssize_t n;
+        while ((n = read(fd, buffer.data(), buffer.size())) > 0) {
+            XXH3_128bits_update(state, buffer.data(), static_cast<size_t>(n));
+            total += static_cast<uint64_t>(n);
+        }
+
+        // Do not leave the scan's data crowding out the page cache
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+
+        if (n < 0 || total != f.size) {
+            XXH3_freeState(state);
+            f.ok = false;
+            ++errors;
+            return;
+        }
+
+        f.full = XXH3_128bits_digest(state);
+        XXH3_freeState(state);
+
+        bytes_read += total;
+        ++fully_hashed;
+        remember(f, s, has_full);
+    }
+};
+
+// Run fn(item, worker) over items on `threads` threads
+template <typename T, typename F>
+void
+parallel_for(std::vector<T *> &items, unsigned threads, F &&fn)
+{
+    std::atomic<size_t> next { 0 };
+    std::vector<std::thread> pool;
+    threads = std::clamp<unsigned>(threads, 1, static_cast<unsigned>(std::max<size_t>(1, items.size())));
+
+    for (unsigned t = 0; t < threads; ++t)
+        pool.emplace_back([&, t]() {
+            for (size_t i = next.fetch_add(1); i < items.size(); i = next.fetch_add(1))
+                fn(*items[i], t);
+        });
+    for (auto &t : pool)
+        t.join();
+}
+
+// Split [begin, end) (sorted by `same`) into runs of equal entries with more than one member
+template <typename It, typename Eq, typename F>
+void
+for_each_group(It begin, It end, Eq same, F &&fn)
+{
+    while (begin != end) {
+        It run_end = std::next(begin);
+        while (run_end != end && same(**begin, **run_end))
+            ++run_end;
+        if (std::distance(begin, run_end) > 1)
+            fn(begin, run_end);
+        begin = run_end;
+    }
+}
+
+} // anonymous namespace
+
+
+/**
+ * @brief Find sets of identical files under the given directories.
+ *
+ * Four passes, each on fewer files: walk (all files of at least min_size),
+ * size groups, head/tail hash groups, full hash groups. Only the last two
+ * read file data, and the index saves most of that on later scans.
+ *
+ * @param roots Directories to walk; overlapping roots are fine.
+ * @param opts  Threads, minimum size and whether to use the index.
+ */
+ds::report
+ds::scan(const std::vector<std::string> &roots, const options &opts)
+{
+    report r;
+
+    unsigned threads = opts.threads ? opts.threads : std::max(1u, std::thread::hardware_concurrency());
+
+    // 1) Walk
+    walk w(opts, threads);
+
+    size_t usable_roots = 0;
+    for (const auto &root : roots) {
+        std::error_code ec;
+        std::string canonical = fs::weakly_canonical(root, ec).string();
+        if (!w.filter.add_root(canonical)) {
+            DEBUG_LOG("[dupscan] ", root, " is not a directory on btrfs: ", strerror(errno));
+            ++w.errors;
+            continue;
+        }
+
+        w.dirs.push(usable_roots++, canonical);
+    }
+
+    if (usable_roots == 0) {
+        r.errors = w.errors;
+        return r;
+    }
+
+    w.dirs.run([&w](size_t worker, const std::string &dir) { w.read_dir(worker, dir); });
+
+    std::vector<file_entry> files;
+    for (auto &found : w.files)
+        files.insert(files.end(), std::make_move_iterator(found.begin()), std::make_move_iterator(found.end()));
+
+    // Hard links and overlapping roots: one entry per inode
+    std::sort(files.begin(), files.end(), [](const file_entry &a, const file_entry &b) {
+        return std::tie(a.dev, a.ino, a.path) < std::tie(b.dev, b.ino, b.path);
+    });
+    files.erase(std::unique(files.begin(), files.end(), [](const file_entry &a, const file_entry &b) {
+        return a.dev == b.dev && a.ino == b.ino;
+    }), files.end());
+
+    r.complete = true;
+    r.files = files.size();
+
+    // 2) Same size
+    std::vector<file_entry *> by_size;
+    by_size.reserve(files.size());
+    for (auto &f : files)
+        by_size.push_back(&f);
+    std::sort(by_size.begin(), by_size.end(), [](const file_entry *a, const file_entry *b) { return a->size < b->size; });
+
+    std::vector<file_entry *> candidates;
+    for_each_group(by_size.begin(), by_size.end(),
+                   [](const file_entry &a, const file_entry &b) { return a.size == b.size; },
+                   [&](auto begin, auto end) { candidates.insert(candidates.end(), begin, end); });
+    r.candidates = candidates.size();
+
+    hash_index index;
+    hasher h;
+    if (opts.use_index && index.open(bk_util::system_path(index_path)))
+        h.index = &index;
+
+    // 3) Same head and tail
+    parallel_for(candidates, threads, [&](file_entry &f, unsigned) { h.head_tail(f); });
+
+    candidates.erase(std::remove_if(candidates.begin(), candidates.end(), [](const file_entry *f) { return !f->ok; }),
+                     candidates.end());
+    std::sort(candidates.begin(), candidates.end(), [](const file_entry *a, const file_entry *b) {
+        return std::tie(a->size, a->head_tail) < std::tie(b->size, b->head_tail);
+    });
+
+    std::vector<file_entry *> survivors;
+    for_each_group(candidates.begin(), candidates.end(),
+                   [](const file_entry &a, const file_entry &b) { return a.size == b.size && a.head_tail == b.head_tail; },
+                   [&](auto begin, auto end) { survivors.insert(survivors.end(), begin, end); });
+
+    // 4) Same content. Largest first, so one big file does not finish last alone.
+    std::vector<file_entry *> to_hash;
+    for (file_entry *f : survivors)
+        if (f->size > 2 * probe_size)
+            to_hash.push_back(f);
+    std::stable_sort(to_hash.begin(), to_hash.end(), [](const file_entry *a, const file_entry *b) { return a->size > b->size; });
+
+    std::vector<std::vector<unsigned char>> buffers(threads, std::vector<unsigned char>(read_size));
+    parallel_for(to_hash, threads, [&](file_entry &f, unsigned worker) { h.full(f, buffers[worker]); });
+
+    index.close();
+
+    survivors.erase(std::remove_if(survivors.begin(), survivors.end(), [](const file_entry *f) { return !f->ok; }),
+                    survivors.end());
+    std::sort(survivors.begin(), survivors.end(), [](const file_entry *a, const file_entry *b) {
+        return std::tie(a->size, a->full.high64, a->full.low64, a->path)
+             < std::tie(b->size, b->full.high64, b->full.low64, b->path);
+    });
+
+    for_each_group(survivors.begin(), survivors.end(),
+                   [](const file_entry &a, const file_entry &b) { return a.size == b.size && full_equal(a.full, b.full); },
+                   [&](auto begin, auto end) {
+                       duplicate_set set;
+                       set.size = (*begin)->size;
+                       for (auto it = begin; it != end; ++it)
+                           set.paths.push_back((*it)->path);
+                       set.reclaimable = set.size * (set.paths.size() - 1);
+                       r.reclaimable += set.reclaimable;
+                       r.sets.push_back(std::move(set));
+                   });
+
+    std::stable_sort(r.sets.begin(), r.sets.end(), [](const duplicate_set &a, const duplicate_set &b) {
+        return a.reclaimable > b.reclaimable;
+    });
+
+    r.fully_hashed = h.fully_hashed;
+    r.from_index = h.from_index;
+    r.bytes_read = h.bytes_read;
+    r.errors = w.errors + h.errors;
+
+    DEBUG_LOG("[dupscan] ", r.files, " files, ", r.candidates, " candidates, ", r.sets.size(),
+              " duplicate sets, ", r.bytes_read, " bytes read, ", r.from_index, " from the index");
+    return r;
+}
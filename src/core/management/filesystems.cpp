@@ -1,13 +1,18 @@
 #include "beekeeper/beesdmgmt.hpp"
 #include "beekeeper/btrfsetup.hpp"
 #include "beekeeper/debug.hpp"
+#include "beekeeper/timingsmgmt.hpp"
 
 #include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <limits.h>
 #include <unordered_set>
 #include <vector>
 #include <sys/stat.h>
+#include <sys/sysmacros.h>
+
+namespace timings = beekeeper::management::timings;
 
 // check if a given mountpoint or uuid is a btrfs filesystem
 bool
@@ -51,7 +56,7 @@ bk_mgmt::is_btrfs(const std::string &mountpoint_or_uuid_or_device)
         normalized = mountpoint_or_uuid_or_device;
     }
 
-    std::ifstream mounts("/proc/mounts");
+    std::ifstream mounts(bk_util::system_path("/proc/mounts"));
     if (!mounts.is_open()) {
         std::cerr << "[is_btrfs] failed to open /proc/mounts\n";
         return false;
@@ -101,7 +106,7 @@ bk_mgmt::get_mount_uuid(const std::string &mountpoint)
     dev_t dev_id = st.st_dev;
 
     // Iterate over /proc/mounts to find matching mountpoint/device
-    std::ifstream mounts("/proc/mounts");
+    std::ifstream mounts(bk_util::system_path("/proc/mounts"));
     if (!mounts.is_open()) {
         std::cerr << "[get_mount_uuid] failed to open /proc/mounts" << std::endl;
         return {};
@@ -133,11 +138,11 @@ bk_mgmt::get_mount_uuid(const std::string &mountpoint)
         return {};
 
     // Now resolve the UUID via /dev/disk/by-uuid symlinks
-    const std::string uuid_dir = "/dev/disk/by-uuid";
+    const std::string uuid_dir = bk_util::system_path("/dev/disk/by-uuid");
     for (const auto &entry : std::filesystem::directory_iterator(uuid_dir)) {
         try {
             std::string uuid = entry.path().filename().string();
-            std::string target = std::filesystem::canonical(entry.path()).string();
+            std::string target = bk_util::system_relative(std::filesystem::canonical(entry.path()).string());
 
             if (target == backing_device) {
                 return uuid; // return UUID string
@@ -267,7 +272,11 @@ bk_mgmt::remount_in_place(
         any_attempted = true;
         DEBUG_LOG("[bk_mgmt::remount_in_place] remounting: ", mp, " opts=", opt);
 
-        auto res = bk_util::exec_command("mount", "-o", opt, mp);
+        command_streams res;
+        {
+            timings::scoped_timer timer(timings::family::remount, mp);
+            res = bk_util::exec_command("mount", "-o", opt, mp);
+        }
 
         if (!res.stderr_str.empty()) {
             std::cerr << "remount_in_place failed for " << mp
@@ -308,18 +317,19 @@ bk_mgmt::get_real_device(const std::string &uuid_or_device)
     }
 
     // Otherwise it's a UUID -> resolve /dev/disk/by-uuid/<UUID>
-    fs::path uuid_path = fs::path("/dev/disk/by-uuid") / uuid_or_device;
+    fs::path uuid_path = fs::path(bk_util::system_path("/dev/disk/by-uuid")) / uuid_or_device;
     if (!fs::exists(uuid_path)) {
         return {}; // UUID not present
     }
 
     fs::path real_device = fs::canonical(uuid_path, ec);
     if (ec) return {};
+    real_device = bk_util::system_relative(real_device.string());
 
     // If device is a device-mapper entry (starts with "dm-"), try to map to /dev/mapper/<name>
     // (this mirrors your original logic exactly)
     if (real_device.filename().string().rfind("dm-", 0) == 0) { // starts with dm-
-        fs::path sys_dm_name = fs::path("/sys/block") / real_device.filename() / "dm" / "name";
+        fs::path sys_dm_name = fs::path(bk_util::system_path("/sys/block")) / real_device.filename() / "dm" / "name";
         std::ifstream name_file(sys_dm_name);
         if (name_file.is_open()) {
             std::string dm_name;
@@ -333,6 +343,66 @@ bk_mgmt::get_real_device(const std::string &uuid_or_device)
     return real_device.string();
 }
 
+/**
+ * @brief Resolve the sysfs directory of the whole disk backing a filesystem.
+ *
+ * Partitions are walked up to their parent disk, since per-disk knobs
+ * (queue/rotational, io.max, ...) only exist there. Device-mapper devices
+ * are returned as-is; they carry their own queue attributes.
+ *
+ * @param uuid_or_device Filesystem UUID or device path.
+ * @return e.g. "/sys/devices/pci0000:00/.../block/sda", or "" on failure.
+ */
+std::string
+bk_mgmt::get_backing_disk(const std::string &uuid_or_device)
+{
+    namespace fs = std::filesystem;
+
+    std::string device = get_real_device(uuid_or_device);
+    if (device.empty())
+        return "";
+
+    struct stat st {};
+    if (::stat(device.c_str(), &st) != 0 || !S_ISBLK(st.st_mode))
+        return "";
+
+    std::string devno = std::to_string(major(st.st_rdev)) + ":" + std::to_string(minor(st.st_rdev));
+
+    std::error_code ec;
+    fs::path sysdev = fs::canonical(fs::path(bk_util::system_path("/sys/dev/block")) / devno, ec);
+    if (ec)
+        return "";
+
+    if (fs::exists(sysdev / "partition", ec))
+        sysdev = sysdev.parent_path();
+
+    return sysdev.string();
+}
+
+// "MAJ:MIN" of the backing disk, as cgroup io files want it
+std::string
+bk_mgmt::get_backing_disk_devno(const std::string &uuid_or_device)
+{
+    std::string disk = get_backing_disk(uuid_or_device);
+    if (disk.empty())
+        return "";
+
+    auto lines = bk_util::read_lines_from_file(disk + "/dev");
+    return lines.empty() ? "" : lines[0];
+}
+
+// Spinning disk? Unknown devices are treated as non-rotational.
+bool
+bk_mgmt::is_rotational(const std::string &uuid_or_device)
+{
+    std::string disk = get_backing_disk(uuid_or_device);
+    if (disk.empty())
+        return false;
+
+    auto lines = bk_util::read_lines_from_file(disk + "/queue/rotational");
+    return !lines.empty() && lines[0] == "1";
+}
+
 std::vector<std::string>
 bk_mgmt::get_mount_paths(const std::string &uuid_or_device)
 {
@@ -352,32 +422,24 @@ bk_mgmt::get_mount_paths(const std::string &uuid_or_device)
 
     // DEBUG_LOG("Real device for uuid ", uuid_or_device, " is: ", real_device);
 
-    // Find all /proc/mounts lines that contain the real device string (case-insensitive)
-    // The helper returns each matching line as a full string.
-    auto matched_lines = bk_util::find_lines_matching_substring_in_file(
-        "/proc/mounts",
-        real_device,
-        /*case_insensitive=*/true
-    );
+    // Find all /proc/mounts lines that contain the real device string
+    // (case-insensitive), matched in place in one buffer
+    timings::scoped_timer timer(timings::family::proc_scan, "mounts");
+    bk_util::text_buffer mounts;
+    if (!mounts.load(bk_util::system_path("/proc/mounts")))
+        return mountpoints;
 
-    if (matched_lines.empty()) {
-        return mountpoints; // nothing found
-    }
+    const bk_util::line_matcher matcher({real_device}, /*case_insensitive=*/true);
 
     // Extract the second token (mountpoint) from each matched line.
     // Use a set to deduplicate while preserving insertion order.
     std::unordered_set<std::string> seen;
-    for (const auto &line : matched_lines) {
-        if (line.empty()) continue;
-
-        auto tokens = bk_util::tokenize(line, ' ');
+    for (std::string_view line : matcher.matching_lines(mounts.text())) {
+        const auto &tokens = mounts.tokenize(line, ' ');
         if (tokens.size() < 2) continue;
 
-        std::string mnt = bk_util::trim_string(tokens[1]);
-
-        // Unescape /proc/mounts escapes (e.g. "\040" -> space) if helper exists
-        // (we assume bk_util::unescape_proc_mount_field is available as discussed).
-        mnt = bk_util::unescape_proc_mount_field(mnt);
+        // Unescape /proc/mounts escapes (e.g. "\040" -> space)
+        std::string mnt(mounts.unescape_mount_field(tokens[1]));
 
         if (mnt.empty()) continue;
         if (seen.emplace(mnt).second) {
@@ -438,11 +500,11 @@ get_filesystem_label(const std::string &mountpoint_or_uuid)
     }
 
     // Try resolving /dev/disk/by-uuid/<uuid> with realpath()
-    std::string syspath = "/dev/disk/by-uuid/" + uuid;
+    std::string syspath = bk_util::system_path("/dev/disk/by-uuid/" + uuid);
     char resolved[PATH_MAX + 1];
     std::string device_path;
     if (realpath(syspath.c_str(), resolved) != nullptr) {
-        device_path = resolved; // absolute device path
+        device_path = bk_util::system_relative(resolved); // absolute device path
     }
 
     // If realpath failed, try user-provided helper to obtain device path
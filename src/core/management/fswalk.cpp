@@ -0,0 +1,168 @@
+#include "beekeeper/fswalkmgmt.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/btrfs.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+namespace fw = beekeeper::management::fswalk;
+
+static_assert(BTRFS_FSID_SIZE == 16, "fswalk::filesystem_filter keeps 16-byte fsids");
+
+// Helpers
+namespace {
+
+bool
+read_fsid(int fd, std::array<uint8_t, 16> &fsid)
+{
+    btrfs_ioctl_fs_info_args info {};
+    if (ioctl(fd, BTRFS_IOC_FS_INFO, &info) < 0)
+        return false;
+    std::memcpy(fsid.data(), info.fsid, fsid.size());
+    return true;
+}
+
+} // anonymous namespace
+
+
+bool
+fw::filesystem_filter::add_root(const std::string &root)
+{
+    int fd = open(root.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    struct stat st {};
+    std::array<uint8_t, 16> fsid {};
+    bool ok = fstat(fd, &st) == 0 && read_fsid(fd, fsid);
+    close(fd);
+    if (!ok)
+        return false;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_same[st.st_dev] = true;
+    if (std::find(m_fsids.begin(), m_fsids.end(), fsid) == m_fsids.end())
+        m_fsids.push_back(fsid);
+    return true;
+}
+
+bool
+fw::filesystem_filter::contains(int parent_fd, const char *name, dev_t dev)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_same.find(dev);
+        if (it != m_same.end())
+            return it->second;
+    }
+
+    // A new st_dev: ask the directory itself which filesystem it is on
+    std::array<uint8_t, 16> fsid {};
+    int fd = openat(parent_fd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    bool btrfs = fd >= 0 && read_fsid(fd, fsid);
+    if (fd >= 0)
+        close(fd);
+    // Unreadable now says nothing about its siblings on the same st_dev
+    if (fd < 0)
+        return false;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    bool same = btrfs && std::find(m_fsids.begin(), m_fsids.end(), fsid) != m_fsids.end();
+    m_same.emplace(dev, same);
+    return same;
+}
+
+fw::parallel_walk::parallel_walk(unsigned threads)
+{
+    for (unsigned i = 0; i < std::max(1u, threads); ++i)
+        m_queues.push_back(std::make_unique<queue>());
+}
+
+void
+fw::parallel_walk::push(size_t worker, std::string dir)
+{
+    m_pending.fetch_add(1);
+    {
+        auto &own = *m_queues[worker % m_queues.size()];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        own.dirs.push_back(std::move(dir));
+    }
+    m_queued.fetch_add(1);
+    wake(false);
+}
+
+// Own queue from the back, others' from the front
+bool
+fw::parallel_walk::next_dir(size_t worker, std::string &dir)
+{
+    for (size_t i = 0; i < m_queues.size(); ++i) {
+        auto &q = *m_queues[(worker + i) % m_queues.size()];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (q.dirs.empty())
+            continue;
+        if (i == 0) {
+            dir = std::move(q.dirs.back());
+            q.dirs.pop_back();
+        } else {
+            dir = std::move(q.dirs.front());
+            q.dirs.pop_front();
+        }
+        m_queued.fetch_sub(1);
+        return true;
+    }
+    return false;
+}
+
+// Taking the idle mutex orders this against a thread between checking for
+// work and going to sleep, so the wakeup cannot be lost
+void
+fw::parallel_walk::wake(bool everyone)
+{
+    { std::lock_guard<std::mutex> lock(m_idle_mutex); }
+    if (everyone)
+        m_work_available.notify_all();
+    else
+        m_work_available.notify_one();
+}
+
+void
+fw::parallel_walk::wait_for_work()
+{
+    std::unique_lock<std::mutex> lock(m_idle_mutex);
+    m_work_available.wait(lock, [this] { return m_queued.load() > 0 || m_pending.load() == 0; });
+}
+
+void
+fw::parallel_walk::worker(size_t worker, const read_dir_fn &read_dir, const thread_init_fn &thread_init)
+{
+    if (thread_init)
+        thread_init(worker);
+
+    std::string dir;
+    while (m_pending.load() > 0) {
+        if (!next_dir(worker, dir)) {
+            wait_for_work();
+            continue;
+        }
+
+        read_dir(worker, dir);
+
+        // The last directory: let the sleepers go
+        if (m_pending.fetch_sub(1) == 1)
+            wake(true);
+    }
+}
+
+void
+fw::parallel_walk::run(const read_dir_fn &read_dir, const thread_init_fn &thread_init)
+{
+    std::vector<std::thread> pool;
+    for (size_t i = 0; i < m_queues.size(); ++i)
+        pool.emplace_back(&parallel_walk::worker, this, i, std::cref(read_dir), std::cref(thread_init));
+    for (auto &t : pool)
+        t.join();
+}
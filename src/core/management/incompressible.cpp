@@ -0,0 +1,337 @@
+#include "beekeeper/btrfsetup.hpp"
+#include "beekeeper/compressibilitymgmt.hpp"
+#include "beekeeper/debug.hpp"
+#include "beekeeper/fswalkmgmt.hpp"
+#include "beekeeper/incompressiblemgmt.hpp"
+#include "beekeeper/util.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <sys/stat.h>
+#include <sys/xattr.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace fs = std::filesystem;
+namespace inc = beekeeper::management::incompressible;
+namespace cmp = beekeeper::management::compressibility;
+
+// Helpers
+namespace {
+
+constexpr const char *property = "btrfs.compression";
+
+// Above this many bits per byte a block is noise to any compressor
+constexpr double hopeless_entropy = 7.95;
+
+constexpr uint64_t sector_size = 4096;
+
+std::string
+undo_path(const std::string &uuid)
+{
+    return bk_util::system_path(inc::undo_dir) + bk_util::to_lower(uuid) + ".undo";
+}
+
+// Undo log entries, oldest first: "<previous value>\t<path>" per line. Read
+// raw: the previous value is usually empty, so the line starts with the
+// tab that whitespace-trimming readers would eat.
+std::vector<std::pair<std::string, std::string>>
+read_undo_log(const std::string &path)
+{
+    std::vector<std::pair<std::string, std::string>> entries;
+    std::ifstream in(path);
+    for (std::string line; std::getline(in, line); ) {
+        auto tab = line.find('\t');
+        if (tab != std::string::npos)
+            entries.emplace_back(line.substr(0, tab), line.substr(tab + 1));
+    }
+    return entries;
+}
+
+std::string
+read_property(const std::string &path)
+{
+    char value[32] = {};
+    ssize_t n = getxattr(path.c_str(), property, value, sizeof(value) - 1);
+    return n > 0 ? std::string(value, static_cast<size_t>(n)) : std::string();
+}
+
+// Shannon entropy in bits per byte
+double
+entropy(const unsigned char *data, size_t n)
+{
+    if (n == 0) return 0;
+
+    std::array<uint32_t, 256> counts {};
+    for (size_t i = 0; i < n; ++i)
+        ++counts[data[i]];
+
+    double bits = 0;
+    for (uint32_t c : counts) {
+        if (!c) continue;
+        double p = static_cast<double>(c) / static_cast<double>(n);
+        bits -= p * std::log2(p);
+    }
+    return bits;
+}
+
+// Every directory below `root` on the same filesystem (subvolumes
+// included), until the deadline
+std::vector<std::string>
+list_directories(const std::string &root, std::chrono::steady_clock::time_point deadline, bool &partial)
+{
+    std::vector<std::string> dirs;
+
+    bk_mgmt::fswalk::filesystem_filter filter;
+    if (!filter.add_root(root)) return dirs;
+
+    dirs.push_back(root);
+
+    std::error_code ec;
+    fs::recursive_directory_iterator it(root, fs::directory_options::skip_permission_denied, ec);
+    for (; !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+        if ((dirs.size() & 255) == 0 && std::chrono::steady_clock::now() > deadline) {
+            partial = true;
+            break;
+        }
+
+        struct stat st {};
+        if (lstat(it->path().c_str(), &st) < 0 || !S_ISDIR(st.st_mode))
+            continue;
+
+        if (filter.contains(AT_FDCWD, it->path().c_str(), st.st_dev))
+            dirs.push_back(it->path().string());
+        else
+            it.disable_recursion_pending();
+    }
+
+    return dirs;
+}
+
+// Sample the files directly inside one directory
+inc::directory
+sample_directory(const std::string &path, const inc::options &opts)
+{
+    inc::directory d;
+    d.path = path;
+    d.current = read_property(path);
+
+    DIR *dir = opendir(path.c_str());
+    if (!dir) return d;
+    int dir_fd = dirfd(dir);
+
+    std::vector<std::pair<std::string, uint64_t>> files;
+    while (dirent *e = readdir(dir)) {
+        if (e->d_type != DT_REG && e->d_type != DT_UNKNOWN)
+            continue;
+        struct stat st {};
+        if (fstatat(dir_fd, e->d_name, &st, AT_SYMLINK_NOFOLLOW) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+            files.emplace_back(e->d_name, static_cast<uint64_t>(st.st_size));
+    }
+
+    // Evenly spread over the listing, not just its first entries
+    std::sort(files.begin(), files.end());
+    size_t step = std::max<size_t>(1, files.size() / std::max(1u, opts.files_per_dir));
+
+    std::vector<unsigned char> block(cmp::block_size);
+    uint64_t input = 0, stored = 0;
+    double entropy_sum = 0;
+    unsigned blocks = 0;
+
+    for (size_t i = 0; i < files.size(); i += step) {
+        const auto &[name, size] = files[i];
+
+        int fd = openat(dir_fd, name.c_str(), O_RDONLY | O_NOFOLLOW | O_CLOEXEC | O_NOATIME);
+        if (fd < 0 && errno == EPERM)
+            fd = openat(dir_fd, name.c_str(), O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+        if (fd < 0) continue;
+
+        // Start, end and evenly in between: headers alone can mislead
+        unsigned count = std::max(1u, opts.blocks_per_file);
+        uint64_t last_offset = size > cmp::block_size ? size - cmp::block_size : 0;
+
+        for (unsigned b = 0; b < count; ++b) {
+            uint64_t offset = count > 1 ? last_offset * b / (count - 1) : 0;
+            ssize_t n = pread(fd, block.data(), block.size(), static_cast<off_t>(offset));
+            if (n <= 0) break;
+
+            size_t len = static_cast<size_t>(n);
+            double e = entropy(block.data(), len);
+            uint64_t raw = (len + sector_size - 1) / sector_size * sector_size;
+
+            uint64_t best = raw;
+            if (e < hopeless_entropy)
+                best = std::min(cmp::stored_bytes("lzo", 0, block.data(), len),
+                                cmp::stored_bytes("zstd", 1, block.data(), len));
+
+            input += raw;
+            stored += best;
+            entropy_sum += e;
+            ++blocks;
+
+            if (last_offset == 0) break; // one block covers the whole file
+        }
+        close(fd);
+    }
+    closedir(dir);
+
+    d.sampled = input;
+    d.entropy = blocks ? entropy_sum / blocks : 0;
+    d.saved_fraction = input ? 1.0 - static_cast<double>(stored) / static_cast<double>(input) : 0;
+    d.incompressible = input >= opts.min_sampled && d.saved_fraction < opts.threshold;
+    return d;
+}
+
+} // anonymous namespace
+
+
+/**
+ * @brief Find the directories whose data does not compress.
+ *
+ * Directories are listed first (bounded by walk_seconds) and then sampled
+ * on a pool of threads. Only the files directly inside a directory count
+ * towards its verdict, since the property is inherited by the files
+ * created there and not by subdirectories created before it.
+ *
+ * @param uuid Filesystem UUID; it must be mounted.
+ * @param opts Threshold and sampling density.
+ */
+inc::report
+inc::scan(const std::string &uuid, const options &opts)
+{
+    report r;
+
+    auto mounts = bk_mgmt::get_mount_paths(uuid);
+    if (mounts.empty()) {
+        DEBUG_LOG("[incompressible] ", uuid, " is not mounted");
+        return r;
+    }
+    r.available = true;
+
+    auto dirs = list_directories(mounts.front(),
+                                 std::chrono::steady_clock::now() + std::chrono::seconds(opts.walk_seconds),
+                                 r.partial_walk);
+
+    std::vector<directory> results(dirs.size());
+    std::atomic<size_t> next { 0 };
+
+    unsigned threads = opts.threads ? opts.threads : std::thread::hardware_concurrency();
+    threads = std::clamp<unsigned>(threads, 1, static_cast<unsigned>(std::max<size_t>(1, dirs.size())));
+
+    std::vector<std::thread> pool;
+    for (unsigned t = 0; t < threads; ++t)
+        pool.emplace_back([&]() {
+            for (size_t i = next.fetch_add(1); i < dirs.size(); i = next.fetch_add(1))
+                results[i] = sample_directory(dirs[i], opts);
+        });
+    for (auto &t : pool)
+        t.join();
+
+    for (auto &d : results)
+        if (d.sampled >= opts.min_sampled)
+            r.directories.push_back(std::move(d));
+
+    DEBUG_LOG("[incompressible] ", uuid, ": ", dirs.size(), " directories, ",
+              r.directories.size(), " with enough data");
+    return r;
+}
+
+size_t
+inc::apply(const std::string &uuid, const report &r)
+{
+    std::error_code ec;
+    fs::create_directories(bk_util::system_path(undo_dir), ec);
+
+    std::ofstream log(undo_path(uuid), std::ios::app);
+    if (!log) {
+        DEBUG_LOG("[incompressible] cannot open undo log for ", uuid);
+        return 0;
+    }
+
+    size_t set = 0;
+    for (const auto &d : r.directories) {
+        // Leave explicit settings alone; a newline would break the log
+        if (!d.incompressible || !d.current.empty() || d.path.find('\n') != std::string::npos)
+            continue;
+
+        if (setxattr(d.path.c_str(), property, "none", 4, 0) < 0) {
+            DEBUG_LOG("[incompressible] cannot set ", property, " on ", d.path, ": ", strerror(errno));
+            continue;
+        }
+
+        // "<previous value>\t<path>", flushed per line so a crash loses nothing
+        log << d.current << '\t' << d.path << std::endl;
+        ++set;
+    }
+
+    return set;
+}
+
+size_t
+inc::undo(const std::string &uuid)
+{
+    const std::string path = undo_path(uuid);
+    auto entries = read_undo_log(path);
+
+    size_t reverted = 0;
+    std::vector<std::pair<std::string, std::string>> kept; // newest first
+
+    for (auto it = entries.rbegin(); it != entries.rend(); ++it) {
+        const auto &[previous, dir] = *it;
+
+        // Gone, or changed by hand since: not ours to revert
+        if (read_property(dir) != "none")
+            continue;
+
+        int rc = previous.empty()
+            ? removexattr(dir.c_str(), property)
+            : setxattr(dir.c_str(), property, previous.data(), previous.size(), 0);
+        if (rc == 0 || errno == ENODATA) {
+            ++reverted;
+        } else {
+            DEBUG_LOG("[incompressible] cannot revert ", dir, ": ", strerror(errno));
+            kept.push_back(*it);
+        }
+    }
+
+    std::error_code ec;
+    if (kept.empty()) {
+        fs::remove(path, ec);
+        return reverted;
+    }
+
+    // Keep what could not be reverted for the next undo
+    const std::string tmp = path + ".new";
+    {
+        std::ofstream log(tmp, std::ios::trunc);
+        for (auto it = kept.rbegin(); it != kept.rend(); ++it)
+            log << it->first << '\t' << it->second << '\n';
+        if (!log.flush()) {
+            DEBUG_LOG("[incompressible] cannot rewrite undo log for ", uuid);
+            fs::remove(tmp, ec);
+            return reverted;
+        }
+    }
+    fs::rename(tmp, path, ec);
+
+    return reverted;
+}
+
+std::vector<std::string>
+inc::changed(const std::string &uuid)
+{
+    std::vector<std::string> dirs;
+    for (auto &[previous, dir] : read_undo_log(undo_path(uuid)))
+        dirs.push_back(std::move(dir));
+    return dirs;
+}
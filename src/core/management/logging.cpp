@@ -11,7 +11,7 @@ namespace fs = std::filesystem;
 std::string
 bk_mgmt::get_log_dir ()
 {
-    return "/var/log/beesd/";
+    return bk_util::system_path("/var/log/beesd/");
 }
 
 // Helper: Get log file path
@@ -61,7 +61,7 @@ bk_mgmt::clear_log_file_for_uuid(const std::string &uuid)
 std::string
 bk_mgmt::started_with_n_gb_file_path (const std::string &uuid)
 {
-    return fs::path("/run/bees/beekeeper-qt/") / uuid / "startingfreespace";
+    return fs::path(bk_util::system_path("/run/bees/beekeeper-qt/")) / uuid / "startingfreespace";
 }
 
 void
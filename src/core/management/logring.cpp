@@ -0,0 +1,333 @@
+#include "beekeeper/beesdmgmt.hpp"
+#include "beekeeper/debug.hpp"
+#include "beekeeper/logringmgmt.hpp"
+#include "beekeeper/util.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unistd.h>
+#include <zlib.h>
+
+namespace fs = std::filesystem;
+namespace logring = beekeeper::management::logring;
+
+// Helpers
+namespace {
+
+// Byte ring holding '\n'-terminated lines. Positions are absolute byte
+// offsets; the byte for position p lives at p % ring_capacity.
+//
+// A single writer appends whole lines and then publishes the new end. The
+// drain thread of a worker claims the ring for as long as it runs; the one
+// of a restarted worker waits until the previous one has seen EOF, so
+// appends need no lock. Readers copy without locking and validate
+// afterwards: whatever the writer may have touched while they copied
+// (anything closer than one capacity minus one line to the new end) is
+// thrown away. Same idea as a seqlock, per byte range instead of per record.
+class line_ring
+{
+public:
+    void
+    claim()
+    {
+        while (writer.test_and_set(std::memory_order_acquire))
+            writer.wait(true, std::memory_order_relaxed);
+    }
+
+    void
+    release()
+    {
+        writer.clear(std::memory_order_release);
+        writer.notify_one();
+    }
+
+    // Only between claim() and release()
+    void
+    append(const char *data, size_t len)
+    {
+        uint64_t pos = written.load(std::memory_order_relaxed);
+        for (size_t done = 0; done < len; ) {
+            size_t offset = (pos + done) % logring::ring_capacity;
+            size_t n = std::min(len - done, logring::ring_capacity - offset);
+            std::memcpy(bytes.get() + offset, data + done, n);
+            done += n;
+        }
+
+        written.store(pos + len, std::memory_order_release);
+    }
+
+    logring::chunk
+    read(uint64_t cursor) const
+    {
+        logring::chunk out;
+
+        uint64_t end = written.load(std::memory_order_acquire);
+        out.cursor = end;
+
+        // A cursor from a previous helper instance: start over
+        if (cursor > end) {
+            cursor = 0;
+            out.lost = true;
+        }
+
+        uint64_t start = std::max(cursor, oldest_valid(end));
+        if (start >= end)
+            return out;
+
+        std::string copy(end - start, '\0');
+        for (uint64_t done = 0; done < copy.size(); ) {
+            size_t offset = (start + done) % logring::ring_capacity;
+            size_t n = std::min<uint64_t>(copy.size() - done, logring::ring_capacity - offset);
+            std::memcpy(copy.data() + done, bytes.get() + offset, n);
+            done += n;
+        }
+
+        // Did the writer get into what we just copied?
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t valid_from = oldest_valid(written.load(std::memory_order_relaxed));
+        size_t skip = valid_from > start ? static_cast<size_t>(valid_from - start) : 0;
+
+        if (start > cursor || skip > 0) {
+            out.lost = out.lost || cursor > 0 || skip > 0;
+
+            // Resync on the next complete line
+            size_t newline = copy.find('\n', std::min(skip, copy.size()));
+            skip = newline == std::string::npos ? copy.size() : newline + 1;
+        }
+
+        for (size_t pos = skip; pos < copy.size(); ) {
+            size_t newline = copy.find('\n', pos);
+            if (newline == std::string::npos)
+                break;
+            out.lines.emplace_back(copy, pos, newline - pos);
+            pos = newline + 1;
+        }
+
+        return out;
+    }
+
+    uint64_t
+    head() const
+    {
+        return written.load(std::memory_order_acquire);
+    }
+
+    std::atomic_bool keep_files { false };
+
+private:
+    // Oldest position no writer can be overwriting while the end is `end`
+    static uint64_t
+    oldest_valid(uint64_t end)
+    {
+        constexpr uint64_t window = logring::ring_capacity - (logring::max_line_length + 1);
+        return end > window ? end - window : 0;
+    }
+
+    std::unique_ptr<char[]> bytes { new char[logring::ring_capacity] };
+    std::atomic<uint64_t> written { 0 };
+    std::atomic_flag writer = ATOMIC_FLAG_INIT;
+};
+
+std::mutex rings_mutex;
+std::map<std::string, std::shared_ptr<line_ring>> rings; // uuid -> ring
+
+std::shared_ptr<line_ring>
+ring_for(const std::string &uuid, bool create)
+{
+    std::lock_guard<std::mutex> lock(rings_mutex);
+    auto it = rings.find(uuid);
+    if (it != rings.end())
+        return it->second;
+    if (!create)
+        return nullptr;
+    return rings[uuid] = std::make_shared<line_ring>();
+}
+
+// Rotating log file: <uuid>.log while it is small, then gzip-compressed
+// into <uuid>.log.1.gz, shifting older segments up and dropping the last
+class file_sink
+{
+public:
+    explicit file_sink(const std::string &uuid)
+        : path(bk_mgmt::get_log_path(uuid))
+    {
+    }
+
+    void
+    write(const char *data, size_t len)
+    {
+        if (!out.is_open()) {
+            bk_mgmt::ensure_log_dir();
+            out.open(path, std::ios::app | std::ios::binary);
+            std::error_code ec;
+            size = out ? fs::file_size(path, ec) : 0;
+            if (ec) size = 0;
+        }
+        if (!out) return;
+
+        out.write(data, static_cast<std::streamsize>(len));
+        size += len;
+
+        if (size >= logring::file_segment_size)
+            rotate();
+    }
+
+    void
+    close()
+    {
+        if (out.is_open())
+            out.close();
+    }
+
+private:
+    std::string
+    segment(int n) const
+    {
+        return path + "." + std::to_string(n) + ".gz";
+    }
+
+    void
+    rotate()
+    {
+        out.close();
+        std::error_code ec;
+
+        fs::remove(segment(logring::file_segments_kept), ec);
+        for (int n = logring::file_segments_kept - 1; n >= 1; --n)
+            if (fs::exists(segment(n), ec))
+                fs::rename(segment(n), segment(n + 1), ec);
+
+        if (!compress(path, segment(1)))
+            DEBUG_LOG("[logring] cannot compress ", path);
+
+        fs::remove(path, ec);
+        size = 0;
+    }
+
+    static bool
+    compress(const std::string &from, const std::string &to)
+    {
+        std::ifstream in(from, std::ios::binary);
+        gzFile gz = gzopen(to.c_str(), "wb6");
+        if (!in || !gz) {
+            if (gz) gzclose(gz);
+            return false;
+        }
+
+        char buffer[64 * 1024];
+        bool ok = true;
+        while (in.read(buffer, sizeof(buffer)) || in.gcount() > 0) {
+            if (gzwrite(gz, buffer, static_cast<unsigned>(in.gcount())) <= 0) {
+                ok = false;
+                break;
+            }
+        }
+
+        return gzclose(gz) == Z_OK && ok;
+    }
+
+    std::string path;
+    std::ofstream out;
+    uint64_t size = 0;
+};
+
+void
+drain(std::string uuid, int fd, std::shared_ptr<line_ring> ring)
+{
+    ring->claim();
+
+    file_sink files(uuid);
+    std::string pending; // partial line from the last read()
+    char buffer[64 * 1024];
+
+    auto emit_line = [&](std::string line) {
+        if (line.size() > logring::max_line_length)
+            line.resize(logring::max_line_length);
+        line.push_back('\n');
+
+        ring->append(line.data(), line.size());
+
+        if (ring->keep_files.load(std::memory_order_relaxed))
+            files.write(line.data(), line.size());
+        else
+            files.close();
+    };
+
+    for (;;) {
+        ssize_t n = ::read(fd, buffer, sizeof(buffer));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break; // worker closed its end
+
+        pending.append(buffer, static_cast<size_t>(n));
+
+        size_t start = 0;
+        for (size_t newline; (newline = pending.find('\n', start)) != std::string::npos; ) {
+            emit_line(pending.substr(start, newline - start));
+            start = newline + 1;
+        }
+        pending.erase(0, start);
+
+        // A "line" that never ends would grow without bound
+        if (pending.size() > logring::max_line_length) {
+            emit_line(std::move(pending));
+            pending.clear();
+        }
+    }
+
+    if (!pending.empty())
+        emit_line(std::move(pending));
+
+    files.close();
+    ring->release();
+
+    close(fd);
+    DEBUG_LOG("[logring] output of ", uuid, " closed");
+}
+
+} // anonymous namespace
+
+
+void
+logring::capture(const std::string &uuid, int fd)
+{
+    if (fd < 0) return;
+
+    // The ring outlives workers, so cursors keep growing across restarts
+    std::thread(drain, uuid, fd, ring_for(uuid, true)).detach();
+}
+
+void
+logring::keep_files(const std::string &uuid, bool enable)
+{
+    ring_for(uuid, true)->keep_files.store(enable);
+}
+
+logring::chunk
+logring::read(const std::string &uuid, uint64_t cursor)
+{
+    auto ring = ring_for(uuid, false);
+    if (!ring) return {};
+    return ring->read(cursor);
+}
+
+std::vector<std::pair<std::string, uint64_t>>
+logring::heads()
+{
+    std::vector<std::pair<std::string, uint64_t>> result;
+
+    std::lock_guard<std::mutex> lock(rings_mutex);
+    for (const auto &[uuid, ring] : rings)
+        result.emplace_back(uuid, ring->head());
+
+    return result;
+}
@@ -0,0 +1,370 @@
+#include "beekeeper/beesdmgmt.hpp"
+#include "beekeeper/debug.hpp"
+#include "beekeeper/metricsmgmt.hpp"
+#include "beekeeper/tuningmgmt.hpp"
+#include "beekeeper/util.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace metrics = beekeeper::management::metrics;
+
+// Helpers
+namespace {
+
+// Where bees (and beesd) put <uuid>.status unless BEESSTATUS says otherwise
+const std::string status_dir = "/run/bees";
+const std::string status_suffix = ".status";
+
+// One hash table cell: 64-bit hash + 64-bit address
+constexpr uint64_t hash_cell_size = 16;
+
+// bees' crawl position is printed in millionths of the cycle
+constexpr double crawl_point_scale = 1000000.0;
+
+struct cached_status {
+    std::time_t mtime = 0;
+    off_t size = -1;
+    metrics::snapshot data;
+};
+
+std::mutex cache_mutex;
+std::map<std::string, cached_status> cache; // uuid -> last parse
+
+// DB_SIZE of every configured filesystem, for hash_fill. Kept while
+// watch()'s descriptor also watches the config directory and has not seen
+// it change; without that watch (a one-shot CLI) re-read on every use.
+const std::string config_dir = "/etc/bees";
+std::mutex db_sizes_mutex;
+std::map<std::string, uint64_t> db_sizes;   // lowercase uuid -> bytes
+bool db_sizes_valid = false;
+std::atomic_int config_watch { -1 };        // watch descriptor of config_dir
+
+enum class section { none, total, rates, threads, progress };
+
+// "10.707G" -> bytes. bees prints sizes with binary suffixes.
+uint64_t
+parse_size(const std::string &text)
+{
+    size_t used = 0;
+    double value;
+    try {
+        value = bk_util::to_double(text, &used);
+    } catch (...) {
+        return 0;
+    }
+    if (value < 0)
+        return 0;
+
+    switch (used < text.size() ? text[used] : '\0') {
+        case 'K': value *= 1024.0; break;
+        case 'M': value *= 1024.0 * 1024; break;
+        case 'G': value *= 1024.0 * 1024 * 1024; break;
+        case 'T': value *= 1024.0 * 1024 * 1024 * 1024; break;
+        case 'P': value *= 1024.0 * 1024 * 1024 * 1024 * 1024; break;
+        default: break;
+    }
+    return static_cast<uint64_t>(value);
+}
+
+// "key=value key=value ..." into `into`
+void
+parse_counters(const std::string &line, std::map<std::string, double> &into)
+{
+    std::istringstream in(line);
+    for (std::string token; in >> token; ) {
+        auto eq = token.find('=');
+        if (eq == std::string::npos || eq == 0)
+            continue;
+        try {
+            into[token.substr(0, eq)] = bk_util::to_double(std::string_view(token).substr(eq + 1));
+        } catch (...) {
+            into[token.substr(0, eq)] = 0;
+        }
+    }
+}
+
+// One row of the PROGRESS table: extsz datasz point gen_min gen_max ...
+// Returns false for headers, rulers and anything else that is not a row.
+bool
+parse_crawl_row(const std::string &line, metrics::crawl_row &row)
+{
+    std::istringstream in(line);
+    std::string extsz, datasz, point;
+    if (!(in >> extsz >> datasz))
+        return false;
+
+    if (extsz == "extsz" || extsz[0] == '-' || !std::isdigit(static_cast<unsigned char>(datasz[0])))
+        return false;
+
+    row.extent_size = extsz;
+    row.data_size = parse_size(datasz);
+    row.position = -1;
+
+    // "idle", "finished" and the like carry no position; "total" has none either
+    if (in >> point && !point.empty()
+        && std::all_of(point.begin(), point.end(), [](unsigned char c) { return std::isdigit(c); }))
+        row.position = std::min(1.0, bk_util::to_double(point) / crawl_point_scale);
+
+    return true;
+}
+
+double
+counter(const std::map<std::string, double> &counters, const std::string &key)
+{
+    auto it = counters.find(key);
+    return it == counters.end() ? 0 : it->second;
+}
+
+uint64_t
+configured_db_size(const std::string &uuid)
+{
+    std::lock_guard<std::mutex> lock(db_sizes_mutex);
+    if (!db_sizes_valid) {
+        db_sizes = beekeeper::management::tuning::configured_db_sizes();
+        db_sizes_valid = config_watch >= 0;
+    }
+
+    auto it = db_sizes.find(bk_util::to_lower(uuid));
+    return it == db_sizes.end() ? 0 : it->second;
+}
+
+void
+forget_db_sizes()
+{
+    std::lock_guard<std::mutex> lock(db_sizes_mutex);
+    db_sizes_valid = false;
+}
+
+// Parse the file at `path` if it changed since the cached copy
+metrics::snapshot
+reload(const std::string &uuid, const std::string &path, bool force)
+{
+    struct stat st {};
+    if (stat(path.c_str(), &st) < 0) {
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        cache.erase(uuid);
+        return {};
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        auto it = cache.find(uuid);
+        if (!force && it != cache.end()
+            && it->second.mtime == st.st_mtime && it->second.size == st.st_size)
+            return it->second.data;
+    }
+
+    std::ifstream in(path);
+    if (!in) {
+        DEBUG_LOG("[metrics] cannot read ", path);
+        return {};
+    }
+
+    std::ostringstream text;
+    text << in.rdbuf();
+
+    metrics::snapshot data = metrics::parse(text.str(), configured_db_size(uuid));
+    data.updated = st.st_mtime;
+
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    cache[uuid] = { st.st_mtime, st.st_size, data };
+    return data;
+}
+
+} // anonymous namespace
+
+
+/**
+ * @brief Turn the text of a bees status file into typed metrics.
+ *
+ * Rates come straight from the RATES section. Crawl progress averages the
+ * per size class positions weighted by how much data each class holds.
+ * bees does not report hash table occupancy, so it is estimated from the
+ * insert/erase/evict counters since the worker started; after a restart
+ * that is a lower bound until the table has turned over.
+ *
+ * @param text Contents of the status file.
+ * @param db_size Hash table size in bytes, 0 if unknown.
+ */
+metrics::snapshot
+metrics::parse(std::string_view text, uint64_t db_size)
+{
+    snapshot data;
+    section current = section::none;
+
+    std::istringstream in { std::string(text) };
+    for (std::string line; std::getline(in, line); ) {
+        if (line.empty())
+            continue;
+
+        // Section headers start at column 0, their contents are indented
+        // (PROGRESS rows are right-aligned and may not be, so that section
+        // is only left at the next known header)
+        if (!std::isspace(static_cast<unsigned char>(line[0]))) {
+            section next = section::none;
+            if (line.rfind("TOTAL:", 0) == 0)          next = section::total;
+            else if (line.rfind("RATES:", 0) == 0)     next = section::rates;
+            else if (line.rfind("THREADS", 0) == 0)    next = section::threads;
+            else if (line.rfind("PROGRESS:", 0) == 0)  next = section::progress;
+
+            if (next != section::none) {
+                current = next;
+                data.available = true;
+
+                // Counters may follow the header on the same line
+                auto colon = line.find(':');
+                if (colon != std::string::npos)
+                    line = line.substr(colon + 1);
+                else
+                    continue;
+            } else if (current != section::progress) {
+                current = section::none;
+                continue;
+            }
+        }
+
+        switch (current) {
+            case section::total:
+                parse_counters(line, data.totals);
+                break;
+            case section::rates:
+                parse_counters(line, data.rates);
+                break;
+            case section::progress: {
+                crawl_row row;
+                if (parse_crawl_row(line, row))
+                    data.crawl.push_back(std::move(row));
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    data.dedup_bytes_per_sec = counter(data.rates, "dedup_bytes");
+    data.dedup_bytes = static_cast<uint64_t>(counter(data.totals, "dedup_bytes"));
+    data.extents_scanned = static_cast<uint64_t>(counter(data.totals, "scan_extent"));
+
+    // Older bees only count 4 KiB blocks
+    data.scanned_bytes_per_sec = data.rates.count("scan_bytes")
+        ? counter(data.rates, "scan_bytes")
+        : counter(data.rates, "scan_block") * 4096.0;
+
+    double weighted = 0, weight = 0;
+    for (const auto &row : data.crawl) {
+        if (row.extent_size == "total" || row.position < 0)
+            continue;
+        weighted += row.position * static_cast<double>(row.data_size);
+        weight += static_cast<double>(row.data_size);
+    }
+    if (weight > 0)
+        data.crawl_progress = weighted / weight;
+
+    if (db_size >= hash_cell_size && !data.totals.empty()) {
+        double cells = counter(data.totals, "hash_insert")
+                     - counter(data.totals, "hash_erase")
+                     - counter(data.totals, "hash_evict");
+        data.hash_fill = std::clamp(cells * hash_cell_size / static_cast<double>(db_size), 0.0, 1.0);
+    }
+
+    return data;
+}
+
+metrics::snapshot
+metrics::read(const std::string &uuid)
+{
+    return reload(uuid, bk_mgmt::bees_status_path(uuid), false);
+}
+
+int
+metrics::watch()
+{
+    const std::string dir = bk_util::system_path(status_dir);
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+
+    int fd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+    if (fd < 0) {
+        DEBUG_LOG("[metrics] inotify_init1 failed: ", strerror(errno));
+        return -1;
+    }
+
+    // bees writes <uuid>.status.tmp and renames it over the old file
+    if (inotify_add_watch(fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        DEBUG_LOG("[metrics] cannot watch ", dir, ": ", strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    // Configs coming, going or rewritten change the DB_SIZE we divide by
+    const std::string configs = bk_util::system_path(config_dir);
+    config_watch = inotify_add_watch(fd, configs.c_str(),
+                                     IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE);
+    if (config_watch < 0)
+        DEBUG_LOG("[metrics] cannot watch ", configs, ", re-reading DB_SIZE on every parse");
+    forget_db_sizes();
+
+    return fd;
+}
+
+std::vector<std::string>
+metrics::changed(int fd)
+{
+    std::vector<std::string> uuids;
+    alignas(inotify_event) char buffer[4096];
+
+    for (;;) {
+        ssize_t len = ::read(fd, buffer, sizeof(buffer));
+        if (len <= 0)
+            break; // EAGAIN: nothing left
+
+        for (ssize_t offset = 0; offset < len; ) {
+            auto *ev = reinterpret_cast<inotify_event *>(buffer + offset);
+            offset += static_cast<ssize_t>(sizeof(inotify_event) + ev->len);
+
+            if (ev->mask & IN_Q_OVERFLOW) {
+                // Lost track: every file gets re-read on its next stat() mismatch
+                forget_db_sizes();
+                std::lock_guard<std::mutex> lock(cache_mutex);
+                cache.clear();
+                continue;
+            }
+
+            if (ev->wd == config_watch) {
+                // IN_IGNORED: the directory itself is gone, stop trusting the cache
+                if (ev->mask & IN_IGNORED)
+                    config_watch = -1;
+                forget_db_sizes();
+                continue;
+            }
+            if (!ev->len)
+                continue;
+
+            std::string name(ev->name);
+            if (name.size() <= status_suffix.size()
+                || name.compare(name.size() - status_suffix.size(), status_suffix.size(), status_suffix) != 0)
+                continue;
+
+            std::string uuid = name.substr(0, name.size() - status_suffix.size());
+            if (std::find(uuids.begin(), uuids.end(), uuid) == uuids.end())
+                uuids.push_back(uuid);
+        }
+    }
+
+    for (const auto &uuid : uuids)
+        reload(uuid, bk_util::system_path(status_dir) + "/" + uuid + status_suffix, true);
+
+    return uuids;
+}
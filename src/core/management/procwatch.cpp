@@ -0,0 +1,261 @@
+#include "beekeeper/btrfsetup.hpp"
+#include "beekeeper/debug.hpp"
+#include "beekeeper/procwatchmgmt.hpp"
+#include "beekeeper/timingsmgmt.hpp"
+#include "beekeeper/util.hpp"
+
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <linux/cn_proc.h>
+#include <linux/connector.h>
+#include <linux/netlink.h>
+#include <map>
+#include <mutex>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace pw = beekeeper::management::procwatch;
+namespace timings = beekeeper::management::timings;
+
+// Helpers
+namespace {
+
+const std::string bees_mount_prefix = "/run/bees/mnt/";
+
+std::mutex table_mutex;
+std::map<pid_t, std::string> workers; // pid -> uuid
+std::atomic_bool live { false };
+
+// Is argv[0] bees? Test builds also take the stand-in the launcher runs
+// instead ($BEEKEEPER_BEES, see find_bees_binary())
+bool
+is_bees(const std::string &argv0)
+{
+#ifdef BEEKEEPER_TEST_HOOKS
+    if (const char *stand_in = std::getenv("BEEKEEPER_BEES"); stand_in && argv0 == stand_in)
+        return true;
+#endif
+    return std::filesystem::path(argv0).filename() == "bees";
+}
+
+// UUID of the filesystem a bees process works on, "" if it is not bees.
+// bees takes the filesystem as its last argument; beesd hands it the
+// private mount under /run/bees/mnt/<uuid>.
+std::string
+identify(pid_t pid)
+{
+    std::ifstream in(bk_util::system_path("/proc/" + std::to_string(pid) + "/cmdline"), std::ios::binary);
+    if (!in) return "";
+
+    // NUL-separated argv
+    std::vector<std::string> args;
+    for (std::string arg; std::getline(in, arg, '\0'); )
+        args.push_back(arg);
+
+    if (args.size() < 2 || !is_bees(args.front()))
+        return "";
+
+    const std::string &target = args.back();
+    const std::string prefix = bk_util::system_path(bees_mount_prefix);
+    if (target.rfind(prefix, 0) == 0)
+        return target.substr(prefix.size());
+
+    return bk_mgmt::get_mount_uuid(target);
+}
+
+bool
+send_listen(int fd, proc_cn_mcast_op op)
+{
+    constexpr size_t size = NLMSG_LENGTH(sizeof(cn_msg) + sizeof(proc_cn_mcast_op));
+    alignas(nlmsghdr) char request[size] {};
+
+    auto *header = reinterpret_cast<nlmsghdr *>(request);
+    header->nlmsg_len = size;
+    header->nlmsg_type = NLMSG_DONE;
+    header->nlmsg_pid = static_cast<__u32>(getpid());
+
+    auto *message = static_cast<cn_msg *>(NLMSG_DATA(header));
+    message->id.idx = CN_IDX_PROC;
+    message->id.val = CN_VAL_PROC;
+    message->len = sizeof(proc_cn_mcast_op);
+    std::memcpy(message->data, &op, sizeof(op));
+
+    return send(fd, request, size, 0) == static_cast<ssize_t>(size);
+}
+
+} // anonymous namespace
+
+
+int
+pw::subscribe()
+{
+    int fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_CONNECTOR);
+    if (fd < 0) {
+        DEBUG_LOG("[procwatch] socket failed: ", strerror(errno));
+        return -1;
+    }
+
+    sockaddr_nl addr {};
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = CN_IDX_PROC;
+    addr.nl_pid = 0; // let the kernel pick
+
+    if (bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0
+        || !send_listen(fd, PROC_CN_MCAST_LISTEN)) {
+        DEBUG_LOG("[procwatch] cannot subscribe to process events: ", strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    // Whatever starts from now on is caught; seed() covers the rest
+    seed();
+    live.store(true);
+
+    DEBUG_LOG("[procwatch] listening to process events");
+    return fd;
+}
+
+void
+pw::unsubscribe(int fd)
+{
+    live.store(false);
+    if (fd < 0) return;
+
+    send_listen(fd, PROC_CN_MCAST_IGNORE);
+    close(fd);
+}
+
+std::vector<pw::event>
+pw::seed()
+{
+    std::map<pid_t, std::string> found;
+    std::error_code ec;
+
+    timings::scoped_timer timer(timings::family::proc_scan, "procwatch_seed");
+
+    for (const auto &entry : std::filesystem::directory_iterator(bk_util::system_path("/proc"), ec)) {
+        const std::string name = entry.path().filename().string();
+        if (name.empty() || !std::isdigit(static_cast<unsigned char>(name[0])))
+            continue;
+
+        pid_t pid = static_cast<pid_t>(std::stol(name));
+        std::string uuid = identify(pid);
+        if (!uuid.empty())
+            found.emplace(pid, uuid);
+    }
+
+    std::vector<event> changes;
+    std::lock_guard<std::mutex> lock(table_mutex);
+
+    // Workers that exited or exec'd into something else while we weren't listening
+    for (const auto &[pid, uuid] : workers) {
+        auto it = found.find(pid);
+        if (it == found.end() || it->second != uuid) {
+            DEBUG_LOG("[procwatch] bees ", pid, " for ", uuid, " is gone");
+            changes.push_back({ uuid, pid, false });
+        }
+    }
+
+    for (const auto &[pid, uuid] : found) {
+        auto it = workers.find(pid);
+        if (it == workers.end() || it->second != uuid) {
+            DEBUG_LOG("[procwatch] bees ", pid, " for ", uuid, " found");
+            changes.push_back({ uuid, pid, true });
+        }
+    }
+
+    workers = std::move(found);
+    return changes;
+}
+
+std::vector<pw::event>
+pw::drain(int fd)
+{
+    std::vector<event> changes;
+    alignas(nlmsghdr) char buffer[8192];
+
+    for (;;) {
+        ssize_t len = recv(fd, buffer, sizeof(buffer), 0);
+
+        if (len < 0) {
+            // The kernel dropped events for us: start over from /proc
+            if (errno == ENOBUFS) {
+                DEBUG_LOG("[procwatch] event queue overflowed, rescanning /proc");
+                auto missed = seed();
+                changes.insert(changes.end(), missed.begin(), missed.end());
+                continue;
+            }
+            break; // EAGAIN: nothing left
+        }
+
+        for (auto *nl = reinterpret_cast<nlmsghdr *>(buffer);
+             NLMSG_OK(nl, static_cast<unsigned int>(len));
+             nl = NLMSG_NEXT(nl, len)) {
+
+            auto *cn = static_cast<cn_msg *>(NLMSG_DATA(nl));
+            if (cn->id.idx != CN_IDX_PROC || cn->id.val != CN_VAL_PROC)
+                continue;
+
+            auto *ev = reinterpret_cast<proc_event *>(cn->data);
+
+            if (ev->what == proc_event::PROC_EVENT_EXEC) {
+                pid_t pid = ev->event_data.exec.process_tgid;
+                std::string uuid = identify(pid);
+
+                std::lock_guard<std::mutex> lock(table_mutex);
+                auto it = workers.find(pid);
+
+                // exec() into something else: the worker is gone all the same
+                if (it != workers.end() && it->second != uuid) {
+                    DEBUG_LOG("[procwatch] bees ", pid, " for ", it->second, " exec'd away");
+                    changes.push_back({ it->second, pid, false });
+                    workers.erase(it);
+                }
+
+                if (!uuid.empty()) {
+                    DEBUG_LOG("[procwatch] bees ", pid, " for ", uuid, " started");
+                    workers[pid] = uuid;
+                    changes.push_back({ uuid, pid, true });
+                }
+
+            } else if (ev->what == proc_event::PROC_EVENT_EXIT) {
+                // Sent for every thread; only the thread group leader ends the process
+                if (ev->event_data.exit.process_pid != ev->event_data.exit.process_tgid)
+                    continue;
+
+                pid_t pid = ev->event_data.exit.process_tgid;
+
+                std::lock_guard<std::mutex> lock(table_mutex);
+                auto it = workers.find(pid);
+                if (it != workers.end()) {
+                    DEBUG_LOG("[procwatch] bees ", pid, " for ", it->second, " exited");
+                    changes.push_back({ it->second, pid, false });
+                    workers.erase(it);
+                }
+            }
+        }
+    }
+
+    return changes;
+}
+
+bool
+pw::is_live()
+{
+    return live.load();
+}
+
+pid_t
+pw::worker_for(const std::string &uuid)
+{
+    std::lock_guard<std::mutex> lock(table_mutex);
+    for (const auto &[pid, worker_uuid] : workers)
+        if (bk_util::compare_strings_case_insensitive(worker_uuid, uuid))
+            return pid;
+    return 0;
+}
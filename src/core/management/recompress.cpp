@@ -0,0 +1,726 @@
+#include "beekeeper/btrfsetup.hpp"
+#include "beekeeper/debug.hpp"
+#include "beekeeper/fswalkmgmt.hpp"
+#include "beekeeper/recompressmgmt.hpp"
+#include "beekeeper/transparentcompressionmgmt.hpp"
+#include "beekeeper/util.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <dirent.h>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <linux/btrfs.h>
+#include <linux/fiemap.h>
+#include <linux/fs.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/xattr.h>
+#include <thread>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+namespace rc = beekeeper::management::recompress;
+namespace tc = beekeeper::management::transparentcompression;
+
+// Newer kernels take a level with the algorithm (6.15+)
+#ifndef BTRFS_DEFRAG_RANGE_LEVEL
+#define BTRFS_DEFRAG_RANGE_LEVEL 4
+#endif
+
+// Helpers
+namespace {
+
+// Rewrite at most this much per ioctl, so throttling and pausing stay responsive
+constexpr uint64_t max_chunk = 8ULL * 1024 * 1024;
+
+// Files handed from the walker to the rewriters
+constexpr size_t queue_capacity = 256;
+
+constexpr auto checkpoint_interval = std::chrono::seconds(5);
+constexpr auto busy_poll = std::chrono::seconds(5);
+
+// FIEMAP extents that cannot or should not be rewritten compressed
+constexpr uint32_t skipped_extent_flags = FIEMAP_EXTENT_ENCODED | FIEMAP_EXTENT_SHARED
+                                        | FIEMAP_EXTENT_DATA_INLINE | FIEMAP_EXTENT_UNKNOWN
+                                        | FIEMAP_EXTENT_DELALLOC | FIEMAP_EXTENT_UNWRITTEN;
+
+// btrfs_compression_type, which the uapi headers do not export
+uint32_t
+compress_type(const std::string &algorithm)
+{
+    if (algorithm == "zlib") return 1;
+    if (algorithm == "lzo") return 2;
+    if (algorithm == "zstd") return 3;
+    return 0;
+}
+
+// ----- state file -----
+
+bool
+write_state(const rc::progress &p)
+{
+    std::error_code ec;
+    fs::create_directories(bk_util::system_path(rc::state_dir), ec);
+
+    const std::string path = rc::state_path(p.uuid);
+    const std::string tmp = path + ".tmp";
+
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        if (!out) return false;
+
+        out << "state=" << p.state << '\n'
+            << "algorithm=" << p.algorithm << '\n'
+            << "level=" << p.level << '\n'
+            << "bytes_per_sec=" << p.rate.bytes_per_sec << '\n'
+            << "ops_per_sec=" << p.rate.ops_per_sec << '\n'
+            << "max_load_per_core=" << p.rate.max_load_per_core << '\n'
+            << "threads=" << p.rate.threads << '\n'
+            << "resume_after=" << p.resume_after << '\n'
+            << "bytes_total=" << p.bytes_total << '\n'
+            << "bytes_visited=" << p.bytes_visited << '\n'
+            << "bytes_rewritten=" << p.bytes_rewritten << '\n'
+            << "bytes_skipped=" << p.bytes_skipped << '\n'
+            << "files_done=" << p.files_done << '\n'
+            << "files_skipped=" << p.files_skipped << '\n'
+            << "errors=" << p.errors << '\n'
+            << "started=" << p.started << '\n'
+            << "updated=" << p.updated << '\n';
+        if (!out) return false;
+    }
+
+    chmod(tmp.c_str(), 0644);
+    return std::rename(tmp.c_str(), path.c_str()) == 0;
+}
+
+rc::progress
+read_state(const std::string &uuid)
+{
+    rc::progress p;
+    p.uuid = uuid;
+
+    std::ifstream in(rc::state_path(uuid));
+    std::string line;
+    while (std::getline(in, line)) {
+        auto eq = line.find('=');
+        if (eq == std::string::npos) continue;
+        std::string key = line.substr(0, eq);
+        std::string value = line.substr(eq + 1);
+
+        try {
+            if (key == "state") p.state = value;
+            else if (key == "algorithm") p.algorithm = value;
+            else if (key == "level") p.level = std::stoi(value);
+            else if (key == "bytes_per_sec") p.rate.bytes_per_sec = bk_util::to_double(value);
+            else if (key == "ops_per_sec") p.rate.ops_per_sec = bk_util::to_double(value);
+            else if (key == "max_load_per_core") p.rate.max_load_per_core = bk_util::to_double(value);
+            else if (key == "threads") p.rate.threads = static_cast<unsigned>(std::stoul(value));
+            else if (key == "resume_after") p.resume_after = value;
+            else if (key == "bytes_total") p.bytes_total = std::stoull(value);
+            else if (key == "bytes_visited") p.bytes_visited = std::stoull(value);
+            else if (key == "bytes_rewritten") p.bytes_rewritten = std::stoull(value);
+            else if (key == "bytes_skipped") p.bytes_skipped = std::stoull(value);
+            else if (key == "files_done") p.files_done = std::stoull(value);
+            else if (key == "files_skipped") p.files_skipped = std::stoull(value);
+            else if (key == "errors") p.errors = std::stoull(value);
+            else if (key == "started") p.started = static_cast<std::time_t>(std::stoll(value));
+            else if (key == "updated") p.updated = static_cast<std::time_t>(std::stoll(value));
+        } catch (...) {
+            DEBUG_LOG("[recompress] bad value in state file: ", line);
+        }
+    }
+
+    return p;
+}
+
+// ----- throttling -----
+
+// Tokens go into debt; whoever takes them sleeps the debt off
+class token_bucket
+{
+public:
+    explicit token_bucket(double rate) : m_rate(rate), m_tokens(rate) {}
+
+    // Seconds to wait before using `n` tokens
+    double
+    take(double n)
+    {
+        if (m_rate <= 0) return 0; // unlimited
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto now = std::chrono::steady_clock::now();
+        double elapsed = std::chrono::duration<double>(now - m_last).count();
+        m_last = now;
+
+        m_tokens = std::min(m_rate, m_tokens + elapsed * m_rate); // at most a second's worth of burst
+        m_tokens -= n;
+        return m_tokens < 0 ? -m_tokens / m_rate : 0;
+    }
+
+private:
+    std::mutex m_mutex;
+    double m_rate;
+    double m_tokens;
+    std::chrono::steady_clock::time_point m_last = std::chrono::steady_clock::now();
+};
+
+bool
+machine_busy(double max_load_per_core)
+{
+    if (max_load_per_core <= 0) return false;
+
+    double load = 0;
+    std::ifstream(bk_util::system_path("/proc/loadavg")) >> load;
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    return load / cores > max_load_per_core;
+}
+
+// Does `a` (a directory) contain `b`?
+bool
+is_ancestor(const fs::path &a, const fs::path &b)
+{
+    auto [ai, bi] = std::mismatch(a.begin(), a.end(), b.begin(), b.end());
+    return ai == a.end() && bi != b.end();
+}
+
+// ----- a running job -----
+
+struct job
+{
+    rc::progress p;                 // guarded by mutex
+    std::mutex mutex;
+
+    std::string mount;
+    std::string resume_from;        // checkpoint the walk started from
+    uint32_t type = 0;
+    std::atomic_bool with_level { true };
+    std::atomic_bool stop { false };
+
+    token_bucket bytes;
+    token_bucket ops;
+
+    // Walk order window: files handed out and not all done yet, oldest first
+    std::deque<std::pair<std::string, bool>> window;
+    uint64_t window_front = 0;      // sequence number of window.front()
+    uint64_t next_seq = 0;
+
+    // Walker -> rewriters
+    std::mutex queue_mutex;
+    std::condition_variable queue_changed;
+    std::deque<std::pair<uint64_t, std::string>> queue;
+    bool walk_over = false;
+
+    std::chrono::steady_clock::time_point last_checkpoint = std::chrono::steady_clock::now();
+    std::thread controller;
+
+    explicit job(const rc::progress &from)
+        : p(from), resume_from(from.resume_after),
+          bytes(from.rate.bytes_per_sec), ops(from.rate.ops_per_sec) {}
+
+    // A joinable controller would terminate the process, e.g. when the
+    // job table is destroyed at exit
+    ~job() { halt(); }
+
+    // Sleep in slices; false if stopped meanwhile
+    bool
+    nap(std::chrono::duration<double> d)
+    {
+        auto until = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(d);
+        while (!stop && std::chrono::steady_clock::now() < until)
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        return !stop;
+    }
+
+    void
+    set_state(const std::string &state)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (p.state != state) {
+            p.state = state;
+            p.updated = std::time(nullptr);
+            write_state(p);
+        }
+    }
+
+    // Throttle, and wait out a busy machine. False if stopped.
+    bool
+    wait_for_turn(uint64_t len)
+    {
+        if (machine_busy(p.rate.max_load_per_core)) {
+            set_state("waiting");
+            while (machine_busy(p.rate.max_load_per_core))
+                if (!nap(busy_poll)) return false;
+            set_state("running");
+        }
+
+        double wait = std::max(bytes.take(static_cast<double>(len)), ops.take(1));
+        return wait <= 0 || nap(std::chrono::duration<double>(wait));
+    }
+
+    // Rewrite one range compressed. False on error.
+    bool
+    rewrite(int fd, uint64_t start, uint64_t len)
+    {
+        btrfs_ioctl_defrag_range_args args {};
+        args.start = start;
+        args.len = len;
+        args.flags = BTRFS_DEFRAG_RANGE_COMPRESS | BTRFS_DEFRAG_RANGE_START_IO;
+        args.compress_type = type;
+
+        // The level goes in the byte after the type (compress.level in newer headers)
+        if (p.level != 0 && with_level) {
+            args.flags |= BTRFS_DEFRAG_RANGE_LEVEL;
+            args.compress_type = type | (static_cast<uint32_t>(static_cast<uint8_t>(p.level)) << 8);
+        }
+
+        if (ioctl(fd, BTRFS_IOC_DEFRAG_RANGE, &args) == 0)
+            return true;
+
+        if ((errno == EOPNOTSUPP || errno == EINVAL) && (args.flags & BTRFS_DEFRAG_RANGE_LEVEL)) {
+            DEBUG_LOG("[recompress] kernel takes no compression level, using the default one");
+            with_level = false;
+            return rewrite(fd, start, len);
+        }
+
+        DEBUG_LOG("[recompress] defrag failed at ", start, ": ", strerror(errno));
+        return false;
+    }
+
+    // Rewrite the uncompressed, unshared extents of one file
+    void
+    process(const std::string &relative)
+    {
+        const std::string path = mount + "/" + relative;
+        uint64_t rewritten = 0, skipped = 0, size = 0;
+        bool skip_file = false, failed = false;
+
+        int fd = open(path.c_str(), O_RDONLY | O_NOFOLLOW | O_CLOEXEC | O_NOATIME);
+        if (fd < 0 && errno == EPERM)
+            fd = open(path.c_str(), O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+        if (fd < 0) {
+            // Deleted since the walk: nothing to do
+            std::lock_guard<std::mutex> lock(mutex);
+            if (errno != ENOENT) ++p.errors;
+            return;
+        }
+
+        struct stat st {};
+        int flags = 0;
+        char prop[16] = {};
+        ssize_t prop_len = fgetxattr(fd, "btrfs.compression", prop, sizeof(prop) - 1);
+
+        if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)) {
+            close(fd);
+            return;
+        }
+        size = static_cast<uint64_t>(st.st_size);
+
+        if (ioctl(fd, FS_IOC_GETFLAGS, &flags) == 0 && (flags & (FS_NOCOMP_FL | FS_NOCOW_FL)))
+            skip_file = true;
+        if (prop_len > 0 && (std::strcmp(prop, "none") == 0 || std::strcmp(prop, "no") == 0))
+            skip_file = true;
+
+        if (!skip_file) {
+            constexpr unsigned batch = 64;
+            std::vector<char> buffer(sizeof(fiemap) + batch * sizeof(fiemap_extent));
+            auto *map = reinterpret_cast<fiemap *>(buffer.data());
+
+            // Contiguous runs of rewritable extents, merged across FIEMAP batches
+            uint64_t run_start = 0, run_len = 0;
+            auto flush_run = [&]() {
+                for (uint64_t off = 0; off < run_len && !failed && !stop; off += max_chunk) {
+                    uint64_t len = std::min(max_chunk, run_len - off);
+                    if (!wait_for_turn(len)) return;
+                    if (rewrite(fd, run_start + off, len)) rewritten += len;
+                    else failed = true;
+                }
+                run_len = 0;
+            };
+
+            uint64_t next = 0;
+            bool last = false;
+            while (!last && !failed && !stop) {
+                std::memset(map, 0, sizeof(fiemap));
+                map->fm_start = next;
+                map->fm_length = FIEMAP_MAX_OFFSET - next;
+                map->fm_extent_count = batch;
+
+                if (ioctl(fd, FS_IOC_FIEMAP, map) < 0) {
+                    failed = true;
+                    break;
+                }
+                if (map->fm_mapped_extents == 0)
+                    break;
+
+                for (unsigned i = 0; i < map->fm_mapped_extents && !failed && !stop; ++i) {
+                    const fiemap_extent &fe = map->fm_extents[i];
+                    last = fe.fe_flags & FIEMAP_EXTENT_LAST;
+                    next = fe.fe_logical + fe.fe_length;
+
+                    if (fe.fe_flags & skipped_extent_flags) {
+                        skipped += fe.fe_length;
+                        flush_run();
+                        continue;
+                    }
+
+                    if (run_len && fe.fe_logical != run_start + run_len)
+                        flush_run();
+                    if (!run_len)
+                        run_start = fe.fe_logical;
+                    run_len += fe.fe_length;
+                }
+            }
+            if (!failed && !stop)
+                flush_run();
+        }
+
+        close(fd);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        p.bytes_rewritten += rewritten;
+        p.bytes_skipped += skipped;
+        if (stop) return; // not finished: stays before the checkpoint
+        p.bytes_visited += size;
+        if (failed) ++p.errors;
+        else if (skip_file) ++p.files_skipped;
+        else ++p.files_done;
+    }
+
+    // Mark a file done and move the checkpoint over every finished prefix
+    void
+    finish(uint64_t seq)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        window[seq - window_front].second = true;
+        while (!window.empty() && window.front().second) {
+            p.resume_after = std::move(window.front().first);
+            window.pop_front();
+            ++window_front;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_checkpoint >= checkpoint_interval) {
+            last_checkpoint = now;
+            p.updated = std::time(nullptr);
+            write_state(p);
+        }
+    }
+
+    void
+    rewriter()
+    {
+        for (;;) {
+            std::pair<uint64_t, std::string> item;
+            {
+                std::unique_lock<std::mutex> lock(queue_mutex);
+                queue_changed.wait(lock, [&] { return !queue.empty() || walk_over || stop; });
+                if (stop || queue.empty()) return;
+                item = std::move(queue.front());
+                queue.pop_front();
+            }
+            queue_changed.notify_all();
+
+            process(item.second);
+            if (stop) return;
+            finish(item.first);
+        }
+    }
+
+    // False if stopped
+    bool
+    hand_out(const std::string &relative)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            window.emplace_back(relative, false);
+        }
+
+        std::unique_lock<std::mutex> lock(queue_mutex);
+        queue_changed.wait(lock, [&] { return queue.size() < queue_capacity || stop; });
+        if (stop) return false;
+        queue.emplace_back(next_seq++, relative);
+        queue_changed.notify_all();
+        return true;
+    }
+
+    // Depth first in name order, so a path is enough to resume from.
+    // Subvolumes are entered; other filesystems mounted inside are not.
+    bool
+    walk(const std::string &relative, bk_mgmt::fswalk::filesystem_filter &filter)
+    {
+        const std::string path = relative.empty() ? mount : mount + "/" + relative;
+        DIR *dir = opendir(path.c_str());
+        if (!dir) return true;
+
+        std::vector<std::string> names;
+        while (dirent *e = readdir(dir))
+            if (std::strcmp(e->d_name, ".") != 0 && std::strcmp(e->d_name, "..") != 0)
+                names.emplace_back(e->d_name);
+        int dir_fd = dirfd(dir);
+        std::sort(names.begin(), names.end());
+
+        const fs::path resume_after = resume_from;
+        bool go_on = true;
+
+        for (const auto &name : names) {
+            if (stop) { go_on = false; break; }
+
+            struct stat st {};
+            if (fstatat(dir_fd, name.c_str(), &st, AT_SYMLINK_NOFOLLOW) < 0)
+                continue;
+
+            std::string child = relative.empty() ? name : relative + "/" + name;
+            const fs::path child_path = child;
+
+            if (S_ISDIR(st.st_mode)) {
+                // Entirely before the checkpoint: done already
+                if (!resume_after.empty() && child_path < resume_after && !is_ancestor(child_path, resume_after))
+                    continue;
+
+                if (!filter.contains(dir_fd, name.c_str(), st.st_dev))
+                    continue;
+
+                if (!walk(child, filter)) { go_on = false; break; }
+            } else if (S_ISREG(st.st_mode)) {
+                if (!resume_after.empty() && child_path <= resume_after)
+                    continue;
+                if (!hand_out(child)) { go_on = false; break; }
+            }
+        }
+
+        closedir(dir);
+        return go_on;
+    }
+
+    void
+    run()
+    {
+        DEBUG_LOG("[recompress] ", p.uuid, ": recompressing ", mount, " with ", p.algorithm,
+                  resume_from.empty() ? std::string() : ", resuming after " + resume_from);
+
+        std::vector<std::thread> pool;
+        for (unsigned i = 0; i < std::max(1u, p.rate.threads); ++i)
+            pool.emplace_back(&job::rewriter, this);
+
+        bk_mgmt::fswalk::filesystem_filter filter;
+        bool on_btrfs = filter.add_root(mount);
+        bool walked = on_btrfs && walk("", filter);
+
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            walk_over = true;
+        }
+        queue_changed.notify_all();
+        for (auto &t : pool)
+            t.join();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!stop) {
+            p.state = on_btrfs && walked ? "done" : "failed";
+            if (p.state == "done") p.resume_after.clear();
+        }
+        p.updated = std::time(nullptr);
+        write_state(p);
+
+        DEBUG_LOG("[recompress] ", p.uuid, ": ", p.state, ", ", p.bytes_rewritten, " bytes rewritten");
+    }
+
+    // Stop and wait for every thread (state is written by the caller)
+    void
+    halt()
+    {
+        stop = true;
+        queue_changed.notify_all();
+        if (controller.joinable())
+            controller.join();
+    }
+};
+
+std::mutex jobs_mutex;
+std::map<std::string, std::unique_ptr<job>> jobs; // lowercase uuid -> job
+
+// Join the threads of jobs that are done or failed. Caller holds jobs_mutex.
+void
+reap_finished()
+{
+    for (auto it = jobs.begin(); it != jobs.end(); ) {
+        bool finished;
+        {
+            std::lock_guard<std::mutex> job_lock(it->second->mutex);
+            finished = it->second->p.state == "done" || it->second->p.state == "failed";
+        }
+        it = finished ? jobs.erase(it) : std::next(it);
+    }
+}
+
+} // anonymous namespace
+
+
+std::string
+rc::state_path(const std::string &uuid)
+{
+    return bk_util::system_path(state_dir) + bk_util::to_lower(uuid) + ".state";
+}
+
+/**
+ * @brief Start or resume recompressing a filesystem in the background.
+ *
+ * A checkpoint of an unfinished job with the same algorithm and level is
+ * resumed from where it stopped; otherwise the walk starts over. The job
+ * runs on its own threads in this process until it is done, paused or
+ * cancelled.
+ *
+ * @param uuid Filesystem UUID; it must be mounted and have a
+ *             transparent compression setting.
+ * @param rate Throttling and thread count.
+ */
+bool
+rc::start(const std::string &uuid, const limits &rate)
+{
+    auto [algorithm, level] = tc::configured_compression(uuid);
+    if (compress_type(algorithm) == 0) {
+        DEBUG_LOG("[recompress] ", uuid, " has no transparent compression setting");
+        return false;
+    }
+
+    auto mounts = bk_mgmt::get_mount_paths(uuid);
+    if (mounts.empty()) {
+        DEBUG_LOG("[recompress] ", uuid, " is not mounted");
+        return false;
+    }
+
+    const std::string key = bk_util::to_lower(uuid);
+    std::lock_guard<std::mutex> lock(jobs_mutex);
+
+    auto it = jobs.find(key);
+    if (it != jobs.end()) {
+        std::string state;
+        {
+            std::lock_guard<std::mutex> job_lock(it->second->mutex);
+            state = it->second->p.state;
+        }
+        if (state == "running" || state == "waiting")
+            return true;
+        it->second->halt(); // finished: reap its threads
+        jobs.erase(it);
+    }
+
+    progress p = read_state(uuid);
+    bool resumable = (p.state == "running" || p.state == "waiting" || p.state == "paused")
+                  && p.algorithm == algorithm && p.level == level;
+    if (!resumable) {
+        p = progress {};
+        p.uuid = uuid;
+        p.algorithm = algorithm;
+        p.level = level;
+        p.started = std::time(nullptr);
+
+        unsigned long long used = bk_mgmt::get_space::used(uuid);
+        p.bytes_total = used == static_cast<unsigned long long>(-1) ? 0 : used;
+    }
+    p.rate = rate;
+    p.state = "running";
+    p.updated = std::time(nullptr);
+    write_state(p);
+
+    auto j = std::make_unique<job>(p);
+    j->mount = mounts.front();
+    j->type = compress_type(algorithm);
+    j->controller = std::thread(&job::run, j.get());
+    jobs.emplace(key, std::move(j));
+    return true;
+}
+
+bool
+rc::pause(const std::string &uuid)
+{
+    std::lock_guard<std::mutex> lock(jobs_mutex);
+    auto it = jobs.find(bk_util::to_lower(uuid));
+
+    if (it == jobs.end()) {
+        // Not running here (e.g. cut short by a reboot): just mark it
+        progress p = read_state(uuid);
+        if (p.state != "running" && p.state != "waiting")
+            return false;
+        p.state = "paused";
+        p.updated = std::time(nullptr);
+        return write_state(p);
+    }
+
+    job &j = *it->second;
+    j.halt();
+
+    bool was_active;
+    {
+        std::lock_guard<std::mutex> job_lock(j.mutex);
+        was_active = j.p.state == "running" || j.p.state == "waiting";
+        if (was_active) {
+            j.p.state = "paused";
+            j.p.updated = std::time(nullptr);
+            write_state(j.p);
+        }
+    }
+    jobs.erase(it);
+    return was_active;
+}
+
+bool
+rc::cancel(const std::string &uuid)
+{
+    {
+        std::lock_guard<std::mutex> lock(jobs_mutex);
+        auto it = jobs.find(bk_util::to_lower(uuid));
+        if (it != jobs.end()) {
+            it->second->halt();
+            jobs.erase(it);
+        }
+    }
+
+    std::error_code ec;
+    return fs::remove(state_path(uuid), ec);
+}
+
+rc::progress
+rc::status(const std::string &uuid)
+{
+    {
+        std::lock_guard<std::mutex> lock(jobs_mutex);
+        reap_finished();
+    }
+    return read_state(uuid);
+}
+
+void
+rc::resume_all()
+{
+    {
+        std::lock_guard<std::mutex> lock(jobs_mutex);
+        reap_finished();
+    }
+
+    std::error_code ec;
+    for (const auto &entry : fs::directory_iterator(bk_util::system_path(state_dir), ec)) {
+        if (entry.path().extension() != ".state")
+            continue;
+
+        const std::string uuid = entry.path().stem().string();
+        progress p = read_state(uuid);
+        if (p.state != "running" && p.state != "waiting")
+            continue;
+
+        DEBUG_LOG("[recompress] resuming ", uuid);
+        if (!start(uuid, p.rate))
+            DEBUG_LOG("[recompress] could not resume ", uuid);
+    }
+}
@@ -0,0 +1,452 @@
+#include "beekeeper/beesdmgmt.hpp"
+#include "beekeeper/btrfsetup.hpp"
+#include "beekeeper/cgroupmgmt.hpp"
+#include "beekeeper/debug.hpp"
+#include "beekeeper/schedulemgmt.hpp"
+#include "beekeeper/util.hpp"
+
+#include <algorithm>
+#include <csignal>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace sched = beekeeper::management::schedule;
+
+// Helpers
+namespace {
+
+const char *const day_names[7] = { "mon", "tue", "wed", "thu", "fri", "sat", "sun" };
+
+int
+day_index(const std::string &name)
+{
+    std::string lower = bk_util::to_lower(bk_util::trim_string(name));
+    for (int i = 0; i < 7; ++i) {
+        if (lower == day_names[i])
+            return i;
+    }
+    return -1;
+}
+
+// "mon-fri", "sat,sun", "fri-mon" -> bitmask (bit 0 = Monday)
+bool
+parse_days(const std::string &spec, unsigned &mask)
+{
+    mask = 0;
+
+    for (const auto &part : bk_util::tokenize(spec, ',')) {
+        auto dash = part.find('-');
+
+        if (dash == std::string::npos) {
+            int d = day_index(part);
+            if (d < 0) return false;
+            mask |= 1u << d;
+            continue;
+        }
+
+        int from = day_index(part.substr(0, dash));
+        int to   = day_index(part.substr(dash + 1));
+        if (from < 0 || to < 0) return false;
+
+        // Ranges may wrap around the week ("fri-mon")
+        for (int d = from; ; d = (d + 1) % 7) {
+            mask |= 1u << d;
+            if (d == to) break;
+        }
+    }
+
+    return mask != 0;
+}
+
+// "HH:MM" -> minutes since midnight; "24:00" is allowed as an end of day
+bool
+parse_clock(const std::string &spec, int &minutes)
+{
+    auto colon = spec.find(':');
+    if (colon == std::string::npos)
+        return false;
+
+    try {
+        int h = std::stoi(spec.substr(0, colon));
+        int m = std::stoi(spec.substr(colon + 1));
+        if (h < 0 || h > 24 || m < 0 || m > 59) return false;
+        if (h == 24 && m != 0) return false;
+        minutes = h * 60 + m;
+    } catch (...) {
+        return false;
+    }
+
+    return true;
+}
+
+std::string
+format_clock(int minutes)
+{
+    char buf[8];
+    std::snprintf(buf, sizeof(buf), "%02d:%02d", minutes / 60, minutes % 60);
+    return buf;
+}
+
+// Local wall-clock time `minute` minutes past the midnight that starts the
+// day `offset` days away from `when`. mktime() resolves the clock time on
+// that very day, so a 23 or 25 hour day still lands on the right HH:MM;
+// 1440 normalizes to the next midnight.
+std::time_t
+local_time_on(std::time_t when, int offset, int minute)
+{
+    std::tm tm {};
+    localtime_r(&when, &tm);
+    tm.tm_mday += offset;
+    tm.tm_hour = minute / 60;
+    tm.tm_min = minute % 60;
+    tm.tm_sec = 0;
+    tm.tm_isdst = -1;
+    return std::mktime(&tm);
+}
+
+// Thread count bees was started with, or 0 if it was left to bees
+int
+running_thread_count(const std::string &uuid)
+{
+    auto workers = bk_mgmt::find_beesd_processes(uuid, true);
+    if (workers.empty())
+        return 0;
+
+    std::ifstream cmdline(bk_util::system_path("/proc/" + std::to_string(workers[0]) + "/cmdline"));
+    std::string arg;
+    bool next_is_value = false;
+
+    while (std::getline(cmdline, arg, '\0')) {
+        try {
+            if (next_is_value)
+                return std::stoi(arg);
+            if (arg.rfind("--thread-count=", 0) == 0)
+                return std::stoi(arg.substr(15));
+        } catch (...) {
+            return 0;
+        }
+        next_is_value = (arg == "--thread-count" || arg == "-c");
+    }
+
+    return 0;
+}
+
+// Pause or resume the whole worker tree. Prefer the cgroup freezer; fall
+// back to job-control signals when bees is not in its own cgroup.
+void
+set_paused(const std::string &uuid, bool paused)
+{
+    if (bk_mgmt::cgroup::freeze(uuid, paused))
+        return;
+
+    for (pid_t pid : bk_mgmt::find_beesd_processes(uuid, true))
+        kill(pid, paused ? SIGSTOP : SIGCONT);
+}
+
+} // anonymous namespace
+
+
+bool
+sched::parse_window(const std::string &spec, window &out)
+{
+    window w;
+    std::string rest = bk_util::trim_string(spec);
+
+    // Optional day list before '@'
+    auto at = rest.find('@');
+    if (at != std::string::npos) {
+        if (!parse_days(rest.substr(0, at), w.days_mask))
+            return false;
+        rest = rest.substr(at + 1);
+    }
+
+    // Time range, then optional key=value attributes
+    auto fields = bk_util::tokenize(rest, ',');
+    if (fields.empty())
+        return false;
+
+    auto dash = fields[0].find('-');
+    if (dash == std::string::npos)
+        return false;
+
+    if (!parse_clock(fields[0].substr(0, dash), w.start_minute) ||
+        !parse_clock(fields[0].substr(dash + 1), w.end_minute))
+        return false;
+
+    if (w.start_minute == 24 * 60)
+        return false;
+
+    for (size_t i = 1; i < fields.size(); ++i) {
+        auto eq = fields[i].find('=');
+        if (eq == std::string::npos)
+            return false;
+
+        std::string key = bk_util::to_lower(fields[i].substr(0, eq));
+        int value = 0;
+
+        try {
+            value = std::stoi(fields[i].substr(eq + 1));
+        } catch (...) {
+            return false;
+        }
+
+        if (key == "threads" && value > 0)
+            w.threads = value;
+        else if (key == "weight" && value >= 1 && value <= 10000)
+            w.weight = value;
+        else
+            return false;
+    }
+
+    out = w;
+    return true;
+}
+
+std::string
+sched::format_window(const window &w)
+{
+    std::string spec;
+
+    if (w.days_mask != 0x7f) {
+        for (int d = 0; d < 7; ++d) {
+            if (!(w.days_mask & (1u << d))) continue;
+            if (!spec.empty()) spec += ',';
+            spec += day_names[d];
+        }
+        spec += '@';
+    }
+
+    spec += format_clock(w.start_minute) + "-" + format_clock(w.end_minute);
+
+    if (w.threads > 0) spec += ",threads=" + std::to_string(w.threads);
+    if (w.weight > 0)  spec += ",weight=" + std::to_string(w.weight);
+
+    return spec;
+}
+
+std::optional<sched::plan>
+sched::parse_plan(const std::string &line)
+{
+    auto tokens = bk_util::tokenize(line);
+    if (tokens.size() < 2 || !bk_util::is_uuid(tokens[0]))
+        return std::nullopt;
+
+    plan p;
+    p.uuid = tokens[0];
+
+    for (size_t i = 1; i < tokens.size(); ++i) {
+        std::string lower = bk_util::to_lower(tokens[i]);
+
+        if (lower == "idle=pause") { p.pause_when_idle = true;  continue; }
+        if (lower == "idle=stop")  { p.pause_when_idle = false; continue; }
+
+        window w;
+        if (parse_window(tokens[i], w))
+            p.windows.push_back(w);
+        else
+            DEBUG_LOG("[schedule] ignoring malformed window '", tokens[i], "' for ", p.uuid);
+    }
+
+    if (p.windows.empty())
+        return std::nullopt;
+
+    return p;
+}
+
+std::vector<sched::plan>
+sched::list()
+{
+    std::vector<plan> plans;
+
+    for (const auto &line : bk_util::read_lines_from_file(bk_util::system_path(schedule_config_file))) {
+        if (auto p = parse_plan(line))
+            plans.push_back(std::move(*p));
+    }
+
+    return plans;
+}
+
+std::optional<sched::plan>
+sched::fetch(const std::string &uuid)
+{
+    for (auto &p : list()) {
+        if (bk_util::compare_strings_case_insensitive(p.uuid, uuid))
+            return p;
+    }
+    return std::nullopt;
+}
+
+bool
+sched::is_scheduled(const std::string &uuid)
+{
+    return fetch(uuid).has_value();
+}
+
+/**
+ * @brief Validate and store the schedule of a filesystem.
+ *
+ * Windows are normalized (e.g. "Mon-Wed@1:00-5:00" is stored as
+ * "mon,tue,wed@01:00-05:00") so the file stays machine-friendly.
+ *
+ * @return false if the UUID is invalid, no window was given, or any
+ *         window spec is malformed. Nothing is written in that case.
+ */
+bool
+sched::set(const std::string &uuid,
+           const std::vector<std::string> &window_specs,
+           bool pause_when_idle)
+{
+    if (!bk_util::is_uuid(uuid) || window_specs.empty())
+        return false;
+
+    std::string line_tail = pause_when_idle ? "idle=pause" : "idle=stop";
+
+    for (const auto &spec : window_specs) {
+        window w;
+        if (!parse_window(spec, w)) {
+            DEBUG_LOG("[schedule] rejecting malformed window '", spec, "'");
+            return false;
+        }
+        line_tail += " " + format_window(w);
+    }
+
+    configfile::add(bk_util::system_path(schedule_config_file), uuid, line_tail);
+    return true;
+}
+
+void
+sched::remove(const std::string &uuid)
+{
+    configfile::remove_uuid(bk_util::system_path(schedule_config_file), uuid);
+}
+
+int
+sched::active_window(const plan &p, std::time_t when)
+{
+    std::tm tm {};
+    localtime_r(&when, &tm);
+
+    int minute    = tm.tm_hour * 60 + tm.tm_min;
+    int today     = (tm.tm_wday + 6) % 7; // tm_wday counts from Sunday
+    int yesterday = (today + 6) % 7;
+
+    for (size_t i = 0; i < p.windows.size(); ++i) {
+        const window &w = p.windows[i];
+        bool on_today     = w.days_mask & (1u << today);
+        bool on_yesterday = w.days_mask & (1u << yesterday);
+
+        if (w.end_minute > w.start_minute) {
+            if (on_today && minute >= w.start_minute && minute < w.end_minute)
+                return static_cast<int>(i);
+        } else {
+            // Wraps past midnight: the tail belongs to the previous day's window
+            if ((on_today && minute >= w.start_minute) ||
+                (on_yesterday && minute < w.end_minute))
+                return static_cast<int>(i);
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * @brief Find the next moment the active window changes.
+ *
+ * Every window start and end over the coming week is a candidate; the
+ * first one at which active_window() differs from now is the transition.
+ * Each boundary is resolved by mktime() as a clock time on its own day,
+ * not as minutes added to midnight, so DST days get the right instant.
+ */
+std::time_t
+sched::next_transition(const plan &p, std::time_t now)
+{
+    std::vector<std::time_t> boundaries;
+
+    for (int day = -1; day <= 8; ++day) {
+        for (const auto &w : p.windows) {
+            boundaries.push_back(local_time_on(now, day, w.start_minute));
+
+            int end_day = (w.end_minute > w.start_minute) ? day : day + 1;
+            boundaries.push_back(local_time_on(now, end_day, w.end_minute));
+        }
+    }
+
+    std::sort(boundaries.begin(), boundaries.end());
+    boundaries.erase(std::unique(boundaries.begin(), boundaries.end()), boundaries.end());
+
+    int current = active_window(p, now);
+
+    for (std::time_t t : boundaries) {
+        if (t <= now) continue;
+        if (active_window(p, t) != current)
+            return t;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Start, stop, pause or resume the worker as the schedule says.
+ *
+ * Idempotent: calling it again in the same window does nothing unless
+ * the worker drifted (e.g. someone stopped it by hand).
+ *
+ * @return Index of the active window, or -1 when outside every window.
+ */
+int
+sched::apply(const plan &p, std::time_t now)
+{
+    int index = active_window(p, now);
+    std::string status = bk_mgmt::beesstatus(p.uuid);
+
+    if (status == "unconfigured") {
+        DEBUG_LOG("[schedule] ", p.uuid, " is not configured, ignoring its schedule");
+        return index;
+    }
+
+    if (index < 0) {
+        if (status != "running")
+            return index;
+
+        if (p.pause_when_idle) {
+            DEBUG_LOG("[schedule] pausing bees for ", p.uuid);
+            set_paused(p.uuid, true);
+        } else {
+            DEBUG_LOG("[schedule] stopping bees for ", p.uuid);
+            bk_mgmt::beesstop(p.uuid);
+        }
+        return index;
+    }
+
+    const window &w = p.windows[index];
+
+    // A window without threads= or weight= goes back to what the config
+    // says, not to what the previous window set
+    const int threads = w.threads > 0 ? w.threads : bk_mgmt::read_bees_options(p.uuid).thread_count;
+
+    std::vector<std::string> bees_args;
+    if (w.threads > 0)
+        bees_args.push_back("--thread-count=" + std::to_string(w.threads));
+
+    if (status == "running") {
+        set_paused(p.uuid, false);
+
+        // Thread count is fixed at startup, so a different one needs a restart
+        if (running_thread_count(p.uuid) != threads) {
+            DEBUG_LOG("[schedule] restarting bees for ", p.uuid, " with ",
+                      threads > 0 ? std::to_string(threads) : std::string("its default"), " threads");
+            bk_mgmt::beesrestart(p.uuid, bees_args);
+        }
+    } else {
+        DEBUG_LOG("[schedule] starting bees for ", p.uuid);
+        bk_mgmt::beesstart(p.uuid, bees_args);
+    }
+
+    if (w.weight > 0)
+        bk_mgmt::cgroup::set_weight(p.uuid, w.weight);
+    else
+        bk_mgmt::cgroup::reset_weight(p.uuid);
+
+    return index;
+}
@@ -0,0 +1,631 @@
+#include "beekeeper/debug.hpp"
+#include "beekeeper/fswalkmgmt.hpp"
+#include "beekeeper/spaceaccountmgmt.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <dirent.h>
+#include <endian.h>
+#include <fcntl.h>
+#include <filesystem>
+#include <linux/btrfs.h>
+#include <linux/btrfs_tree.h>
+#include <linux/fiemap.h>
+#include <linux/fs.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace fs = std::filesystem;
+namespace fw = beekeeper::management::fswalk;
+namespace sa = beekeeper::management::spaceaccount;
+
+// Helpers
+namespace {
+
+// Extent compression codes (btrfs_file_extent_item.compression; the uapi
+// headers do not export them). The last one is ours for FIEMAP's
+// "encoded, algorithm unknown".
+enum : uint8_t {
+    compression_none = 0,
+    compression_zlib = 1,
+    compression_lzo = 2,
+    compression_zstd = 3,
+    compression_encoded = 0xff,
+};
+
+// Walker threads beyond this only queue up on the same disks
+constexpr unsigned max_threads = 16;
+
+// Tree search result buffer
+constexpr size_t search_buffer_size = 64 * 1024;
+
+// Idle I/O class for ioprio_set (IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT)
+constexpr int ioprio_who_process = 1;
+constexpr int ioprio_idle = 3 << 13;
+
+const char *
+algorithm_name(uint8_t compression)
+{
+    switch (compression) {
+        case compression_none:    return "none";
+        case compression_zlib:    return "zlib";
+        case compression_lzo:     return "lzo";
+        case compression_zstd:    return "zstd";
+        case compression_encoded: return "encoded";
+        default:             return "unknown";
+    }
+}
+
+// One file extent reference
+struct extent_ref {
+    uint64_t bytenr = 0;       // 0 for inline extents, which belong to their inode only
+    uint64_t disk_bytes = 0;
+    uint64_t ram_bytes = 0;
+    uint64_t num_bytes = 0;    // what this reference covers
+    uint8_t compression = 0;
+};
+
+// ----- per-inode cache, kept across walks -----
+
+struct inode_key {
+    dev_t dev;
+    ino_t ino;
+    bool operator==(const inode_key &) const = default;
+};
+
+struct inode_key_hash {
+    size_t operator()(const inode_key &k) const
+    {
+        return std::hash<uint64_t>()(static_cast<uint64_t>(k.dev) * 0x9e3779b97f4a7c15ULL ^ k.ino);
+    }
+};
+
+struct inode_entry {
+    uint64_t transid = 0;
+    std::vector<extent_ref> extents;
+};
+
+// Two generations approximate an LRU without per-lookup bookkeeping: hits
+// in the old one move to the new one, and when the new one is full the old
+// one (whatever was not touched for a whole generation) is dropped.
+class inode_cache
+{
+public:
+    bool
+    find(const inode_key &key, uint64_t transid, std::vector<extent_ref> &extents)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if (auto it = young.find(key); it != young.end()) {
+            if (it->second.transid != transid) return false;
+            extents = it->second.extents;
+            return true;
+        }
+
+        auto it = old.find(key);
+        if (it == old.end() || it->second.transid != transid)
+            return false;
+
+        extents = it->second.extents;
+        insert_locked(key, std::move(it->second));
+        old.erase(key);
+        return true;
+    }
+
+    void
+    insert(const inode_key &key, uint64_t transid, const std::vector<extent_ref> &extents)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        old.erase(key);
+        insert_locked(key, { transid, extents });
+    }
+
+    void
+    clear()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        young.clear();
+        old.clear();
+    }
+
+private:
+    // Per generation; a few hundred bytes each for typical files
+    static constexpr size_t generation_size = 256 * 1024;
+
+    using map = std::unordered_map<inode_key, inode_entry, inode_key_hash>;
+
+    void
+    insert_locked(const inode_key &key, inode_entry entry)
+    {
+        if (young.size() >= generation_size && !young.count(key)) {
+            old = std::move(young);
+            young = map();
+        }
+        young[key] = std::move(entry);
+    }
+
+    std::mutex mutex;
+    map young, old;
+};
+
+inode_cache cache;
+
+// ----- cancellation of running walks -----
+
+std::mutex walks_mutex;
+std::multimap<std::string, std::shared_ptr<std::atomic_bool>> running_walks; // root -> stop flag
+
+std::string
+normalized(const std::string &path)
+{
+    std::error_code ec;
+    auto p = fs::weakly_canonical(path, ec);
+    return ec ? path : p.string();
+}
+
+// ----- distinct extents seen by one walk -----
+
+// Sharded by bytenr so walkers rarely wait on each other
+class extent_table
+{
+public:
+    struct entry {
+        uint64_t disk_bytes = 0;
+        uint64_t ram_bytes = 0;
+        uint64_t referenced = 0;
+        uint32_t refs = 0;
+        uint8_t compression = 0;
+    };
+
+    void
+    add(const extent_ref &e)
+    {
+        shard &s = shards[(e.bytenr >> 12) % shards.size()];
+        std::lock_guard<std::mutex> lock(s.mutex);
+
+        entry &x = s.extents[e.bytenr];
+        x.disk_bytes = e.disk_bytes;
+        x.ram_bytes = e.ram_bytes;
+        x.compression = e.compression;
+        x.referenced += e.num_bytes;
+        ++x.refs;
+    }
+
+    template <typename F>
+    void
+    for_each(F &&f) const
+    {
+        for (const auto &s : shards)
+            for (const auto &[bytenr, x] : s.extents)
+                f(x);
+    }
+
+private:
+    struct shard {
+        std::mutex mutex;
+        std::unordered_map<uint64_t, entry> extents;
+    };
+    std::array<shard, 64> shards;
+};
+
+// ----- reading extents -----
+
+uint64_t
+le64_at(const char *p)
+{
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return le64toh(v);
+}
+
+// Search the inode's subvolume tree for items of `ino` with type in
+// [min_type, max_type]. Calls f(type, item, len) for each. Returns false
+// (errno set) if the search itself failed.
+template <typename F>
+bool
+tree_search(int fd, uint64_t ino, uint32_t min_type, uint32_t max_type, uint32_t max_items, F &&f)
+{
+    alignas(btrfs_ioctl_search_args_v2) char buffer[sizeof(btrfs_ioctl_search_args_v2) + search_buffer_size];
+    auto *args = reinterpret_cast<btrfs_ioctl_search_args_v2 *>(buffer);
+
+    std::memset(&args->key, 0, sizeof(args->key));
+    args->key.tree_id = 0; // the subvolume fd is in
+    args->key.min_objectid = args->key.max_objectid = ino;
+    args->key.min_type = min_type;
+    args->key.max_type = max_type;
+    args->key.min_offset = 0;
+    args->key.max_offset = UINT64_MAX;
+    args->key.min_transid = 0;
+    args->key.max_transid = UINT64_MAX;
+
+    uint32_t seen = 0;
+    for (;;) {
+        args->key.nr_items = max_items ? max_items - seen : UINT32_MAX;
+        args->buf_size = search_buffer_size;
+
+        if (ioctl(fd, BTRFS_IOC_TREE_SEARCH_V2, args) < 0)
+            return false;
+        if (args->key.nr_items == 0)
+            return true;
+
+        const char *p = reinterpret_cast<const char *>(args->buf);
+        btrfs_ioctl_search_header header {};
+        for (uint32_t i = 0; i < args->key.nr_items; ++i) {
+            std::memcpy(&header, p, sizeof(header));
+            p += sizeof(header);
+            if (header.type >= min_type && header.type <= max_type)
+                f(header.type, p, header.len);
+            p += header.len;
+        }
+
+        seen += args->key.nr_items;
+        if (max_items && seen >= max_items)
+            return true;
+
+        // Continue right after the last key returned
+        if (header.offset == UINT64_MAX) {
+            if (header.type >= max_type)
+                return true;
+            args->key.min_type = header.type + 1;
+            args->key.min_offset = 0;
+        } else {
+            args->key.min_type = header.type;
+            args->key.min_offset = header.offset + 1;
+        }
+    }
+}
+
+// Inode transid: bumped by every change to the file, including extent
+// replacement by clone and dedupe, which leave mtime alone
+bool
+read_transid(int fd, uint64_t ino, uint64_t &transid)
+{
+    bool found = false;
+    bool ok = tree_search(fd, ino, BTRFS_INODE_ITEM_KEY, BTRFS_INODE_ITEM_KEY, 1,
+        [&](uint32_t, const char *item, uint32_t len) {
+            if (len >= offsetof(btrfs_inode_item, size)) {
+                transid = le64_at(item + offsetof(btrfs_inode_item, transid));
+                found = true;
+            }
+        });
+    return ok && found;
+}
+
+bool
+read_tree_extents(int fd, uint64_t ino, std::vector<extent_ref> &out)
+{
+    // Offsets inside btrfs_file_extent_item
+    constexpr size_t inline_data = offsetof(btrfs_file_extent_item, disk_bytenr);
+    constexpr size_t full_item = sizeof(btrfs_file_extent_item);
+
+    return tree_search(fd, ino, BTRFS_EXTENT_DATA_KEY, BTRFS_EXTENT_DATA_KEY, 0,
+        [&](uint32_t, const char *item, uint32_t len) {
+            if (len < inline_data) return;
+
+            extent_ref e;
+            e.compression = static_cast<uint8_t>(item[offsetof(btrfs_file_extent_item, compression)]);
+            e.ram_bytes = le64_at(item + offsetof(btrfs_file_extent_item, ram_bytes));
+            uint8_t type = static_cast<uint8_t>(item[offsetof(btrfs_file_extent_item, type)]);
+
+            if (type == BTRFS_FILE_EXTENT_INLINE) {
+                e.disk_bytes = len - inline_data;
+                e.num_bytes = e.ram_bytes;
+            } else {
+                if (len < full_item) return;
+                e.bytenr = le64_at(item + offsetof(btrfs_file_extent_item, disk_bytenr));
+                if (e.bytenr == 0) return; // hole
+                e.disk_bytes = le64_at(item + offsetof(btrfs_file_extent_item, disk_num_bytes));
+                e.num_bytes = le64_at(item + offsetof(btrfs_file_extent_item, num_bytes));
+            }
+
+            out.push_back(e);
+        });
+}
+
+// Unprivileged fallback: physical address and length, plus two flags
+bool
+read_fiemap_extents(int fd, std::vector<extent_ref> &out)
+{
+    constexpr unsigned batch = 256;
+    std::vector<char> buffer(sizeof(fiemap) + batch * sizeof(fiemap_extent));
+    auto *map = reinterpret_cast<fiemap *>(buffer.data());
+
+    uint64_t start = 0;
+    for (;;) {
+        std::memset(map, 0, sizeof(fiemap));
+        map->fm_start = start;
+        map->fm_length = FIEMAP_MAX_OFFSET - start;
+        map->fm_extent_count = batch;
+
+        if (ioctl(fd, FS_IOC_FIEMAP, map) < 0)
+            return false;
+        if (map->fm_mapped_extents == 0)
+            return true;
+
+        for (unsigned i = 0; i < map->fm_mapped_extents; ++i) {
+            const fiemap_extent &fe = map->fm_extents[i];
+
+            extent_ref e;
+            e.bytenr = (fe.fe_flags & FIEMAP_EXTENT_DATA_INLINE) ? 0 : fe.fe_physical;
+            e.disk_bytes = e.ram_bytes = e.num_bytes = fe.fe_length;
+            e.compression = (fe.fe_flags & FIEMAP_EXTENT_ENCODED) ? compression_encoded : compression_none;
+            out.push_back(e);
+
+            if (fe.fe_flags & FIEMAP_EXTENT_LAST)
+                return true;
+            start = fe.fe_logical + fe.fe_length;
+        }
+    }
+}
+
+// ----- the walk -----
+
+struct walk
+{
+    const sa::options &opts;
+    std::shared_ptr<std::atomic_bool> stop;
+
+    fw::filesystem_filter filter;
+    fw::parallel_walk dirs;
+
+    std::atomic_bool use_tree_search { true };
+    std::atomic_bool precise { true };      // no file needed FIEMAP
+    std::atomic<uint64_t> files { 0 }, cached_files { 0 }, errors { 0 };
+
+    extent_table table;
+
+    // Inline extents per walker thread, merged at the end
+    std::vector<std::map<std::string, sa::usage>> inline_usage;
+
+    std::mutex links_mutex;
+    std::unordered_set<inode_key, inode_key_hash> seen_links;
+
+    walk(const sa::options &o, unsigned threads) : opts(o), dirs(threads), inline_usage(dirs.threads()) {}
+
+    bool
+    cancelled() const
+    {
+        return stop->load(std::memory_order_relaxed) || (opts.cancelled && opts.cancelled());
+    }
+
+    void
+    account_file(int dir_fd, const char *name, std::map<std::string, sa::usage> &local_inline)
+    {
+        int fd = openat(dir_fd, name, O_RDONLY | O_NOFOLLOW | O_CLOEXEC | O_NOATIME);
+        if (fd < 0 && errno == EPERM)
+            fd = openat(dir_fd, name, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+        if (fd < 0) {
+            ++errors;
+            return;
+        }
+
+        struct stat st {};
+        if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)) {
+            close(fd);
+            return;
+        }
+
+        inode_key key { st.st_dev, st.st_ino };
+
+        // Hard links: count the inode once
+        if (st.st_nlink > 1) {
+            std::lock_guard<std::mutex> lock(links_mutex);
+            if (!seen_links.insert(key).second) {
+                close(fd);
+                return;
+            }
+        }
+
+        std::vector<extent_ref> extents;
+        bool have = false;
+
+        if (use_tree_search.load(std::memory_order_relaxed)) {
+            uint64_t transid = 0;
+            if (read_transid(fd, st.st_ino, transid)) {
+                if (cache.find(key, transid, extents)) {
+                    have = true;
+                    ++cached_files;
+                } else if (read_tree_extents(fd, st.st_ino, extents)) {
+                    have = true;
+                    cache.insert(key, transid, extents);
+                }
+            } else if (errno == EPERM) {
+                DEBUG_LOG("[spaceaccount] tree search not permitted, falling back to FIEMAP");
+                use_tree_search.store(false);
+            }
+        }
+
+        if (!have) {
+            extents.clear();
+            have = read_fiemap_extents(fd, extents);
+            precise.store(false, std::memory_order_relaxed);
+        }
+        close(fd);
+
+        if (!have) {
+            ++errors;
+            return;
+        }
+
+        ++files;
+        for (const auto &e : extents) {
+            if (e.bytenr) {
+                table.add(e);
+            } else {
+                sa::usage &u = local_inline[algorithm_name(e.compression)];
+                u.disk += e.disk_bytes;
+                u.uncompressed += e.ram_bytes;
+                u.referenced += e.num_bytes;
+            }
+        }
+    }
+
+    void
+    read_dir(size_t worker, const std::string &path)
+    {
+        // Once cancelled, queued directories are only drained
+        if (cancelled()) return;
+
+        int dir_fd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        DIR *dir = dir_fd >= 0 ? fdopendir(dir_fd) : nullptr;
+        if (!dir) {
+            if (dir_fd >= 0) close(dir_fd);
+            ++errors;
+            return;
+        }
+
+        while (dirent *entry = readdir(dir)) {
+            if (cancelled()) break;
+
+            const char *name = entry->d_name;
+            if (std::strcmp(name, ".") == 0 || std::strcmp(name, "..") == 0)
+                continue;
+
+            unsigned char type = entry->d_type;
+            struct stat st {};
+            if (type == DT_UNKNOWN || type == DT_DIR) {
+                if (fstatat(dir_fd, name, &st, AT_SYMLINK_NOFOLLOW) < 0) {
+                    ++errors;
+                    continue;
+                }
+                type = S_ISDIR(st.st_mode) ? DT_DIR : S_ISREG(st.st_mode) ? DT_REG : DT_UNKNOWN;
+            }
+
+            if (type == DT_DIR) {
+                if (filter.contains(dir_fd, name, st.st_dev))
+                    dirs.push(worker, path + "/" + name);
+            } else if (type == DT_REG) {
+                account_file(dir_fd, name, inline_usage[worker]);
+            }
+        }
+
+        closedir(dir);
+    }
+};
+
+} // anonymous namespace
+
+
+/**
+ * @brief Account the extents of every file under a directory.
+ *
+ * Each distinct extent counts once towards disk and uncompressed bytes, no
+ * matter how many files (or offsets in a file) reference it; referenced
+ * bytes count every reference. So referenced - uncompressed is what sharing
+ * (deduplication, reflinks) saves and uncompressed - disk what compression
+ * saves. Extents shared with files outside the walked tree still count
+ * fully here, as in compsize.
+ *
+ * @param root Directory to walk.
+ * @param opts Threads, I/O priority and a cancellation hook.
+ */
+sa::report
+sa::account(const std::string &root, const options &opts)
+{
+    report result;
+
+    unsigned threads = opts.threads ? opts.threads : std::thread::hardware_concurrency();
+    threads = std::clamp(threads, 1u, max_threads);
+
+    walk w(opts, threads);
+    w.stop = std::make_shared<std::atomic_bool>(false);
+
+    if (!w.filter.add_root(root)) {
+        DEBUG_LOG("[spaceaccount] ", root, " is not a directory on btrfs: ", strerror(errno));
+        return result;
+    }
+
+    const std::string key = normalized(root);
+    {
+        std::lock_guard<std::mutex> lock(walks_mutex);
+        running_walks.emplace(key, w.stop);
+    }
+
+    w.dirs.push(0, root);
+    w.dirs.run([&w](size_t worker, const std::string &dir) { w.read_dir(worker, dir); },
+               [&opts](size_t) {
+                   if (opts.idle_io)
+                       syscall(SYS_ioprio_set, ioprio_who_process, 0, ioprio_idle); // this thread only
+               });
+
+    {
+        std::lock_guard<std::mutex> lock(walks_mutex);
+        for (auto it = running_walks.begin(); it != running_walks.end(); ++it) {
+            if (it->second == w.stop) {
+                running_walks.erase(it);
+                break;
+            }
+        }
+    }
+
+    result.complete = !w.cancelled();
+    result.precise = w.precise.load();
+    result.files = w.files.load();
+    result.cached_files = w.cached_files.load();
+    result.errors = w.errors.load();
+
+    w.table.for_each([&](const extent_table::entry &x) {
+        usage &u = result.by_algorithm[algorithm_name(x.compression)];
+        u.disk += x.disk_bytes;
+        u.uncompressed += x.ram_bytes;
+        u.referenced += x.referenced;
+
+        ++result.extents;
+        if (x.refs > 1)
+            result.shared += x.referenced;
+    });
+
+    for (const auto &local : w.inline_usage) {
+        for (const auto &[name, u] : local) {
+            usage &into = result.by_algorithm[name];
+            into.disk += u.disk;
+            into.uncompressed += u.uncompressed;
+            into.referenced += u.referenced;
+        }
+    }
+
+    for (const auto &[name, u] : result.by_algorithm) {
+        result.total.disk += u.disk;
+        result.total.uncompressed += u.uncompressed;
+        result.total.referenced += u.referenced;
+    }
+
+    DEBUG_LOG("[spaceaccount] ", root, ": ", result.files, " files (", result.cached_files,
+              " cached), ", result.extents, " extents, disk ", result.total.disk,
+              ", referenced ", result.total.referenced);
+
+    return result;
+}
+
+bool
+sa::cancel(const std::string &root)
+{
+    const std::string key = normalized(root);
+    bool any = false;
+
+    std::lock_guard<std::mutex> lock(walks_mutex);
+    auto [begin, end] = running_walks.equal_range(key);
+    for (auto it = begin; it != end; ++it) {
+        it->second->store(true);
+        any = true;
+    }
+    return any;
+}
+
+void
+sa::clear_cache()
+{
+    cache.clear();
+}
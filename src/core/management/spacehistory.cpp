@@ -0,0 +1,263 @@
+#include "beekeeper/btrfsetup.hpp"
+#include "beekeeper/debug.hpp"
+#include "beekeeper/spacehistorymgmt.hpp"
+#include "beekeeper/util.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+namespace spacehistory = beekeeper::management::spacehistory;
+
+// Helpers
+namespace {
+
+const std::string history_dir = "/var/lib/beekeeper-qt/space/";
+
+constexpr char ring_magic[4] = { 'B', 'K', 'S', 'H' };
+constexpr uint32_t ring_version = 1;
+
+// On-disk layout: this header, then `capacity` samples
+struct ring_header {
+    char magic[4];
+    uint32_t version;
+    uint32_t capacity;
+    uint32_t sample_size;
+    uint64_t next;      // samples ever appended; slot of the next one is next % capacity
+    uint64_t reserved;
+};
+static_assert(sizeof(ring_header) == 32, "ring_header is part of the file format");
+static_assert(sizeof(spacehistory::sample) == 24, "sample is part of the file format");
+
+constexpr size_t ring_file_size = sizeof(ring_header) + spacehistory::capacity * sizeof(spacehistory::sample);
+
+// Smoothing of the per-interval savings rate
+constexpr double rate_smoothing = 0.25;
+
+// Intervals longer than this are gaps (bees or the helper were not running)
+constexpr int64_t max_interval_sec = 3 * spacehistory::sample_interval_sec;
+
+// Points needed before trusting a decay fit
+constexpr size_t min_fit_points = 6;
+
+// "Converged": the rate fell under 1% of its peak, or 1 MiB/hour
+constexpr double converged_fraction = 0.01;
+constexpr double converged_floor = 1024.0 * 1024;
+
+bool
+valid_header(const ring_header *h)
+{
+    return std::memcmp(h->magic, ring_magic, sizeof(ring_magic)) == 0
+        && h->version == ring_version
+        && h->capacity == spacehistory::capacity
+        && h->sample_size == sizeof(spacehistory::sample);
+}
+
+// Published counter, shared with readers mapping the same file
+uint64_t
+load_next(const ring_header *h)
+{
+    return std::atomic_ref<uint64_t>(const_cast<uint64_t &>(h->next)).load(std::memory_order_acquire);
+}
+
+} // anonymous namespace
+
+
+std::string
+spacehistory::history_path(const std::string &uuid)
+{
+    return bk_util::system_path(history_dir) + bk_util::to_lower(uuid) + ".ring";
+}
+
+bool
+spacehistory::append(const std::string &uuid, const sample &s)
+{
+    std::error_code ec;
+    fs::create_directories(bk_util::system_path(history_dir), ec);
+
+    const std::string path = history_path(uuid);
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        DEBUG_LOG("[spacehistory] cannot open ", path, ": ", strerror(errno));
+        return false;
+    }
+
+    struct stat st {};
+    if (fstat(fd, &st) < 0 || (static_cast<size_t>(st.st_size) != ring_file_size
+                               && ftruncate(fd, ring_file_size) < 0)) {
+        DEBUG_LOG("[spacehistory] cannot size ", path, ": ", strerror(errno));
+        close(fd);
+        return false;
+    }
+    // The umask may have eaten the read bits; the GUI reads this directly
+    fchmod(fd, 0644);
+
+    void *map = mmap(nullptr, ring_file_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        DEBUG_LOG("[spacehistory] mmap ", path, " failed: ", strerror(errno));
+        return false;
+    }
+
+    auto *header = static_cast<ring_header *>(map);
+    auto *samples = reinterpret_cast<sample *>(header + 1);
+
+    // New file, or one from another format: start over
+    if (!valid_header(header)) {
+        std::memset(map, 0, ring_file_size);
+        std::memcpy(header->magic, ring_magic, sizeof(ring_magic));
+        header->version = ring_version;
+        header->capacity = capacity;
+        header->sample_size = sizeof(sample);
+    }
+
+    // Sample first, then publish it
+    uint64_t next = header->next;
+    samples[next % capacity] = s;
+    std::atomic_ref<uint64_t>(header->next).store(next + 1, std::memory_order_release);
+
+    msync(map, ring_file_size, MS_ASYNC);
+    munmap(map, ring_file_size);
+    return true;
+}
+
+bool
+spacehistory::record(const std::string &uuid)
+{
+    // Both return -1 (as unsigned) when the filesystem is not mounted
+    unsigned long long free_bytes = bk_mgmt::get_space::free(uuid);
+    unsigned long long used_bytes = bk_mgmt::get_space::used(uuid);
+    if (free_bytes == static_cast<unsigned long long>(-1) || used_bytes == static_cast<unsigned long long>(-1))
+        return false;
+
+    return append(uuid, { static_cast<int64_t>(std::time(nullptr)), free_bytes, used_bytes });
+}
+
+std::vector<spacehistory::sample>
+spacehistory::load(const std::string &uuid)
+{
+    const std::string path = history_path(uuid);
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return {};
+
+    struct stat st {};
+    if (fstat(fd, &st) < 0 || static_cast<size_t>(st.st_size) != ring_file_size) {
+        close(fd);
+        return {};
+    }
+
+    void *map = mmap(nullptr, ring_file_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return {};
+
+    const auto *header = static_cast<const ring_header *>(map);
+    const auto *slots = reinterpret_cast<const sample *>(header + 1);
+
+    std::vector<sample> result;
+    if (valid_header(header)) {
+        uint64_t next = load_next(header);
+        uint64_t count = std::min<uint64_t>(next, capacity);
+
+        result.reserve(count);
+        for (uint64_t i = next - count; i < next; ++i)
+            result.push_back(slots[i % capacity]);
+
+        // The helper appended while we copied: its slots held the oldest samples
+        uint64_t appended = load_next(header) - next;
+        if (appended && count == capacity)
+            result.erase(result.begin(), result.begin() + std::min<uint64_t>(appended, result.size()));
+    }
+
+    munmap(map, ring_file_size);
+    return result;
+}
+
+/**
+ * @brief Savings, savings rate and convergence ETA from a space history.
+ *
+ * The rate is an exponential moving average of the per-interval drop in
+ * used space. Deduplication finds less and less as it converges, so the
+ * smoothed rate is fitted to an exponential decay (a line through its
+ * logarithm); with time constant tau, about rate * tau bytes are still to
+ * come and the rate gets negligible after tau * ln(rate / threshold).
+ * Gaps (bees stopped) and intervals with no net savings are left out of
+ * the fit.
+ */
+spacehistory::trend
+spacehistory::analyze(const std::vector<sample> &samples)
+{
+    trend t;
+    if (samples.size() < 2)
+        return t;
+
+    const sample &first = samples.front();
+    const sample &last = samples.back();
+
+    t.available = true;
+    t.saved = static_cast<int64_t>(first.used) - static_cast<int64_t>(last.used);
+
+    // Last hour: from the newest sample at least an hour old (or the oldest one)
+    const sample *hour_ago = &first;
+    for (const auto &s : samples)
+        if (s.time <= last.time - 3600)
+            hour_ago = &s;
+    if (last.time > hour_ago->time)
+        t.saved_last_hour = (static_cast<double>(hour_ago->used) - static_cast<double>(last.used))
+                            * 3600.0 / static_cast<double>(last.time - hour_ago->time);
+
+    // Smoothed rate, and (hours, log rate) points for the decay fit
+    std::vector<std::pair<double, double>> points;
+    bool smoothed_any = false;
+    double peak = 0;
+
+    for (size_t i = 1; i < samples.size(); ++i) {
+        int64_t dt = samples[i].time - samples[i - 1].time;
+        if (dt <= 0 || dt > max_interval_sec)
+            continue;
+
+        double rate = (static_cast<double>(samples[i - 1].used) - static_cast<double>(samples[i].used))
+                      * 3600.0 / static_cast<double>(dt);
+
+        t.rate_per_hour = smoothed_any ? t.rate_per_hour + rate_smoothing * (rate - t.rate_per_hour) : rate;
+        smoothed_any = true;
+        peak = std::max(peak, t.rate_per_hour);
+
+        if (t.rate_per_hour > 0)
+            points.emplace_back(static_cast<double>(samples[i].time - first.time) / 3600.0,
+                                std::log(t.rate_per_hour));
+    }
+
+    if (points.size() < min_fit_points || t.rate_per_hour <= 0)
+        return t;
+
+    // Least squares slope of log(rate) over time: -1/tau
+    double mean_x = 0, mean_y = 0;
+    for (const auto &[x, y] : points) { mean_x += x; mean_y += y; }
+    mean_x /= static_cast<double>(points.size());
+    mean_y /= static_cast<double>(points.size());
+
+    double sxx = 0, sxy = 0;
+    for (const auto &[x, y] : points) {
+        sxx += (x - mean_x) * (x - mean_x);
+        sxy += (x - mean_x) * (y - mean_y);
+    }
+    if (sxx <= 0 || sxy >= 0)
+        return t; // flat or growing: no convergence in sight yet
+
+    double tau_hours = -sxx / sxy;
+    t.remaining = t.rate_per_hour * tau_hours;
+
+    double threshold = std::max(converged_floor, peak * converged_fraction);
+    double hours_left = t.rate_per_hour > threshold ? tau_hours * std::log(t.rate_per_hour / threshold) : 0;
+    t.eta = static_cast<std::time_t>(last.time + hours_left * 3600.0);
+
+    return t;
+}
@@ -0,0 +1,365 @@
+#include "beekeeper/debug.hpp"
+#include "beekeeper/timingsmgmt.hpp"
+#include "beekeeper/util.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <unistd.h>
+#include <unordered_map>
+
+namespace timings = beekeeper::management::timings;
+
+// Helpers
+namespace {
+
+constexpr size_t family_count = 5;
+
+// Lets a std::string_view look up a std::string key without copying it
+struct label_hash {
+    using is_transparent = void;
+    size_t operator()(std::string_view label) const { return std::hash<std::string_view>{}(label); }
+};
+
+using label_map = std::unordered_map<std::string, timings::histogram, label_hash, std::equal_to<>>;
+
+// One thread's histograms. Only its thread records into it; the mutex is
+// there for the readers merging it, so it is practically never contended.
+struct shard {
+    std::mutex mutex;
+    std::array<label_map, family_count> series;    // indexed by family
+};
+
+// Live shards, and what threads that already exited left behind. Never
+// destroyed: detached threads may still exit after static destructors ran
+struct shard_registry {
+    std::mutex mutex;
+    std::vector<std::shared_ptr<shard>> shards;
+    shard retired;
+};
+
+shard_registry &
+registry()
+{
+    static shard_registry *instance = new shard_registry;
+    return *instance;
+}
+
+void
+merge_into(std::array<label_map, family_count> &into, const shard &from)
+{
+    for (size_t f = 0; f < family_count; ++f)
+        for (const auto &[label, h] : from.series[f])
+            into[f][label].merge(h);
+}
+
+// Registers this thread's shard on first use; folds it into `retired`
+// when the thread exits, so short-lived threads do not pile up
+struct shard_handle {
+    std::shared_ptr<shard> mine = std::make_shared<shard>();
+
+    shard_handle()
+    {
+        shard_registry &r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.shards.push_back(mine);
+    }
+
+    ~shard_handle()
+    {
+        shard_registry &r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        {
+            std::lock_guard<std::mutex> retired_lock(r.retired.mutex);
+            std::lock_guard<std::mutex> mine_lock(mine->mutex);
+            merge_into(r.retired.series, *mine);
+        }
+        r.shards.erase(std::remove(r.shards.begin(), r.shards.end(), mine), r.shards.end());
+    }
+};
+
+shard &
+this_thread_shard()
+{
+    thread_local shard_handle handle;
+    return *handle.mine;
+}
+
+std::string
+prometheus_escape(const std::string &value)
+{
+    std::string out;
+    out.reserve(value.size());
+    for (char c : value) {
+        if (c == '\\' || c == '"') out += '\\';
+        if (c == '\n') { out += "\\n"; continue; }
+        out += c;
+    }
+    return out;
+}
+
+const char *
+family_help(timings::family what)
+{
+    switch (what) {
+    case timings::family::clause:    return "Time spent in clause handlers, per verb";
+    case timings::family::command:   return "Time spent running external commands until they exit, per program";
+    case timings::family::dbus:      return "Time from a D-Bus call arriving at the helper to its reply being sent, per method";
+    case timings::family::proc_scan: return "Time spent walking the process table or reading the mount table";
+    case timings::family::remount:   return "Time spent remounting a filesystem, per mountpoint";
+    }
+    return "";
+}
+
+// Exposition bucket bounds, in seconds: 10 us to 5 minutes in 1-2.5-5 steps
+const double prometheus_bounds[] = {
+    1e-5, 2.5e-5, 5e-5, 1e-4, 2.5e-4, 5e-4, 1e-3, 2.5e-3, 5e-3, 1e-2, 2.5e-2, 5e-2,
+    0.1, 0.25, 0.5, 1, 2.5, 5, 10, 25, 50, 100, 300
+};
+
+} // anonymous namespace
+
+size_t
+timings::histogram::bucket_of(uint64_t ns)
+{
+    constexpr uint64_t linear = 1ull << sub_bucket_bits;
+    if (ns < linear)
+        return static_cast<size_t>(ns);
+
+    int exponent = std::bit_width(ns) - 1;
+    if (exponent > max_exponent)
+        return bucket_count - 1;
+
+    const int shift = exponent - sub_bucket_bits;
+    const size_t sub = static_cast<size_t>((ns >> shift) & (linear - 1));
+    return (static_cast<size_t>(shift + 1) << sub_bucket_bits) + sub;
+}
+
+uint64_t
+timings::histogram::bucket_upper(size_t bucket)
+{
+    constexpr uint64_t linear = 1ull << sub_bucket_bits;
+    if (bucket < linear)
+        return bucket;
+
+    const int shift = static_cast<int>(bucket >> sub_bucket_bits) - 1;
+    const uint64_t sub = bucket & (linear - 1);
+    return ((linear + sub + 1) << shift) - 1;
+}
+
+void
+timings::histogram::record(uint64_t ns)
+{
+    ++count;
+    sum_ns += ns;
+    max_ns = std::max(max_ns, ns);
+    ++buckets[bucket_of(ns)];
+}
+
+void
+timings::histogram::merge(const histogram &other)
+{
+    count += other.count;
+    sum_ns += other.sum_ns;
+    max_ns = std::max(max_ns, other.max_ns);
+    for (size_t i = 0; i < bucket_count; ++i)
+        buckets[i] += other.buckets[i];
+}
+
+uint64_t
+timings::histogram::percentile(double p) const
+{
+    if (count == 0)
+        return 0;
+
+    // Nearest rank
+    uint64_t rank = static_cast<uint64_t>(std::clamp(p, 0.0, 1.0) * count + 0.999999);
+    rank = std::clamp<uint64_t>(rank, 1, count);
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < bucket_count; ++i) {
+        seen += buckets[i];
+        if (seen >= rank)
+            return std::min(bucket_upper(i), max_ns);
+    }
+    return max_ns;
+}
+
+void
+timings::record(family what, std::string_view label, uint64_t ns)
+{
+    shard &mine = this_thread_shard();
+    std::lock_guard<std::mutex> lock(mine.mutex);
+
+    // Only the first measurement of a label allocates its key
+    label_map &labels = mine.series[static_cast<size_t>(what)];
+    auto it = labels.find(label);
+    if (it == labels.end())
+        it = labels.emplace(std::string(label), histogram {}).first;
+    it->second.record(ns);
+}
+
+std::vector<timings::series>
+timings::snapshot()
+{
+    std::array<label_map, family_count> merged;
+    {
+        shard_registry &r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        for (const auto &s : r.shards) {
+            std::lock_guard<std::mutex> shard_lock(s->mutex);
+            merge_into(merged, *s);
+        }
+        std::lock_guard<std::mutex> retired_lock(r.retired.mutex);
+        merge_into(merged, r.retired);
+    }
+
+    std::vector<series> out;
+    for (size_t f = 0; f < family_count; ++f)
+        for (const auto &[label, h] : merged[f])
+            out.push_back(series { static_cast<family>(f), label, h });
+
+    std::sort(out.begin(), out.end(), [](const series &a, const series &b) {
+        return a.what != b.what ? a.what < b.what : a.label < b.label;
+    });
+    return out;
+}
+
+const char *
+timings::family_name(family what)
+{
+    switch (what) {
+    case family::clause:    return "clause";
+    case family::command:   return "command";
+    case family::dbus:      return "dbus";
+    case family::proc_scan: return "proc_scan";
+    case family::remount:   return "remount";
+    }
+    return "unknown";
+}
+
+const char *
+timings::label_name(family what)
+{
+    switch (what) {
+    case family::clause:    return "verb";
+    case family::command:   return "program";
+    case family::dbus:      return "method";
+    case family::proc_scan: return "scan";
+    case family::remount:   return "mountpoint";
+    }
+    return "label";
+}
+
+std::string
+timings::prometheus()
+{
+    const std::vector<series> all = snapshot();
+
+    std::ostringstream out;
+    out.precision(9);
+
+    for (size_t f = 0; f < family_count; ++f) {
+        const family what = static_cast<family>(f);
+        const std::string metric = std::string("beekeeper_") + family_name(what) + "_duration_seconds";
+
+        out << "# HELP " << metric << ' ' << family_help(what) << '\n'
+            << "# TYPE " << metric << " histogram\n";
+
+        for (const auto &s : all) {
+            if (s.what != what)
+                continue;
+
+            const std::string label = std::string(label_name(what)) + "=\"" + prometheus_escape(s.label) + '"';
+
+            // Cumulative counts of the fine buckets that end within each bound
+            uint64_t cumulative = 0;
+            size_t bucket = 0;
+            for (double bound : prometheus_bounds) {
+                const uint64_t bound_ns = static_cast<uint64_t>(bound * 1e9);
+                for (; bucket < bucket_count && histogram::bucket_upper(bucket) <= bound_ns; ++bucket)
+                    cumulative += s.h.buckets[bucket];
+                out << metric << "_bucket{" << label << ",le=\"" << bound << "\"} " << cumulative << '\n';
+            }
+            out << metric << "_bucket{" << label << ",le=\"+Inf\"} " << s.h.count << '\n'
+                << metric << "_sum{" << label << "} " << s.h.sum_ns / 1e9 << '\n'
+                << metric << "_count{" << label << "} " << s.h.count << '\n';
+        }
+    }
+    return out.str();
+}
+
+std::string
+timings::json()
+{
+    const std::vector<series> all = snapshot();
+
+    std::ostringstream out;
+    out << '{';
+    for (size_t f = 0; f < family_count; ++f) {
+        const family what = static_cast<family>(f);
+        if (f) out << ',';
+        out << "\n  \"" << family_name(what) << "\":[";
+
+        bool first = true;
+        for (const auto &s : all) {
+            if (s.what != what)
+                continue;
+            if (!first) out << ',';
+            first = false;
+
+            out << "\n    {\"" << label_name(what) << "\":\"" << bk_util::json_escape(s.label) << "\","
+                << "\"count\":" << s.h.count << ","
+                << "\"sum_ns\":" << s.h.sum_ns << ","
+                << "\"max_ns\":" << s.h.max_ns << ","
+                << "\"p50_ns\":" << s.h.percentile(0.5) << ","
+                << "\"p90_ns\":" << s.h.percentile(0.9) << ","
+                << "\"p99_ns\":" << s.h.percentile(0.99) << ","
+                << "\"p999_ns\":" << s.h.percentile(0.999) << '}';
+        }
+        out << (first ? "]" : "\n  ]");
+    }
+    out << "\n}";
+    return out.str();
+}
+
+std::string
+timings::default_file()
+{
+    return bk_util::system_path("/run/bees/beekeeper.prom");
+}
+
+bool
+timings::write_file(const std::string &path)
+{
+    // The exporter may read at any moment: never let it see half a file
+    const std::string tmp = path + ".tmp";
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ec);
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        if (!out) {
+            DEBUG_LOG_AT(warning, "[timings] cannot write ", tmp, ": ", strerror(errno));
+            return false;
+        }
+        out << prometheus();
+        if (!out) {
+            unlink(tmp.c_str());
+            return false;
+        }
+    }
+
+    if (rename(tmp.c_str(), path.c_str()) != 0) {
+        DEBUG_LOG_AT(warning, "[timings] cannot replace ", path, ": ", strerror(errno));
+        unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
@@ -10,10 +10,24 @@
 
 namespace tc = beekeeper::management::transparentcompression;
 
+const std::vector<tc::preset> &
+tc::presets()
+{
+    static const std::vector<preset> table = {
+        {"feather",     "lzo", 0},
+        {"light",       "zstd", 1},
+        {"balanced",    "zstd", 3},
+        {"high",        "zstd", 6},
+        {"harder",      "zstd", 10},
+        {"maximum",     "zstd", 15}
+    };
+    return table;
+}
+
 bool
 tc::is_enabled_for(const std::string &uuid)
 {
-    return configfile::is_present(transparentcompression_config_file, uuid);
+    return configfile::is_present(bk_util::system_path(transparentcompression_config_file), uuid);
 }
 
 /**
@@ -76,37 +90,26 @@ tc::add_uuid(const std::string &uuid, const std::string &algorithm, int level)
 
     // Stitch line as "uuid algorithm level" if level != 0
     if (level != 0)
-        configfile::add(transparentcompression_config_file, uuid, algo, std::to_string(level));
+        configfile::add(bk_util::system_path(transparentcompression_config_file), uuid, algo, std::to_string(level));
     else
-        configfile::add(transparentcompression_config_file, uuid, algo);
+        configfile::add(bk_util::system_path(transparentcompression_config_file), uuid, algo);
 }
 
 void
 tc::remove_uuid(const std::string &uuid)
 {
-    configfile::remove_line_matching_substring(transparentcompression_config_file, uuid);
+    configfile::remove_line_matching_substring(bk_util::system_path(transparentcompression_config_file), uuid);
 }
 
-bool
-tc::start(const std::string &uuid)
+std::pair<std::string, int>
+tc::configured_compression(const std::string &uuid)
 {
-    if (uuid.empty()) {
-        DEBUG_LOG("[transparentcompression] start: empty uuid");
-        return false;
-    }
-
-    // 1) Resolve all mountpoints for UUID
-    std::vector<std::string> mountpoints = bk_mgmt::get_mount_paths(uuid);
-    if (mountpoints.empty()) {
-        DEBUG_LOG("[transparentcompression] start: no mountpoints found for uuid " + uuid);
-        return false;
-    }
-
-    // 2) Fetch config for uuid (first matching line)
     std::string algo;
     int level = 0;
+
+    // First matching line
     auto cfg_lines = bk_mgmt::configfile::fetch(
-        bk_mgmt::transparentcompression_config_file,
+        bk_util::system_path(bk_mgmt::transparentcompression_config_file),
         uuid,
         /*case_insensitive=*/true,
         /*max_coincidence_lines_count=*/1
@@ -122,8 +125,28 @@ tc::start(const std::string &uuid)
         }
     }
 
+    return { bk_util::to_lower(bk_util::trim_string(algo)), level };
+}
+
+bool
+tc::start(const std::string &uuid)
+{
+    if (uuid.empty()) {
+        DEBUG_LOG("[transparentcompression] start: empty uuid");
+        return false;
+    }
+
+    // 1) Resolve all mountpoints for UUID
+    std::vector<std::string> mountpoints = bk_mgmt::get_mount_paths(uuid);
+    if (mountpoints.empty()) {
+        DEBUG_LOG("[transparentcompression] start: no mountpoints found for uuid " + uuid);
+        return false;
+    }
+
+    // 2) Fetch config for uuid
+    auto [algo, level] = configured_compression(uuid);
+
     // 3) Apply defaults
-    algo = bk_util::to_lower(bk_util::trim_string(algo));
     if (algo.empty()) algo = "lzo";
 
     // 4) Build compression token
@@ -335,7 +358,7 @@ tc::get_current_compression_level(const std::string &mountpoint_or_uuid)
     // Try to find a mountpoint line that includes both the mountpoint and "compress="
     for (const auto &possible_mountpoint : mountpoints) {
         std::vector<std::string> matched = bk_util::find_lines_matching_substring_in_file(
-            "/proc/mounts",
+            bk_util::system_path("/proc/mounts"),
             std::vector<std::string>{possible_mountpoint, "compress="},
             false,
             1 // only need the first match
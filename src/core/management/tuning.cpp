@@ -0,0 +1,209 @@
+#include "beekeeper/btrfsetup.hpp"
+#include "beekeeper/debug.hpp"
+#include "beekeeper/tuningmgmt.hpp"
+#include "beekeeper/util.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <thread>
+#include <unistd.h>
+
+namespace tuning = beekeeper::management::tuning;
+
+namespace {
+
+uint64_t
+physical_ram()
+{
+    long pages = sysconf(_SC_PHYS_PAGES);
+    long page_size = sysconf(_SC_PAGE_SIZE);
+    if (pages <= 0 || page_size <= 0)
+        return 0;
+    return static_cast<uint64_t>(pages) * static_cast<uint64_t>(page_size);
+}
+
+} // anonymous namespace
+
+tuning::hardware
+tuning::probe(const std::string &uuid)
+{
+    hardware hw;
+
+    hw.cores = std::max(1u, std::thread::hardware_concurrency());
+    hw.ram_bytes = physical_ram();
+    hw.rotational = bk_mgmt::is_rotational(uuid);
+
+    DEBUG_LOG("[tuning] ", uuid, ": cores=", hw.cores, " ram=", hw.ram_bytes,
+              " rotational=", hw.rotational);
+
+    return hw;
+}
+
+/**
+ * @brief Propose bees options for the given hardware.
+ *
+ * Heuristics:
+ *  - Spinning disks: seeks dominate, so more threads only add head
+ *    movement. Cap at 2 threads and throttle harder.
+ *  - SSD/NVMe: one thread per core is fine, bees' own default.
+ *  - Low RAM (< 4 GiB): cap threads, each one keeps extent buffers around.
+ *  - Always keep some CPU for the user: loadavg target at 3/4 of the cores
+ *    (1/2 on spinning disks, where I/O wait inflates the load average).
+ *
+ * The scan mode is left to bees; its default is the best general choice.
+ */
+bk_mgmt::bees_options
+tuning::autotune(const hardware &hw)
+{
+    constexpr uint64_t low_ram = 4ULL * 1024 * 1024 * 1024;
+
+    bees_options options;
+
+    if (hw.rotational) {
+        options.thread_count = static_cast<int>(std::min(hw.cores, 2u));
+        options.loadavg_target = std::max(1.0, hw.cores * 0.5);
+        options.throttle_factor = 2.0;
+    } else {
+        options.thread_factor = 1.0;
+        options.loadavg_target = std::max(1.0, hw.cores * 0.75);
+    }
+
+    if (hw.ram_bytes && hw.ram_bytes < low_ram) {
+        options.thread_factor = 0;
+        options.thread_count = static_cast<int>(std::min(hw.cores, 2u));
+    }
+
+    return options;
+}
+
+bk_mgmt::bees_options
+tuning::autotune(const std::string &uuid)
+{
+    return autotune(probe(uuid));
+}
+
+// ----- Hash table (DB_SIZE) sizing -----
+
+// DB_SIZE is sourced by beesd as shell, so hand-written configs often say
+// DB_SIZE=$((1024*1024*1024)). Accept plain numbers and such products.
+uint64_t
+tuning::parse_db_size(std::string value)
+{
+    value = bk_util::trip_quotes(bk_util::trim_string(value));
+
+    if (value.rfind("$((", 0) == 0 && value.size() > 5 && value.compare(value.size() - 2, 2, "))") == 0)
+        value = value.substr(3, value.size() - 5);
+
+    if (value.empty())
+        return 0;
+
+    uint64_t product = 1;
+    for (const auto &factor : bk_util::tokenize(value, '*')) {
+        try {
+            product *= std::stoull(bk_util::trim_string(factor));
+        } catch (...) {
+            return 0;
+        }
+    }
+    return product;
+}
+
+namespace {
+
+uint64_t
+round_down_to_granularity(uint64_t bytes)
+{
+    return bytes / tuning::db_size_granularity * tuning::db_size_granularity;
+}
+
+} // anonymous namespace
+
+std::map<std::string, uint64_t>
+tuning::configured_db_sizes()
+{
+    namespace fs = std::filesystem;
+
+    std::map<std::string, uint64_t> sizes;
+    std::error_code ec;
+
+    for (const auto &entry : fs::recursive_directory_iterator(bk_util::system_path("/etc/bees"), ec)) {
+        if (!entry.is_regular_file() || entry.path().extension() != ".conf")
+            continue;
+
+        std::string uuid;
+        uint64_t db_size = 0;
+
+        for (const auto &line : bk_util::read_lines_from_file(entry.path().string())) {
+            if (line[0] == '#') continue;
+
+            if (line.rfind("UUID=", 0) == 0)
+                uuid = bk_util::trip_quotes(bk_util::trim_string(line.substr(5)));
+            else if (line.rfind("DB_SIZE=", 0) == 0)
+                db_size = parse_db_size(line.substr(8));
+        }
+
+        if (!uuid.empty())
+            sizes[bk_util::to_lower(uuid)] = db_size;
+    }
+
+    return sizes;
+}
+
+uint64_t
+tuning::default_db_budget()
+{
+    return physical_ram() / 4;
+}
+
+/**
+ * @brief Recommend a hash table size for a filesystem.
+ *
+ * bees' rule of thumb is 1 GiB of hash table per 1 TiB of unique data,
+ * which gives an average dedupe block around 128 KiB; bigger tables find
+ * smaller duplicates but the whole table stays locked in RAM. Used bytes
+ * stand in for unique data (they already count shared extents once).
+ *
+ * The sum of every hash table must fit the budget, so the DB_SIZE already
+ * configured for the other filesystems is subtracted before capping.
+ * Results are multiples of 16 MiB and never below 16 MiB.
+ *
+ * @param uuid Filesystem UUID.
+ * @param budget Bytes of RAM for all hash tables together; 0 = a quarter of RAM.
+ */
+tuning::db_size_advice
+tuning::advise_db_size(const std::string &uuid, uint64_t budget)
+{
+    constexpr uint64_t data_per_table_byte = 1024; // 1 GiB per TiB
+    constexpr uint64_t fallback_db_size = 1024ULL * 1024 * 1024;
+
+    db_size_advice advice;
+    advice.budget = budget ? budget : default_db_budget();
+
+    for (const auto &[configured_uuid, size] : configured_db_sizes()) {
+        if (bk_util::compare_strings_case_insensitive(configured_uuid, uuid))
+            advice.current = size;
+        else
+            advice.committed_elsewhere += size;
+    }
+
+    // get_space::used returns -1 (as unsigned) when the filesystem is not mounted
+    unsigned long long used = bk_mgmt::get_space::used(uuid);
+    advice.used_bytes = (used == static_cast<unsigned long long>(-1)) ? 0 : used;
+
+    advice.ideal = advice.used_bytes
+        ? std::max(min_db_size, round_down_to_granularity(advice.used_bytes / data_per_table_byte))
+        : fallback_db_size;
+
+    uint64_t room = advice.budget > advice.committed_elsewhere
+        ? advice.budget - advice.committed_elsewhere
+        : 0;
+
+    advice.recommended = std::max(min_db_size, std::min(advice.ideal, round_down_to_granularity(room)));
+    advice.capped = advice.recommended < advice.ideal;
+
+    DEBUG_LOG("[tuning] advise_db_size(", uuid, "): used=", advice.used_bytes,
+              " ideal=", advice.ideal, " budget=", advice.budget,
+              " elsewhere=", advice.committed_elsewhere, " -> ", advice.recommended);
+
+    return advice;
+}
@@ -1,3 +1,4 @@
+#include "beekeeper/timingsmgmt.hpp"
 #include "beekeeper/util.hpp"
 
 #include <array>
@@ -8,6 +9,16 @@
 #include <sys/poll.h>
 #include <sys/wait.h>
 
+namespace timings = beekeeper::management::timings;
+
+// What the command timings are filed under: the program's base name
+static std::string program_label(std::string_view command)
+{
+    command = command.substr(0, command.find_first_of(" \t"));
+    auto slash = command.rfind('/');
+    return std::string(slash == std::string_view::npos ? command : command.substr(slash + 1));
+}
+
 /*
   Utility: drain two fds using poll until EOF on both,
   while also checking the child status via waitpid(WNOHANG).
@@ -41,7 +52,7 @@ static void drain_pipes_and_reap(pid_t child,
     std::array<char, 4096> buf;
 
     bool child_exited = false;
-    while (active > 0 || !child_exited) {
+    while (active > 0) {
         // poll with a reasonable timeout so we can check child status periodically
         int timeout_ms = 3000;
         int rv = poll(fds, 2, timeout_ms);
@@ -96,13 +107,17 @@ static void drain_pipes_and_reap(pid_t child,
         if (r == child) child_exited = true;
     }
 
-    // Ensure pipes closed
-    if (fd_out >= 0) close(fd_out);
-    if (fd_err >= 0) close(fd_err);
+    // Ensure pipes closed; the ones that reached EOF already are, and their
+    // numbers may belong to someone else by now
+    for (auto &p : fds)
+        if (p.fd >= 0) close(p.fd);
 
-    // Wait for child if not reaped yet
-    int status = 0;
-    waitpid(child, &status, 0);
+    // Wait for child if not reaped yet. Both pipes at EOF means it is on its
+    // way out: block here rather than poll() on nothing for a whole timeout
+    if (!child_exited) {
+        int status = 0;
+        waitpid(child, &status, 0);
+    }
 }
 
 bool
@@ -128,10 +143,13 @@ bk_util::exec_command_shell(const char* cmd)
     command_streams result;
     if (!cmd) return result;
 
+    const std::string program = program_label(cmd);
+    timings::scoped_timer timer(timings::family::command, program);
+
     int out_pipe[2] = {-1,-1};
     int err_pipe[2] = {-1,-1};
 
-    if (pipe(out_pipe) < 0 || pipe(err_pipe) < 0) {
+    if (pipe2(out_pipe, O_CLOEXEC) < 0 || pipe2(err_pipe, O_CLOEXEC) < 0) {
         std::cerr << "pipe() failed: " << strerror(errno) << std::endl;
         if (out_pipe[0] >= 0) close(out_pipe[0]);
         if (out_pipe[1] >= 0) close(out_pipe[1]);
@@ -184,10 +202,13 @@ bk_util::exec_commandv(const std::vector<std::string> &args)
     command_streams result;
     if (args.empty()) return result;
 
+    const std::string program = program_label(args[0]);
+    timings::scoped_timer timer(timings::family::command, program);
+
     int out_pipe[2] = {-1,-1};
     int err_pipe[2] = {-1,-1};
 
-    if (pipe(out_pipe) < 0 || pipe(err_pipe) < 0) {
+    if (pipe2(out_pipe, O_CLOEXEC) < 0 || pipe2(err_pipe, O_CLOEXEC) < 0) {
         std::cerr << "pipe() failed: " << strerror(errno) << std::endl;
         return result;
     }
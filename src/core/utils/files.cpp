@@ -1,7 +1,9 @@
 #include "beekeeper/util.hpp"
 
 #include <cerrno>
+#include <cstdlib>
 #include <cstring>
+#include <fcntl.h>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
@@ -25,6 +27,45 @@ bk_util::file_readable (const std::string& path)
     return true;
 }
 
+const std::string &
+bk_util::system_root()
+{
+#ifdef BEEKEEPER_TEST_HOOKS
+    static const std::string root = [] {
+        const char *env = std::getenv("BEEKEEPER_SYSROOT");
+        std::string dir = env ? env : "";
+        while (dir.size() > 1 && dir.back() == '/')
+            dir.pop_back();
+        return dir == "/" ? std::string() : dir;
+    }();
+#else
+    static const std::string root;
+#endif
+    return root;
+}
+
+std::string
+bk_util::system_path(const std::string &absolute)
+{
+    const std::string &root = system_root();
+    if (root.empty() || absolute.empty() || absolute.front() != '/')
+        return absolute;
+    return root + absolute;
+}
+
+std::string
+bk_util::system_relative(const std::string &path)
+{
+    const std::string &root = system_root();
+    if (root.empty() || path.compare(0, root.size(), root) != 0)
+        return path;
+    if (path.size() == root.size())
+        return "/";
+    if (path[root.size()] != '/')
+        return path;
+    return path.substr(root.size());
+}
+
 /**
  * @brief Read all non-empty, trimmed lines from a file.
  *
@@ -46,16 +87,14 @@ bk_util::read_lines_from_file(const std::string &path)
 {
     std::vector<std::string> lines;
 
-    if (!std::filesystem::exists(path))
+    bk_util::text_buffer file;
+    if (!file.load(path))
         return lines;
 
-    std::ifstream infile(path);
-    std::string line;
-    while (std::getline(infile, line)) {
-        line = bk_util::trim_string(line);
-        if (!line.empty())
-            lines.push_back(line);
-    }
+    const auto &views = file.lines();
+    lines.reserve(views.size());
+    for (std::string_view line : views)
+        lines.emplace_back(line);
     return lines;
 }
 
@@ -73,7 +112,34 @@ bk_util::make_file_world_readable(const std::string &path)
     );
 }
 
-// Wrapper: read file into lines and delegate to the in-memory matcher
+// Read the whole file with read(2): /proc files report a size of 0, so the
+// buffer grows as it goes
+std::string
+bk_util::read_file(const std::string &path)
+{
+    std::string buffer;
+
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return buffer;
+
+    size_t used = 0;
+    buffer.resize(16 * 1024);
+    for (;;) {
+        if (used == buffer.size())
+            buffer.resize(buffer.size() * 2);
+        ssize_t n = read(fd, buffer.data() + used, buffer.size() - used);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        used += static_cast<size_t>(n);
+    }
+    close(fd);
+
+    buffer.resize(used);
+    return buffer;
+}
+
+// Wrapper: match the lines of the file in place (trimmed, empty ones
+// skipped, as read_lines_from_file gives them) and copy only the matches
 std::vector<std::string>
 bk_util::find_lines_matching_substring_in_file(
     const std::string &path,
@@ -81,16 +147,15 @@ bk_util::find_lines_matching_substring_in_file(
     bool case_insensitive,
     size_t max_coincidence_lines_count)
 {
-    // Read all lines from the file into a vector
-    std::vector<std::string> file_lines = bk_util::read_lines_from_file(path);
+    std::vector<std::string> result;
+    if (substrs_to_match.empty()) return result;
 
-    // Delegate the actual matching to the in-memory function, passing the max
-    return bk_util::find_lines_matching_substring_in_vector(
-        file_lines,
-        substrs_to_match,
-        case_insensitive,
-        max_coincidence_lines_count
-    );
+    const std::string buffer = bk_util::read_file(path);
+    const line_matcher matcher(substrs_to_match, case_insensitive);
+
+    for (std::string_view line : matcher.matching_lines(buffer, max_coincidence_lines_count))
+        result.emplace_back(line);
+    return result;
 }
 
 // Single-string overload: wrap the needle into a one-element vector and delegate.
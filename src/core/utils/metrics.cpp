@@ -22,7 +22,7 @@ bk_util::current_cpu_usage(int decimals)
     static std::vector<unsigned long long> last_total;
     static std::vector<unsigned long long> last_idle;
 
-    std::ifstream file("/proc/stat");
+    std::ifstream file(bk_util::system_path("/proc/stat"));
     if (!file.is_open()) return -1.0;
 
     std::vector<unsigned long long> total;
@@ -1,17 +1,54 @@
 #include "beekeeper/util.hpp"
 #include <cctype>
+#include <charconv>
 #include <cmath>
+#include <cstring>
 #include <iomanip>
 #include <iostream>
+#include <stdexcept>
 #include <unistd.h>
 #include <unordered_map>
 
-// Case-insensitive string comparison
-// Use bk_util::to_lower (assumes it returns a std::string)
+// Case-insensitive string comparison, without lowercased copies
 bool
 bk_util::compare_strings_case_insensitive(const std::string &a, const std::string &b)
 {
-    return bk_util::to_lower(a) == bk_util::to_lower(b);
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i)
+        if (std::tolower(static_cast<unsigned char>(a[i])) != std::tolower(static_cast<unsigned char>(b[i])))
+            return false;
+    return true;
+}
+
+double
+bk_util::to_double(std::string_view s, size_t *consumed)
+{
+    size_t start = 0;
+    while (start < s.size() && std::isspace(static_cast<unsigned char>(s[start])))
+        ++start;
+
+    // from_chars takes no leading '+'
+    if (start < s.size() && s[start] == '+')
+        ++start;
+
+    double value = 0;
+    auto [end, ec] = std::from_chars(s.data() + start, s.data() + s.size(), value);
+    if (ec == std::errc::invalid_argument)
+        throw std::invalid_argument("to_double: no number in '" + std::string(s) + "'");
+    if (ec == std::errc::result_out_of_range)
+        throw std::out_of_range("to_double: '" + std::string(s) + "' is out of range");
+
+    if (consumed)
+        *consumed = static_cast<size_t>(end - s.data());
+    return value;
+}
+
+std::string
+bk_util::format_double(double value)
+{
+    char buf[32];
+    auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), value);
+    return ec == std::errc() ? std::string(buf, end) : std::string("0");
 }
 
 std::string
@@ -218,152 +255,214 @@ bk_util::get_second_token (std::string line)
     return token;
 }
 
-// Find all lines from 'lines' that contain ANY needle from 'substrs_to_find'.
-// If none found, return an empty vector.
-//
-// If case_insensitive == true, matching is performed using
-// bk_util::compare_strings_case_insensitive on each candidate substring slice
-// (this avoids allocating/lowering the full haystack). Returned lines are the
-// original input lines (not lowercased).
-std::vector<std::string>
-bk_util::find_lines_matching_substring_in_vector(
-    const std::vector<std::string> &lines,
-    const std::vector<std::string> &substrs_to_find,
-    bool case_insensitive,
-    size_t max_coincidence_lines_count)
+// ASCII case folding for the matcher (the same folding to_lower does for
+// the UUIDs, paths and config keys it is used on)
+namespace {
+
+inline unsigned char
+fold(unsigned char c)
 {
-    std::vector<std::string> result;
-    if (lines.empty() || substrs_to_find.empty()) return result;
+    return (c >= 'A' && c <= 'Z') ? static_cast<unsigned char>(c + ('a' - 'A')) : c;
+}
 
-    // Prepare needles: remove empty needles and parse key=val needles
-    struct Needle {
-        bool is_kv = false;
-        std::string key;
-        std::string val;
-        std::string raw; // original needle for non-kv
-    };
+inline bool
+equals_folded(std::string_view a, std::string_view lower_b)
+{
+    if (a.size() != lower_b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i)
+        if (fold(static_cast<unsigned char>(a[i])) != static_cast<unsigned char>(lower_b[i]))
+            return false;
+    return true;
+}
+
+// Whether `hay` contains `needle` (already lowercased when folding).
+// memchr finds the candidates for the first character, in both cases.
+bool
+contains(std::string_view hay, std::string_view needle, bool folded)
+{
+    if (needle.empty() || needle.size() > hay.size()) return false;
+    if (!folded) return hay.find(needle) != std::string_view::npos;
+
+    const unsigned char first = static_cast<unsigned char>(needle[0]);
+    const unsigned char first_upper = (first >= 'a' && first <= 'z') ? static_cast<unsigned char>(first - ('a' - 'A')) : first;
+    const std::string_view rest = needle.substr(1);
+
+    const char *p = hay.data();
+    const char *last = hay.data() + (hay.size() - needle.size());
+    while (p <= last) {
+        size_t span = static_cast<size_t>(last - p) + 1;
+        auto *lower_hit = static_cast<const char *>(std::memchr(p, first, span));
+        const char *hit = lower_hit;
+        if (first_upper != first) {
+            auto *upper_hit = static_cast<const char *>(
+                std::memchr(p, first_upper, lower_hit ? static_cast<size_t>(lower_hit - p) : span));
+            if (upper_hit) hit = upper_hit;
+        }
+        if (!hit) return false;
+
+        if (equals_folded(std::string_view(hit + 1, rest.size()), rest))
+            return true;
+        p = hit + 1;
+    }
+    return false;
+}
+
+inline bool
+equals(std::string_view a, std::string_view b, bool folded)
+{
+    return folded ? equals_folded(a, b) : a == b;
+}
+
+// Next token of `line` from `pos`, split the way tokenize(line, ' ') does:
+// a quote at the start of a token or right after '=' groups spaces until
+// its closing quote. Quotes are kept in the view.
+std::string_view
+next_token(std::string_view line, size_t &pos)
+{
+    while (pos < line.size() && line[pos] == ' ') ++pos;
+
+    const size_t start = pos;
+    char quote = '\0';
+    for (; pos < line.size(); ++pos) {
+        char c = line[pos];
+        bool escaped = pos > start && line[pos - 1] == '\\';
+
+        if (quote != '\0') {
+            if (c == quote && !escaped) quote = '\0';
+            continue;
+        }
+        if ((c == '"' || c == '\'') && !escaped && (pos == start || line[pos - 1] == '=')) {
+            quote = c;
+            continue;
+        }
+        if (c == ' ') break;
+    }
+    return line.substr(start, pos - start);
+}
+
+inline std::string_view
+strip_quotes(std::string_view v)
+{
+    if (v.size() >= 2 && v.front() == v.back() && (v.front() == '"' || v.front() == '\''))
+        return v.substr(1, v.size() - 2);
+    return v;
+}
+
+inline std::string_view
+trim_view(std::string_view v)
+{
+    while (!v.empty() && std::isspace(static_cast<unsigned char>(v.front()))) v.remove_prefix(1);
+    while (!v.empty() && std::isspace(static_cast<unsigned char>(v.back()))) v.remove_suffix(1);
+    return v;
+}
 
-    std::vector<Needle> needles;
+} // anonymous namespace
+
+bk_util::line_matcher::line_matcher(const std::vector<std::string> &substrs_to_find, bool case_insensitive)
+    : case_insensitive(case_insensitive)
+{
     needles.reserve(substrs_to_find.size());
     for (const auto &s : substrs_to_find) {
         if (s.empty()) continue;
+
+        needle n;
         auto pos = s.find('=');
         if (pos != std::string::npos) {
-            Needle n;
             n.is_kv = true;
             n.key = s.substr(0, pos);
-            n.val = s.substr(pos + 1);
             // strip optional surrounding quotes from needle value
-            if (n.val.size() >= 2 &&
-                ((n.val.front() == '"' && n.val.back() == '"') ||
-                 (n.val.front() == '\'' && n.val.back() == '\''))) {
-                n.val = n.val.substr(1, n.val.size() - 2);
-            }
-            needles.push_back(std::move(n));
+            n.val = std::string(strip_quotes(std::string_view(s).substr(pos + 1)));
         } else {
-            Needle n;
-            n.is_kv = false;
             n.raw = s;
-            needles.push_back(std::move(n));
+            n.has_space = s.find(' ') != std::string::npos;
         }
-    }
-    if (needles.empty()) return result;
 
-    // Helper lambdas for comparisons
-    auto eq_compare = [&](const std::string &a, const std::string &b) -> bool {
-        if (case_insensitive) return bk_util::compare_strings_case_insensitive(a, b);
-        return a == b;
-    };
-
-    auto contains_compare = [&](const std::string &hay, const std::string &needle) -> bool {
-        if (needle.empty()) return false;
         if (case_insensitive) {
-            // fast path: try sliding-window equality using existing comparator
-            size_t nlen = needle.size();
-            if (nlen > hay.size()) return false;
-            for (size_t p = 0; p + nlen <= hay.size(); ++p) {
-                if (bk_util::compare_strings_case_insensitive(hay.substr(p, nlen), needle))
-                    return true;
-            }
-            return false;
-        } else {
-            return hay.find(needle) != std::string::npos;
+            n.key = bk_util::to_lower(n.key);
+            n.val = bk_util::to_lower(n.val);
+            n.raw = bk_util::to_lower(n.raw);
         }
-    };
+        needles.push_back(std::move(n));
+    }
+}
 
-    // For each line, tokenize and match needles deterministically
-    for (const auto &line : lines) {
-        if (line.empty()) continue;
-
-        // Tokenize with existing tokenizer so quotes are respected
-        std::vector<std::string> tokens = bk_util::tokenize(line, ' ');
-
-        bool matched_line = false;
-
-        // Build a map of key->value for tokens that contain '=' to speed repeated needle checks
-        std::unordered_map<std::string, std::string> kv_map;
-        kv_map.reserve(tokens.size());
-        for (const auto &tok : tokens) {
-            auto eqpos = tok.find('=');
-            if (eqpos != std::string::npos && eqpos > 0) {
-                std::string k = tok.substr(0, eqpos);
-                std::string v = tok.substr(eqpos + 1);
-                v = bk_util::trip_quotes(v);
-                kv_map.emplace(std::move(k), std::move(v));
+bool
+bk_util::line_matcher::matches(std::string_view line) const
+{
+    if (line.empty()) return false;
+
+    for (const auto &n : needles) {
+        if (!n.is_kv) {
+            // Tokens are the line split at spaces: without a space of its
+            // own, the needle is in a token exactly when it is in the line
+            if (!n.has_space) {
+                if (contains(line, n.raw, case_insensitive)) return true;
+                continue;
             }
+            for (size_t pos = 0; pos < line.size();)
+                if (contains(next_token(line, pos), n.raw, case_insensitive)) return true;
+            continue;
         }
 
-        // Check all needles; stop on first match
-        for (const auto &n : needles) {
-            if (n.is_kv) {
-                // Need exact key=value match (key compared literally or case-insensitive)
-                auto it = kv_map.find(n.key);
-                if (it != kv_map.end()) {
-                    if (eq_compare(it->second, n.val)) {
-                        matched_line = true;
-                        break;
-                    }
-                } else if (case_insensitive) {
-                    // If case-insensitive, try to find a key ignoring case
-                    for (const auto &kv : kv_map) {
-                        if (bk_util::compare_strings_case_insensitive(kv.first, n.key) &&
-                            eq_compare(kv.second, n.val)) {
-                            matched_line = true;
-                            break;
-                        }
-                    }
-                    if (matched_line) break;
-                }
-            } else {
-                // Plain needle: match against tokens (after trip_quotes) either by equality OR substring
-                for (const auto &tok : tokens) {
-                    std::string v = tok;
-                    // remove surrounding quotes if present
-                    if (v.size() >= 2 &&
-                        ((v.front() == '"' && v.back() == '"') ||
-                         (v.front() == '\'' && v.back() == '\''))) {
-                        v = v.substr(1, v.size()-2);
-                    }
-                    if (eq_compare(v, n.raw) || contains_compare(v, n.raw)) {
-                        matched_line = true;
-                        break;
-                    }
-                    // also try with the raw token (to catch things like TYPE="btrfs")
-                    if (eq_compare(tok, n.raw) || contains_compare(tok, n.raw)) {
-                        matched_line = true;
-                        break;
-                    }
-                }
-                if (matched_line) break;
-            }
+        // key=value: cheap rejection before splitting the line
+        if (!contains(line, n.key, case_insensitive)) continue;
+
+        for (size_t pos = 0; pos < line.size();) {
+            std::string_view tok = strip_quotes(next_token(line, pos));
+            size_t eq = tok.find('=');
+            if (eq == std::string_view::npos || eq == 0) continue;
+
+            if (equals(tok.substr(0, eq), n.key, case_insensitive)
+                && equals(strip_quotes(tok.substr(eq + 1)), n.val, case_insensitive))
+                return true;
         }
+    }
+    return false;
+}
 
-        if (matched_line) {
-            result.push_back(line);
-            if (max_coincidence_lines_count > 0 &&
-                result.size() >= max_coincidence_lines_count) {
-                return result;
-            }
+std::vector<std::string_view>
+bk_util::line_matcher::matching_lines(std::string_view buffer, size_t max_coincidence_lines_count) const
+{
+    std::vector<std::string_view> result;
+    if (needles.empty()) return result;
+
+    while (!buffer.empty()) {
+        size_t nl = buffer.find('\n');
+        std::string_view line = trim_view(buffer.substr(0, nl));
+        buffer.remove_prefix(nl == std::string_view::npos ? buffer.size() : nl + 1);
+
+        if (!matches(line)) continue;
+        result.push_back(line);
+        if (max_coincidence_lines_count > 0 && result.size() >= max_coincidence_lines_count)
+            break;
+    }
+    return result;
+}
+
+// Find all lines from 'lines' that contain ANY needle from 'substrs_to_find'.
+// If none found, return an empty vector.
+//
+// Needles are compiled once into a bk_util::line_matcher, which matches each
+// line in place. Returned lines are the original input lines (not lowercased).
+std::vector<std::string>
+bk_util::find_lines_matching_substring_in_vector(
+    const std::vector<std::string> &lines,
+    const std::vector<std::string> &substrs_to_find,
+    bool case_insensitive,
+    size_t max_coincidence_lines_count)
+{
+    std::vector<std::string> result;
+    if (lines.empty() || substrs_to_find.empty()) return result;
+
+    const line_matcher matcher(substrs_to_find, case_insensitive);
+
+    for (const auto &line : lines) {
+        if (!matcher.matches(line)) continue;
+
+        result.push_back(line);
+        if (max_coincidence_lines_count > 0 &&
+            result.size() >= max_coincidence_lines_count) {
+            return result;
         }
     }
 
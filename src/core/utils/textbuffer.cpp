@@ -0,0 +1,398 @@
+#include "beekeeper/util.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// Below this, one read() is as cheap as setting up a mapping
+constexpr size_t mmap_threshold = 64 * 1024;
+
+// Arena blocks; larger tokens get a block of their own
+constexpr size_t arena_block_size = 16 * 1024;
+
+inline bool
+is_quote(char c)
+{
+    return c == '"' || c == '\'';
+}
+
+// Whether s contains q not preceded by an odd number of backslashes
+bool
+has_unescaped_quote(std::string_view s, char q)
+{
+    for (size_t pos = 0; pos < s.size(); ++pos) {
+        if (s[pos] != q) continue;
+        size_t bs = 0;
+        size_t k = pos;
+        while (k > 0 && s[k - 1] == '\\') { ++bs; --k; }
+        if (bs % 2 == 0) return true;
+    }
+    return false;
+}
+
+inline bool
+inside(std::string_view part, std::string_view whole)
+{
+    return part.data() >= whole.data() && part.data() + part.size() <= whole.data() + whole.size();
+}
+
+} // anonymous namespace
+
+// ---------- arena ----------
+
+void
+bk_util::text_buffer::arena::reserve(size_t extra)
+{
+    if (!blocks.empty() && used + extra <= blocks[current].capacity)
+        return;
+
+    // The token being built moves along to the next block
+    size_t building = used - start;
+    size_t needed = building + extra;
+
+    size_t next = blocks.empty() ? 0 : current + 1;
+    while (next < blocks.size() && blocks[next].capacity < needed)
+        ++next;
+    if (next == blocks.size()) {
+        block b;
+        b.capacity = std::max(arena_block_size, needed);
+        b.data = std::make_unique<char[]>(b.capacity);
+        blocks.push_back(std::move(b));
+    }
+
+    if (building > 0)
+        std::memcpy(blocks[next].data.get(), blocks[current].data.get() + start, building);
+    current = next;
+    start = 0;
+    used = building;
+}
+
+void
+bk_util::text_buffer::arena::begin(std::string_view prefix)
+{
+    start = used;
+    append(prefix);
+}
+
+void
+bk_util::text_buffer::arena::push(char c)
+{
+    reserve(1);
+    blocks[current].data[used++] = c;
+}
+
+void
+bk_util::text_buffer::arena::append(std::string_view text)
+{
+    if (text.empty()) {
+        reserve(0);
+        return;
+    }
+    reserve(text.size());
+    std::memcpy(blocks[current].data.get() + used, text.data(), text.size());
+    used += text.size();
+}
+
+std::string_view
+bk_util::text_buffer::arena::finish()
+{
+    std::string_view built(blocks[current].data.get() + start, used - start);
+    start = used;
+    return built;
+}
+
+// ---------- text_buffer ----------
+
+bk_util::text_buffer::~text_buffer()
+{
+    release();
+}
+
+void
+bk_util::text_buffer::release()
+{
+    if (mapping)
+        munmap(mapping, size);
+    mapping = nullptr;
+    owned.clear();
+    data = nullptr;
+    size = 0;
+
+    line_views.clear();
+    lines_split = false;
+    clear_tokens();
+}
+
+void
+bk_util::text_buffer::clear_tokens()
+{
+    split_views.clear();
+    token_views.clear();
+    tokens_arena.reset();
+}
+
+bool
+bk_util::text_buffer::load(const std::string &path)
+{
+    release();
+
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    // /proc and /sys report a size of 0 (or a made-up one): read those
+    struct stat st{};
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)
+        && static_cast<size_t>(st.st_size) >= mmap_threshold)
+    {
+        void *m = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (m != MAP_FAILED) {
+            madvise(m, st.st_size, MADV_SEQUENTIAL);
+            close(fd);
+            mapping = m;
+            data = static_cast<const char *>(m);
+            size = static_cast<size_t>(st.st_size);
+            return true;
+        }
+    }
+    close(fd);
+
+    assign(bk_util::read_file(path));
+    return true;
+}
+
+void
+bk_util::text_buffer::assign(std::string text)
+{
+    release();
+    owned = std::move(text);
+    data = owned.data();
+    size = owned.size();
+}
+
+const std::vector<std::string_view> &
+bk_util::text_buffer::lines()
+{
+    if (lines_split)
+        return line_views;
+    lines_split = true;
+
+    std::string_view rest = text();
+    while (!rest.empty()) {
+        size_t nl = rest.find('\n');
+        std::string_view line = rest.substr(0, nl);
+        rest.remove_prefix(nl == std::string_view::npos ? rest.size() : nl + 1);
+
+        while (!line.empty() && std::isspace(static_cast<unsigned char>(line.front()))) line.remove_prefix(1);
+        while (!line.empty() && std::isspace(static_cast<unsigned char>(line.back()))) line.remove_suffix(1);
+        if (!line.empty())
+            line_views.push_back(line);
+    }
+    return line_views;
+}
+
+/**
+ * @brief bk_util::tokenize over views.
+ *
+ * Same two passes and the same rules (see bk_util::tokenize). A token is a
+ * view into @p line while it is a contiguous span of it; the first time a
+ * character is dropped (a grouping quote, an escaping backslash) it is
+ * copied to the arena and built on there. Tokens squashed back together
+ * after an '=' stay views into the line when only single delimiters
+ * separated them.
+ *
+ * @param line       Input text; tokens may point into it, so it must outlive them.
+ * @param split_char Delimiter character (commonly space).
+ * @return The tokens, in a vector reused by the next call.
+ */
+const std::vector<std::string_view> &
+bk_util::text_buffer::tokenize(std::string_view line, char split_char)
+{
+    split_views.clear();
+    token_views.clear();
+
+    // --- First pass: split, dropping grouping quotes ---
+    size_t span_start = 0, span_end = 0;   // current token while it is a span of line
+    bool in_arena = false;
+    char quote_char = '\0';
+
+    auto length = [&]() { return in_arena ? tokens_arena.length() : span_end - span_start; };
+    auto append = [&](size_t i) {
+        if (in_arena) {
+            tokens_arena.push(line[i]);
+        } else if (span_end == span_start) {
+            span_start = i;
+            span_end = i + 1;
+        } else if (span_end == i) {
+            ++span_end;
+        } else {
+            tokens_arena.begin(line.substr(span_start, span_end - span_start));
+            tokens_arena.push(line[i]);
+            in_arena = true;
+        }
+    };
+    auto emit = [&]() {
+        if (in_arena) {
+            std::string_view tok = tokens_arena.finish();
+            if (!tok.empty()) split_views.push_back(tok);
+        } else if (span_end > span_start) {
+            split_views.push_back(line.substr(span_start, span_end - span_start));
+        }
+        in_arena = false;
+        span_start = span_end = 0;
+    };
+
+    for (size_t i = 0; i < line.size(); ++i) {
+        char c = line[i];
+
+        size_t backslashes = 0;
+        while (backslashes < i && line[i - 1 - backslashes] == '\\') ++backslashes;
+        bool escaped = (backslashes % 2 == 1);
+
+        if (is_quote(c) && !escaped) {
+            if (quote_char == '\0' && length() == 0) {
+                quote_char = c;
+                continue;
+            }
+            if (quote_char != '\0' && quote_char == c) {
+                quote_char = '\0';
+                continue;
+            }
+            append(i);
+            continue;
+        }
+
+        // Escaped quote: drop one escaping backslash
+        if (is_quote(c) && escaped) {
+            if (length() > 0 && (in_arena ? tokens_arena.back() : line[span_end - 1]) == '\\') {
+                if (in_arena) {
+                    tokens_arena.pop();
+                } else {
+                    --span_end;
+                }
+            }
+            append(i);
+            continue;
+        }
+
+        if (c == split_char && quote_char == '\0') {
+            emit();
+            continue;
+        }
+
+        append(i);
+    }
+    emit();
+
+    // --- Second pass: squash tokens when an '=' is followed by a quote that was split across tokens ---
+    auto squash = [&](size_t from, size_t to) -> std::string_view {
+        // [from, to] are views into line separated by exactly one delimiter: one span
+        bool contiguous = true;
+        for (size_t k = from; k <= to && contiguous; ++k) {
+            if (!inside(split_views[k], line)) contiguous = false;
+            else if (k > from) {
+                const char *prev_end = split_views[k - 1].data() + split_views[k - 1].size();
+                contiguous = prev_end + 1 == split_views[k].data() && *prev_end == split_char;
+            }
+        }
+        if (contiguous) {
+            const char *first = split_views[from].data();
+            const char *last = split_views[to].data() + split_views[to].size();
+            return std::string_view(first, static_cast<size_t>(last - first));
+        }
+
+        tokens_arena.begin(split_views[from]);
+        for (size_t k = from + 1; k <= to; ++k) {
+            tokens_arena.push(split_char);
+            tokens_arena.append(split_views[k]);
+        }
+        return tokens_arena.finish();
+    };
+
+    for (size_t i = 0; i < split_views.size(); ++i) {
+        std::string_view tok = split_views[i];
+
+        size_t eqpos = tok.find('=');
+        if (eqpos == std::string_view::npos) {
+            token_views.push_back(tok);
+            continue;
+        }
+
+        // Look for an opening quote *after* '=' in the same token (skip spaces)
+        size_t p = eqpos + 1;
+        while (p < tok.size() && std::isspace(static_cast<unsigned char>(tok[p]))) ++p;
+
+        char opening_quote = '\0';
+        if (p < tok.size() && is_quote(tok[p])) {
+            opening_quote = tok[p];
+            if (tok.find(opening_quote, p + 1) != std::string_view::npos) {
+                token_views.push_back(tok);
+                continue;
+            }
+        } else {
+            if (i + 1 >= split_views.size()
+                || split_views[i + 1].empty() || !is_quote(split_views[i + 1][0]))
+            {
+                token_views.push_back(tok);
+                continue;
+            }
+            opening_quote = split_views[i + 1][0];
+            if (has_unescaped_quote(split_views[i + 1].substr(1), opening_quote)) {
+                token_views.push_back(squash(i, i + 1));
+                ++i;
+                continue;
+            }
+        }
+
+        // Merge tokens i .. j until an unescaped closing quote
+        bool closed = false;
+        size_t j = i + 1;
+        for (; j < split_views.size(); ++j) {
+            if (has_unescaped_quote(split_views[j], opening_quote)) {
+                closed = true;
+                break;
+            }
+        }
+
+        if (!closed) {
+            std::cerr << "warn: left unclosed quotes in line: " << line << std::endl;
+            token_views.push_back(squash(i, split_views.size() - 1));
+            break;
+        }
+        token_views.push_back(squash(i, j));
+        i = j;
+    }
+
+    return token_views;
+}
+
+std::string_view
+bk_util::text_buffer::unescape_mount_field(std::string_view field)
+{
+    if (field.find('\\') == std::string_view::npos)
+        return field;
+
+    tokens_arena.begin({});
+    for (size_t i = 0; i < field.size(); ++i) {
+        if (field[i] == '\\' && i + 3 < field.size()
+            && std::isdigit(static_cast<unsigned char>(field[i+1]))
+            && std::isdigit(static_cast<unsigned char>(field[i+2]))
+            && std::isdigit(static_cast<unsigned char>(field[i+3])))
+        {
+            // three octal digits
+            int v = (field[i+1]-'0')*64 + (field[i+2]-'0')*8 + (field[i+3]-'0');
+            tokens_arena.push(static_cast<char>(v));
+            i += 3;
+        } else {
+            tokens_arena.push(field[i]);
+        }
+    }
+    return tokens_arena.finish();
+}
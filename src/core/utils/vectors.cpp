@@ -2,6 +2,10 @@
 #include "beekeeper/util.hpp"
 #include <algorithm>
 
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
 const fs_info *
 bk_util::retrieve_filesystem_info_from_a_list(const fs_map &haystack, const std::string &needle)
 {
@@ -153,4 +157,66 @@ bk_util::difference_between_two_fs_maps (
     differences.just_changed = list_of_filesystems_that_still_exist_and_were_changed(snapshot, fresh_list);
 
     return differences;
-}
\ No newline at end of file
+}
+
+std::string
+bk_util::fs_map_to_json(const fs_map &filesystems)
+{
+    // Compact JSON array for machine consumption
+    std::string out;
+    out.reserve(filesystems.size() * 256);
+    out += '[';
+
+    bool is_first = true;
+    for (const auto &[uuid, info] : filesystems) {
+        if (!is_first) {
+            out += ',';
+        }
+
+        is_first = false;
+
+        out += "{\"uuid\":\"";      out += bk_util::json_escape(uuid);
+        out += "\",\"label\":\"";   out += bk_util::json_escape(info.label);
+        out += "\",\"status\":\"";  out += bk_util::json_escape(info.status);
+        out += "\",\"devname\":\""; out += bk_util::json_escape(info.devname);
+        out += "\",\"config\":\"";  out += bk_util::json_escape(info.config);
+        out += "\",\"compressing\":"; out += info.compressing ? "true" : "false";
+        out += ",\"autostart\":";     out += info.autostart ? "true" : "false";
+        out += '}';
+    }
+
+    out += ']';
+    return out;
+}
+
+fs_map
+bk_util::fs_map_from_json(const std::string &json)
+{
+    fs_map result;
+    if (json.empty()) return result;
+
+    QJsonParseError parseError;
+    QJsonDocument doc = QJsonDocument::fromJson(QByteArray::fromStdString(json), &parseError);
+    if (parseError.error != QJsonParseError::NoError) return result;
+    if (!doc.isArray()) return result;
+
+    QJsonArray fsArray = doc.array();
+    for (const QJsonValue &val : fsArray) {
+        if (!val.isObject()) continue;
+        QJsonObject obj = val.toObject();
+
+        result.emplace(
+            obj.value("uuid").toString("").toStdString(),
+            fs_info {
+                obj.value("label").toString("").toStdString(),
+                obj.value("status").toString("unknown").trimmed().toStdString(),
+                obj.value("devname").toString("unknown").trimmed().toStdString(),
+                obj.value("config").toString("unknown").trimmed().toStdString(),
+                obj.value("compressing").toBool(false),
+                obj.value("autostart").toBool(false)
+            }
+        );
+    }
+
+    return result;
+}
@@ -1,6 +1,9 @@
 #include "beekeeper/internalaliases.hpp"
+#include "beekeeper/recompressmgmt.hpp"
 #include "beekeeper/transparentcompressionmgmt.hpp"
+#include "livelog.hpp"
 #include "mainwindow.hpp"
+#include "metricspanel.hpp"
 #include "../polkit/globals.hpp"
 #include "../polkit/_staticcommander.hpp"
 #include "refreshfilesystems_helpers.hpp"
@@ -56,15 +59,41 @@ MainWindow::update_button_states()
         is_any(in_the_autostart_file, fs_table, fs_view_state)
     );
 
+    // Metrics come from a running bees, one filesystem at a time
+    metrics_btn->setEnabled(
+        refresh_fs_helpers::selected_rows_count(fs_table) == 1
+            &&
+        is_any(running, fs_table, fs_view_state)
+    );
+
     #ifdef BEEKEEPER_DEBUG_LOGGING
-    // enable logs button only if exactly 1 row and it’s running with logging
+    // enable logs button only if exactly 1 row and it’s running;
+    // the helper always keeps the latest output in memory
     showlog_btn->setEnabled(
         refresh_fs_helpers::selected_rows_count(fs_table) == 1
             &&
-        is_any(running_with_logging, fs_table, fs_view_state)
+        is_any(running, fs_table, fs_view_state)
     );
     #endif
 
+    // Existing data can be recompressed once compression is on; the
+    // checkpoint file is world-readable, so progress is read directly
+    recompress_btn->setEnabled(is_any(being_compressed, fs_table, fs_view_state));
+    {
+        QString tooltip = tr("Compress data written before transparent compression was enabled");
+        const QModelIndexList selected = list_of_selected_rows(fs_table, false);
+        if (selected.size() == 1) {
+            auto p = bk_mgmt::recompress::status(refresh_fs_helpers::fetch_user_role(selected.first(), 0).toStdString());
+            int percent = p.bytes_total ? static_cast<int>(std::min<uint64_t>(100, p.bytes_visited * 100 / p.bytes_total)) : 0;
+
+            if (p.state == "running" || p.state == "waiting")
+                tooltip = tr("Recompressing existing data: %1% done. Click to pause").arg(percent);
+            else if (p.state == "paused")
+                tooltip = tr("Recompression paused at %1%. Click to resume").arg(percent);
+        }
+        recompress_btn->setToolTip(tooltip);
+    }
+
     // Enable only if exactly 1 is selected,
     // it is configured and stopped
     remove_btn->setEnabled(
@@ -252,6 +281,51 @@ MainWindow::handle_setup()
     // will change the status in the Setup dialog instead
 }
 
+void
+MainWindow::handle_show_metrics()
+{
+    if (!komander->do_i_have_root_permissions()) return;
+
+    const QModelIndexList selected = list_of_selected_rows(fs_table, false);
+    if (selected.size() != 1) return;
+
+    const QString uuid = refresh_fs_helpers::fetch_user_role(selected.first(), 0);
+
+    auto it = fs_view_state.find(uuid.toStdString());
+    QString label = it != fs_view_state.end() ? QString::fromStdString(it->second.label) : QString();
+
+    // Non-modal: keep it open next to the table while bees works
+    auto *panel = new MetricsPanel(uuid, label, this);
+    panel->show();
+}
+
+/**
+ * @brief Start recompressing the existing data of the selected filesystems,
+ * or pause it if any of them is already being recompressed.
+ */
+void
+MainWindow::handle_recompress()
+{
+    if (!komander->do_i_have_root_permissions()) return;
+
+    const QModelIndexList selected = list_of_selected_rows(fs_table, false);
+
+    bool any_active = false;
+    for (const QModelIndex &idx : selected) {
+        auto state = bk_mgmt::recompress::status(refresh_fs_helpers::fetch_user_role(idx, 0).toStdString()).state;
+        any_active |= state == "running" || state == "waiting";
+    }
+
+    for (const QModelIndex &idx : selected) {
+        if (!any_active && !being_compressed(idx, fs_view_state))
+            continue;
+
+        const QString uuid = refresh_fs_helpers::fetch_user_role(idx, 0);
+        komander->recompress(uuid, any_active ? "pause" : "start")
+            .then(this, [this](bool) { update_button_states(); });
+    }
+}
+
 void
 MainWindow::handle_showlog()
 {
@@ -259,7 +333,17 @@ MainWindow::handle_showlog()
         return;
     }
 
-    // no-op: logging through GUI doesn't exist anymore
+    const QModelIndexList selected = list_of_selected_rows(fs_table, false);
+    if (selected.size() != 1) return;
+
+    const QString uuid = refresh_fs_helpers::fetch_user_role(selected.first(), 0);
+
+    auto it = fs_view_state.find(uuid.toStdString());
+    QString label = it != fs_view_state.end() ? QString::fromStdString(it->second.label) : QString();
+
+    // Streamed from the helper's in-memory capture, no log file involved
+    auto *log = new LiveLogDialog(uuid, tr("bees output: %1").arg(label.isEmpty() ? uuid : label), this);
+    log->show();
 }
 
 void
@@ -0,0 +1,50 @@
+#include "sparkline.hpp"
+#include <QPainter>
+#include <QPainterPath>
+#include <algorithm>
+
+Sparkline::Sparkline(QWidget *parent) : QWidget(parent)
+{
+    setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
+    hide();
+}
+
+void
+Sparkline::set_values (const QList<double> &new_values)
+{
+    values = new_values;
+    setVisible(values.size() >= 2);
+    update();
+}
+
+QSize
+Sparkline::sizeHint () const
+{
+    return QSize(96, fontMetrics().height());
+}
+
+void
+Sparkline::paintEvent (QPaintEvent *)
+{
+    if (values.size() < 2) return;
+
+    auto [min_it, max_it] = std::minmax_element(values.begin(), values.end());
+    double low = *min_it;
+    double span = std::max(*max_it - low, 1.0); // flat history: a line at the bottom
+
+    QRectF area = QRectF(rect()).adjusted(1, 1, -1, -1);
+    double step = area.width() / static_cast<double>(values.size() - 1);
+
+    QPainterPath path;
+    for (qsizetype i = 0; i < values.size(); ++i) {
+        QPointF point(area.left() + step * static_cast<double>(i),
+                      area.bottom() - (values[i] - low) / span * area.height());
+        if (i == 0) path.moveTo(point);
+        else path.lineTo(point);
+    }
+
+    QPainter painter(this);
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.setPen(QPen(palette().color(QPalette::Highlight), 1.5));
+    painter.drawPath(path);
+}
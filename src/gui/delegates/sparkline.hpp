@@ -0,0 +1,24 @@
+#pragma once
+
+#include <QList>
+#include <QWidget>
+
+// Small line chart for the status bar: the space saved over time on the
+// hovered filesystem. Hidden while it has nothing to draw.
+class Sparkline : public QWidget {
+    Q_OBJECT
+
+public:
+    Sparkline(QWidget *parent = nullptr);
+
+    // Points in time order; fewer than two hides the widget
+    void set_values (const QList<double> &values);
+
+    QSize sizeHint () const override;
+
+protected:
+    void paintEvent (QPaintEvent *event) override;
+
+private:
+    QList<double> values;
+};
@@ -1,14 +1,21 @@
 #include "beekeeper/beesdmgmt.hpp"
 #include "beekeeper/btrfsetup.hpp"
+#include "beekeeper/cgroupmgmt.hpp"
+#include "beekeeper/recompressmgmt.hpp"
+#include "beekeeper/schedulemgmt.hpp"
+#include "beekeeper/spacehistorymgmt.hpp"
 #include "tablecheckers.hpp"
 #include "mainwindow.hpp"
 
+#include <QDateTime>
+
 /**
  * @brief Event filter for hover detection over the filesystem table.
  * 
  * Monitors mouse movement over fs_table's viewport to detect when the user
  * hovers over a filesystem row. When hovering a running deduplication job,
- * displays space savings info in the status bar.
+ * displays space savings info in the status bar. Scheduled filesystems
+ * also show their next start/stop time.
  * 
  * @param obj The object receiving the event
  * @param event The event to process
@@ -33,6 +40,7 @@ bool MainWindow::eventFilter(QObject *obj, QEvent *event)
     // Step 4: Handle hover exit - clear status bar when not over any item
     if (!idx.isValid()) {
         barmessage->print("");
+        savings_sparkline->set_values({});
         return QMainWindow::eventFilter(obj, event);
     }
 
@@ -59,18 +67,104 @@ bool MainWindow::eventFilter(QObject *obj, QEvent *event)
 
     // Step 9: Check if deduplication is actively running on this filesystem
     // running() examines fs_view_state to determine operational status
+    QString message;
+
     if (tablecheckers::running(idx, fs_view_state)) {
         // Step 10: Format and display the space savings message
         // auto_size_suffix converts bytes to human-readable (GB, TB, etc.)
-        barmessage->print(
+        message =
             tr("Deduplicating files. Started with %1 free, now you have %2 free.")
                 .arg(bk_util::auto_size_suffix(starting_free_space))
-                .arg(bk_util::auto_size_suffix(current_free_space))
-        );
-    } else {
-        // Not running - clear any previous message
-        barmessage->print("");
+                .arg(bk_util::auto_size_suffix(current_free_space));
+
+        // Step 11: Append the worker's resource usage if it lives in its own cgroup
+        // Interface files are world-readable, so no helper round-trip is needed;
+        // they are re-read every few seconds, not on every mouse move
+        qint64 now_ms = QDateTime::currentMSecsSinceEpoch();
+        cached_cgroup_stats &cached = hover_cgroup_stats[uuid.toStdString()];
+        if (now_ms - cached.read_at_ms >= hover_stats_ttl_ms) {
+            cached.stats = bk_mgmt::cgroup::read_stats(uuid.toStdString());
+            cached.read_at_ms = now_ms;
+        }
+
+        const auto &usage = cached.stats;
+        if (usage.available) {
+            message += ' ';
+            message += tr("CPU time %1 s, %2 read, %3 written, %4 memory.")
+                .arg(usage.cpu_usage_usec / 1000000)
+                .arg(bk_util::auto_size_suffix(usage.io_rbytes))
+                .arg(bk_util::auto_size_suffix(usage.io_wbytes))
+                .arg(bk_util::auto_size_suffix(usage.memory_current));
+        }
+    }
+
+    // Step 12: Savings trend from the space history the helper samples
+    // The ring file is world-readable, so it is mapped directly; it is
+    // read once and again only after the helper's space_sampled signal
+    constexpr qint64 history_ttl_ms = bk_mgmt::spacehistory::sample_interval_sec * 1000LL;
+    auto cached_history = hover_space_history.find(uuid.toStdString());
+    if (cached_history == hover_space_history.end()
+        || QDateTime::currentMSecsSinceEpoch() - cached_history->second.read_at_ms >= history_ttl_ms) {
+        auto history = bk_mgmt::spacehistory::load(uuid.toStdString());
+
+        cached_space_history entry;
+        entry.read_at_ms = QDateTime::currentMSecsSinceEpoch();
+        for (const auto &s : history)
+            entry.saved_over_time << static_cast<double>(history.front().used) - static_cast<double>(s.used);
+        entry.trend = bk_mgmt::spacehistory::analyze(history);
+
+        cached_history = hover_space_history.insert_or_assign(uuid.toStdString(), std::move(entry)).first;
+    }
+    savings_sparkline->set_values(cached_history->second.saved_over_time);
+
+    if (tablecheckers::running(idx, fs_view_state)) {
+        const auto &trend = cached_history->second.trend;
+        if (trend.available && trend.rate_per_hour > 0) {
+            message += ' ';
+            message += tr("Saving %1/h.").arg(bk_util::auto_size_suffix(trend.rate_per_hour));
+            if (trend.eta)
+                message += ' ' + tr("Converging by %1.")
+                    .arg(QDateTime::fromSecsSinceEpoch(trend.eta).toString("ddd HH:mm"));
+        }
+    }
+
+    // Step 13: Scheduled filesystems also tell when the helper acts next
+    // The schedule file is world-readable, same as the autostart file
+    if (auto plan = bk_mgmt::schedule::fetch(uuid.toStdString())) {
+        std::time_t now = std::time(nullptr);
+        std::time_t when = bk_mgmt::schedule::next_transition(*plan, now);
+
+        if (when) {
+            QString at = QDateTime::fromSecsSinceEpoch(when).toString("ddd HH:mm");
+            bool goes_idle = bk_mgmt::schedule::active_window(*plan, when) < 0;
+
+            if (!message.isEmpty()) message += ' ';
+            message += goes_idle
+                ? (plan->pause_when_idle ? tr("Schedule: pauses at %1.").arg(at)
+                                         : tr("Schedule: stops at %1.").arg(at))
+                : tr("Schedule: runs from %1.").arg(at);
+        }
     }
 
+    // Step 14: Recompression of existing data, from its checkpoint file
+    auto recompression = bk_mgmt::recompress::status(uuid.toStdString());
+    if (recompression.state == "running" || recompression.state == "waiting" || recompression.state == "paused") {
+        int percent = recompression.bytes_total
+            ? static_cast<int>(std::min<uint64_t>(100, recompression.bytes_visited * 100 / recompression.bytes_total))
+            : 0;
+
+        if (!message.isEmpty()) message += ' ';
+        message += recompression.state == "paused"
+            ? tr("Recompression paused at %1%.").arg(percent)
+            : recompression.state == "waiting"
+                ? tr("Recompression waiting for a quieter moment (%1%).").arg(percent)
+                : tr("Recompressing: %1% (%2 rewritten).")
+                      .arg(percent)
+                      .arg(bk_util::auto_size_suffix(recompression.bytes_rewritten));
+    }
+
+    // Empty when none applies - clears any previous message
+    barmessage->print(message);
+
     return QMainWindow::eventFilter(obj, event);
 }
\ No newline at end of file
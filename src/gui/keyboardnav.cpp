@@ -489,8 +489,10 @@ QList<QWidget*> KeyboardNav::toolbarButtons()
             << mainWindow->stop_btn
             << mainWindow->setup_btn
             << mainWindow->compression_switch_btn
+            << mainWindow->recompress_btn
             << mainWindow->add_autostart_btn
             << mainWindow->remove_autostart_btn
+            << mainWindow->metrics_btn
             #ifdef BEEKEEPER_DEBUG_LOGGING
             << mainWindow->showlog_btn
             #endif
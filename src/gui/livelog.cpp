@@ -0,0 +1,91 @@
+// livelog.cpp
+//
+// Implementation of LiveLogDialog; see livelog.hpp.
+
+#include "livelog.hpp"
+#include "../polkit/globals.hpp" // komander
+
+#include <QDBusConnection>
+#include <QFontDatabase>
+#include <QPointer>
+#include <QPushButton>
+#include <QScrollBar>
+#include <QTextEdit>
+#include <QVBoxLayout>
+
+LiveLogDialog::LiveLogDialog(const QString &uuid, const QString &title, QWidget *parent)
+    : QDialog(parent), m_uuid(uuid)
+{
+    setAttribute(Qt::WA_DeleteOnClose);
+    setWindowTitle(title.isEmpty() ? uuid : title);
+    resize(900, 600);
+
+    auto *layout = new QVBoxLayout(this);
+
+    m_view = new QTextEdit(this);
+    m_view->setReadOnly(true);
+    m_view->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    // Plain text: bees lines are not HTML, and the ring holds 1 MiB anyway
+    m_view->setAcceptRichText(false);
+    layout->addWidget(m_view);
+
+    m_autoScroll = new QPushButton(tr("Auto scrolling"), this);
+    m_autoScroll->setCheckable(true);
+    m_autoScroll->setChecked(true);
+    layout->addWidget(m_autoScroll);
+
+    // Scrolling up stops following the output
+    connect(m_view->verticalScrollBar(), &QScrollBar::valueChanged, this, [this](int value) {
+        if (value != m_view->verticalScrollBar()->maximum())
+            m_autoScroll->setChecked(false);
+    });
+
+    QDBusConnection::systemBus().connect(
+        "org.beekeeper.dbush", "/org/beekeeper/dbush", "org.beekeeper.dbush",
+        "log_appended",
+        this, SLOT(on_log_appended(QString,qulonglong)));
+
+    fetch();
+}
+
+void
+LiveLogDialog::on_log_appended(const QString &uuid, qulonglong cursor)
+{
+    if (uuid.compare(m_uuid, Qt::CaseInsensitive) != 0 || cursor == m_cursor)
+        return;
+
+    fetch();
+}
+
+void
+LiveLogDialog::fetch()
+{
+    // One request in flight; announcements meanwhile fold into one more
+    if (m_fetching) {
+        m_fetchAgain = true;
+        return;
+    }
+    m_fetching = true;
+
+    QPointer<LiveLogDialog> self(this);
+    komander->beeslog_since(m_uuid, m_cursor).then(this, [self](const QVariantMap &chunk) {
+        if (!self) return;
+
+        if (chunk.value("lost").toBool())
+            self->m_view->append(tr("[... some output was overwritten before it could be shown ...]"));
+
+        for (const QString &line : chunk.value("lines").toStringList())
+            self->m_view->append(line);
+
+        self->m_cursor = chunk.value("cursor").toULongLong();
+
+        if (self->m_autoScroll->isChecked())
+            self->m_view->moveCursor(QTextCursor::End);
+
+        self->m_fetching = false;
+        if (self->m_fetchAgain) {
+            self->m_fetchAgain = false;
+            self->fetch();
+        }
+    });
+}
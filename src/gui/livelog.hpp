@@ -0,0 +1,41 @@
+#pragma once
+
+// livelog.hpp
+//
+// Non-modal window following the bees output of one filesystem, as
+// captured in memory by the helper. It starts with what the helper still
+// has and then appends only new lines: the helper announces new output with
+// the log_appended D-Bus signal and the window asks for whatever came
+// after the last cursor it saw.
+//
+// Usage:
+//   auto *log = new LiveLogDialog(uuid, title, this);
+//   log->show(); // deletes itself on close
+//
+#include <QDialog>
+#include <QString>
+
+class QPushButton;
+class QTextEdit;
+
+class LiveLogDialog : public QDialog
+{
+    Q_OBJECT
+public:
+    explicit LiveLogDialog(const QString &uuid, const QString &title, QWidget *parent = nullptr);
+    ~LiveLogDialog() override = default;
+
+private slots:
+    void on_log_appended(const QString &uuid, qulonglong cursor);
+
+private:
+    void fetch();
+
+    QString m_uuid;
+    qulonglong m_cursor = 0;
+    bool m_fetching = false;
+    bool m_fetchAgain = false;
+
+    QTextEdit *m_view = nullptr;
+    QPushButton *m_autoScroll = nullptr;
+};
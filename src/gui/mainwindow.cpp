@@ -54,8 +54,10 @@ MainWindow::MainWindow(QWidget* parent)
     compression_switch_btn->setToolTip(tr("Select a filesystem to view its transparent compression status"));
     compression_switch_btn->setCheckable(true);
     compression_switch_btn->setAutoRepeat(false);    // ensure no autorepeat
+    recompress_btn = new QPushButton(QIcon::fromTheme("edit-redo"), "");
     add_autostart_btn = new QPushButton(QIcon::fromTheme("list-add"), "");
     remove_autostart_btn = new QPushButton(QIcon::fromTheme("list-remove"), "");
+    metrics_btn = new QPushButton(QIcon::fromTheme("utilities-system-monitor"), "");
     #ifdef BEEKEEPER_DEBUG_LOGGING
     showlog_btn = new QPushButton(QIcon::fromTheme("text-x-log"), "");
     #endif
@@ -69,6 +71,7 @@ MainWindow::MainWindow(QWidget* parent)
     setup_btn->setToolTip(tr("Setup"));
     add_autostart_btn->setToolTip(tr("Automatically start deduplicating filesystems at boot"));
     remove_autostart_btn->setToolTip(tr("Do not start deduplicating filesystems at boot"));
+    metrics_btn->setToolTip(tr("Show live deduplication metrics"));
     #ifdef BEEKEEPER_DEBUG_LOGGING
     showlog_btn->setToolTip(tr("Show logs"));
     #endif
@@ -192,7 +195,7 @@ void MainWindow::setup_button_toolbar()
     main_layout = new QVBoxLayout(central_widget);
 
     QHBoxLayout *toolbar = new QHBoxLayout();
-    // Correct order: refresh, start, stop, spacing, setup, compression, add/remove autostart, debug, stretch, remove config
+    // Correct order: refresh, start, stop, spacing, setup, compression, recompression, add/remove autostart, metrics, debug, stretch, remove config
     toolbar->addWidget(refresh_btn);
     toolbar->addWidget(start_btn);
     toolbar->addWidget(stop_btn);
@@ -203,8 +206,10 @@ void MainWindow::setup_button_toolbar()
 
     toolbar->addWidget(setup_btn);
     toolbar->addWidget(compression_switch_btn);
+    toolbar->addWidget(recompress_btn);
     toolbar->addWidget(add_autostart_btn);
     toolbar->addWidget(remove_autostart_btn);
+    toolbar->addWidget(metrics_btn);
 
     #ifdef BEEKEEPER_DEBUG_LOGGING
     toolbar->addWidget(showlog_btn);
@@ -252,8 +257,11 @@ void MainWindow::connect_button_toolbar_handlers()
                 handle_transparentcompression_switch(checked);
             });
 
+    connect(recompress_btn, &QPushButton::clicked, this, &MainWindow::handle_recompress);
+
     connect(add_autostart_btn, &QPushButton::clicked, this, &MainWindow::handle_add_to_autostart);
     connect(remove_autostart_btn, &QPushButton::clicked, this, &MainWindow::handle_remove_from_autostart);
+    connect(metrics_btn, &QPushButton::clicked, this, &MainWindow::handle_show_metrics);
     #ifdef BEEKEEPER_DEBUG_LOGGING
     // showlog button handler
     connect(showlog_btn, &QPushButton::clicked, this, &MainWindow::handle_showlog);
@@ -307,6 +315,11 @@ void MainWindow::setup_status_bar()
 
     barmessage = new BarMessage(status_bar);
     status_bar->addWidget(barmessage);
+
+    // Space saved over time on the hovered filesystem
+    savings_sparkline = new Sparkline(status_bar);
+    savings_sparkline->setToolTip(tr("Space saved over the last days"));
+    status_bar->addPermanentWidget(savings_sparkline);
 }
 
 // connects
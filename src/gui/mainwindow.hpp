@@ -1,10 +1,13 @@
 #pragma once
 
+#include "beekeeper/cgroupmgmt.hpp"
 #include "beekeeper/debug.hpp"
 #include "beekeeper/qt-debug.hpp"
+#include "beekeeper/spacehistorymgmt.hpp"
 #include "beekeeper/internalaliases.hpp"
 #include "delegates/barmessage.hpp"
 #include "delegates/cpuusagemeter.hpp"
+#include "delegates/sparkline.hpp"
 #include "keyboardnav.hpp"
 #include "refreshfilesystems_helpers.hpp"
 #include "rootshellthread.hpp"
@@ -19,6 +22,7 @@
 #include <QTimer>
 #include <QVBoxLayout>
 #include <string>
+#include <unordered_map>
 
 #include "../polkit/globals.hpp"
 
@@ -67,6 +71,9 @@ private:
 
     void show_no_admin_rights_banner();
 
+    // Ask the helper about each configured hash table, warn once if any is fragmented
+    void warn_about_fragmented_hash_tables();
+
     std::unordered_map<std::string, std::string> get_baseline();
     void refresh_table(const bool fetch_data_from_daemon = false);
     void quick_refresh(
@@ -89,6 +96,8 @@ private:
     void handle_transparentcompression_switch(bool pause);
     void handle_remove_button();
     void handle_cpu_timer();
+    void handle_show_metrics();
+    void handle_recompress();
 
     // ----- Add or remove your filesystems from autostart -----
 
@@ -295,8 +304,10 @@ private:
     QPushButton *stop_btn = nullptr;
     QPushButton *setup_btn = nullptr;
     QPushButton *compression_switch_btn = nullptr;
+    QPushButton *recompress_btn = nullptr;
     QPushButton *add_autostart_btn = nullptr;
     QPushButton *remove_autostart_btn = nullptr;
+    QPushButton *metrics_btn = nullptr;
     #ifdef BEEKEEPER_DEBUG_LOGGING
     QPushButton *showlog_btn = nullptr; // exclusively for debugging purposes
     #endif
@@ -308,9 +319,28 @@ private:
 
     QString current_hovered_uuid;
 
+    // Hovering re-reads the worker's cgroup counters at most this often
+    static constexpr qint64 hover_stats_ttl_ms = 2000;
+    struct cached_cgroup_stats {
+        qint64 read_at_ms = 0;
+        bk_mgmt::cgroup::stats stats;
+    };
+    std::unordered_map<std::string, cached_cgroup_stats> hover_cgroup_stats;
+
+    // Space history only changes when the helper samples it (every 15
+    // minutes), so hovering maps and analyzes it once until then; the
+    // interval bounds the staleness when the signal is not connected
+    struct cached_space_history {
+        qint64 read_at_ms = 0;
+        QList<double> saved_over_time;
+        bk_mgmt::spacehistory::trend trend;
+    };
+    std::unordered_map<std::string, cached_space_history> hover_space_history;
+
     QStatusBar *status_bar;
     CpuUsageMeter *cpumeter;
     BarMessage *barmessage;
+    Sparkline *savings_sparkline;
 
     KeyboardNav *keyboardNav = nullptr;
 
@@ -318,6 +348,12 @@ public slots:
     void on_root_shell_ready();
 
 private slots:
+    // The helper saw a bees worker start or exit
+    void on_helper_status_changed(const QString &uuid, const QString &status);
+
+    // The helper added a sample to a filesystem's space history
+    void on_helper_space_sampled(const QString &uuid);
+
     // Show a log file automatically scrolled, like tail -f
     void showLog(const QString &logpath, const QString &customTitle = QStringLiteral());
     void update_button_states();
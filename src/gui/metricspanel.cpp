@@ -0,0 +1,145 @@
+// metricspanel.cpp
+//
+// Implementation of MetricsPanel. Metrics come from the helper (the status
+// file and the hash table size are root-only); see metricspanel.hpp.
+
+#include "beekeeper/util.hpp"
+#include "metricspanel.hpp"
+#include "../polkit/globals.hpp" // komander
+
+#include <QDateTime>
+#include <QDBusConnection>
+#include <QFormLayout>
+#include <QLabel>
+#include <QPointer>
+#include <QProgressBar>
+#include <QPushButton>
+#include <QTimer>
+#include <QVBoxLayout>
+#include <algorithm>
+
+namespace {
+
+// bees rewrites its status file every few seconds; this only matters when
+// the helper could not watch it
+constexpr int fallback_refresh_ms = 10000;
+
+QString
+human_size(double bytes)
+{
+    return QString::fromStdString(bk_util::auto_size_suffix(static_cast<size_t>(std::max(0.0, bytes))));
+}
+
+// fraction is 0..1, or negative when bees did not say
+void
+set_fraction(QProgressBar *bar, double fraction)
+{
+    if (fraction < 0) {
+        bar->setValue(0);
+        bar->setFormat(QObject::tr("Unknown"));
+        return;
+    }
+    bar->setValue(static_cast<int>(fraction * 1000));
+    bar->setFormat(QString::number(fraction * 100, 'f', 1) + "%");
+}
+
+QProgressBar *
+make_fraction_bar(QWidget *parent)
+{
+    auto *bar = new QProgressBar(parent);
+    bar->setRange(0, 1000);
+    bar->setTextVisible(true);
+    return bar;
+}
+
+} // anonymous namespace
+
+MetricsPanel::MetricsPanel(const QString &uuid, const QString &label, QWidget *parent)
+    : QDialog(parent), m_uuid(uuid)
+{
+    setAttribute(Qt::WA_DeleteOnClose);
+    setWindowTitle(tr("Deduplication metrics: %1").arg(label.isEmpty() ? uuid : label));
+    setMinimumWidth(380);
+
+    auto *layout = new QVBoxLayout(this);
+
+    m_state = new QLabel(tr("Waiting for bees..."), this);
+    layout->addWidget(m_state);
+
+    auto *form = new QFormLayout();
+    m_dedupRate = new QLabel("-", this);
+    m_scanRate = new QLabel("-", this);
+    m_dedupTotal = new QLabel("-", this);
+    m_extents = new QLabel("-", this);
+    m_crawl = make_fraction_bar(this);
+    m_hashFill = make_fraction_bar(this);
+
+    form->addRow(tr("Deduplicating:"), m_dedupRate);
+    form->addRow(tr("Scanning:"), m_scanRate);
+    form->addRow(tr("Deduplicated since start:"), m_dedupTotal);
+    form->addRow(tr("Extents scanned since start:"), m_extents);
+    form->addRow(tr("Crawl progress:"), m_crawl);
+    form->addRow(tr("Hash table fill (estimate):"), m_hashFill);
+    layout->addLayout(form);
+
+    auto *close_btn = new QPushButton(tr("Close"), this);
+    connect(close_btn, &QPushButton::clicked, this, &QDialog::close);
+    layout->addWidget(close_btn, 0, Qt::AlignRight);
+
+    QDBusConnection::systemBus().connect(
+        "org.beekeeper.dbush", "/org/beekeeper/dbush", "org.beekeeper.dbush",
+        "metrics_changed",
+        this, SLOT(on_metrics_changed(QString)));
+
+    m_fallbackTimer = new QTimer(this);
+    connect(m_fallbackTimer, &QTimer::timeout, this, &MetricsPanel::fetch);
+    m_fallbackTimer->start(fallback_refresh_ms);
+
+    fetch();
+}
+
+void
+MetricsPanel::on_metrics_changed(const QString &uuid)
+{
+    if (!bk_util::compare_strings_case_insensitive(uuid.toStdString(), m_uuid.toStdString()))
+        return;
+
+    // Fresh numbers just arrived; push the fallback back
+    m_fallbackTimer->start(fallback_refresh_ms);
+    fetch();
+}
+
+void
+MetricsPanel::fetch()
+{
+    if (!komander->do_i_have_root_permissions()) {
+        m_state->setText(tr("Administrator rights are needed to read bees metrics."));
+        return;
+    }
+
+    QPointer<MetricsPanel> self(this);
+    komander->metrics(m_uuid).then(this, [self](const QVariantMap &metrics) {
+        if (self)
+            self->show_metrics(metrics);
+    });
+}
+
+void
+MetricsPanel::show_metrics(const QVariantMap &metrics)
+{
+    if (metrics.isEmpty()) {
+        m_state->setText(tr("bees is not reporting metrics for this filesystem. Is deduplication running?"));
+        return;
+    }
+
+    QDateTime updated = QDateTime::fromSecsSinceEpoch(metrics.value("updated").toLongLong());
+    m_state->setText(tr("Last update from bees: %1").arg(updated.toString("HH:mm:ss")));
+
+    m_dedupRate->setText(tr("%1/s").arg(human_size(metrics.value("dedup_bytes_per_sec").toDouble())));
+    m_scanRate->setText(tr("%1/s").arg(human_size(metrics.value("scanned_bytes_per_sec").toDouble())));
+    m_dedupTotal->setText(human_size(metrics.value("dedup_bytes").toDouble()));
+    m_extents->setText(QString::number(metrics.value("extents_scanned").toULongLong()));
+
+    set_fraction(m_crawl, metrics.value("crawl_progress", -1).toDouble());
+    set_fraction(m_hashFill, metrics.value("hash_fill", -1).toDouble());
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+// metricspanel.hpp
+//
+// Non-modal window with the live dedupe metrics of one filesystem: dedupe
+// and scan rates, extents scanned, crawl progress and hash table fill, as
+// parsed by the helper from the bees status file.
+//
+// The helper announces every rewrite of that file with the metrics_changed
+// D-Bus signal, so the panel refreshes exactly when there is something new.
+// A slow timer covers helpers that cannot watch the status directory.
+//
+// Usage:
+//   auto *panel = new MetricsPanel(uuid, label, this);
+//   panel->show(); // deletes itself on close
+//
+#include <QDialog>
+#include <QString>
+
+class QLabel;
+class QProgressBar;
+class QTimer;
+
+class MetricsPanel : public QDialog
+{
+    Q_OBJECT
+public:
+    explicit MetricsPanel(const QString &uuid, const QString &label, QWidget *parent = nullptr);
+    ~MetricsPanel() override = default;
+
+private slots:
+    // The helper reparsed a status file
+    void on_metrics_changed(const QString &uuid);
+
+private:
+    void fetch();
+    void show_metrics(const QVariantMap &metrics);
+
+    QString m_uuid;
+
+    QLabel *m_state = nullptr;
+    QLabel *m_dedupRate = nullptr;
+    QLabel *m_scanRate = nullptr;
+    QLabel *m_dedupTotal = nullptr;
+    QLabel *m_extents = nullptr;
+    QProgressBar *m_crawl = nullptr;
+    QProgressBar *m_hashFill = nullptr;
+    QTimer *m_fallbackTimer = nullptr;
+};
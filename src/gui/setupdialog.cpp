@@ -1,9 +1,10 @@
 // setupdialog.cpp
 //
 // Implementation of SetupDialog. On Accept it:
-//  - Parses the db size from the combo box (default 256 MiB)
+//  - Parses the db size from the combo box (default: recommended per filesystem)
 //  - Filters uuids to those that need setup (supercommander->btrfstat(uuid) indicates no config)
-//  - Calls supercommander->beessetup(uuid, db_size) for each
+//  - Calls supercommander->beessetup(uuid, db_size, ..., bees_options) for each,
+//    with either auto-tune or the performance options picked by hand
 //  - If compression enabled, configures transparent compression (adds UUID to config)
 //    and remounts active filesystems with compression (management::transparentcompression::start)
 //  - Shows a summary (success / failures)
@@ -15,12 +16,16 @@
 // GUI refresh handles status updates.
 
 #include "beekeeper/btrfsetup.hpp"
+#include "beekeeper/compressbenchmgmt.hpp"
 #include "beekeeper/qt-debug.hpp"
+#include "beekeeper/tuningmgmt.hpp"
+#include "beekeeper/util.hpp"
 #include "mainwindow.hpp"
 #include "tablecheckers.hpp"
 #include "../polkit/globals.hpp" // launcher + komander
 #include "setupdialog.hpp"
 
+#include <algorithm>
 #include <QLabel>
 #include <QList>
 #include <QPushButton>
@@ -31,15 +36,24 @@
 #include <QCheckBox>
 #include <QComboBox>
 #include <QFont>
+#include <QFormLayout>
+#include <QGroupBox>
+#include <QHash>
 #include <QMetaObject>
+#include <QPointer>
 #include <qabstractitemmodel.h>
 #include <qobjectdefs.h>
 #include <qwindowdefs.h>
 #include <string>
+#include <thread>
 
 using namespace beekeeper::privileged;
 using namespace tablecheckers;
 
+// Compression suggestions per filesystem (lowercase UUID), for as long as
+// the GUI runs
+QHash<QString, QVariantMap> SetupDialog::analysis_cache;
+
 
 QStringList
 SetupDialog::filter_unconfigured_uuids (const QModelIndexList &selected)
@@ -64,7 +78,7 @@ SetupDialog::filter_unconfigured_uuids (const QModelIndexList &selected)
 
 
 SetupDialog::SetupDialog(const QStringList &uuids, QWidget *parent)
-    : QDialog(parent)
+    : QDialog(parent), m_uuids(uuids)
 {
     setWindowTitle(tr("Setting up selected filesystems"));
     setModal(true);
@@ -75,7 +89,8 @@ SetupDialog::SetupDialog(const QStringList &uuids, QWidget *parent)
     // Help label
     QLabel *help = new QLabel(
         tr("Only filesystems without an existing configuration will be modified.\n")
-        + tr("Select the database size. This value covers most of the use cases."), this
+        + tr("Select the database size. The recommended size is computed for each filesystem "
+             "from the data it holds and the RAM left for hash tables."), this
     );
     help->setWordWrap(true);
     main_layout->addWidget(help);
@@ -101,15 +116,23 @@ SetupDialog::SetupDialog(const QStringList &uuids, QWidget *parent)
     options.append(SizeOption{1 * 1024 * 1024 * 1024, tr("1 GiB")});
     options.append(SizeOption{4ULL * 1024 * 1024 * 1024, tr("4 GiB")});
 
+    // 0 = let the helper size each filesystem ("--db-size auto")
+    m_dbSizeCombo->addItem(tr("Recommended"), QVariant::fromValue<qulonglong>(0));
+
     for (const auto &opt : options)
         m_dbSizeCombo->addItem(opt.display, QVariant::fromValue<qulonglong>(opt.value));
 
-    // Set default to 256 MiB
-    for (int i = 0; i < m_dbSizeCombo->count(); ++i) {
-        if (m_dbSizeCombo->itemData(i).toULongLong() == 256 * 1024 * 1024) {
-            m_dbSizeCombo->setCurrentIndex(i);
-            break;
-        }
+    m_dbSizeCombo->setCurrentIndex(0);
+
+    // Show the figure for the first filesystem once the helper answers
+    if (!m_uuids.isEmpty() && launcher->root_alive) {
+        QPointer<QComboBox> combo = m_dbSizeCombo;
+        komander->advise_db_size(m_uuids.first())
+            .then(this, [combo](qulonglong recommended) {
+                if (!combo || !recommended) return;
+                combo->setItemText(0, tr("Recommended (%1)")
+                    .arg(QString::fromStdString(bk_util::auto_size_suffix(recommended))));
+            });
     }
 
     m_dbSizeCombo->setMaximumWidth(300);
@@ -136,9 +159,139 @@ SetupDialog::SetupDialog(const QStringList &uuids, QWidget *parent)
     // Default = Balanced (index 2)
     m_compressionCombo->setCurrentIndex(2);
 
+    // Write speed of each preset, from the last `compressctl --benchmark`
+    // of the first filesystem (the results file is world-readable)
+    if (!m_uuids.isEmpty()) {
+        auto bench = bk_mgmt::compressbench::load(m_uuids.first().toStdString());
+        for (const auto &r : bench.results) {
+            int index = m_compressionCombo->findData(QString::fromStdString(r.preset));
+            if (index < 0 || !r.ok) continue;
+            m_compressionCombo->setItemText(index, tr("%1 (writes %2/s)")
+                .arg(m_compressionCombo->itemText(index),
+                     QString::fromStdString(bk_util::auto_size_suffix(static_cast<size_t>(r.write_bytes_per_sec)))));
+        }
+    }
+
     compression_row->addWidget(m_compressionCombo, 1);
     main_layout->addLayout(compression_row);
 
+    // Suggest a preset from a sample of the first filesystem's data. Sampling
+    // keeps every core busy for up to 20 s, so it only runs when asked for
+    m_suggestBtn = new QPushButton(tr("Suggest"), this);
+    m_suggestBtn->setToolTip(tr("Sample this filesystem's data and recommend a compression level"));
+    m_suggestBtn->setEnabled(!m_uuids.isEmpty() && launcher->root_alive);
+    compression_row->addWidget(m_suggestBtn);
+    connect(m_suggestBtn, &QPushButton::clicked, this, &SetupDialog::start_analysis);
+
+    m_compressionHint = new QLabel(this);
+    m_compressionHint->setWordWrap(true);
+    m_compressionHint->setVisible(false);
+    main_layout->addWidget(m_compressionHint);
+
+    connect(m_compressionCombo, &QComboBox::activated, this,
+            [this](int) { m_compressionPicked = true; });
+
+    // An earlier suggestion for this filesystem still holds
+    if (!m_uuids.isEmpty()) {
+        auto cached = analysis_cache.constFind(m_uuids.first().toLower());
+        if (cached != analysis_cache.constEnd())
+            show_analysis(*cached);
+    }
+
+    // --- bees performance section ---
+    auto *perf_box = new QGroupBox(tr("Performance"), this);
+    auto *perf_layout = new QFormLayout(perf_box);
+
+    m_autoTune = new QCheckBox(tr("Tune automatically for this hardware"), perf_box);
+    m_autoTune->setChecked(true);
+    perf_layout->addRow(m_autoTune);
+
+    // 0 / "Default" means: let bees decide
+    m_threadCount = new QSpinBox(perf_box);
+    m_threadCount->setRange(0, 256);
+    m_threadCount->setSpecialValueText(tr("Default"));
+    perf_layout->addRow(tr("Threads:"), m_threadCount);
+
+    m_threadFactor = new QDoubleSpinBox(perf_box);
+    m_threadFactor->setRange(0.0, 16.0);
+    m_threadFactor->setSingleStep(0.25);
+    m_threadFactor->setSpecialValueText(tr("Default"));
+    perf_layout->addRow(tr("Threads per core:"), m_threadFactor);
+
+    m_loadavgTarget = new QDoubleSpinBox(perf_box);
+    m_loadavgTarget->setRange(0.0, 1024.0);
+    m_loadavgTarget->setSingleStep(0.5);
+    m_loadavgTarget->setSpecialValueText(tr("Off"));
+    perf_layout->addRow(tr("Load average target:"), m_loadavgTarget);
+
+    m_scanMode = new QComboBox(perf_box);
+    m_scanMode->addItem(tr("Default"),     QVariant(-1));
+    m_scanMode->addItem(tr("Lockstep"),    QVariant(0));
+    m_scanMode->addItem(tr("Independent"), QVariant(1));
+    m_scanMode->addItem(tr("Sequential"),  QVariant(2));
+    m_scanMode->addItem(tr("Recent"),      QVariant(3));
+    m_scanMode->addItem(tr("Extent"),      QVariant(4));
+    perf_layout->addRow(tr("Scan mode:"), m_scanMode);
+
+    m_throttleFactor = new QDoubleSpinBox(perf_box);
+    m_throttleFactor->setRange(0.0, 100.0);
+    m_throttleFactor->setSingleStep(0.5);
+    m_throttleFactor->setSpecialValueText(tr("Default"));
+    perf_layout->addRow(tr("Throttle factor:"), m_throttleFactor);
+
+    // Show what auto-tune would pick for the first filesystem. The helper
+    // tunes each filesystem on its own, since disks may differ.
+    bk_mgmt::bees_options proposal =
+        bk_mgmt::tuning::autotune(m_uuids.isEmpty() ? std::string() : m_uuids.first().toStdString());
+
+    m_threadCount->setValue(proposal.thread_count);
+    m_threadFactor->setValue(proposal.thread_factor);
+    m_loadavgTarget->setValue(proposal.loadavg_target);
+    m_scanMode->setCurrentIndex(m_scanMode->findData(proposal.scan_mode));
+    m_throttleFactor->setValue(proposal.throttle_factor);
+
+    auto set_manual_enabled = [this](bool auto_tune) {
+        for (QWidget *w : std::initializer_list<QWidget *>{
+                 m_threadCount, m_threadFactor, m_loadavgTarget, m_scanMode, m_throttleFactor })
+            w->setEnabled(!auto_tune);
+    };
+    set_manual_enabled(true);
+    connect(m_autoTune, &QCheckBox::toggled, this, set_manual_enabled);
+
+    main_layout->addWidget(perf_box);
+
+    // --- cgroup limits of the bees worker ---
+    auto *limits_box = new QGroupBox(tr("Resource limits"), this);
+    auto *limits_layout = new QFormLayout(limits_box);
+
+    // 0 means no limit: the kernel default applies
+    m_cpuLimit = new QSpinBox(limits_box);
+    m_cpuLimit->setRange(0, 100 * static_cast<int>(std::max(1u, std::thread::hardware_concurrency())));
+    m_cpuLimit->setSingleStep(25);
+    m_cpuLimit->setSuffix(tr("% of a core"));
+    m_cpuLimit->setSpecialValueText(tr("No limit"));
+    limits_layout->addRow(tr("CPU:"), m_cpuLimit);
+
+    m_ioWeight = new QSpinBox(limits_box);
+    m_ioWeight->setRange(0, 10000);
+    m_ioWeight->setSpecialValueText(tr("Default"));
+    m_ioWeight->setToolTip(tr("Share of the disk against other programs; 100 is the default of every program"));
+    limits_layout->addRow(tr("Disk weight:"), m_ioWeight);
+
+    m_memoryLimit = new QSpinBox(limits_box);
+    m_memoryLimit->setRange(0, 1024 * 1024);
+    m_memoryLimit->setSingleStep(256);
+    m_memoryLimit->setSuffix(tr(" MiB"));
+    m_memoryLimit->setSpecialValueText(tr("No limit"));
+    m_memoryLimit->setToolTip(tr("Memory above this is reclaimed under pressure; the hash table counts too"));
+    limits_layout->addRow(tr("Memory:"), m_memoryLimit);
+
+    for (QSpinBox *limit : { m_cpuLimit, m_ioWeight, m_memoryLimit })
+        connect(limit, &QSpinBox::valueChanged, this,
+                [this, limit](int) { m_editedLimits.insert(limit); });
+
+    main_layout->addWidget(limits_box);
+
     // Note label
     QString note_text = tr(
         "Note: compression only works for new files created while it is running.\n"
@@ -172,6 +325,111 @@ SetupDialog::SetupDialog(const QStringList &uuids, QWidget *parent)
     main_layout->addLayout(btn_row);
 }
 
+void
+SetupDialog::start_analysis()
+{
+    if (m_uuids.isEmpty() || m_analysisRunning)
+        return;
+
+    m_analysisRunning = true;
+    m_suggestBtn->setEnabled(false);
+    m_compressionHint->setText(tr("Sampling data to suggest a compression level..."));
+    m_compressionHint->setVisible(true);
+
+    const QString uuid = m_uuids.first();
+    QPointer<SetupDialog> self = this;
+
+    komander->analyze_compression(uuid)
+        .then(this, [self, uuid](const QVariantMap &analysis) {
+            // Cancelled or failed analyses come back empty; keep none of them
+            if (!analysis.isEmpty())
+                analysis_cache.insert(uuid.toLower(), analysis);
+
+            if (!self) return;
+            self->m_analysisRunning = false;
+            self->m_suggestBtn->setEnabled(true);
+
+            if (analysis.isEmpty()) {
+                self->m_compressionHint->setText(tr("Nothing could be sampled on this filesystem."));
+                return;
+            }
+            self->show_analysis(analysis);
+        });
+}
+
+void
+SetupDialog::show_analysis(const QVariantMap &analysis)
+{
+    const QString recommended = analysis.value("recommended").toString();
+    int index = m_compressionCombo->findData(recommended);
+    if (index < 0) {
+        m_compressionHint->setVisible(false);
+        return;
+    }
+
+    double saved = 0;
+    for (const QVariant &v : analysis.value("candidates").toList()) {
+        QVariantMap c = v.toMap();
+        if (c.value("preset").toString() == recommended)
+            saved = c.value("saved").toDouble();
+    }
+
+    m_compressionCombo->setItemText(index, tr("%1 (recommended)").arg(m_compressionCombo->itemText(index)));
+    if (!m_compressionPicked)
+        m_compressionCombo->setCurrentIndex(index);
+
+    m_compressionHint->setText(
+        tr("A sample of this filesystem's data would shrink by about %1% with the recommended level.")
+            .arg(qRound(saved * 100)));
+    m_compressionHint->setVisible(true);
+}
+
+void
+SetupDialog::done(int result)
+{
+    // Nobody is left to read the suggestion; free the helper's cores
+    if (m_analysisRunning)
+        komander->cancel_compression_analysis(m_uuids.first());
+
+    QDialog::done(result);
+}
+
+QVariantMap
+SetupDialog::bees_options_from_widgets() const
+{
+    QVariantMap opts;
+
+    // "default" clears the knob so bees' own default applies
+    auto number_or_default = [](double value) -> QVariant {
+        return value > 0 ? QVariant(value) : QVariant("default");
+    };
+
+    // Limits left alone keep what `beekeeperman setup` may have set
+    if (m_editedLimits.contains(m_cpuLimit))
+        opts.insert("cpu-max", m_cpuLimit->value() > 0 ? QVariant(QString("%1%").arg(m_cpuLimit->value()))
+                                                        : QVariant("default"));
+    if (m_editedLimits.contains(m_ioWeight))
+        opts.insert("io-weight", number_or_default(m_ioWeight->value()));
+    if (m_editedLimits.contains(m_memoryLimit))
+        opts.insert("memory-high", m_memoryLimit->value() > 0 ? QVariant(QString("%1M").arg(m_memoryLimit->value()))
+                                                               : QVariant("default"));
+
+    if (m_autoTune->isChecked()) {
+        opts.insert("auto-tune", "<default>");
+        return opts;
+    }
+
+    opts.insert("thread-count",    number_or_default(m_threadCount->value()));
+    opts.insert("thread-factor",   number_or_default(m_threadFactor->value()));
+    opts.insert("loadavg-target",  number_or_default(m_loadavgTarget->value()));
+    opts.insert("throttle-factor", number_or_default(m_throttleFactor->value()));
+
+    int scan_mode = m_scanMode->currentData().toInt();
+    opts.insert("scan-mode", scan_mode >= 0 ? QVariant(scan_mode) : QVariant("default"));
+
+    return opts;
+}
+
 void
 SetupDialog::on_text_changed(const QString & /*text*/)
 {
@@ -217,9 +475,13 @@ SetupDialog::accept()
     auto *setup_futures = new QList<QFuture<std::string>>();
     auto *tc_futures = new QList<QFuture<bool>>();
 
+    QVariantMap bees_options = bees_options_from_widgets();
+    if (db_size == 0)
+        bees_options.insert("db-size", "auto");
+
     // --- Beesd setup ---
     for (const QString &q : uuids_to_setup) {
-        setup_futures->append(komander->beessetup(q, db_size));
+        setup_futures->append(komander->beessetup(q, db_size, false, bees_options));
         // Render it as set up
         mw->fs_view_state[q.toStdString()].status = "stopped";
         mw->fs_view_state[q.toStdString()].config = "__DUMMY__";
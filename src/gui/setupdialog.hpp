@@ -2,8 +2,8 @@
 
 // setupdialog.hpp
 //
-// Small modal dialog used by the GUI to configure DB size for one or more
-// selected btrfs filesystems. The dialog only acts on filesystems that
+// Small modal dialog used by the GUI to configure DB size, bees
+// performance options and resource limits for one or more selected btrfs filesystems. The dialog only acts on filesystems that
 // currently lack a configuration file (it checks via supercommander->btrfstat).
 //
 // Usage:
@@ -14,10 +14,15 @@
 #include <QCheckBox>
 #include <QComboBox>
 #include <QDialog>
+#include <QDoubleSpinBox>
+#include <QHash>
 #include <QMainWindow>
+#include <QSet>
+#include <QSpinBox>
 #include <QStringList>
 #include <qtablewidget.h>
 
+class QLabel;
 class QLineEdit;
 class QPushButton;
 
@@ -31,10 +36,17 @@ public:
 
     QStringList filter_unconfigured_uuids (const QModelIndexList &selected);
 
+public slots:
+    // Cancels a compression analysis still running in the helper
+    void done(int result) override;
+
 private slots:
     // Override accept() so we run the setup operations before closing the dialog.
     void accept() override;
 
+    // Sample the first filesystem and recommend a compression level
+    void start_analysis();
+
     // Keep the Accept button enabled only when input is valid (digits or empty).
     void on_text_changed(const QString &text);
 
@@ -45,4 +57,30 @@ private:
     QPushButton *m_cancelBtn = nullptr;
     QCheckBox *m_enableCompression = nullptr;
     QComboBox *m_compressionCombo = nullptr;
+    QLabel *m_compressionHint = nullptr;
+    QPushButton *m_suggestBtn = nullptr;
+    bool m_compressionPicked = false;  // the user chose a preset: keep it
+    bool m_analysisRunning = false;
+
+    static QHash<QString, QVariantMap> analysis_cache;
+
+    // Mark the recommended preset and say what it saves
+    void show_analysis(const QVariantMap &analysis);
+
+    // bees performance options
+    QCheckBox *m_autoTune = nullptr;
+    QSpinBox *m_threadCount = nullptr;
+    QDoubleSpinBox *m_threadFactor = nullptr;
+    QDoubleSpinBox *m_loadavgTarget = nullptr;
+    QComboBox *m_scanMode = nullptr;
+    QDoubleSpinBox *m_throttleFactor = nullptr;
+
+    // cgroup limits of the bees worker
+    QSpinBox *m_cpuLimit = nullptr;      // percent of one core
+    QSpinBox *m_ioWeight = nullptr;
+    QSpinBox *m_memoryLimit = nullptr;   // MiB
+    QSet<const QSpinBox *> m_editedLimits;  // only these are sent to setup
+
+    // setup clause options for the chosen performance settings
+    QVariantMap bees_options_from_widgets() const;
 };
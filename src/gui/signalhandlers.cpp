@@ -2,9 +2,79 @@
 #include "beekeeper/debug.hpp"
 #include "../polkit/globals.hpp"
 
+#include <QDBusConnection>
+#include <QMessageBox>
+#include <memory>
+
 void
 MainWindow::on_root_shell_ready() {
     DEBUG_LOG("[MainWindow] Root shell ready signal received!"); // Mark launcher/komander as authorized/alive
     launcher->root_alive = true;
+
+    // Worker starts and crashes arrive as they happen instead of at the next refresh
+    QDBusConnection::systemBus().connect(
+        "org.beekeeper.dbush", "/org/beekeeper/dbush", "org.beekeeper.dbush",
+        "status_changed",
+        this, SLOT(on_helper_status_changed(QString,QString)));
+
+    QDBusConnection::systemBus().connect(
+        "org.beekeeper.dbush", "/org/beekeeper/dbush", "org.beekeeper.dbush",
+        "space_sampled",
+        this, SLOT(on_helper_space_sampled(QString)));
+
+    // The refresh below brings the configured filesystems; check them once it lands
+    connect(this, &MainWindow::table_refresh_finished,
+            this, &MainWindow::warn_about_fragmented_hash_tables,
+            Qt::SingleShotConnection);
+
     refresh_table(true); // now safe to enable root-only controls
+}
+
+void
+MainWindow::on_helper_status_changed(const QString &uuid, const QString &status)
+{
+    DEBUG_LOG("[MainWindow] helper reports ", uuid.toStdString(), " ", status.toStdString());
+    refresh_table(true);
+}
+
+void
+MainWindow::on_helper_space_sampled(const QString &uuid)
+{
+    // Re-read on the next hover
+    hover_space_history.erase(uuid.toStdString());
+}
+
+void
+MainWindow::warn_about_fragmented_hash_tables()
+{
+    struct pending_check {
+        int remaining = 0;
+        QStringList lines;
+    };
+    auto check = std::make_shared<pending_check>();
+
+    for (const auto &[uuid, info] : fs_view_state) {
+        if (info.status == "unconfigured") continue;
+
+        ++check->remaining;
+        QString label = QString::fromStdString(info.label.empty() ? uuid : info.label);
+
+        komander->fragmented_hash_table_extents(QString::fromStdString(uuid))
+            .then(this, [this, check, label](qulonglong extents) {
+                if (extents)
+                    check->lines << tr("%1: %2 extents").arg(label).arg(extents);
+
+                if (--check->remaining > 0 || check->lines.isEmpty())
+                    return;
+
+                QMessageBox::warning(
+                    this,
+                    tr("Fragmented hash table"),
+                    tr("The bees hash table of these filesystems is heavily fragmented, "
+                       "which makes deduplication slower over time:\n\n")
+                    + check->lines.join('\n')
+                    + tr("\n\nStop and start deduplication on them to rewrite it as a "
+                         "pre-allocated, non copy-on-write file."));
+            });
+    }
 }
\ No newline at end of file
@@ -10,10 +10,15 @@ QFuture<bool> beesstart(const QString &uuid, bool enable_logging) { return koman
 QFuture<bool> beesstop(const QString &uuid) { return komander->beesstop(uuid); }
 QFuture<bool> beesrestart(const QString &uuid) { return komander->beesrestart(uuid); }
 QFuture<std::string> beeslog(const QString &uuid) { return komander->beeslog(uuid); }
+QFuture<QVariantMap> beeslog_since(const QString &uuid, qulonglong cursor) { return komander->beeslog_since(uuid, cursor); }
 QFuture<bool> beesclean(const QString &uuid) { return komander->beesclean(uuid); }
 QFuture<std::string> beessetup(const QString &uuid,
                                 size_t db_size,
-                                bool return_success_bool_instead) { return komander->beessetup(uuid, db_size, return_success_bool_instead); }
+                                bool return_success_bool_instead,
+                                const QVariantMap &bees_options) { return komander->beessetup(uuid, db_size, return_success_bool_instead, bees_options); }
+QFuture<qulonglong> advise_db_size(const QString &uuid) { return komander->advise_db_size(uuid); }
+QFuture<qulonglong> fragmented_hash_table_extents(const QString &uuid) { return komander->fragmented_hash_table_extents(uuid); }
+QFuture<QVariantMap> metrics(const QString &uuid) { return komander->metrics(uuid); }
 QFuture<std::string> beeslocate(const QString &uuid) { return komander->beeslocate(uuid); }
 QFuture<bool> beesremoveconfig(const QString &uuid) { return komander->beesremoveconfig(uuid); }
 QFuture<std::string> btrfstat(const QString &uuid, const QString &mode) { return komander->btrfstat(uuid, mode); }
@@ -37,5 +42,21 @@ QFuture<bool> pause_transparentcompression_for_uuid(const QString &uuid)
 {
     return komander->pause_transparentcompression_for_uuid(uuid);
 }
+QFuture<QVariantMap> analyze_compression(const QString &uuid)
+{
+    return komander->analyze_compression(uuid);
+}
+QFuture<bool> cancel_compression_analysis(const QString &uuid)
+{
+    return komander->cancel_compression_analysis(uuid);
+}
+QFuture<bool> recompress(const QString &uuid, const QString &action)
+{
+    return komander->recompress(uuid, action);
+}
+QFuture<QVariantMap> recompress_status(const QString &uuid)
+{
+    return komander->recompress_status(uuid);
+}
 
 }}} // namespace beekeeper::privileged::_static
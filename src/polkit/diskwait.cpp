@@ -3,6 +3,7 @@
 
 #include "beekeeper/beesdmgmt.hpp"                  // beesstart, autostart, transparentcompression
 #include "beekeeper/btrfsetup.hpp"                  // get_mount_paths / get_real_device
+#include "beekeeper/schedulemgmt.hpp"                 // scheduled filesystems are left to windowscheduler
 #include "beekeeper/transparentcompressionmgmt.hpp"
 #include "beekeeper/debug.hpp"
 #include "beekeeper/util.hpp"
@@ -161,7 +162,7 @@ void process_existing_mounts()
     // do it synchronously to avoid any wrongdoing
     fully_refresh_libblkid_cache();
 
-    const fs::path by_uuid_dir{"/dev/disk/by-uuid"};
+    const fs::path by_uuid_dir{bk_util::system_path("/dev/disk/by-uuid")};
     if (!fs::exists(by_uuid_dir) || !fs::is_directory(by_uuid_dir)) {
         DEBUG_LOG("[diskwait] /dev/disk/by-uuid missing or not accessible - skipping initial scan");
         return;
@@ -184,6 +185,7 @@ void process_existing_mounts()
         {
             std::lock_guard<std::mutex> lk(autostart_mutex);
             if (bk_mgmt::autostart::is_enabled_for(uuid) &&
+                !bk_mgmt::schedule::is_scheduled(uuid) &&
                 autostart_started.find(uuid) == autostart_started.end()) {
                 DEBUG_LOG("[diskwait] initial-scan: autostart enabled, starting beesd once for uuid:", uuid);
                 if (!bk_mgmt::beesstart(uuid)) {
@@ -343,6 +345,7 @@ diskwait::run()
                 {
                     std::lock_guard<std::mutex> lk(autostart_mutex);
                     if (bk_mgmt::autostart::is_enabled_for(uuid) &&
+                        !bk_mgmt::schedule::is_scheduled(uuid) &&
                         autostart_started.find(uuid) == autostart_started.end()) {
 
                         if (!bk_mgmt::beesstart(uuid)) {
@@ -1,21 +1,120 @@
 #include "masterservice.hpp"
 
 #include "../core/clauses/bk-clauses.hpp"
-#include "beekeeper/debug.hpp"
+#include "beekeeper/metricsmgmt.hpp"
+#include "beekeeper/timingsmgmt.hpp"
 #include "beekeeper/util.hpp"
-#include "diskwait.hpp"
 
-#include <QCoreApplication>
+#include <QDBusArgument>
 #include <QDBusConnection>
 #include <QDBusConnectionInterface>
 #include <QDBusMessage>
+#include <QDBusMetaType>
+#include <QDBusReply>
 #include <QRunnable>
 
-#include <iostream>
+#include <chrono>
 #include <map>
 #include <string>
 #include <vector>
 
+namespace timings = beekeeper::management::timings;
+
+//
+// ---------- Caller checks ----------
+//
+
+namespace {
+
+// polkit's (sa{sv}) subject, here always a D-Bus sender
+struct polkit_subject {
+    QString kind;
+    QVariantMap details;
+};
+
+QDBusArgument &
+operator<<(QDBusArgument &arg, const polkit_subject &subject)
+{
+    arg.beginStructure();
+    arg << subject.kind << subject.details;
+    arg.endStructure();
+    return arg;
+}
+
+const QDBusArgument &
+operator>>(const QDBusArgument &arg, polkit_subject &subject)
+{
+    arg.beginStructure();
+    arg >> subject.kind >> subject.details;
+    arg.endStructure();
+    return arg;
+}
+
+} // anonymous namespace
+
+Q_DECLARE_METATYPE(polkit_subject)
+
+namespace {
+
+// Does polkit grant `sender` org.beekeeper.privileged, without asking?
+bool
+polkit_allows(const QDBusConnection &connection, const QString &sender)
+{
+    static const bool registered = [] {
+        qDBusRegisterMetaType<polkit_subject>();
+        qDBusRegisterMetaType<QMap<QString, QString>>();
+        return true;
+    }();
+    (void) registered;
+
+    QDBusMessage call = QDBusMessage::createMethodCall(
+        "org.freedesktop.PolicyKit1", "/org/freedesktop/PolicyKit1/Authority",
+        "org.freedesktop.PolicyKit1.Authority", "CheckAuthorization");
+    call << QVariant::fromValue(polkit_subject { "system-bus-name", { { "name", sender } } })
+         << QStringLiteral("org.beekeeper.privileged")
+         << QVariant::fromValue(QMap<QString, QString>())
+         << 0u          // no interaction: there is nobody to ask
+         << QString();
+
+    QDBusMessage reply = connection.call(call);
+    if (reply.type() != QDBusMessage::ReplyMessage || reply.arguments().isEmpty())
+        return false;
+
+    // (bba{ss}): is_authorized, is_challenge, details
+    const QDBusArgument result = reply.arguments().first().value<QDBusArgument>();
+    bool authorized = false, challenge = false;
+    QMap<QString, QString> details;
+    result.beginStructure();
+    result >> authorized >> challenge >> details;
+    result.endStructure();
+    return authorized;
+}
+
+// Why the sender of `msg` may not run `verb`, or "" if it may
+std::string
+caller_refusal(const QDBusConnection &connection, const QDBusMessage &msg,
+               const std::string &verb, const clause_options &options)
+{
+    const auto access = beekeeper::clauses::helper_access(verb, options);
+    if (access == beekeeper::clauses::helper_caller::anyone)
+        return "";
+
+    QDBusReply<uint> uid = connection.interface()->serviceUid(msg.service());
+    if (uid.isValid() && uid.value() == 0)
+        return "";
+
+    if (access == beekeeper::clauses::helper_caller::root_only)
+        return verb + " opens the paths it is given, so the helper only runs it for root;"
+                      " run beekeeperman " + verb + " yourself instead";
+
+    if (polkit_allows(connection, msg.service()))
+        return "";
+
+    return "Not authorized to run " + verb + " through the helper";
+}
+
+} // anonymous namespace
+
 //
 // ---------- Utilities (pure, thread-safe) ----------
 //
@@ -50,14 +149,19 @@ masterservice::convert_subjects(const QStringList &subjects)
 
 struct clause_runnable : public QRunnable
 {
-    clause_runnable(const QDBusMessage &msg,
+    clause_runnable(const clause_registry &registry,
+                    const QDBusConnection &connection,
+                    const QDBusMessage &msg,
                     const QString &verb,
                     const QVariantMap &options,
                     const QStringList &subjects)
-        : pending_msg(msg),
+        : registry(registry),
+          connection(connection),
+          pending_msg(msg),
           verb(verb),
           options(options),
-          subjects(subjects)
+          subjects(subjects),
+          arrived(std::chrono::steady_clock::now())
     {
         setAutoDelete(true);
     }
@@ -66,15 +170,22 @@ struct clause_runnable : public QRunnable
     {
         command_streams reply;
 
-        auto it = clauses_registry::get().find(verb.toStdString());
-        if (it == clauses_registry::get().end()) {
+        const clause_options opts = masterservice::convert_options(options);
+
+        auto it = registry.find(verb.toStdString());
+        if (it == registry.end()) {
             reply.errcode = 1;
             reply.stdout_str.clear();
             reply.stderr_str = "Unknown clause: " + verb.toStdString();
+        } else if (std::string refusal = caller_refusal(connection, pending_msg, it->first, opts);
+                   !refusal.empty()) {
+            reply.errcode = 1;
+            reply.stderr_str = refusal;
         } else {
             const clause &cmd = it->second;
+            timings::scoped_timer timer(timings::family::clause, it->first);
             reply = cmd.handler(
-                masterservice::convert_options(options),
+                opts,
                 masterservice::convert_subjects(subjects)
             );
         }
@@ -84,16 +195,24 @@ struct clause_runnable : public QRunnable
         dbus_reply["stderr_str"] = QString::fromStdString(reply.stderr_str);
         dbus_reply["errcode"]    = reply.errcode;
 
-        // Resolve the original DBus promise
-        QDBusConnection::systemBus().send(
+        // Resolve the original DBus promise, on the bus it came from
+        connection.send(
             pending_msg.createReply(dbus_reply)
         );
+
+        // Queueing in the pool included
+        timings::record(timings::family::dbus, "execute_clause",
+                        std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            std::chrono::steady_clock::now() - arrived).count());
     }
 
+    const clause_registry &registry;
+    QDBusConnection connection;
     QDBusMessage pending_msg;
     QString verb;
     QVariantMap options;
     QStringList subjects;
+    std::chrono::steady_clock::time_point arrived;
 };
 
 //
@@ -101,7 +220,13 @@ struct clause_runnable : public QRunnable
 //
 
 masterservice::masterservice(QObject *parent)
-    : QObject(parent)
+    : masterservice(clauses_registry::get(), parent)
+{
+}
+
+masterservice::masterservice(const clause_registry &registry, QObject *parent)
+    : QObject(parent),
+      registry(registry)
 {
     worker_pool.setMaxThreadCount(QThread::idealThreadCount());
 }
@@ -116,8 +241,8 @@ masterservice::_internal_execute_clause(const QString &verb,
                                         const QVariantMap &options,
                                         const QStringList &subjects)
 {
-    auto it = clauses_registry::get().find(verb.toStdString());
-    if (it == clauses_registry::get().end()) {
+    auto it = registry.find(verb.toStdString());
+    if (it == registry.end()) {
         return {
             "",
             "Unknown clause: " + verb.toStdString(),
@@ -125,6 +250,7 @@ masterservice::_internal_execute_clause(const QString &verb,
         };
     }
 
+    timings::scoped_timer timer(timings::family::clause, it->first);
     return it->second.handler(
         convert_options(options),
         convert_subjects(subjects)
@@ -146,54 +272,42 @@ masterservice::execute_clause(const QString &verb,
     setDelayedReply(true);
 
     // Fork into a worker thread
-    worker_pool.start(new clause_runnable(msg, verb, options, subjects));
+    worker_pool.start(new clause_runnable(registry, connection(), msg, verb, options, subjects));
 
     // Return nothing now — DBus reply will be sent from worker
     return QVariantMap();
 }
 
 //
-// ---------- main ----------
+// Typed metrics: cheap (a stat() unless bees just rewrote its status
+// file), so answered right away instead of going through the pool
 //
-
-int
-main(int argc, char **argv)
+QVariantMap
+masterservice::metrics(const QString &uuid)
 {
-    QCoreApplication app(argc, argv);
-
-    // Get registry reference (untranslated since no QTranslator installed)
-    const auto& clauses_registry = clauses_registry::get();
-
-    QDBusConnection bus = QDBusConnection::systemBus();
-    if (!bus.isConnected()) {
-        std::cerr << "System D-Bus is not connected; aborting helper\n";
-        return 1;
+    timings::scoped_timer timer(timings::family::dbus, "metrics");
+
+    auto m = bk_mgmt::metrics::read(uuid.toStdString());
+    if (!m.available)
+        return QVariantMap();
+
+    QVariantList crawl;
+    for (const auto &row : m.crawl) {
+        crawl.append(QVariantMap {
+            { "extent_size", QString::fromStdString(row.extent_size) },
+            { "data_size", static_cast<qulonglong>(row.data_size) },
+            { "position", row.position }
+        });
     }
 
-    if (bus.interface()->isServiceRegistered("org.beekeeper.dbush")) {
-        DEBUG_LOG("DBus name already owned, exiting cleanly");
-        return 0;
-    }
-
-    if (!bus.registerService("org.beekeeper.dbush")) {
-        std::cerr << "Failed to claim DBus name org.beekeeper.dbush\n";
-        return 2;
-    }
-
-    DEBUG_LOG("[thebeekeeper] registered service org.beekeeper.dbush");
-
-    masterservice helper;
-    if (!bus.registerObject("/org/beekeeper/dbush", &helper,
-                            QDBusConnection::ExportAllSlots)) {
-        std::cerr << "Failed to register DBus object /org/beekeeper/dbush\n";
-        return 1;
-    }
-
-    // diskwait is totally independent
-    diskwait *disk_thread = new diskwait();
-    disk_thread->start();
-    DEBUG_LOG("[thebeekeeper] diskwait thread launched");
-
-    DEBUG_LOG("[thebeekeeper] Helper DBus service ready and waiting for calls");
-    return app.exec();
+    return QVariantMap {
+        { "updated", static_cast<qlonglong>(m.updated) },
+        { "dedup_bytes_per_sec", m.dedup_bytes_per_sec },
+        { "scanned_bytes_per_sec", m.scanned_bytes_per_sec },
+        { "dedup_bytes", static_cast<qulonglong>(m.dedup_bytes) },
+        { "extents_scanned", static_cast<qulonglong>(m.extents_scanned) },
+        { "crawl_progress", m.crawl_progress },
+        { "hash_fill", m.hash_fill },
+        { "crawl", crawl }
+    };
 }
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "beekeeper/clauses.hpp"
 #include "beekeeper/util.hpp"
 #include <QObject>
 #include <QDBusContext>
@@ -9,6 +10,10 @@
 
 #include <map>
 #include <qcontainerfwd.h>
+#include <unordered_map>
+
+// Verb -> clause, as clauses_registry::get() returns it
+using clause_registry = std::unordered_map<std::string, clause>;
 
 class masterservice : public QObject, protected QDBusContext
 {
@@ -17,6 +22,10 @@ class masterservice : public QObject, protected QDBusContext
 
 public:
     explicit masterservice(QObject *parent = nullptr);
+
+    // Serve the clauses of `registry` instead (it must outlive the
+    // service), e.g. canned ones to time the D-Bus path on its own
+    explicit masterservice(const clause_registry &registry, QObject *parent = nullptr);
     ~masterservice();
 
 
@@ -37,6 +46,25 @@ public slots:
                     const QVariantMap &options,
                     const QStringList &subjects);
 
+    // Live dedupe metrics of one filesystem as typed D-Bus values
+    // (see beekeeper/metricsmgmt.hpp); empty if bees is not running
+    QVariantMap
+    metrics(const QString &uuid);
+
+signals:
+    // Forwarded from procwatcher: a bees worker started ("running") or exited ("stopped")
+    void status_changed(const QString &uuid, const QString &status);
+
+    // Forwarded from statuswatcher: bees rewrote its status file
+    void metrics_changed(const QString &uuid);
+
+    // Forwarded from spacesampler: a sample was added to the space history
+    void space_sampled(const QString &uuid);
+
+    // New bees output was captured; fetch it with `log --since <old cursor>`
+    void log_appended(const QString &uuid, qulonglong cursor);
+
 private:
+    const clause_registry &registry;
     QThreadPool worker_pool;
 };
\ No newline at end of file
@@ -0,0 +1,48 @@
+// procwatcher.cpp
+#include "procwatcher.hpp"
+
+#include "beekeeper/debug.hpp"
+#include "beekeeper/procwatchmgmt.hpp"
+
+#include <poll.h>
+
+namespace pw = beekeeper::management::procwatch;
+
+procwatcher::procwatcher(QObject *parent)
+    : QThread(parent)
+{
+}
+
+procwatcher::~procwatcher()
+{
+    requestInterruption();
+    wait();
+}
+
+void
+procwatcher::run()
+{
+    DEBUG_LOG("[procwatcher] thread started");
+
+    int fd = pw::subscribe();
+    if (fd < 0) {
+        // Status queries fall back to pidfiles and process scans
+        DEBUG_LOG("[procwatcher] proc connector unavailable, thread exiting");
+        return;
+    }
+
+    while (!isInterruptionRequested()) {
+        // Wake up every second to honour interruption
+        pollfd pfd { fd, POLLIN, 0 };
+        if (poll(&pfd, 1, 1000) <= 0 || !(pfd.revents & POLLIN))
+            continue;
+
+        for (const auto &change : pw::drain(fd))
+            emit worker_changed(QString::fromStdString(change.uuid),
+                                change.started ? QStringLiteral("running") : QStringLiteral("stopped"));
+    }
+
+    pw::unsubscribe(fd);
+
+    DEBUG_LOG("[procwatcher] thread exiting");
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <QString>
+#include <QThread>
+
+// Listens to kernel process events (proc connector) and keeps the
+// procwatch table of bees workers live. Emits worker_changed() when a
+// worker starts or exits, within milliseconds of it happening.
+class procwatcher : public QThread
+{
+    Q_OBJECT
+
+public:
+    explicit procwatcher(QObject *parent = nullptr);
+    ~procwatcher() override;
+
+signals:
+    // status is "running" or "stopped"
+    void worker_changed(const QString &uuid, const QString &status);
+
+protected:
+    void run() override;
+};
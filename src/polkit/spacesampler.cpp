@@ -0,0 +1,63 @@
+// spacesampler.cpp
+#include "spacesampler.hpp"
+
+#include "beekeeper/beesdmgmt.hpp"
+#include "beekeeper/debug.hpp"
+#include "beekeeper/spacehistorymgmt.hpp"
+#include "beekeeper/tuningmgmt.hpp"
+
+#include <ctime>
+#include <unordered_map>
+
+namespace history = beekeeper::management::spacehistory;
+
+spacesampler::spacesampler(QObject *parent)
+    : QThread(parent)
+{
+}
+
+spacesampler::~spacesampler()
+{
+    requestInterruption();
+    wait();
+}
+
+void
+spacesampler::run()
+{
+    DEBUG_LOG("[spacesampler] thread started");
+
+    // uuid -> time of its newest sample, so a helper restart does not
+    // squeeze in samples closer than one interval
+    std::unordered_map<std::string, std::time_t> last_sampled;
+
+    while (!isInterruptionRequested()) {
+        std::time_t now = std::time(nullptr);
+
+        for (const auto &[uuid, db_size] : bk_mgmt::tuning::configured_db_sizes()) {
+            auto known = last_sampled.find(uuid);
+            if (known == last_sampled.end()) {
+                auto samples = history::load(uuid);
+                known = last_sampled.emplace(uuid, samples.empty() ? 0 : samples.back().time).first;
+            }
+
+            if (now - known->second < history::sample_interval_sec)
+                continue;
+
+            // Savings only happen while bees works
+            if (bk_mgmt::beesstatus(uuid) != "running")
+                continue;
+
+            if (history::record(uuid)) {
+                known->second = now;
+                emit space_sampled(QString::fromStdString(uuid));
+            }
+        }
+
+        // Wake up every second to honour interruption
+        for (int i = 0; i < 60 && !isInterruptionRequested(); ++i)
+            msleep(1000);
+    }
+
+    DEBUG_LOG("[spacesampler] thread exiting");
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <QThread>
+
+// Samples free and used space of every deduplicating filesystem into its
+// space history ring (see beekeeper/spacehistorymgmt.hpp) once per
+// sampling interval, and says so, so readers of the ring know when to
+// re-read it.
+class spacesampler : public QThread
+{
+    Q_OBJECT
+
+public:
+    explicit spacesampler(QObject *parent = nullptr);
+    ~spacesampler() override;
+
+signals:
+    void space_sampled(const QString &uuid);
+
+protected:
+    void run() override;
+};
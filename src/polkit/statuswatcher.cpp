@@ -0,0 +1,48 @@
+// statuswatcher.cpp
+#include "statuswatcher.hpp"
+
+#include "beekeeper/debug.hpp"
+#include "beekeeper/metricsmgmt.hpp"
+
+#include <poll.h>
+#include <unistd.h>
+
+namespace metrics = beekeeper::management::metrics;
+
+statuswatcher::statuswatcher(QObject *parent)
+    : QThread(parent)
+{
+}
+
+statuswatcher::~statuswatcher()
+{
+    requestInterruption();
+    wait();
+}
+
+void
+statuswatcher::run()
+{
+    DEBUG_LOG("[statuswatcher] thread started");
+
+    int fd = metrics::watch();
+    if (fd < 0) {
+        // metrics::read() still works, it just notices changes by stat()
+        DEBUG_LOG("[statuswatcher] inotify unavailable, thread exiting");
+        return;
+    }
+
+    while (!isInterruptionRequested()) {
+        // Wake up every second to honour interruption
+        pollfd pfd { fd, POLLIN, 0 };
+        if (poll(&pfd, 1, 1000) <= 0 || !(pfd.revents & POLLIN))
+            continue;
+
+        for (const auto &uuid : metrics::changed(fd))
+            emit metrics_changed(QString::fromStdString(uuid));
+    }
+
+    close(fd);
+
+    DEBUG_LOG("[statuswatcher] thread exiting");
+}
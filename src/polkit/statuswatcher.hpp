@@ -0,0 +1,22 @@
+#pragma once
+
+#include <QString>
+#include <QThread>
+
+// Watches the bees status directory with inotify and re-parses a status
+// file only when bees finished rewriting it. Emits metrics_changed() for
+// that filesystem right after, so nobody has to poll for fresh numbers.
+class statuswatcher : public QThread
+{
+    Q_OBJECT
+
+public:
+    explicit statuswatcher(QObject *parent = nullptr);
+    ~statuswatcher() override;
+
+signals:
+    void metrics_changed(const QString &uuid);
+
+protected:
+    void run() override;
+};
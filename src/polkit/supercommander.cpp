@@ -58,34 +58,12 @@ supercommander::btrfsls()
     opts.insert("json", "<default>");
 
     return root_thread->call_bk_future("list", opts, QStringList{}).then([](command_streams res) {
-        fs_map result;
-
         if (!res.stdout_str.empty()) {
             DEBUG_LOG("RECEIVED BY btrfsls(): ", res.stdout_str);
-            QJsonParseError parseError;
-            QJsonDocument doc = QJsonDocument::fromJson(QByteArray::fromStdString(res.stdout_str), &parseError);
-            if (parseError.error != QJsonParseError::NoError) return result;
-            if (!doc.isArray()) return result;
-
-            QJsonArray fsArray = doc.array();
-            for (const QJsonValue &val : fsArray) {
-                if (!val.isObject()) continue;
-                QJsonObject obj = val.toObject();
-
-                result.emplace(
-                    obj.value("uuid").toString("").toStdString(),
-                    fs_info {
-                        obj.value("label").toString("").toStdString(),
-                        obj.value("status").toString("unknown").trimmed().toStdString(),
-                        obj.value("devname").toString("unknown").trimmed().toStdString(),
-                        obj.value("config").toString("unknown").trimmed().toStdString(),
-                        obj.value("compressing").toBool(false),
-                        obj.value("autostart").toBool(false)
-                    }
-                );
-            }
         }
 
+        fs_map result = bk_util::fs_map_from_json(res.stdout_str);
+
         /*
         #ifdef BEEKEEPER_DEBUG_LOGGING
         DEBUG_LOG("Found filesystems: ");
@@ -158,6 +136,35 @@ supercommander::beeslog(const QString &uuid)
         .then([](command_streams res) { return res.stdout_str; });
 }
 
+// Captured bees output after `cursor`: {"cursor", "lost", "lines"}.
+// Pass the returned cursor to the next call to only get new lines.
+QFuture<QVariantMap>
+supercommander::beeslog_since(const QString &uuid, qulonglong cursor)
+{
+    QVariantMap opts;
+    opts.insert("since", QString::number(cursor));
+    opts.insert("json", "<default>");
+
+    return root_thread->call_bk_future("log", opts, QStringList{uuid})
+        .then([cursor](command_streams res) -> QVariantMap {
+            QJsonDocument doc = QJsonDocument::fromJson(QByteArray::fromStdString(res.stdout_str));
+            if (!doc.isArray() || doc.array().isEmpty())
+                return { { "cursor", cursor }, { "lost", false }, { "lines", QStringList{} } };
+
+            QJsonObject obj = doc.array().first().toObject();
+
+            QStringList lines;
+            for (const QJsonValue &line : obj.value("lines").toArray())
+                lines << line.toString();
+
+            return {
+                { "cursor", static_cast<qulonglong>(obj.value("cursor").toDouble()) },
+                { "lost", obj.value("lost").toBool() },
+                { "lines", lines }
+            };
+        });
+}
+
 QFuture<bool>
 supercommander::beesclean(const QString &uuid)
 {
@@ -168,10 +175,13 @@ supercommander::beesclean(const QString &uuid)
 QFuture<std::string>
 supercommander::beessetup(const QString &uuid,
                           size_t db_size,
-                          bool return_success_bool_instead)
+                          bool return_success_bool_instead,
+                          const QVariantMap &bees_options)
 {
-    QVariantMap opts;
-    if (db_size) opts.insert("db_size", static_cast<qulonglong>(db_size));
+    // bees_options carries setup clause options as-is, e.g.
+    // {"auto-tune": "<default>"} or {"thread-count": 4, "scan-mode": "default"}
+    QVariantMap opts = bees_options;
+    if (db_size) opts.insert("db-size", static_cast<qulonglong>(db_size));
     opts.insert("json", "<default>");
 
     return root_thread->call_bk_future("setup", opts, QStringList{uuid})
@@ -196,6 +206,76 @@ supercommander::beessetup(const QString &uuid,
         });
 }
 
+// Recommended DB_SIZE in bytes, 0 if it could not be computed. Goes through
+// the helper because the other filesystems' configs are root-only.
+QFuture<qulonglong>
+supercommander::advise_db_size(const QString &uuid)
+{
+    QVariantMap opts;
+    opts.insert("advise", "<default>");
+    opts.insert("json", "<default>");
+
+    return root_thread->call_bk_future("setup", opts, QStringList{uuid})
+        .then([](command_streams res) -> qulonglong {
+            QJsonDocument doc = QJsonDocument::fromJson(QByteArray::fromStdString(res.stdout_str));
+            if (!doc.isObject())
+                return 0;
+
+            return static_cast<qulonglong>(doc.object().value("recommended").toDouble());
+        });
+}
+
+// Extent count of the hash table if it is heavily fragmented, 0 otherwise
+QFuture<qulonglong>
+supercommander::fragmented_hash_table_extents(const QString &uuid)
+{
+    QVariantMap opts;
+    opts.insert("inspect", "<default>");
+    opts.insert("json", "<default>");
+
+    return root_thread->call_bk_future("setup", opts, QStringList{uuid})
+        .then([](command_streams res) -> qulonglong {
+            QJsonDocument doc = QJsonDocument::fromJson(QByteArray::fromStdString(res.stdout_str));
+            if (!doc.isObject() || !doc.object().value("fragmented").toBool())
+                return 0;
+
+            return static_cast<qulonglong>(doc.object().value("extents").toDouble());
+        });
+}
+
+// Live dedupe metrics, keyed like the `metrics -j` output; empty when
+// bees has no status file for this filesystem
+QFuture<QVariantMap>
+supercommander::metrics(const QString &uuid)
+{
+    QVariantMap opts;
+    opts.insert("json", "<default>");
+
+    return root_thread->call_bk_future("metrics", opts, QStringList{uuid})
+        .then([](command_streams res) -> QVariantMap {
+            QJsonDocument doc = QJsonDocument::fromJson(QByteArray::fromStdString(res.stdout_str));
+            if (!doc.isArray() || doc.array().isEmpty())
+                return {};
+
+            QJsonObject obj = doc.array().first().toObject();
+            if (!obj.value("available").toBool())
+                return {};
+
+            return obj.toVariantMap();
+        });
+}
+
+// Stop an analyze_compression() still sampling; it then yields an empty map
+QFuture<bool>
+supercommander::cancel_compression_analysis(const QString &uuid)
+{
+    QVariantMap opts;
+    opts.insert("cancel-analysis", "<default>");
+
+    return root_thread->call_bk_future("compressctl", opts, QStringList{uuid})
+        .then([](command_streams res) { return res.errcode == 0; });
+}
+
 QFuture<std::string>
 supercommander::beeslocate(const QString &uuid)
 {
@@ -316,6 +396,58 @@ supercommander::pause_transparentcompression_for_uuid(const QString &uuid)
         .then([](command_streams) { return true; });
 }
 
+// Compressibility sample and recommended preset, keyed like the
+// `compressctl --analyze -j` output; empty when nothing could be sampled
+QFuture<QVariantMap>
+supercommander::analyze_compression(const QString &uuid)
+{
+    QVariantMap opts;
+    opts.insert("analyze", "<default>");
+    opts.insert("json", "<default>");
+
+    return root_thread->call_bk_future("compressctl", opts, QStringList{uuid})
+        .then([](command_streams res) -> QVariantMap {
+            QJsonDocument doc = QJsonDocument::fromJson(QByteArray::fromStdString(res.stdout_str));
+            if (!doc.isArray() || doc.array().isEmpty())
+                return {};
+
+            QJsonObject obj = doc.array().first().toObject();
+            if (!obj.value("available").toBool())
+                return {};
+
+            return obj.toVariantMap();
+        });
+}
+
+// Background recompression: action is "start", "pause" or "cancel"
+QFuture<bool>
+supercommander::recompress(const QString &uuid, const QString &action)
+{
+    QVariantMap opts;
+    opts.insert("recompress", action);
+
+    return root_thread->call_bk_future("compressctl", opts, QStringList{uuid})
+        .then([](command_streams res) { return res.errcode == 0; });
+}
+
+// Recompression progress, keyed like `compressctl --recompress status -j`
+QFuture<QVariantMap>
+supercommander::recompress_status(const QString &uuid)
+{
+    QVariantMap opts;
+    opts.insert("recompress", "status");
+    opts.insert("json", "<default>");
+
+    return root_thread->call_bk_future("compressctl", opts, QStringList{uuid})
+        .then([](command_streams res) -> QVariantMap {
+            QJsonDocument doc = QJsonDocument::fromJson(QByteArray::fromStdString(res.stdout_str));
+            if (!doc.isArray() || doc.array().isEmpty())
+                return {};
+
+            return doc.array().first().toObject().toVariantMap();
+        });
+}
+
 
 
 } // namespace privileged
@@ -0,0 +1,139 @@
+// thebeekeeper: the privileged helper. Owns org.beekeeper.dbush on the
+// system bus and runs the background threads.
+#include "masterservice.hpp"
+
+#include "../core/clauses/bk-clauses.hpp"
+#include "beekeeper/cgroupmgmt.hpp"
+#include "beekeeper/debug.hpp"
+#include "beekeeper/logringmgmt.hpp"
+#include "beekeeper/recompressmgmt.hpp"
+#include "beekeeper/timingsmgmt.hpp"
+#include "diskwait.hpp"
+#include "procwatcher.hpp"
+#include "spacesampler.hpp"
+#include "statuswatcher.hpp"
+#include "windowscheduler.hpp"
+
+#include <QCoreApplication>
+#include <QDBusConnection>
+#include <QDBusConnectionInterface>
+#include <QTimer>
+
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <string>
+
+int
+main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+
+    // Get registry reference (untranslated since no QTranslator installed)
+    const auto& clauses_registry = clauses_registry::get();
+
+    QDBusConnection bus = QDBusConnection::systemBus();
+    if (!bus.isConnected()) {
+        std::cerr << "System D-Bus is not connected; aborting helper\n";
+        return 1;
+    }
+
+    if (bus.interface()->isServiceRegistered("org.beekeeper.dbush")) {
+        DEBUG_LOG("DBus name already owned, exiting cleanly");
+        return 0;
+    }
+
+    if (!bus.registerService("org.beekeeper.dbush")) {
+        std::cerr << "Failed to claim DBus name org.beekeeper.dbush\n";
+        return 2;
+    }
+
+    DEBUG_LOG("[thebeekeeper] registered service org.beekeeper.dbush");
+
+    masterservice helper;
+    if (!bus.registerObject("/org/beekeeper/dbush", &helper,
+                            QDBusConnection::ExportAllSlots | QDBusConnection::ExportAllSignals)) {
+        std::cerr << "Failed to register DBus object /org/beekeeper/dbush\n";
+        return 1;
+    }
+
+    // Make room in our delegated cgroup for the per-filesystem ones
+    if (bk_mgmt::cgroup::enter_unit())
+        DEBUG_LOG("[thebeekeeper] moved into ", bk_mgmt::cgroup::unit_path, "/", bk_mgmt::cgroup::helper_leaf);
+
+    // diskwait is totally independent
+    diskwait *disk_thread = new diskwait();
+    disk_thread->start();
+    DEBUG_LOG("[thebeekeeper] diskwait thread launched");
+
+    // schedules are enforced on their own timer
+    windowscheduler *scheduler_thread = new windowscheduler();
+    scheduler_thread->start();
+    DEBUG_LOG("[thebeekeeper] windowscheduler thread launched");
+
+    // bees workers are tracked from kernel process events; the GUI hears
+    // about starts and crashes as a D-Bus signal
+    procwatcher *proc_thread = new procwatcher();
+    QObject::connect(proc_thread, &procwatcher::worker_changed,
+                     &helper, &masterservice::status_changed,
+                     Qt::QueuedConnection);
+    // A worker exiting inside its window is restarted by the scheduler
+    QObject::connect(proc_thread, &procwatcher::worker_changed, scheduler_thread,
+                     [scheduler_thread](const QString &, const QString &status) {
+                         if (status == QStringLiteral("stopped"))
+                             scheduler_thread->recheck();
+                     },
+                     Qt::DirectConnection);
+    proc_thread->start();
+    DEBUG_LOG("[thebeekeeper] procwatcher thread launched");
+
+    // bees status files are parsed when they change; the GUI is told
+    // so it can fetch the new metrics
+    statuswatcher *status_thread = new statuswatcher();
+    QObject::connect(status_thread, &statuswatcher::metrics_changed,
+                     &helper, &masterservice::metrics_changed,
+                     Qt::QueuedConnection);
+    status_thread->start();
+    DEBUG_LOG("[thebeekeeper] statuswatcher thread launched");
+
+    // free/used space history for savings rates and ETAs
+    spacesampler *space_thread = new spacesampler();
+    QObject::connect(space_thread, &spacesampler::space_sampled,
+                     &helper, &masterservice::space_sampled,
+                     Qt::QueuedConnection);
+    space_thread->start();
+    DEBUG_LOG("[thebeekeeper] spacesampler thread launched");
+
+    // recompression jobs cut short by a reboot or a helper restart go on
+    bk_mgmt::recompress::resume_all();
+
+    // Announce captured bees output at most a few times per second instead
+    // of once per line; clients pull the lines with their cursor
+    constexpr int log_announce_ms = 250;
+    std::map<std::string, uint64_t> announced_heads;
+    QTimer log_announcer;
+    QObject::connect(&log_announcer, &QTimer::timeout, &helper, [&helper, &announced_heads]() {
+        for (const auto &[uuid, head] : bk_mgmt::logring::heads()) {
+            uint64_t &announced = announced_heads[uuid];
+            if (head == announced) continue;
+            announced = head;
+            emit helper.log_appended(QString::fromStdString(uuid), head);
+        }
+    });
+    log_announcer.start(log_announce_ms);
+
+    // With BEEKEEPER_TIMINGS_INTERVAL=<seconds>, keep the helper's timings in
+    // /run/bees/beekeeper.prom for a node exporter's textfile collector
+    QTimer timings_exporter;
+    if (const char *interval = std::getenv("BEEKEEPER_TIMINGS_INTERVAL"); interval && std::atoi(interval) > 0) {
+        QObject::connect(&timings_exporter, &QTimer::timeout, &helper, []() {
+            bk_mgmt::timings::write_file(bk_mgmt::timings::default_file());
+        });
+        timings_exporter.start(std::atoi(interval) * 1000);
+        DEBUG_LOG("[thebeekeeper] writing timings to ", bk_mgmt::timings::default_file(),
+                  " every ", interval, " s");
+    }
+
+    DEBUG_LOG("[thebeekeeper] Helper DBus service ready and waiting for calls");
+    return app.exec();
+}
@@ -0,0 +1,184 @@
+// windowscheduler.cpp
+#include "windowscheduler.hpp"
+
+#include "beekeeper/beesdmgmt.hpp"
+#include "beekeeper/debug.hpp"
+#include "beekeeper/schedulemgmt.hpp"
+#include "beekeeper/util.hpp"
+
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+namespace sched = beekeeper::management::schedule;
+
+namespace {
+
+// Filesystems are only scheduled while their device is present
+bool
+is_present(const std::string &uuid)
+{
+    std::error_code ec;
+    return std::filesystem::exists(std::filesystem::path(bk_util::system_path("/dev/disk/by-uuid")) / uuid, ec);
+}
+
+std::filesystem::file_time_type
+config_mtime()
+{
+    std::error_code ec;
+    auto t = std::filesystem::last_write_time(bk_util::system_path(sched::schedule_config_file), ec);
+    return ec ? std::filesystem::file_time_type{} : t;
+}
+
+// Arm the timer for an absolute wall-clock time, or disarm it with 0.
+// TFD_TIMER_CANCEL_ON_SET wakes us up early if the clock is changed, so
+// we can recompute.
+void
+arm_timer(int tfd, std::time_t when)
+{
+    itimerspec spec {};
+    spec.it_value.tv_sec = when;
+
+    if (timerfd_settime(tfd, TFD_TIMER_ABSTIME | TFD_TIMER_CANCEL_ON_SET, &spec, nullptr) < 0)
+        DEBUG_LOG("[windowscheduler] timerfd_settime failed: ", strerror(errno));
+}
+
+} // anonymous namespace
+
+
+windowscheduler::windowscheduler(QObject *parent)
+    : QThread(parent),
+      wake_fd(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK))
+{
+}
+
+windowscheduler::~windowscheduler()
+{
+    requestInterruption();
+    if (wake_fd >= 0) {
+        uint64_t one = 1;
+        (void) write(wake_fd, &one, sizeof(one));
+    }
+    wait();
+    if (wake_fd >= 0)
+        close(wake_fd);
+}
+
+void
+windowscheduler::recheck()
+{
+    if (wake_fd >= 0) {
+        uint64_t one = 1;
+        (void) write(wake_fd, &one, sizeof(one));
+    }
+}
+
+void
+windowscheduler::run()
+{
+    DEBUG_LOG("[windowscheduler] thread started");
+
+    int tfd = timerfd_create(CLOCK_REALTIME, TFD_CLOEXEC | TFD_NONBLOCK);
+    if (tfd < 0) {
+        DEBUG_LOG("[windowscheduler] timerfd_create failed: ", strerror(errno));
+        return;
+    }
+
+    // Config rewrites (autostartctl --schedule) and disks coming and going
+    int ifd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+    const std::string config_dir =
+        std::filesystem::path(bk_util::system_path(sched::schedule_config_file)).parent_path().string();
+    bool watching = ifd >= 0
+        && inotify_add_watch(ifd, config_dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE) >= 0
+        && inotify_add_watch(ifd, bk_util::system_path("/dev/disk/by-uuid").c_str(),
+                             IN_CREATE | IN_DELETE | IN_MOVED_TO | IN_MOVED_FROM) >= 0;
+
+    // Without inotify, look again every few seconds
+    constexpr int fallback_poll_ms = 5000;
+    if (!watching)
+        DEBUG_LOG("[windowscheduler] cannot watch ", config_dir, " and /dev/disk/by-uuid, polling instead");
+
+    // Workers inside their window are also looked at this often, in case
+    // one exits without recheck() being called
+    constexpr int liveness_poll_ms = 60 * 1000;
+
+    std::vector<sched::plan> plans;
+    auto loaded_mtime = std::filesystem::file_time_type::min();
+
+    // uuid -> window index we last enforced (-1 = idle)
+    std::unordered_map<std::string, int> enforced;
+
+    while (!isInterruptionRequested()) {
+
+        // Reload on config changes (autostartctl --schedule writes this file)
+        auto mtime = config_mtime();
+        if (mtime != loaded_mtime) {
+            DEBUG_LOG("[windowscheduler] (re)loading ", bk_util::system_path(sched::schedule_config_file));
+            plans = sched::list();
+            loaded_mtime = mtime;
+            enforced.clear();
+        }
+
+        std::time_t now = std::time(nullptr);
+        std::time_t earliest = 0;
+        bool any_active = false;
+
+        for (const auto &p : plans) {
+            if (!is_present(p.uuid)) {
+                enforced.erase(p.uuid);
+                continue;
+            }
+
+            int index = sched::active_window(p, now);
+            auto it = enforced.find(p.uuid);
+
+            // Newly plugged in, reloaded, or crossed a boundary
+            if (it == enforced.end() || it->second != index) {
+                DEBUG_LOG("[windowscheduler] ", p.uuid, " enters window ", index);
+                enforced[p.uuid] = sched::apply(p, now);
+            } else if (index >= 0 && bk_mgmt::beesstatus(p.uuid) == "stopped") {
+                // Crashed or stopped by hand: the window still wants it running
+                DEBUG_LOG("[windowscheduler] bees for ", p.uuid, " exited inside window ", index, ", starting it again");
+                enforced[p.uuid] = sched::apply(p, now);
+            }
+            any_active = any_active || index >= 0;
+
+            std::time_t next = sched::next_transition(p, now);
+            if (next && (!earliest || next < earliest))
+                earliest = next;
+        }
+
+        arm_timer(tfd, earliest);
+
+        // Sleep until the boundary, a watched change, or the destructor
+        pollfd pfds[3] = {
+            { tfd, POLLIN, 0 },
+            { watching ? ifd : -1, POLLIN, 0 },
+            { wake_fd, POLLIN, 0 },
+        };
+        const int timeout_ms = !watching ? fallback_poll_ms : any_active ? liveness_poll_ms : -1;
+        if (poll(pfds, 3, timeout_ms) <= 0)
+            continue;
+
+        // ECANCELED on the timer means the clock jumped: just recompute
+        uint64_t count = 0;
+        (void) read(tfd, &count, sizeof(count));
+        (void) read(wake_fd, &count, sizeof(count));
+
+        char events[4096];
+        while (watching && read(ifd, events, sizeof(events)) > 0) {}
+    }
+
+    if (ifd >= 0)
+        close(ifd);
+    close(tfd);
+
+    DEBUG_LOG("[windowscheduler] thread exiting");
+}
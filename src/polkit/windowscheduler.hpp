@@ -0,0 +1,26 @@
+#pragma once
+
+#include <QThread>
+
+// Enforces /etc/bees/schedulesettings.cfg: sleeps on a timerfd until the
+// next window boundary of any schedule, then starts, stops, pauses or
+// resumes the affected bees workers. Besides the timer only inotify
+// (config rewritten, disk plugged in or out), recheck() and the destructor
+// wake it. A worker that exits inside its window is started again.
+class windowscheduler : public QThread
+{
+    Q_OBJECT
+
+public:
+    explicit windowscheduler(QObject *parent = nullptr);
+    ~windowscheduler() override;
+
+    // Look at the workers again, e.g. because one exited. Any thread.
+    void recheck();
+
+protected:
+    void run() override;
+
+private:
+    int wake_fd = -1;   // eventfd, written to stop or recheck
+};
@@ -0,0 +1,88 @@
+// Checks of dedupe's input parsing and its "already shared" test, which
+// decides what is submitted to FIDEDUPERANGE. Needs no filesystem.
+#include "beekeeper/dedupemgmt.hpp"
+#include "testcheck.hpp"
+
+#include <iostream>
+#include <linux/fiemap.h>
+
+namespace dd = beekeeper::management::dedupe;
+
+static void
+test_parse_sets()
+{
+    auto sets = dd::parse_sets("/a/1\n/a/2\n\n/b/1\r\n/b/2\r\n/b/3\n\n/lonely\n");
+    check(sets.size() == 2, "fdupes: two sets, the single file dropped");
+    check(sets.size() == 2 && sets[1].size() == 3 && sets[1][2] == "/b/3", "fdupes: CRLF line ends stripped");
+
+    sets = dd::parse_sets("/a/1\n/a/2");
+    check(sets.size() == 1 && sets[0].size() == 2, "fdupes: last set without a trailing blank line");
+
+    const std::string json =
+        "{\"files\":4,\"sets\":["
+        "{\"size\":10,\"paths\":[\"/x/a\\\"b\",\"/x/tab\\there\"]},"
+        "{\"size\":20,\"paths\":[\"/only\"]},"
+        "{\"size\":30,\"paths\":[\"/y/caf\\u00e9\",\"/y/\\u20ac\",\"/y/\\ud83d\\ude00\",\"/y/\\u0001\"]}"
+        "]}";
+    sets = dd::parse_sets(json);
+    check(sets.size() == 2, "json: sets of one file dropped");
+    if (sets.size() != 2)
+        return;
+    check(sets[0][0] == "/x/a\"b" && sets[0][1] == "/x/tab\there", "json: quote and tab escapes");
+    check(sets[1][0] == "/y/caf\xc3\xa9", "json: \\u00e9 as two UTF-8 bytes");
+    check(sets[1][1] == "/y/\xe2\x82\xac", "json: \\u20ac as three UTF-8 bytes");
+    check(sets[1][2] == "/y/\xf0\x9f\x98\x80", "json: surrogate pair as one four-byte code point");
+    check(sets[1][3] == std::string("/y/\x01"), "json: control character");
+
+    check(dd::parse_sets("").empty(), "empty input");
+}
+
+static void
+test_already_shared()
+{
+    constexpr uint64_t k = 4096;
+    const uint32_t shared = FIEMAP_EXTENT_SHARED;
+    const uint32_t encoded = FIEMAP_EXTENT_ENCODED | FIEMAP_EXTENT_SHARED;
+
+    std::vector<dd::extent> src { { 0, 100 * k, 8 * k, shared } };
+
+    // Same physical extent, split differently in dst
+    std::vector<dd::extent> dst { { 0, 100 * k, 4 * k, shared }, { 4 * k, 104 * k, 4 * k, shared } };
+    check(dd::already_shared(src, dst, 0, 8 * k), "same blocks, different extent boundaries");
+
+    // Shared with someone else, not with src
+    dst = { { 0, 200 * k, 8 * k, shared } };
+    check(!dd::already_shared(src, dst, 0, 8 * k), "shared elsewhere");
+
+    // Same address but the flag is missing: not to be trusted
+    dst = { { 0, 100 * k, 8 * k, 0 } };
+    check(!dd::already_shared(src, dst, 0, 8 * k), "unshared dst");
+
+    // Only the second half differs: a range in the first half is shared
+    dst = { { 0, 100 * k, 4 * k, shared }, { 4 * k, 300 * k, 4 * k, 0 } };
+    check(dd::already_shared(src, dst, 0, 4 * k), "first half shared");
+    check(!dd::already_shared(src, dst, 0, 8 * k), "whole range not shared");
+
+    // Holes in both count as shared, a hole in one does not
+    std::vector<dd::extent> sparse { { 8 * k, 100 * k, 4 * k, shared } };
+    std::vector<dd::extent> sparse_too { { 8 * k, 100 * k, 4 * k, shared } };
+    check(dd::already_shared(sparse, sparse_too, 0, 12 * k), "hole in both, then the same extent");
+    check(!dd::already_shared(src, sparse, 0, 8 * k), "hole in dst only");
+
+    // Compressed extents report the start of the whole extent
+    std::vector<dd::extent> csrc { { 0, 500 * k, 32 * k, encoded } };
+    std::vector<dd::extent> cdst { { 0, 500 * k, 32 * k, encoded } };
+    check(dd::already_shared(csrc, cdst, 8 * k, 8 * k), "same compressed extent");
+    cdst = { { 0, 600 * k, 32 * k, encoded } };
+    check(!dd::already_shared(csrc, cdst, 8 * k, 8 * k), "other compressed extent");
+
+    check(dd::already_shared({}, {}, 0, 8 * k), "empty maps: a hole in both");
+}
+
+int
+main()
+{
+    test_parse_sets();
+    test_already_shared();
+    return check_status();
+}
@@ -0,0 +1,399 @@
+// fake-bees: a stand-in for bees and beesd, so starting, stopping and
+// autostarting can be exercised without btrfs or a real bees.
+//
+// Run as anything whose name ends in "beesd" it behaves like the beesd
+// script: `beesd [bees options] <uuid>` checks the filesystem is configured
+// in /etc/bees, creates /run/bees/mnt/<uuid> and re-executes itself as the
+// worker on it, forwarding SIGTERM and cleaning up after it. Under any other
+// name it is the worker: `bees [options] <mountpoint>`, with bees' option
+// set and argument checks, writing a BEESSTATUS file with counters that grow
+// like a real scan would.
+//
+// Paths are under $BEEKEEPER_SYSROOT when that is set, like beekeeper's own.
+// Point the launcher at it with BEEKEEPER_BEES=/path/to/fake-bees (or
+// BEEKEEPER_BEESD, with BEEKEEPER_BEES set to "" to force the beesd path).
+//
+// Behaviour knobs, all optional:
+//   FAKE_BEES_START_DELAY_MS      the worker waits this long before it
+//                                 checks its arguments and reports (0)
+//   FAKE_BEES_CRASH_AFTER_MS      abort() this long after starting; 0 makes
+//                                 the worker fail right away, like bees
+//                                 rejecting its arguments (never)
+//   FAKE_BEES_TERM_DELAY_MS       linger this long after SIGTERM (0)
+//   FAKE_BEES_IGNORE_TERM         non-empty: ignore SIGTERM, wait for SIGKILL
+//   FAKE_BEES_STATUS_INTERVAL_MS  how often BEESSTATUS is rewritten (1000)
+//   FAKE_BEES_SCAN_RATE           bytes scanned per second (64 MiB)
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <dirent.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+volatile sig_atomic_t terminate_requested = 0;
+volatile sig_atomic_t forward_to = 0;
+
+long
+env_ms(const char *name, long fallback)
+{
+    const char *value = std::getenv(name);
+    if (!value || !*value)
+        return fallback;
+    return std::strtol(value, nullptr, 10);
+}
+
+double
+now_ms()
+{
+    timespec ts {};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+void
+sleep_ms(long ms)
+{
+    timespec ts { ms / 1000, (ms % 1000) * 1000000L };
+    while (nanosleep(&ts, &ts) < 0 && errno == EINTR && !terminate_requested) {}
+}
+
+std::string
+system_path(const std::string &path)
+{
+    std::string root = std::getenv("BEEKEEPER_SYSROOT") ? std::getenv("BEEKEEPER_SYSROOT") : "";
+    while (!root.empty() && root.back() == '/')
+        root.pop_back();
+    return root + path;
+}
+
+bool
+make_dirs(const std::string &path)
+{
+    for (size_t pos = 1; pos != std::string::npos; ) {
+        pos = path.find('/', pos + 1);
+        std::string prefix = path.substr(0, pos);
+        if (mkdir(prefix.c_str(), 0755) < 0 && errno != EEXIST)
+            return false;
+    }
+    return true;
+}
+
+bool
+is_directory(const std::string &path)
+{
+    struct stat st {};
+    return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+std::string
+base_name(const char *path)
+{
+    const char *slash = std::strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+// bees' getopt_long table: options that take a value, and flags
+bool
+takes_value(const std::string &name)
+{
+    for (const char *o : { "thread-count", "thread-factor", "loadavg-target", "throttle-factor",
+                           "scan-mode", "verbose", "c", "C", "g", "G", "m", "v" })
+        if (name == o) return true;
+    return false;
+}
+
+bool
+is_flag(const std::string &name)
+{
+    for (const char *o : { "timestamps", "no-timestamps", "absolute-paths", "strip-paths",
+                           "workaround-btrfs-send", "help", "t", "T", "p", "P", "a", "h" })
+        if (name == o) return true;
+    return false;
+}
+
+// Split argv like bees does. Returns false, having said why, on a bad option.
+bool
+parse_options(const char *self, int argc, char **argv, std::vector<std::string> &options,
+              std::vector<std::string> &positional, int &thread_count)
+{
+    bool only_positional = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (only_positional || arg.size() < 2 || arg[0] != '-') {
+            positional.push_back(arg);
+            continue;
+        }
+        if (arg == "--") {
+            only_positional = true;
+            continue;
+        }
+
+        bool is_long = arg.rfind("--", 0) == 0;
+        std::string name = is_long ? arg.substr(2) : arg.substr(1, 1);
+        std::string value;
+        bool has_value = false;
+
+        if (auto eq = name.find('='); is_long && eq != std::string::npos) {
+            value = name.substr(eq + 1);
+            name = name.substr(0, eq);
+            has_value = true;
+        } else if (!is_long && arg.size() > 2) {
+            value = arg.substr(2);
+            has_value = true;
+        }
+
+        if (takes_value(name)) {
+            if (!has_value) {
+                if (i + 1 >= argc) {
+                    std::cerr << self << ": option '" << arg << "' requires an argument\n";
+                    return false;
+                }
+                value = argv[++i];
+            }
+            if (name == "thread-count" || name == "c")
+                thread_count = std::max(1, std::atoi(value.c_str()));
+            options.push_back(is_long ? "--" + name + "=" + value : "-" + name + value);
+        } else if (is_flag(name) && !(is_long && has_value)) {
+            options.push_back(arg);
+        } else {
+            std::cerr << self << ": unrecognized option '" << arg << "'\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+// The BEESSTATUS layout beekeeper's metrics parser reads
+std::string
+status_text(double elapsed_s, int threads)
+{
+    const double rate = static_cast<double>(env_ms("FAKE_BEES_SCAN_RATE", 64L << 20));
+    const double scanned = rate * elapsed_s;
+    const double deduped = scanned / 8;
+    const double extents = scanned / (128 << 10);
+
+    std::ostringstream out;
+    out.setf(std::ios::fixed);
+    out.precision(0);
+    out << "TOTAL:\n"
+        << "\taddr_block=" << scanned / 4096 << " dedup_bytes=" << deduped << " dedup_copy=" << deduped / 16
+        << " hash_insert=" << extents * 4 << " hash_erase=" << extents / 8 << " hash_evict=" << extents / 16
+        << " scan_extent=" << extents << " scan_bytes=" << scanned << "\n"
+        << "RATES:\n"
+        << "\tdedup_bytes=" << rate / 8 << " scan_bytes=" << rate << " scan_extent=" << rate / (128 << 10) << "\n"
+        << "THREADS (work queue " << threads * 3 << " tasks, " << threads << " workers):\n";
+    for (int i = 0; i < threads; ++i)
+        out << "\ttid " << getpid() + i << ": crawl_" << 256 + i << ": extent " << 4096 * i << "\n";
+
+    // One cycle every hour of synthetic scanning
+    long point = static_cast<long>(std::fmod(elapsed_s / 3600.0, 1.0) * 1000000);
+    char row[128];
+    out << "PROGRESS:\n"
+        << "extsz datasz  point gen_min gen_max this cycle start tm_left   next cycle ETA\n"
+        << "----- ------ ------ ------- ------- ---------------- ------- ----------------\n";
+    for (const char *size : { "max", "32M", "8M", "2M", "512K", "128K" }) {
+        std::snprintf(row, sizeof(row), "%5s %5.3fG %06ld       0       1 2024-01-01 00:00      1h 2024-01-01 01:00\n",
+                      size, scanned / (1 << 30) / 6, point);
+        out << row;
+    }
+    out << "total " << scanned / (1 << 30) << "G       gen_now       1\n";
+    return out.str();
+}
+
+bool
+write_status(const std::string &path, const std::string &text)
+{
+    // Whole files only: bees renames a finished one into place too
+    const std::string tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        if (!(out << text))
+            return false;
+    }
+    return std::rename(tmp.c_str(), path.c_str()) == 0;
+}
+
+int
+run_worker(const char *self, int argc, char **argv)
+{
+    std::vector<std::string> options, positional;
+    int threads = 1;
+    if (!parse_options(self, argc, argv, options, positional, threads))
+        return 1;
+
+    if (positional.size() != 1) {
+        std::cerr << "Usage: " << self << " [options] fs-root-path\n";
+        return 1;
+    }
+    const std::string root = positional[0];
+
+    sleep_ms(env_ms("FAKE_BEES_START_DELAY_MS", 0));
+
+    const long crash_after = env_ms("FAKE_BEES_CRASH_AFTER_MS", -1);
+    if (crash_after == 0) {
+        std::cerr << "bees: simulated failure at startup\n";
+        return 1;
+    }
+
+    if (!is_directory(root)) {
+        std::cerr << "bees: open " << root << ": " << std::strerror(ENOENT) << "\n";
+        return 1;
+    }
+
+    std::cout << "bees version fake-bees\n"
+              << "bees[" << getpid() << "]: root path " << root << ", " << threads << " threads\n"
+              << std::flush;
+
+    const char *status_env = std::getenv("BEESSTATUS");
+    const std::string status_path = status_env ? status_env : "";
+    const long interval = std::max(10L, env_ms("FAKE_BEES_STATUS_INTERVAL_MS", 1000));
+    const bool ignore_term = std::getenv("FAKE_BEES_IGNORE_TERM") && *std::getenv("FAKE_BEES_IGNORE_TERM");
+
+    if (ignore_term)
+        signal(SIGTERM, SIG_IGN);
+
+    const double started = now_ms();
+    double next_status = started;
+    for (;;) {
+        const double now = now_ms();
+
+        if (crash_after > 0 && now - started >= crash_after) {
+            std::cerr << "bees: simulated crash\n" << std::flush;
+            rlimit no_core { 0, 0 };
+            setrlimit(RLIMIT_CORE, &no_core);
+            std::abort();
+        }
+
+        if (terminate_requested) {
+            std::cout << "bees: exiting on signal\n" << std::flush;
+            sleep_ms(env_ms("FAKE_BEES_TERM_DELAY_MS", 0));
+            return 0;
+        }
+
+        if (!status_path.empty() && now >= next_status) {
+            write_status(status_path, status_text((now - started) / 1e3, threads));
+            next_status = now + interval;
+        }
+
+        sleep_ms(std::min<long>(50, interval));
+    }
+}
+
+// What the beesd script does, minus the real mount
+int
+run_beesd(const char *self, int argc, char **argv)
+{
+    std::vector<std::string> options, positional;
+    int threads = 1;
+    if (!parse_options(self, argc, argv, options, positional, threads))
+        return 1;
+
+    if (positional.size() != 1) {
+        std::cerr << "Usage: " << self << " [options] <btrfs_uuid>\n";
+        return 1;
+    }
+    const std::string uuid = positional[0];
+
+    // beesd refuses filesystems without a config naming their UUID
+    bool configured = false;
+    const std::string conf_dir = system_path("/etc/bees");
+    if (DIR *dir = opendir(conf_dir.c_str())) {
+        while (dirent *entry = readdir(dir)) {
+            std::string name = entry->d_name;
+            if (name.size() < 5 || name.compare(name.size() - 5, 5, ".conf") != 0)
+                continue;
+            std::ifstream in(conf_dir + "/" + name);
+            for (std::string line; !configured && std::getline(in, line); )
+                configured = line.find("UUID=" + uuid) != std::string::npos;
+        }
+        closedir(dir);
+    }
+    if (!configured) {
+        std::cerr << "beesd: no configuration found for " << uuid << " in " << conf_dir << "\n";
+        return 1;
+    }
+
+    const std::string mount_dir = system_path("/run/bees/mnt/" + uuid);
+    if (!make_dirs(mount_dir)) {
+        std::cerr << "beesd: cannot create " << mount_dir << ": " << std::strerror(errno) << "\n";
+        return 1;
+    }
+    setenv("BEESSTATUS", system_path("/run/bees/" + uuid + ".status").c_str(), 0);
+    setenv("BEESHOME", (mount_dir + "/.beeshome").c_str(), 0);
+
+    // Re-execute ourselves under the worker's name
+    char exe[4096];
+    ssize_t len = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+    if (len <= 0) {
+        std::cerr << "beesd: cannot find the bees binary\n";
+        return 1;
+    }
+    exe[len] = '\0';
+
+    std::vector<std::string> worker_args { exe };
+    worker_args.insert(worker_args.end(), options.begin(), options.end());
+    worker_args.push_back(mount_dir);
+    std::vector<char *> worker_argv;
+    for (auto &arg : worker_args) worker_argv.push_back(arg.data());
+    worker_argv.push_back(nullptr);
+
+    pid_t worker = fork();
+    if (worker < 0) {
+        std::cerr << "beesd: fork: " << std::strerror(errno) << "\n";
+        return 1;
+    }
+    if (worker == 0) {
+        signal(SIGTERM, SIG_DFL);
+        execv(exe, worker_argv.data());
+        _exit(127);
+    }
+
+    forward_to = worker;
+    int status = 0;
+    while (waitpid(worker, &status, 0) < 0 && errno == EINTR) {}
+
+    rmdir(mount_dir.c_str());
+    if (WIFSIGNALED(status))
+        return 128 + WTERMSIG(status);
+    return WEXITSTATUS(status);
+}
+
+void
+on_terminate(int sig)
+{
+    terminate_requested = 1;
+    if (forward_to > 0)
+        kill(forward_to, sig);
+}
+
+} // anonymous namespace
+
+int
+main(int argc, char **argv)
+{
+    struct sigaction action {};
+    action.sa_handler = on_terminate;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGTERM, &action, nullptr);
+    sigaction(SIGINT, &action, nullptr);
+
+    const std::string name = base_name(argv[0]);
+    const bool as_beesd = name.size() >= 5 && name.compare(name.size() - 5, 5, "beesd") == 0;
+
+    return as_beesd ? run_beesd(argv[0], argc, argv) : run_worker(argv[0], argc, argv);
+}
@@ -0,0 +1,78 @@
+// Round trip of the incompressible undo log: apply() sets btrfs.compression
+// on two fresh directories, undo() must clear both and drop the log.
+//
+// Usage: incompressibleundo <directory on btrfs>
+// Needs to own the directory (or CAP_FOWNER); writes its undo log under
+// $BEEKEEPER_SYSROOT when that is set, like the helper does.
+#include "beekeeper/incompressiblemgmt.hpp"
+#include "beekeeper/util.hpp"
+#include "testcheck.hpp"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <sys/xattr.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+namespace inc = beekeeper::management::incompressible;
+
+static std::string
+property_of(const std::string &path)
+{
+    char value[32] = {};
+    ssize_t n = getxattr(path.c_str(), "btrfs.compression", value, sizeof(value) - 1);
+    return n > 0 ? std::string(value, static_cast<size_t>(n)) : std::string();
+}
+
+int
+main(int argc, char *argv[])
+{
+    if (argc != 2) {
+        std::cerr << "Usage: " << argv[0] << " <directory on btrfs>\n";
+        return 1;
+    }
+
+    std::string scratch_template = std::string(argv[1]) + "/.beekeeper-undo-XXXXXX";
+    if (!mkdtemp(scratch_template.data())) {
+        std::cerr << "Cannot create a scratch directory in " << argv[1] << std::endl;
+        return 1;
+    }
+    const fs::path scratch = scratch_template;
+    const std::string uuid = "undo-test-" + std::to_string(getpid());
+
+    inc::report r;
+    r.available = true;
+    for (const char *name : {"media", "archives"}) {
+        fs::create_directory(scratch / name);
+        inc::directory d;
+        d.path = (scratch / name).string();
+        d.incompressible = true;
+        r.directories.push_back(d);
+    }
+
+    // Only btrfs knows the property; anything else rejects it
+    if (setxattr(scratch.c_str(), "btrfs.compression", "none", 4, 0) < 0) {
+        std::cout << "SKIP " << argv[1] << ": " << strerror(errno) << std::endl;
+        fs::remove_all(scratch);
+        return 0;
+    }
+
+    check(inc::apply(uuid, r) == 2, "apply() sets both directories");
+    for (const auto &d : r.directories)
+        check(property_of(d.path) == "none", "btrfs.compression=none on " + d.path);
+
+    auto logged = inc::changed(uuid);
+    check(logged.size() == 2 && logged[0] == r.directories[0].path && logged[1] == r.directories[1].path,
+          "changed() lists both, oldest first");
+
+    check(inc::undo(uuid) == 2, "undo() reverts both");
+    for (const auto &d : r.directories)
+        check(property_of(d.path).empty(), "no property left on " + d.path);
+    check(inc::changed(uuid).empty(), "undo log dropped");
+
+    fs::remove_all(scratch);
+    return check_status();
+}
@@ -0,0 +1,61 @@
+// Checks of bk_util::line_matcher, which the mount table, blkid and config
+// file lookups go through. Needs no filesystem.
+#include "beekeeper/util.hpp"
+#include "testcheck.hpp"
+
+#include <iostream>
+
+static bool
+matches(const std::vector<std::string> &needles, const std::string &line, bool case_insensitive = false)
+{
+    return bk_util::line_matcher(needles, case_insensitive).matches(line);
+}
+
+int
+main()
+{
+    const std::string blkid = "/dev/sda2: LABEL=\"Malas Decisiones\" UUID=\"22b1-77\" TYPE=\"btrfs\"";
+
+    // Plain needles: a token containing them
+    check(matches({"btrfs"}, blkid), "plain needle inside a quoted value");
+    check(!matches({"ext4"}, blkid), "plain needle absent");
+    check(matches({"BTRFS"}, blkid, true), "plain needle, case-insensitive");
+    check(!matches({"BTRFS"}, blkid), "plain needle, case-sensitive");
+    check(matches({"Malas Decisiones"}, blkid), "needle with a space inside one quoted token");
+    check(!matches({"sda2: LABEL"}, blkid), "needle with a space across two tokens");
+
+    // key=value needles: a whole key=value token, value quotes ignored
+    check(matches({"TYPE=btrfs"}, blkid), "key=value against a double-quoted value");
+    check(matches({"TYPE=\"btrfs\""}, blkid), "quoted key=value needle");
+    check(matches({"LABEL=Malas Decisiones"}, blkid), "key=value with a space in the value");
+    check(!matches({"TYPE=btr"}, blkid), "key=value is not a prefix match");
+    check(!matches({"YPE=btrfs"}, blkid), "key=value is not a suffix match on the key");
+    check(matches({"type=BTRFS"}, blkid, true), "key=value, case-insensitive");
+    check(!matches({"type=btrfs"}, blkid), "key=value, case-sensitive key");
+    check(matches({"OPTIONS=-c 4"}, "OPTIONS='-c 4'"), "key=value against a single-quoted value");
+
+    // Any needle is enough; empty needles never match
+    check(matches({"ext4", "UUID=22b1-77"}, blkid), "second needle matches");
+    check(!matches({""}, blkid), "empty needle");
+    check(!matches({"btrfs"}, ""), "empty line");
+
+    // Whole buffers: trimmed lines, as views into the buffer, up to a limit
+    const std::string mounts =
+        "  /dev/sda2 /mnt btrfs rw 0 0\n"
+        "/dev/sdb1 /boot ext4 rw 0 0\n"
+        "\n"
+        "/dev/sda2 /home btrfs rw 0 0   \n";
+    bk_util::line_matcher btrfs({"btrfs"});
+    auto found = btrfs.matching_lines(mounts);
+    check(found.size() == 2 && found[0] == "/dev/sda2 /mnt btrfs rw 0 0"
+          && found[1] == "/dev/sda2 /home btrfs rw 0 0", "matching_lines trims and skips others");
+    check(!found.empty() && found[0].data() >= mounts.data()
+          && found[0].data() < mounts.data() + mounts.size(), "matching_lines returns views into the buffer");
+    check(btrfs.matching_lines(mounts, 1).size() == 1, "matching_lines stops at the limit");
+
+    auto lines = bk_util::find_lines_matching_substring_in_vector(
+        std::vector<std::string> { "a=1 b=2", "a=2", "c=1" }, std::vector<std::string> { "a=2", "c=1" });
+    check(lines.size() == 2 && lines[0] == "a=2" && lines[1] == "c=1", "find_lines_matching_substring_in_vector");
+
+    return check_status();
+}
@@ -0,0 +1,88 @@
+// Checks of the schedule window syntax and of which window is active when,
+// across midnight and a DST change. Needs no filesystem; runs in
+// Europe/Berlin time.
+#include "beekeeper/schedulemgmt.hpp"
+#include "testcheck.hpp"
+
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+
+namespace sched = beekeeper::management::schedule;
+
+// Local time in the test's zone
+static std::time_t
+at(int year, int month, int day, int hour, int minute)
+{
+    std::tm tm {};
+    tm.tm_year = year - 1900;
+    tm.tm_mon = month - 1;
+    tm.tm_mday = day;
+    tm.tm_hour = hour;
+    tm.tm_min = minute;
+    tm.tm_isdst = -1;
+    return std::mktime(&tm);
+}
+
+static void
+test_windows()
+{
+    sched::window w;
+    check(sched::parse_window("22:00-06:00", w) && w.days_mask == 0x7f
+          && w.start_minute == 22 * 60 && w.end_minute == 6 * 60, "every day, wrapping past midnight");
+    check(sched::parse_window("Mon-Wed@1:00-5:00,threads=2,weight=500", w)
+          && w.days_mask == 0x07 && w.threads == 2 && w.weight == 500, "day range and attributes");
+    check(sched::format_window(w) == "mon,tue,wed@01:00-05:00,threads=2,weight=500", "normalized form");
+    check(sched::parse_window("fri-mon@00:00-24:00", w) && w.days_mask == (0x10 | 0x20 | 0x40 | 0x01)
+          && w.end_minute == 1440, "day range wrapping the week, 24:00 end");
+    check(sched::parse_window("sat,sun@08:30-09:15", w) && w.days_mask == 0x60, "day list");
+
+    for (const char *bad : { "", "22:00", "25:00-01:00", "24:00-01:00", "10:60-11:00", "xyz@01:00-02:00",
+                             "01:00-02:00,threads=0", "01:00-02:00,weight=20000", "01:00-02:00,color=red" }) {
+        check(!sched::parse_window(bad, w), std::string("rejects '") + bad + "'");
+    }
+}
+
+static void
+test_plans()
+{
+    const std::string uuid = "0b6d1e3c-8f2a-4c5e-9a7b-1d2e3f4a5b6c";
+
+    auto p = sched::parse_plan(uuid + " idle=pause mon-fri@22:00-06:00,weight=1000 bogus sat,sun@00:00-24:00");
+    check(p && p->pause_when_idle && p->windows.size() == 2, "plan: idle=pause, malformed window skipped");
+    check(!sched::parse_plan("not-a-uuid 01:00-02:00"), "plan: bad uuid");
+    check(!sched::parse_plan(uuid + " idle=stop"), "plan: no window");
+}
+
+static void
+test_active_windows()
+{
+    // 2026-03-27 is a Friday; Berlin moves to summer time on Sunday the 29th
+    sched::plan p;
+    sched::window nights, weekend;
+    sched::parse_window("mon-fri@22:00-06:00", nights);
+    sched::parse_window("sun@01:00-05:00", weekend);
+    p.windows = { nights, weekend };
+
+    check(sched::active_window(p, at(2026, 3, 27, 23, 0)) == 0, "Friday night");
+    check(sched::active_window(p, at(2026, 3, 28, 5, 59)) == 0, "Saturday morning: tail of Friday's window");
+    check(sched::active_window(p, at(2026, 3, 28, 22, 0)) == -1, "Saturday night: no window");
+    check(sched::active_window(p, at(2026, 3, 27, 12, 0)) == -1, "Friday noon");
+
+    // 02:00-03:00 does not exist that night: 01:00 CET is followed by 03:00 CEST
+    check(sched::next_transition(p, at(2026, 3, 28, 12, 0)) == at(2026, 3, 29, 1, 0), "next start: Sunday 01:00");
+    check(sched::next_transition(p, at(2026, 3, 29, 1, 30)) == at(2026, 3, 29, 5, 0), "end on the short day: 05:00 CEST");
+    check(at(2026, 3, 29, 5, 0) - at(2026, 3, 29, 1, 0) == 3 * 3600, "the short window lasts three hours");
+}
+
+int
+main()
+{
+    setenv("TZ", "Europe/Berlin", 1);
+    tzset();
+
+    test_windows();
+    test_plans();
+    test_active_windows();
+    return check_status();
+}
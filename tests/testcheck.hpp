@@ -0,0 +1,21 @@
+#pragma once
+
+// PASS/FAIL reporting for the checking drivers in tests/. Each check()
+// prints one line; main() returns check_status() as the exit code.
+#include <iostream>
+#include <string>
+
+inline int check_failures = 0;
+
+inline void
+check(bool ok, const std::string &what)
+{
+    std::cout << (ok ? "PASS " : "FAIL ") << what << std::endl;
+    if (!ok) ++check_failures;
+}
+
+inline int
+check_status()
+{
+    return check_failures ? 1 : 0;
+}
@@ -0,0 +1,81 @@
+// text_buffer::tokenize against bk_util::tokenize: hand-picked lines, then
+// random strings of quotes, backslashes, '=' and delimiters, which must
+// split identically.
+//
+// Usage: texttokenize [count [seed]]   (defaults: 400000 strings, seed 1)
+#include "beekeeper/util.hpp"
+#include "testcheck.hpp"
+
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <sstream>
+
+static bool
+same_tokens(bk_util::text_buffer &buffer, const std::string &line, char split_char)
+{
+    const std::vector<std::string> expected = bk_util::tokenize(line, split_char);
+    const auto &got = buffer.tokenize(line, split_char);
+
+    if (got.size() != expected.size())
+        return false;
+    for (size_t i = 0; i < got.size(); ++i)
+        if (got[i] != expected[i])
+            return false;
+    return true;
+}
+
+int
+main(int argc, char *argv[])
+{
+    const unsigned long count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 400000;
+    const unsigned long seed = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 1;
+
+    bk_util::text_buffer buffer;
+
+    for (const std::string &line : {
+             std::string("/dev/sda2: LABEL=\"Malas Decisiones\" UUID=\"22b1\" TYPE=\"btrfs\""),
+             std::string("OPTIONS='--thread-count 4 --scan-mode 3'"),
+             std::string("  leading   and  repeated   spaces  "),
+             std::string("'single quoted' \"double quoted\" mixed\"inner\"quotes"),
+             std::string("escaped \\\"quote\\\" and \\\\\"backslashes"),
+             std::string("unclosed \"quote runs to the end"),
+             std::string("KEY=\"value with spaces\"tail next"),
+             std::string(""),
+         }) {
+        check(same_tokens(buffer, line, ' '), "split '" + line + "'");
+    }
+
+    // Unclosed quotes make bk_util::tokenize warn on stderr; keep it quiet
+    std::ostringstream sink;
+    std::streambuf *stderr_buf = std::cerr.rdbuf(sink.rdbuf());
+
+    const char alphabet[] = { 'a', 'b', '=', '"', '\'', '\\', ' ', ' ', ',', '\t' };
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<size_t> pick(0, sizeof(alphabet) - 1);
+    std::uniform_int_distribution<size_t> length(0, 24);
+
+    unsigned long mismatches = 0;
+    std::string first_mismatch;
+    std::string line;
+    for (unsigned long n = 0; n < count; ++n) {
+        line.clear();
+        for (size_t i = length(rng); i > 0; --i)
+            line += alphabet[pick(rng)];
+
+        const char split_char = (n & 1) ? ',' : ' ';
+        if (!same_tokens(buffer, line, split_char) && mismatches++ == 0)
+            first_mismatch = line + "' split at '" + split_char;
+
+        // Exercise the arena's reuse as load()/assign() would
+        if ((n & 1023) == 0)
+            buffer.clear_tokens();
+    }
+
+    std::cerr.rdbuf(stderr_buf);
+
+    check(mismatches == 0, std::to_string(count) + " random strings (seed " + std::to_string(seed) + ")"
+          + (mismatches ? ", first mismatch: '" + first_mismatch + "'" : std::string()));
+
+    return check_status();
+}